@@ -1,535 +1,10644 @@
+/* clock_gettime e demais interfaces POSIX */
+#define _POSIX_C_SOURCE 200809L
+/* SO_REUSEPORT e afins (servidor de partidas) */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DQ_POSIX 1
+#include <fcntl.h>
+#include <pthread.h>            /* sessões em paralelo: compilar com -pthread */
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/* servidor de partidas: laço de eventos com epoll (ver servidorJogo) */
+#if defined(__linux__)
+#define DQ_EPOLL 1
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#endif
+
+/* núcleos SIMD de texto (ver nucleosTexto) */
+#if defined(__x86_64__) || defined(_M_X64)
+#define DQ_X86 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define DQ_AVX2 1               /* compilado com target("avx2"), usado se a CPU tiver */
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__)
+#define DQ_NEON 1
+#include <arm_neon.h>
+#endif
 
 /* ===========================
    Tipos e estruturas
    =========================== */
 
+/* Bloco de memória de uma arena (os dados vêm logo após o cabeçalho) */
+typedef struct ArenaBloco {
+    struct ArenaBloco *prox;   /* bloco anterior (lista encadeada) */
+    size_t cap;                /* bytes disponíveis em 'dados' */
+    size_t usado;              /* bytes já entregues */
+    max_align_t dados[];       /* área de alocação (alinhada) */
+} ArenaBloco;
+
+/* Arena (alocador por região): tudo é liberado de uma vez em arena_liberar */
+typedef struct Arena {
+    ArenaBloco *atual;         /* bloco onde a próxima alocação é feita */
+    size_t tam_bloco;          /* tamanho padrão de cada novo bloco */
+    size_t n_alocacoes;        /* pedidos atendidos (arena_alloc) */
+    size_t n_blocos;           /* blocos obtidos com malloc */
+    size_t bytes_usados;       /* bytes entregues aos pedidos */
+    size_t bytes_reservados;   /* bytes obtidos com malloc */
+} Arena;
+
+/* Contadores das alocações feitas diretamente no heap */
+typedef struct MemStats {
+    size_t n_alocacoes;
+    size_t n_liberacoes;
+    size_t bytes;              /* total pedido (acumulado) */
+} MemStats;
+
+/* Destino de uma Saida */
+typedef enum SaidaDestino {
+    SAIDA_DESCRITOR,           /* write(2) direto no descritor (POSIX) */
+    SAIDA_ARQUIVO,             /* fwrite num FILE* */
+    SAIDA_MEMORIA              /* só acumula no buffer (ex.: testes) */
+} SaidaDestino;
+
+/* Saída com buffer próprio: o texto do jogo passa todo por aqui */
+typedef struct Saida {
+    SaidaDestino destino;
+    int fd;                    /* SAIDA_DESCRITOR */
+    FILE *f;                   /* SAIDA_ARQUIVO */
+    char *buf;
+    size_t len, cap;
+    size_t bytes;              /* total já entregue ao destino */
+    int erro;                  /* 1 = alguma escrita falhou */
+} Saida;
+
+/* String internada: cabeçalho guardado logo antes dos caracteres */
+typedef struct StrInterna {
+    uint32_t id;        /* identificador estável (ordem de internação) */
+    uint32_t hash;      /* hash da string (calculado uma única vez) */
+    uint32_t len;       /* comprimento sem o '\0' */
+    char s[];           /* caracteres (terminados em '\0') */
+} StrInterna;
+
+/* Função de hash plugável: bytes + semente -> 64 bits */
+typedef uint64_t (*FuncHash)(const void *dados, size_t len, uint64_t semente);
+
+/* Tabela de internação: cada string distinta existe uma única vez */
+typedef struct Interner {
+    Arena *arena;           /* dona de todas as StrInterna */
+    uint64_t semente;       /* semente aleatória do hash */
+    StrInterna **slots;     /* índice por endereçamento aberto (potência de 2) */
+    size_t cap;             /* número de slots */
+    StrInterna **por_id;    /* id -> string */
+    size_t n;               /* strings distintas */
+    size_t cap_ids;
+} Interner;
+
 /* Nó da árvore da mansão (cômodo) */
 typedef struct Sala {
-    char *nome;         /* nome do cômodo */
-    char *pista;        /* pista associada (NULL se não houver) */
+    const char *nome;   /* nome do cômodo (string internada) */
+    const char *pista;  /* pista associada (internada; NULL se não houver) */
     struct Sala *esq;   /* filho à esquerda */
     struct Sala *dir;   /* filho à direita */
 } Sala;
 
-/* Nó da BST para armazenar pistas coletadas (ordenadas) */
+/* Cômodo no layout plano: índices de 32 bits e offsets no pool de strings */
+typedef struct SalaPlana {
+    uint32_t nome;      /* offset do nome em MapaPlano.pool */
+    uint32_t pista;     /* offset da pista (SALA_SEM_PISTA se não houver) */
+    uint32_t esq;       /* índice do filho à esquerda (SALA_NENHUMA se não houver) */
+    uint32_t dir;       /* índice do filho à direita (SALA_NENHUMA se não houver) */
+} SalaPlana;
+
+/* Mansão em vetor único (ordem em largura: filhos próximos dos pais;
+   numa árvore completa é exatamente o layout de Eytzinger 2i+1 / 2i+2).
+   As mansões de gerarMansao vêm em pré-ordem: esquerdo logo após o pai. */
+typedef struct MapaPlano {
+    SalaPlana *salas;   /* salas[0] é a raiz */
+    uint32_t n;         /* número de salas */
+    char *pool;         /* strings terminadas em '\0', cada uma uma única vez */
+    size_t pool_len;
+} MapaPlano;
+
+/* Nó de um mapa genérico (0 = nenhum): Sala* ou índice + 1, conforme o mapa */
+typedef uint64_t NoMapa;
+
+/* Operações de navegação: a exploração funciona sobre qualquer representação.
+   Os textos de nome/pista não são do chamador e valem por tempo limitado:
+   até liberar o mapa (árvore, plano, arquivo mapeado), até a próxima sala
+   carregada (sob demanda; ver MapaSob) ou, no compacto, a pista até liberar
+   o mapa e o nome até mais 4 chamadas de 'nome' na mesma thread (anel de
+   nomes remontados). Quem guarda um texto por mais tempo copia ou interna. */
+typedef struct MapaOps {
+    NoMapa (*raiz)(void *dados);
+    const char *(*nome)(void *dados, NoMapa no);
+    const char *(*pista)(void *dados, NoMapa no);   /* NULL se não houver */
+    NoMapa (*esq)(void *dados, NoMapa no);
+    NoMapa (*dir)(void *dados, NoMapa no);
+} MapaOps;
+
+/* Mapa = representação + operações */
+typedef struct Mapa {
+    const MapaOps *ops;
+    void *dados;
+} Mapa;
+
+/* Nó da BST (AVL) para armazenar pistas coletadas (ordenadas) */
 typedef struct PistaNode {
-    char *pista;
+    const char *pista;  /* string internada */
     struct PistaNode *esq;
     struct PistaNode *dir;
+    int altura;         /* altura da subárvore (folha = 1) */
 } PistaNode;
 
 /* Entrada na tabela hash: chave = pista, valor = suspeito */
 typedef struct HashEntry {
-    char *chave;               /* a pista */
-    char *suspeito;            /* suspeito associado */
+    const char *chave;         /* a pista (internada) */
+    const char *suspeito;      /* suspeito associado (internado) */
     struct HashEntry *prox;    /* lista encadeada para colisões */
+    uint32_t hash;             /* hash da chave (filtra colisões sem strcmp) */
 } HashEntry;
 
+/* Slot da tabela de endereçamento aberto (Robin Hood) */
+typedef struct HashSlot {
+    const char *chave;         /* pista internada (NULL = slot vazio) */
+    const char *suspeito;      /* suspeito internado */
+    uint32_t hash;             /* hash da chave (evita reler a string ao crescer) */
+    uint32_t dist;             /* distância do slot ideal */
+} HashSlot;
+
+/* Slot da hash gravada no arquivo de caso (offsets no pool do arquivo) */
+typedef struct CasoSlot {
+    uint32_t chave;            /* offset da pista (CASO_SLOT_VAZIO = vazio) */
+    uint32_t suspeito;         /* offset do suspeito */
+    uint32_t hash;             /* hash_wy(pista, semente do arquivo) */
+    uint32_t dist;             /* distância do slot ideal (Robin Hood) */
+} CasoSlot;
+
+/* Organização interna da tabela hash */
+typedef enum HashModo {
+    HASH_ENCADEADA = 0,        /* baldes fixos com listas (criarHash) */
+    HASH_ABERTA,               /* endereçamento aberto que cresce (criarHashAberta) */
+    HASH_MAPEADA,              /* somente leitura, direto das páginas do arquivo */
+    HASH_CONCORRENTE,          /* leitores sem travas, escritas publicadas (criarHashConcorrente) */
+    HASH_PERFEITA              /* somente leitura, uma sondagem por busca (congelarHash) */
+} HashModo;
+
+/* Parâmetros de criação da tabela (criarHashConfig) */
+typedef struct HashConfig {
+    HashModo modo;
+    size_t tamanho;     /* baldes (encadeada) ou capacidade inicial (aberta) */
+    FuncHash fn;        /* NULL = hash_wy */
+    uint64_t semente;   /* 0 = semente aleatória por tabela */
+    int modulo;         /* encadeada: 1 = manter 'tamanho' exato e usar %,
+                           0 = arredondar para potência de 2 e usar máscara */
+    Arena *arena;       /* dona das entradas encadeadas (NULL = heap) */
+} HashConfig;
+
+/* Suspeitos distintos de uma tabela, na ordem da primeira associação.
+   Mantido a cada inserção: listar e contar não precisam varrer a tabela. */
+typedef struct SuspeitoSet {
+    const char **nomes;        /* posição -> suspeito */
+    uint32_t *refs;            /* associações que apontam para cada posição */
+    uint32_t *idx;             /* endereçamento aberto: posição + 1 (0 = vazio) */
+    size_t n;                  /* posições usadas */
+    size_t cap_idx;            /* slots de idx (potência de 2, carga <= 1/2) */
+    size_t vivos;              /* posições com refs > 0 */
+} SuspeitoSet;
+
+/* Índice dos suspeitos por nome normalizado (sem caixa e sem acentos) */
+typedef struct IndiceNomes {
+    char *chaves;              /* chaves normalizadas, cada uma terminada em '\0' */
+    uint32_t *off;             /* posição do suspeito -> offset da chave */
+    uint32_t *ordem;           /* posições em ordem alfabética da chave */
+    uint32_t *slots;           /* hash da chave -> índice em 'ordem' + 1 (0 = vazio) */
+    size_t n;                  /* suspeitos indexados */
+    size_t cap_slots;          /* potência de 2 */
+    uint64_t semente;
+} IndiceNomes;
+
 /* Tabela hash */
 typedef struct HashTable {
-    HashEntry **buckets;
-    size_t tamanho; /* número de baldes (buckets) */
+    HashModo modo;
+    HashEntry **buckets;       /* HASH_ENCADEADA */
+    HashSlot *slots;           /* HASH_ABERTA (tamanho é potência de 2) */
+    size_t tamanho; /* número de baldes (buckets) ou slots */
+    size_t mascara; /* tamanho - 1 quando potência de 2; 0 = usar % tamanho */
+    size_t n;       /* associações armazenadas */
+    FuncHash fn;    /* função de hash da tabela */
+    uint64_t semente;
+    Arena *arena;   /* dona das entradas encadeadas (NULL = heap) */
+    const CasoSlot *mslots;    /* HASH_MAPEADA / HASH_PERFEITA: slots no arquivo (ou no bloco) */
+    const char *mpool;         /* HASH_MAPEADA / HASH_PERFEITA: pool de strings */
+    size_t mpool_len;          /* HASH_PERFEITA: bytes do pool (limite do memcmp) */
+    const uint32_t *desloc;    /* HASH_PERFEITA: deslocamento de cada balde */
+    size_t n_baldes;
+    void *congelado;           /* HASH_PERFEITA feita por congelarHash: slots, desloc e pool */
+    SuspeitoSet sus;           /* suspeitos distintos (ver hashSuspeitos) */
+    int sus_pronto;            /* HASH_MAPEADA / HASH_PERFEITA: 'sus' já montado */
+    IndiceNomes *nomes;        /* índice por nome (ver hashIndiceNomes) */
+    struct HashConc *conc;     /* HASH_CONCORRENTE */
 } HashTable;
 
-/* Lista simples para contar pistas por suspeito durante verificação */
-typedef struct SuspeitoConta {
-    char *nome;
-    int cont;
-    struct SuspeitoConta *prox;
-} SuspeitoConta;
 
 /* ===========================
-   Helpers para strings / memória
+   Instrumentação (DQ_INSTRUMENTAR)
    =========================== */
 
-/* duplicador de string (substitui strdup para portabilidade) */
-static char *my_strdup(const char *s) {
-    if (!s) return NULL;
-    size_t n = strlen(s) + 1;
-    char *c = malloc(n);
-    if (!c) return NULL;
-    memcpy(c, s, n);
-    return c;
+/*
+ * Contadores dos caminhos quentes, compilados só com -DDQ_INSTRUMENTAR: sem
+ * a macro, INSTR_* somem e o binário não muda. Cada thread soma na própria
+ * linha de cache (sem RMW atômico nem falso compartilhamento); o relatório
+ * soma as threads (os *_max pegam o maior). Saída em JSON ou no texto do
+ * Prometheus, no fim da execução ou em SIGUSR1 (instrSinal).
+ */
+typedef enum Contador {
+    CONT_HASH_BUSCAS,          /* encontrarSuspeito */
+    CONT_HASH_SONDAS,          /* slots / entradas da cadeia examinados */
+    CONT_HASH_SONDAS_MAX,      /* maior sondagem (ou cadeia) de uma busca */
+    CONT_BST_INSERCOES,        /* inserções na BST de pistas (novas ou não) */
+    CONT_BST_COMPARACOES,      /* comparações de texto na descida */
+    CONT_BST_PROFUNDIDADE_MAX, /* nível mais fundo alcançado */
+    CONT_ALOCACOES,            /* mem_alloc / mem_calloc */
+    CONT_BYTES_ALOCADOS,
+    CONT_ARENA_ALOCACOES,      /* arena_alloc */
+    CONT_NS_EXPLORACAO,        /* tempo por fase, em ns */
+    CONT_NS_VEREDITO,
+    CONT_NS_LIBERACAO,
+    N_CONTADORES
+} Contador;
+
+#ifdef DQ_INSTRUMENTAR
+#define INSTR_MAX_THREADS 256  /* threads além disso dividem a última linha (atômica) */
+
+typedef struct ContadoresThread {
+    _Alignas(64) _Atomic uint64_t v[N_CONTADORES];
+} ContadoresThread;
+
+static ContadoresThread instr_threads[INSTR_MAX_THREADS];
+static atomic_uint instr_n;
+static _Thread_local ContadoresThread *instr_minha = NULL;
+
+static ContadoresThread *instr_slot(void) {
+    if (!instr_minha) {
+        unsigned i = atomic_fetch_add_explicit(&instr_n, 1, memory_order_relaxed);
+        instr_minha = &instr_threads[i < INSTR_MAX_THREADS ? i : INSTR_MAX_THREADS - 1];
+    }
+    return instr_minha;
 }
 
-/* lê linha do stdin e remove newline */
-static void ler_linha(char *buf, size_t tam) {
-    if (!fgets(buf, (int)tam, stdin)) {
-        buf[0] = '\0';
+/* linha de uma thread só: load + store relaxados bastam (leitura do
+   relatório em outra thread vê um valor inteiro, talvez atrasado). As
+   linhas não são recicladas: a última é de todas as threads a partir da
+   INSTR_MAX_THREADS-ésima (suíte de benchmarks, resolvedor, servidor) e
+   nela as atualizações são atômicas de verdade */
+#define INSTR_DIVIDIDA(t) ((t) == &instr_threads[INSTR_MAX_THREADS - 1])
+
+static inline void instr_somar(Contador c, uint64_t v) {
+    ContadoresThread *t = instr_slot();
+    _Atomic uint64_t *x = &t->v[c];
+    if (INSTR_DIVIDIDA(t)) atomic_fetch_add_explicit(x, v, memory_order_relaxed);
+    else atomic_store_explicit(x, atomic_load_explicit(x, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static inline void instr_maximo(Contador c, uint64_t v) {
+    ContadoresThread *t = instr_slot();
+    _Atomic uint64_t *x = &t->v[c];
+    uint64_t atual = atomic_load_explicit(x, memory_order_relaxed);
+    if (!INSTR_DIVIDIDA(t)) {
+        if (v > atual) atomic_store_explicit(x, v, memory_order_relaxed);
         return;
     }
-    size_t len = strlen(buf);
-    if (len > 0 && buf[len - 1] == '\n') buf[len - 1] = '\0';
+    while (v > atual &&
+           !atomic_compare_exchange_weak_explicit(x, &atual, v, memory_order_relaxed, memory_order_relaxed)) {
+    }
 }
 
-/* transforma string para minúsculas (obriga comparar nomes sem diferenciar case) */
-static void str_lower(char *s) {
-    for (size_t i = 0; s[i]; ++i) s[i] = (char)tolower((unsigned char)s[i]);
+static uint64_t instr_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
 }
 
-/* ===========================
-   Funções de Sala (mansão)
-   =========================== */
+#define INSTR_SOMAR(c, v) instr_somar((c), (v))
+#define INSTR_MAXIMO(c, v) instr_maximo((c), (v))
+#define INSTR_FASE(var) uint64_t var = instr_ns()
+#define INSTR_FASE_FIM(var, c) instr_somar((c), instr_ns() - (var))
+#else
+#define INSTR_SOMAR(c, v) ((void)0)
+#define INSTR_MAXIMO(c, v) ((void)0)
+#define INSTR_FASE(var) ((void)0)
+#define INSTR_FASE_FIM(var, c) ((void)0)
+#endif
 
-/**
- * criarSala(nome, pista)
- * Cria dinamicamente um cômodo com nome e pista (pista pode ser NULL).
- * Retorna ponteiro para Sala ou NULL em caso de erro.
- */
-Sala *criarSala(const char *nome, const char *pista) {
-    Sala *s = malloc(sizeof(Sala));
-    if (!s) {
-        fprintf(stderr, "Erro: falha alocação Sala.\n");
-        return NULL;
-    }
-    s->nome = my_strdup(nome ? nome : "");
-    s->pista = (pista && pista[0] != '\0') ? my_strdup(pista) : NULL;
-    s->esq = s->dir = NULL;
-    return s;
+/* uma busca na hash que examinou 'n' posições */
+#define INSTR_SONDAS(n)                          \
+    do {                                         \
+        INSTR_SOMAR(CONT_HASH_BUSCAS, 1);        \
+        INSTR_SOMAR(CONT_HASH_SONDAS, (n));      \
+        INSTR_MAXIMO(CONT_HASH_SONDAS_MAX, (n)); \
+    } while (0)
+
+#ifdef DQ_INSTRUMENTAR
+/* nome no relatório e rótulo da fase (NULL = contador comum) */
+static const struct {
+    const char *nome;
+    const char *fase;
+    int maximo;
+} instr_desc[N_CONTADORES] = {
+    { "hash_buscas", NULL, 0 },
+    { "hash_sondas", NULL, 0 },
+    { "hash_sondas_max", NULL, 1 },
+    { "bst_insercoes", NULL, 0 },
+    { "bst_comparacoes", NULL, 0 },
+    { "bst_profundidade_max", NULL, 1 },
+    { "alocacoes", NULL, 0 },
+    { "bytes_alocados", NULL, 0 },
+    { "arena_alocacoes", NULL, 0 },
+    { "fase_ns", "exploracao", 0 },
+    { "fase_ns", "veredito", 0 },
+    { "fase_ns", "liberacao", 0 },
+};
+
+/* texto acumulado sem stdio nem malloc: vale dentro do tratador de sinal */
+typedef struct InstrTexto {
+    char *buf;
+    size_t n, cap;
+} InstrTexto;
+
+static void instr_por(InstrTexto *t, const char *s) {
+    while (*s && t->n < t->cap) t->buf[t->n++] = *s++;
 }
 
-/* libera memória da árvore de salas */
-void liberarSalas(Sala *raiz) {
-    if (!raiz) return;
-    liberarSalas(raiz->esq);
-    liberarSalas(raiz->dir);
-    free(raiz->nome);
-    if (raiz->pista) free(raiz->pista);
-    free(raiz);
+static void instr_por_uint(InstrTexto *t, uint64_t v) {
+    char d[24];
+    int k = 0;
+    do d[k++] = (char)('0' + v % 10); while ((v /= 10) != 0);
+    while (k > 0 && t->n < t->cap) t->buf[t->n++] = d[--k];
 }
 
-/* ===========================
-   Funções para BST de pistas
-   =========================== */
+/* soma (ou máximo) de um contador sobre as threads */
+static uint64_t instr_total(Contador c) {
+    unsigned n = atomic_load_explicit(&instr_n, memory_order_relaxed);
+    uint64_t r = 0;
+    for (unsigned i = 0; i < n && i < INSTR_MAX_THREADS; ++i) {
+        uint64_t v = atomic_load_explicit(&instr_threads[i].v[c], memory_order_relaxed);
+        r = instr_desc[c].maximo ? (v > r ? v : r) : r + v;
+    }
+    return r;
+}
 
-/* inserirPista(raiz, pista)
- * Insere 'pista' na BST ordenada por strcmp. Evita duplicatas.
- * Retorna a raiz (possivelmente atualizada).
- */
-PistaNode *inserirPista(PistaNode *raiz, const char *pista) {
-    if (!pista || pista[0] == '\0') return raiz;
-    if (raiz == NULL) {
-        PistaNode *n = malloc(sizeof(PistaNode));
-        if (!n) {
-            fprintf(stderr, "Erro: alocação PistaNode.\n");
-            return NULL;
+/* relatório em 'buf'; retorna os bytes escritos (cortado em 'cap') */
+static size_t instr_formatar(char *buf, size_t cap, int prometheus) {
+    InstrTexto t = { buf, 0, cap };
+    if (!prometheus) instr_por(&t, "{\n  \"threads\": ");
+    else instr_por(&t, "# TYPE dq_threads gauge\ndq_threads ");
+    unsigned n = atomic_load_explicit(&instr_n, memory_order_relaxed);
+    instr_por_uint(&t, n < INSTR_MAX_THREADS ? n : INSTR_MAX_THREADS);
+    instr_por(&t, prometheus ? "\n" : ",\n  \"fase_ns\": {");
+    /* JSON: fases primeiro, num objeto; depois os contadores */
+    for (int c = 0; !prometheus && c < N_CONTADORES; ++c) {
+        if (!instr_desc[c].fase) continue;
+        instr_por(&t, c == CONT_NS_EXPLORACAO ? "\"" : ", \"");
+        instr_por(&t, instr_desc[c].fase);
+        instr_por(&t, "\": ");
+        instr_por_uint(&t, instr_total((Contador)c));
+    }
+    for (int c = 0; c < N_CONTADORES; ++c) {
+        if (prometheus) {
+            if (c == 0 || !instr_desc[c].fase || !instr_desc[c - 1].fase) {
+                instr_por(&t, "# TYPE dq_");
+                instr_por(&t, instr_desc[c].nome);
+                instr_por(&t, instr_desc[c].maximo ? " gauge\n" : "_total counter\n");
+            }
+            instr_por(&t, "dq_");
+            instr_por(&t, instr_desc[c].nome);
+            if (!instr_desc[c].maximo) instr_por(&t, "_total");
+            if (instr_desc[c].fase) {
+                instr_por(&t, "{fase=\"");
+                instr_por(&t, instr_desc[c].fase);
+                instr_por(&t, "\"}");
+            }
+            instr_por(&t, " ");
+        } else {
+            if (instr_desc[c].fase) continue;
+            instr_por(&t, c == 0 ? "},\n  \"" : ",\n  \"");
+            instr_por(&t, instr_desc[c].nome);
+            instr_por(&t, "\": ");
         }
-        n->pista = my_strdup(pista);
-        n->esq = n->dir = NULL;
-        return n;
+        instr_por_uint(&t, instr_total((Contador)c));
+        if (prometheus) instr_por(&t, "\n");
     }
-    int cmp = strcmp(pista, raiz->pista);
-    if (cmp == 0) {
-        /* já coletada — não duplicar */
-        return raiz;
-    } else if (cmp < 0) {
-        raiz->esq = inserirPista(raiz->esq, pista);
-    } else {
-        raiz->dir = inserirPista(raiz->dir, pista);
+    if (!prometheus) instr_por(&t, "\n}\n");
+    return t.n;
+}
+
+#ifdef DQ_POSIX
+static volatile sig_atomic_t instr_sinal_prometheus;
+
+static void instr_tratar_sinal(int sig) {
+    static char buf[4096];
+    (void)sig;
+    size_t n = instr_formatar(buf, sizeof(buf), instr_sinal_prometheus);
+    for (size_t e = 0; e < n;) {
+        ssize_t w = write(STDERR_FILENO, buf + e, n - e);
+        if (w <= 0) break;
+        e += (size_t)w;
     }
-    return raiz;
 }
+#endif
+#endif
 
-/* exibirPistas: percorre em ordem e imprime */
-void exibirPistas(PistaNode *raiz) {
-    if (!raiz) return;
-    exibirPistas(raiz->esq);
-    printf(" - %s\n", raiz->pista);
-    exibirPistas(raiz->dir);
+/**
+ * instrRelatorio(f, prometheus)
+ * Escreve os contadores em 'f': JSON ou, com 'prometheus', o formato texto
+ * de exposição. Retorna -1 se o programa foi compilado sem DQ_INSTRUMENTAR.
+ */
+int instrRelatorio(FILE *f, int prometheus) {
+#ifdef DQ_INSTRUMENTAR
+    char buf[4096];
+    size_t n = instr_formatar(buf, sizeof(buf), prometheus);
+    return fwrite(buf, 1, n, f) == n ? 0 : -1;
+#else
+    (void)f;
+    (void)prometheus;
+    fprintf(stderr, "Erro: contadores desligados (compile com -DDQ_INSTRUMENTAR).\n");
+    return -1;
+#endif
 }
 
-/* liberar BST de pistas */
-void liberarPistas(PistaNode *raiz) {
-    if (!raiz) return;
-    liberarPistas(raiz->esq);
-    liberarPistas(raiz->dir);
-    free(raiz->pista);
-    free(raiz);
+/* instrSinal(prometheus): SIGUSR1 passa a escrever o relatório em stderr */
+void instrSinal(int prometheus) {
+#if defined(DQ_INSTRUMENTAR) && defined(DQ_POSIX)
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    instr_sinal_prometheus = prometheus;
+    sa.sa_handler = instr_tratar_sinal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+#else
+    (void)prometheus;
+#endif
 }
 
 /* ===========================
-   Tabela Hash (pista -> suspeito)
+   Helpers para strings / memória
    =========================== */
 
-/* função hash simples (djb2) */
-static unsigned long hash_djb2(const char *str) {
-    unsigned long hash = 5381;
-    int c;
-    while ((c = (unsigned char)*str++))
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-    return hash;
-}
+/* contadores globais de uso do heap (ver mem_alloc / mem_free) */
+static MemStats mem_heap;
 
-/* criar tabela hash com 'tamanho' buckets */
-HashTable *criarHash(size_t tamanho) {
-    HashTable *h = malloc(sizeof(HashTable));
-    if (!h) return NULL;
-    h->buckets = calloc(tamanho, sizeof(HashEntry *));
-    if (!h->buckets) {
-        free(h);
-        return NULL;
+/* malloc com contagem: usado pelas estruturas do jogo */
+static void *mem_alloc(size_t n) {
+    void *p = malloc(n);
+    if (p) {
+        mem_heap.n_alocacoes += 1;
+        mem_heap.bytes += n;
+        INSTR_SOMAR(CONT_ALOCACOES, 1);
+        INSTR_SOMAR(CONT_BYTES_ALOCADOS, n);
     }
-    h->tamanho = tamanho;
-    return h;
+    return p;
 }
 
-/**
- * inserirNaHash(ht, pista, suspeito)
- * Insere a associação pista -> suspeito na tabela hash.
- * Se a chave já existe, sobrescreve o suspeito.
- */
-void inserirNaHash(HashTable *ht, const char *pista, const char *suspeito) {
-    if (!ht || !pista || !suspeito) return;
-    unsigned long h = hash_djb2(pista) % ht->tamanho;
-    /* procurar se já existe */
-    HashEntry *ent = ht->buckets[h];
-    while (ent) {
-        if (strcmp(ent->chave, pista) == 0) {
-            /* sobrescreve o suspeito existente */
-            free(ent->suspeito);
-            ent->suspeito = my_strdup(suspeito);
-            return;
-        }
-        ent = ent->prox;
-    }
-    /* não existe — criar novo */
-    HashEntry *novo = malloc(sizeof(HashEntry));
-    if (!novo) {
-        fprintf(stderr, "Erro: alocar HashEntry\n");
-        return;
+/* calloc com contagem */
+static void *mem_calloc(size_t n, size_t tam) {
+    void *p = calloc(n, tam);
+    if (p) {
+        mem_heap.n_alocacoes += 1;
+        mem_heap.bytes += n * tam;
+        INSTR_SOMAR(CONT_ALOCACOES, 1);
+        INSTR_SOMAR(CONT_BYTES_ALOCADOS, n * tam);
     }
-    novo->chave = my_strdup(pista);
-    novo->suspeito = my_strdup(suspeito);
-    novo->prox = ht->buckets[h];
-    ht->buckets[h] = novo;
+    return p;
 }
 
-/**
- * encontrarSuspeito(ht, pista)
- * Retorna o nome do suspeito associado à pista, ou NULL se não achar.
- * A string retornada é a que está armazenada na hash (não liberar externamente).
- */
-char *encontrarSuspeito(HashTable *ht, const char *pista) {
-    if (!ht || !pista) return NULL;
-    unsigned long h = hash_djb2(pista) % ht->tamanho;
-    HashEntry *ent = ht->buckets[h];
-    while (ent) {
-        if (strcmp(ent->chave, pista) == 0) return ent->suspeito;
-        ent = ent->prox;
-    }
-    return NULL;
+/* free com contagem (aceita NULL, como free) */
+static void mem_free(void *p) {
+    if (!p) return;
+    mem_heap.n_liberacoes += 1;
+    free(p);
 }
 
-/* liberar tabela hash */
-void liberarHash(HashTable *ht) {
-    if (!ht) return;
-    for (size_t i = 0; i < ht->tamanho; ++i) {
-        HashEntry *e = ht->buckets[i];
-        while (e) {
-            HashEntry *next = e->prox;
-            free(e->chave);
-            free(e->suspeito);
-            free(e);
-            e = next;
-        }
-    }
-    free(ht->buckets);
-    free(ht);
+/* Buffer com contagem de referências (copy-on-write): sessões bifurcadas
+   dividem histórico e bitset de pistas até uma delas escrever. Fica fora de
+   mem_stats, como os demais buffers por sessão (uma sessão por thread). */
+typedef struct BufCow {
+    atomic_size_t refs;
+    size_t cap;                /* bytes em 'dados' */
+    max_align_t dados[];
+} BufCow;
+
+static BufCow *cow_cab(const void *p) {
+    return (BufCow *)(uintptr_t)((const char *)p - offsetof(BufCow, dados));
 }
 
-/* listar suspeitos únicos contidos na hash (para ajudar o jogador) */
-void listarSuspeitosHash(HashTable *ht) {
-    if (!ht) return;
-    SuspeitoConta *lista = NULL;
-    for (size_t i = 0; i < ht->tamanho; ++i) {
-        HashEntry *e = ht->buckets[i];
-        while (e) {
-            /* checar se já está na lista */
-            SuspeitoConta *p = lista;
-            int achou = 0;
-            while (p) {
-                if (strcmp(p->nome, e->suspeito) == 0) { achou = 1; break; }
-                p = p->prox;
-            }
-            if (!achou) {
-                SuspeitoConta *novo = malloc(sizeof(SuspeitoConta));
-                novo->nome = my_strdup(e->suspeito);
-                novo->cont = 0;
-                novo->prox = lista;
-                lista = novo;
-            }
-            e = e->prox;
-        }
-    }
-    printf("Suspeitos conhecidos:\n");
-    SuspeitoConta *q = lista;
-    if (!q) {
-        printf("  (nenhum suspeito cadastrado)\n");
+/* buffer exclusivo de 'cap' bytes (zerado se 'zerar') */
+static void *cow_alocar(size_t cap, int zerar) {
+    BufCow *b = zerar ? calloc(1, sizeof(BufCow) + cap) : malloc(sizeof(BufCow) + cap);
+    if (!b) return NULL;
+    atomic_init(&b->refs, 1);
+    b->cap = cap;
+    return b->dados;
+}
+
+/* mais uma referência ao mesmo buffer (NULL continua NULL) */
+static void *cow_compartilhar(void *p) {
+    if (p) atomic_fetch_add_explicit(&cow_cab(p)->refs, 1, memory_order_relaxed);
+    return p;
+}
+
+static int cow_compartilhado(const void *p) {
+    return p && atomic_load_explicit(&cow_cab(p)->refs, memory_order_acquire) > 1;
+}
+
+static void cow_soltar(void *p) {
+    if (p && atomic_fetch_sub_explicit(&cow_cab(p)->refs, 1, memory_order_acq_rel) == 1)
+        free(cow_cab(p));
+}
+
+/* 'p' exclusivo e com pelo menos 'cap' bytes, preservando os 'usados'
+   primeiros: devolve o buffer (talvez outro) ou NULL, sem mexer em 'p' */
+static void *cow_escrever(void *p, size_t cap, size_t usados) {
+    if (p && !cow_compartilhado(p)) {
+        BufCow *b = cow_cab(p);
+        if (b->cap >= cap) return p;
+        BufCow *n = realloc(b, sizeof(BufCow) + cap);
+        if (!n) return NULL;
+        n->cap = cap;
+        return n->dados;
     }
-    while (q) {
-        printf("  - %s\n", q->nome);
-        SuspeitoConta *tmp = q;
-        q = q->prox;
-        free(tmp->nome);
-        free(tmp);
+    size_t c = p && cow_cab(p)->cap > cap ? cow_cab(p)->cap : cap;
+    void *n = cow_alocar(c, 0);
+    if (!n) return NULL;
+    if (p && usados) memcpy(n, p, usados);
+    cow_soltar(p);
+    return n;
+}
+
+/* lê linha do stdin e remove newline; retorna 0 no fim da entrada */
+static int ler_linha(char *buf, size_t tam) {
+    if (!fgets(buf, (int)tam, stdin)) {
+        buf[0] = '\0';
+        return 0;
     }
+    size_t len = strlen(buf);
+    if (len > 0 && buf[len - 1] == '\n') buf[len - 1] = '\0';
+    return 1;
+}
+
+/* relógio monotônico em segundos */
+static double agora_seg(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* núcleos disponíveis (1 se não der para saber) */
+static int nucleos_disponiveis(void) {
+#ifdef DQ_POSIX
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#else
+    return 1;
+#endif
 }
 
 /* ===========================
-   Exploração + coleta de pistas
+   Saída bufferizada
    =========================== */
 
-/**
- * explorarSalas(inicio, ht, ponteiro_raiz_pistas)
- * Permite navegar pela mansão (arvore binaria). Ao entrar numa sala, exibe
- * a pista (se existir), insere na BST de pistas e mostra a quem a pista aponta
- * (consultando a hash).
- *
- * Comandos: 'e' esquerda, 'd' direita, 's' sair.
- */
-void explorarSalas(Sala *inicio, HashTable *ht, PistaNode **pistasRoot) {
-    if (!inicio) {
-        printf("Mapa vazio.\n");
-        return;
-    }
-
-    const char **historico = NULL;
-    size_t cap = 0, n = 0;
-    Sala *atual = inicio;
-    char buf[128];
+/* buffer das saídas para descritor/arquivo; a de memória cresce à vontade */
+#define SAIDA_BUFFER (256 * 1024)
 
-    while (1) {
-        /* registrar visita */
-        if (n + 1 > cap) {
-            size_t nova = (cap == 0) ? 6 : cap * 2;
-            const char **tmp = realloc((void *)historico, nova * sizeof(const char *));
-            if (!tmp) { fprintf(stderr, "Erro: histórico\n"); break; }
-            historico = tmp;
-            cap = nova;
-        }
-        historico[n++] = atual->nome;
-
-        /* mostrar onde está */
-        printf("\nVocê está na sala: %s\n", atual->nome);
-        if (atual->pista && atual->pista[0] != '\0') {
-            printf("Pista encontrada: \"%s\"\n", atual->pista);
-            /* coletar e inserir na BST (evita duplicatas) */
-            *pistasRoot = inserirPista(*pistasRoot, atual->pista);
-            /* mostrar suspeito relacionado (se existir na hash) */
-            char *sus = encontrarSuspeito(ht, atual->pista);
-            if (sus) {
-                printf("  (Essa pista aponta para: %s)\n", sus);
-            } else {
-                printf("  (Nenhum suspeito conhecido para esta pista)\n");
-            }
-        } else {
-            printf("Nenhuma pista nesta sala.\n");
-        }
+/* escreve um literal sem strlen: o tamanho sai do sizeof */
+#define saida_lit(o, lit) saida_escrever((o), (lit), sizeof(lit) - 1)
 
-        /* opções de movimento */
-        int temEsq = (atual->esq != NULL);
-        int temDir = (atual->dir != NULL);
-        printf("Escolha uma opção:\n");
-        if (temEsq) printf("  (e) Ir para a esquerda\n");
-        if (temDir) printf("  (d) Ir para a direita\n");
-        printf("  (s) Sair da exploração\n");
-        printf("Opção: ");
-        ler_linha(buf, sizeof(buf));
-        char escolha = '\0';
-        for (size_t i = 0; buf[i]; ++i) {
-            if (!isspace((unsigned char)buf[i])) { escolha = (char)tolower((unsigned char)buf[i]); break; }
-        }
+/* saída padrão do jogo (stdout), criada no primeiro uso */
+static Saida *saida_global = NULL;
 
-        if (escolha == 's') {
-            printf("Saindo da exploração.\n");
-            break;
-        } else if (escolha == 'e') {
-            if (temEsq) { atual = atual->esq; continue; }
-            else { printf("Caminho à esquerda não disponível.\n"); continue; }
-        } else if (escolha == 'd') {
-            if (temDir) { atual = atual->dir; continue; }
-            else { printf("Caminho à direita não disponível.\n"); continue; }
-        } else {
-            printf("Opção inválida. Use 'e', 'd' ou 's'.\n");
-            continue;
-        }
-    }
+static Saida *saida_nova(SaidaDestino destino, size_t cap) {
+    Saida *o = malloc(sizeof(Saida));
+    if (!o) return NULL;
+    memset(o, 0, sizeof(*o));
+    o->destino = destino;
+    o->cap = cap;
+    o->buf = malloc(cap);
+    if (!o->buf) { free(o); return NULL; }
+    return o;
+}
 
-    /* mostrar histórico de visitas */
-    if (n > 0) {
-        printf("\nHistórico de salas visitadas:\n");
-        for (size_t i = 0; i < n; ++i) printf("  %zu. %s\n", i+1, historico[i]);
-    } else {
-        printf("\nNenhuma sala visitada.\n");
-    }
-    free(historico);
+/* saidaArquivo(f): saída bufferizada sobre um FILE* aberto (não é fechado) */
+Saida *saidaArquivo(FILE *f) {
+    Saida *o = saida_nova(SAIDA_ARQUIVO, SAIDA_BUFFER);
+    if (o) o->f = f;
+    return o;
 }
 
-/* ===========================
-   Verificação final (julgamento)
-   =========================== */
+/* saidaDescritor(fd): escreve direto no descritor, sem passar pelo stdio */
+Saida *saidaDescritor(int fd) {
+#ifdef DQ_POSIX
+    Saida *o = saida_nova(SAIDA_DESCRITOR, SAIDA_BUFFER);
+    if (o) o->fd = fd;
+    return o;
+#else
+    return fd == 1 ? saidaArquivo(stdout) : NULL;
+#endif
+}
 
-/* incrementa contador do suspeito na lista (ou adiciona se não existir) */
-static void conta_suspeito_add(SuspeitoConta **lista, const char *nome) {
-    if (!nome) return;
-    SuspeitoConta *p = *lista;
-    while (p) {
-        if (strcmp(p->nome, nome) == 0) { p->cont += 1; return; }
-        p = p->prox;
-    }
-    /* não achou -> cria novo nó */
-    SuspeitoConta *novo = malloc(sizeof(SuspeitoConta));
-    novo->nome = my_strdup(nome);
-    novo->cont = 1;
-    novo->prox = *lista;
-    *lista = novo;
+/* saidaMemoria(): acumula tudo em memória (ver saidaConteudo) */
+Saida *saidaMemoria(void) {
+    return saida_nova(SAIDA_MEMORIA, 4096);
 }
 
-/* libera lista de contagem */
-static void liberar_conta_lista(SuspeitoConta *l) {
-    while (l) {
-        SuspeitoConta *t = l->prox;
-        free(l->nome);
-        free(l);
-        l = t;
+/* entrega 'a' (buffer) e depois 'b' ao destino, numa chamada só se der */
+static void saida_despejar(Saida *o, const void *a, size_t na, const void *b, size_t nb) {
+    if (na + nb == 0) return;
+#ifdef DQ_POSIX
+    if (o->destino == SAIDA_DESCRITOR) {
+        /* o que já foi para o stdout pelo stdio sai antes */
+        if (o->fd == 1) fflush(stdout);
+        struct iovec v[2] = { { (void *)a, na }, { (void *)b, nb } };
+        int iv = na ? 0 : 1;
+        while (iv < 2) {
+            ssize_t w = writev(o->fd, v + iv, 2 - iv);
+            if (w < 0) { o->erro = 1; return; }
+            o->bytes += (size_t)w;
+            /* escrita parcial: avança pelos vetores */
+            while (iv < 2 && (size_t)w >= v[iv].iov_len) w -= (ssize_t)v[iv++].iov_len;
+            if (iv < 2) {
+                v[iv].iov_base = (char *)v[iv].iov_base + w;
+                v[iv].iov_len -= (size_t)w;
+            }
+        }
+        return;
     }
+#endif
+    if ((na && fwrite(a, 1, na, o->f) != na) || (nb && fwrite(b, 1, nb, o->f) != nb))
+        o->erro = 1;
+    o->bytes += na + nb;
 }
 
-/* atravessa a BST de pistas e cria contagem por suspeito usando hash */
-void contar_pistas_por_suspeito(PistaNode *raiz, HashTable *ht, SuspeitoConta **lista) {
-    if (!raiz) return;
-    /* in-order ou pre-order, não importa para contar */
-    contar_pistas_por_suspeito(raiz->esq, ht, lista);
-    char *sus = encontrarSuspeito(ht, raiz->pista);
-    if (sus) conta_suspeito_add(lista, sus);
-    contar_pistas_por_suspeito(raiz->dir, ht, lista);
+/* saidaDescarregar(o): entrega o buffer ao destino (nada na de memória) */
+void saidaDescarregar(Saida *o) {
+    if (!o || o->destino == SAIDA_MEMORIA) return;
+    saida_despejar(o, o->buf, o->len, NULL, 0);
+    o->len = 0;
+    if (o->destino == SAIDA_ARQUIVO) fflush(o->f);
 }
 
-/**
- * verificarSuspeitoFinal(pistasRoot, ht)
- * Pede ao jogador para acusar um suspeito; verifica se há pelo menos 2 pistas
- * que apontem para esse suspeito e imprime o resultado do julgamento.
- */
-void verificarSuspeitoFinal(PistaNode *pistasRoot, HashTable *ht) {
-    if (!pistasRoot) {
-        printf("\nVocê não coletou pistas suficientes para acusar alguém.\n");
+/* lento: não coube no buffer */
+static void saida_transbordar(Saida *o, const void *p, size_t n) {
+    if (o->destino == SAIDA_MEMORIA) {
+        size_t nova = o->cap * 2;
+        while (nova - o->len < n) nova *= 2;
+        char *tmp = realloc(o->buf, nova);
+        if (!tmp) { o->erro = 1; return; }
+        o->buf = tmp;
+        o->cap = nova;
+        memcpy(o->buf + o->len, p, n);
+        o->len += n;
         return;
     }
+    if (n < o->cap / 2) {
+        saida_despejar(o, o->buf, o->len, NULL, 0);
+        memcpy(o->buf, p, n);
+        o->len = n;
+    } else {
+        /* bloco grande: buffer e bloco vão juntos, sem cópia */
+        saida_despejar(o, o->buf, o->len, p, n);
+        o->len = 0;
+    }
+}
 
-    /* mostrar as pistas coletadas */
-    printf("\nPistas coletadas (em ordem):\n");
-    exibirPistas(pistasRoot);
+/* saida_escrever(o, p, n): acrescenta 'n' bytes */
+static inline void saida_escrever(Saida *o, const void *p, size_t n) {
+    if (o->cap - o->len >= n) {
+        memcpy(o->buf + o->len, p, n);
+        o->len += n;
+    } else {
+        saida_transbordar(o, p, n);
+    }
+}
 
-    /* mostrar suspeitos conhecidos para ajudar o jogador */
-    printf("\n");
-    listarSuspeitosHash(ht);
+static inline void saida_texto(Saida *o, const char *s) {
+    saida_escrever(o, s, strlen(s));
+}
 
-    /* contar quantas pistas apontam para cada suspeito */
-    SuspeitoConta *lista = NULL;
-    contar_pistas_por_suspeito(pistasRoot, ht, &lista);
+static inline void saida_char(Saida *o, char c) {
+    if (o->len < o->cap) o->buf[o->len++] = c;
+    else saida_transbordar(o, &c, 1);
+}
 
-    /* solicitar acusação */
-    char buf[128];
-    printf("\nQuem você acusa? Digite o nome do suspeito: ");
-    ler_linha(buf, sizeof(buf));
-    if (buf[0] == '\0') {
-        printf("Nenhum nome informado. Acusação cancelada.\n");
-        liberar_conta_lista(lista);
-        return;
-    }
+/* inteiro sem sinal em decimal, sem passar por printf */
+static void saida_uint(Saida *o, size_t v) {
+    char tmp[24];
+    size_t i = sizeof(tmp);
+    do { tmp[--i] = (char)('0' + v % 10); v /= 10; } while (v);
+    saida_escrever(o, tmp + i, sizeof(tmp) - i);
+}
 
-    /* simplificar: comparar sem diferenciar maiúsculas/minúsculas */
-    char acusado_norm[128];
-    strncpy(acusado_norm, buf, sizeof(acusado_norm)-1);
-    acusado_norm[sizeof(acusado_norm)-1] = '\0';
-    str_lower(acusado_norm);
+/* saidaConteudo(o, ptr_len): texto acumulado (terminado em '\0') */
+const char *saidaConteudo(Saida *o, size_t *len) {
+    saida_char(o, '\0');
+    o->len -= 1;
+    if (len) *len = o->len;
+    return o->buf;
+}
 
-    /* buscar na lista */
-    SuspeitoConta *p = lista;
-    int achou = 0;
-    int cont = 0;
-    while (p) {
-        char nome_norm[128];
-        strncpy(nome_norm, p->nome, sizeof(nome_norm)-1);
-        nome_norm[sizeof(nome_norm)-1] = '\0';
-        str_lower(nome_norm);
-        if (strcmp(nome_norm, acusado_norm) == 0) {
-            achou = 1;
-            cont = p->cont;
-            break;
-        }
-        p = p->prox;
-    }
+/* saidaLiberar(o): descarrega e libera (arquivo ou descritor continuam abertos) */
+void saidaLiberar(Saida *o) {
+    if (!o) return;
+    saidaDescarregar(o);
+    if (o == saida_global) saida_global = NULL;
+    free(o->buf);
+    free(o);
+}
 
-    if (!achou) {
-        printf("\nO nome '%s' não corresponde a nenhum suspeito com pistas coletadas.\n", buf);
-        printf("Resultado: Acusação improcedente.\n");
-    } else {
-        printf("\nVocê acusou: %s\n", buf);
-        printf("Número de pistas que apontam para esse suspeito: %d\n", cont);
-        if (cont >= 2) {
-            printf("Veredito: Você reuniu evidências suficientes. Suspeito considerado CULPADO.\n");
-        } else {
-            printf("Veredito: Evidências insuficientes (são necessárias pelo menos 2 pistas). Suspeito inocentado.\n");
-        }
-    }
+Saida *saidaPadrao(void) {
+    if (!saida_global) saida_global = saidaDescritor(1);
+    return saida_global;
+}
 
-    liberar_conta_lista(lista);
+/* lê uma linha do jogador: antes, o prompt pendente precisa aparecer */
+static int ler_linha_de(Saida *o, char *buf, size_t tam) {
+    saidaDescarregar(o);
+    return ler_linha(buf, tam);
 }
 
 /* ===========================
-   main: monta mapa, hash, roda exploração e verificação
+   Núcleos de texto (SIMD, escolhidos em tempo de execução)
    =========================== */
 
-int main(void) {
-    /* Montagem manual do mapa (árvore binária de salas) */
-    Sala *hall = criarSala("Hall de Entrada", "Pegadas de lama");
-    Sala *salaEstar = criarSala("Sala de Estar", "Livro com página faltando");
-    Sala *corredor = criarSala("Corredor", NULL);
-    Sala *cozinha = criarSala("Cozinha", "Chave perdida");
-    Sala *biblioteca = criarSala("Biblioteca", NULL);
-    Sala *quarto = criarSala("Quarto", "Lençol manchado");
-    Sala *jardim = criarSala("Jardim", "Gaveta perdida");
+/*
+ * Laços byte a byte dos caminhos quentes: dobrar caixa ASCII (normalizarNome),
+ * pular brancos (comandos do jogador) e achar o primeiro byte diferente
+ * (ordem da BST de pistas); e contar os bits de um bitset de pistas sob uma
+ * máscara (julgamento em lote). Cada núcleo tem versão escalar, SSE2 e AVX2
+ * (x86-64) e NEON (aarch64); nucleosTexto() escolhe, núcleo a núcleo, a
+ * melhor que a CPU tem. DQ_NUCLEOS=escalar|sse2|avx2|neon força uma delas.
+ */
 
-    /* conectar nós (fixo) */
-    hall->esq = salaEstar;
-    hall->dir = corredor;
-    salaEstar->esq = cozinha;
-    salaEstar->dir = biblioteca;
-    corredor->esq = quarto;
-    corredor->dir = jardim;
+/* bits ligados numa palavra */
+static inline unsigned bits_contar(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (unsigned)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
 
-    /* criar tabela hash e inserir associações pista -> suspeito */
-    HashTable *ht = criarHash(31); /* 31 buckets é suficiente para este exemplo */
+/* posição do bit ligado mais baixo (x != 0) */
+static inline unsigned bits_primeiro(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) { x >>= 1; ++n; }
+    return n;
+#endif
+}
 
-    /* Inserir associações (pré-definidas pela lógica do jogo) */
-    inserirNaHash(ht, "Pegadas de lama", "Jardineiro");
-    inserirNaHash(ht, "Gaveta perdida", "Jardineiro");
-    inserirNaHash(ht, "Chave perdida", "Empregado");
-    inserirNaHash(ht, "Lençol manchado", "Empregado");
-    inserirNaHash(ht, "Livro com página faltando", "Bibliotecário");
-    /* você pode adicionar mais pistas↔suspeitos aqui */
+/* conjunto de núcleos de uma arquitetura */
+typedef struct NucleosTexto {
+    const char *nome;
+    /* copia para 'dest', em minúsculas, o maior prefixo de src[0..n) de
+       ASCII imprimível (0x20..0x7e) sem dois espaços seguidos e sem espaço
+       no fim (src[0] não é branco); retorna o tamanho dele */
+    size_t (*dobrar)(char *dest, const unsigned char *src, size_t n);
+    /* tamanho do prefixo de brancos (isspace no locale "C") */
+    size_t (*brancos)(const unsigned char *p, size_t n);
+    /* posição do primeiro byte diferente entre a e b (n se iguais) */
+    size_t (*diferenca)(const unsigned char *a, const unsigned char *b, size_t n);
+    /* bits ligados em a[i] & b[i] para i < n (julgamento em lote) */
+    size_t (*contar_e)(const uint64_t *a, const uint64_t *b, size_t n);
+} NucleosTexto;
+
+static inline int byte_visivel(unsigned char c) { return c > 0x20 && c < 0x7f; }
+static inline int byte_branco(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
 
-    /* BST de pistas coletadas começa vazia */
-    PistaNode *pistasRoot = NULL;
+static size_t dobrar_escalar(char *dest, const unsigned char *src, size_t n) {
+    size_t i = 0;
+    for (; i < n; ++i) {
+        unsigned char c = src[i];
+        if (c == ' ' && !(i + 1 < n && byte_visivel(src[i + 1]))) break;
+        if (c != ' ' && !byte_visivel(c)) break;
+        dest[i] = (char)(c >= 'A' && c <= 'Z' ? c | 0x20 : c);
+    }
+    return i;
+}
 
-    printf("=== Detective Quest: Modo Mestre ===\n");
-    printf("Explore a mansão e colete pistas. No final, acuse um suspeito.\n");
-    printf("Comandos: 'e' (esquerda), 'd' (direita), 's' (sair)\n");
+static size_t brancos_escalar(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && byte_branco(p[i])) ++i;
+    return i;
+}
 
-    explorarSalas(hall, ht, &pistasRoot);
+static size_t diferenca_escalar(const unsigned char *a, const unsigned char *b, size_t n) {
+    size_t i = 0;
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
 
-    verificarSuspeitoFinal(pistasRoot, ht);
+static size_t contar_e_escalar(const uint64_t *a, const uint64_t *b, size_t n) {
+    size_t c = 0;
+    for (size_t i = 0; i < n; ++i) c += bits_contar(a[i] & b[i]);
+    return c;
+}
 
-    /* liberar toda memória usada */
-    liberarPistas(pistasRoot);
-    liberarHash(ht);
-    liberarSalas(hall);
+static const NucleosTexto nucleos_escalar = {
+    "escalar", dobrar_escalar, brancos_escalar, diferenca_escalar, contar_e_escalar
+};
 
-    printf("\nFim do jogo. Obrigado por jogar (console version).\n");
-    return 0;
+#ifdef DQ_X86
+/* Blocos de 16 bytes, sempre embutidos: dentro das funções AVX2 viram
+   instruções VEX (misturar SSE legado com AVX custa caro). */
+#define DQ_EMBUTIR static inline __attribute__((always_inline))
+
+/* dobra 16 bytes se todos puderem ir juntos (ver NucleosTexto.dobrar); bytes
+   com sinal: >= 0x80 são negativos e nunca passam de 0x1f */
+DQ_EMBUTIR int dobrar_bloco16(char *dest, const unsigned char *src) {
+    const __m128i espaco = _mm_set1_epi8(0x20), controle = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i a = _mm_set1_epi8('A' - 1), z = _mm_set1_epi8('Z' + 1);
+    __m128i v = _mm_loadu_si128((const __m128i *)src);
+    __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, controle), _mm_cmplt_epi8(v, del));
+    __m128i mai = _mm_and_si128(_mm_cmpgt_epi8(v, a), _mm_cmplt_epi8(v, z));
+    unsigned sp = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, espaco));
+    /* o bloco anterior não termina em espaço, então só olhar dentro deste */
+    if ((unsigned)_mm_movemask_epi8(ok) != 0xffffu || (sp & (sp >> 1)) || (sp & 0x8000u))
+        return 0;
+    _mm_storeu_si128((__m128i *)dest, _mm_or_si128(v, _mm_and_si128(mai, espaco)));
+    return 1;
+}
+
+/* máscara dos brancos de 16 bytes */
+DQ_EMBUTIR unsigned brancos_bloco16(const unsigned char *p) {
+    const __m128i espaco = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t' - 1), cr = _mm_set1_epi8('\r' + 1);
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, espaco),
+                           _mm_and_si128(_mm_cmpgt_epi8(v, tab), _mm_cmplt_epi8(v, cr))));
+}
+
+/* máscara dos bytes iguais de 16 bytes */
+DQ_EMBUTIR unsigned iguais_bloco16(const unsigned char *a, const unsigned char *b) {
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a),
+                                                      _mm_loadu_si128((const __m128i *)b)));
+}
+
+static size_t dobrar_sse2(char *dest, const unsigned char *src, size_t n) {
+    size_t i = 0;
+    while (i + 16 <= n && dobrar_bloco16(dest + i, src + i)) i += 16;
+    return i + dobrar_escalar(dest + i, src + i, n - i);
+}
+
+static size_t brancos_sse2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned m = brancos_bloco16(p + i);
+        if (m != 0xffffu) return i + bits_primeiro(~m);
+    }
+    return i + brancos_escalar(p + i, n - i);
+}
+
+static size_t diferenca_sse2(const unsigned char *a, const unsigned char *b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned m = iguais_bloco16(a + i, b + i);
+        if (m != 0xffffu) return i + bits_primeiro(~m);
+    }
+    return i + diferenca_escalar(a + i, b + i, n - i);
+}
+
+/* SSE2 não tem popcount: soma em paralelo dentro de cada byte e psadbw */
+static size_t contar_e_sse2(const uint64_t *a, const uint64_t *b, size_t n) {
+    const __m128i m1 = _mm_set1_epi8(0x55), m2 = _mm_set1_epi8(0x33), m4 = _mm_set1_epi8(0x0f);
+    __m128i soma = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(a + i)),
+                                  _mm_loadu_si128((const __m128i *)(b + i)));
+        v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+        v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+        v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+        soma = _mm_add_epi64(soma, _mm_sad_epu8(v, _mm_setzero_si128()));
+    }
+    uint64_t t[2];
+    _mm_storeu_si128((__m128i *)t, soma);
+    return (size_t)(t[0] + t[1]) + contar_e_escalar(a + i, b + i, n - i);
+}
+
+static const NucleosTexto nucleos_sse2 = {
+    "sse2", dobrar_sse2, brancos_sse2, diferenca_sse2, contar_e_sse2
+};
+#endif
+
+#ifdef DQ_AVX2
+#define DQ_ALVO_AVX2 __attribute__((target("avx2")))
+
+DQ_ALVO_AVX2 static size_t dobrar_avx2(char *dest, const unsigned char *src, size_t n) {
+    const __m256i espaco = _mm256_set1_epi8(0x20), controle = _mm256_set1_epi8(0x1f);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    const __m256i a = _mm256_set1_epi8('A' - 1), z = _mm256_set1_epi8('Z' + 1);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i ok = _mm256_and_si256(_mm256_cmpgt_epi8(v, controle), _mm256_cmpgt_epi8(del, v));
+        __m256i mai = _mm256_and_si256(_mm256_cmpgt_epi8(v, a), _mm256_cmpgt_epi8(z, v));
+        uint32_t sp = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, espaco));
+        if ((uint32_t)_mm256_movemask_epi8(ok) != 0xffffffffu || (sp & (sp >> 1)) ||
+            (sp & 0x80000000u))
+            break;
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_or_si256(v, _mm256_and_si256(mai, espaco)));
+    }
+    if (i + 16 <= n && dobrar_bloco16(dest + i, src + i)) i += 16;
+    return i + dobrar_escalar(dest + i, src + i, n - i);
+}
+
+DQ_ALVO_AVX2 static size_t brancos_avx2(const unsigned char *p, size_t n) {
+    const __m256i espaco = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t' - 1), cr = _mm256_set1_epi8('\r' + 1);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_or_si256(_mm256_cmpeq_epi8(v, espaco),
+                                    _mm256_and_si256(_mm256_cmpgt_epi8(v, tab), _mm256_cmpgt_epi8(cr, v)));
+        uint32_t m = (uint32_t)_mm256_movemask_epi8(b);
+        if (m != 0xffffffffu) return i + bits_primeiro(~m);
+    }
+    if (i + 16 <= n) {
+        unsigned m = brancos_bloco16(p + i);
+        if (m != 0xffffu) return i + bits_primeiro(~m);
+        i += 16;
+    }
+    return i + brancos_escalar(p + i, n - i);
+}
+
+DQ_ALVO_AVX2 static size_t diferenca_avx2(const unsigned char *a, const unsigned char *b, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (m != 0xffffffffu) return i + bits_primeiro(~m);
+    }
+    if (i + 16 <= n) {
+        unsigned m = iguais_bloco16(a + i, b + i);
+        if (m != 0xffffu) return i + bits_primeiro(~m);
+        i += 16;
+    }
+    return i + diferenca_escalar(a + i, b + i, n - i);
+}
+
+/* popcount por tabela de nibbles (vpshufb), somado por vpsadbw */
+DQ_ALVO_AVX2 static size_t contar_e_avx2(const uint64_t *a, const uint64_t *b, size_t n) {
+    const __m256i tabela = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i soma = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                     _mm256_loadu_si256((const __m256i *)(b + i)));
+        __m256i c = _mm256_add_epi8(
+            _mm256_shuffle_epi8(tabela, _mm256_and_si256(v, nibble)),
+            _mm256_shuffle_epi8(tabela, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+        soma = _mm256_add_epi64(soma, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+    }
+    uint64_t t[4];
+    _mm256_storeu_si256((__m256i *)t, soma);
+    return (size_t)(t[0] + t[1] + t[2] + t[3]) + contar_e_sse2(a + i, b + i, n - i);
+}
+
+static const NucleosTexto nucleos_avx2 = {
+    "avx2", dobrar_avx2, brancos_avx2, diferenca_avx2, contar_e_avx2
+};
+
+/* escolha automática com AVX2 (medida com --bench-texto): dobrar e brancos
+   saem cedo em strings curtas e ficam melhor com blocos de 16 bytes; só
+   contar_e, que varre o bitset inteiro, ganha com 32 */
+static const NucleosTexto nucleos_avx2_misto = {
+    "avx2+sse2", dobrar_sse2, brancos_sse2, diferenca_avx2, contar_e_avx2
+};
+#endif
+
+#ifdef DQ_NEON
+/* sem movemask: o bloco inteiro passa (vminvq) ou o resto vai pelo escalar */
+static size_t dobrar_neon(char *dest, const unsigned char *src, size_t n) {
+    const uint8x16_t espaco = vdupq_n_u8(0x20), del = vdupq_n_u8(0x7f), zero = vdupq_n_u8(0);
+    const uint8x16_t a = vdupq_n_u8('A'), z = vdupq_n_u8('Z');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint8x16_t ok = vandq_u8(vcgeq_u8(v, espaco), vcltq_u8(v, del));
+        uint8x16_t sp = vceqq_u8(v, espaco);
+        /* espaço seguido de espaço, ou espaço no último byte */
+        uint8x16_t duplo = vandq_u8(sp, vextq_u8(sp, zero, 1));
+        if (vminvq_u8(ok) != 0xff || vmaxvq_u8(duplo) || vgetq_lane_u8(sp, 15)) break;
+        uint8x16_t mai = vandq_u8(vcgeq_u8(v, a), vcleq_u8(v, z));
+        vst1q_u8((uint8_t *)dest + i, vorrq_u8(v, vandq_u8(mai, espaco)));
+    }
+    return i + dobrar_escalar(dest + i, src + i, n - i);
+}
+
+static size_t brancos_neon(const unsigned char *p, size_t n) {
+    const uint8x16_t espaco = vdupq_n_u8(' '), tab = vdupq_n_u8('\t'), cr = vdupq_n_u8('\r');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(p + i);
+        uint8x16_t b = vorrq_u8(vceqq_u8(v, espaco), vandq_u8(vcgeq_u8(v, tab), vcleq_u8(v, cr)));
+        if (vminvq_u8(b) != 0xff) break;
+    }
+    return i + brancos_escalar(p + i, n - i);
+}
+
+static size_t diferenca_neon(const unsigned char *a, const unsigned char *b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        if (vminvq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i))) != 0xff) break;
+    return i + diferenca_escalar(a + i, b + i, n - i);
+}
+
+static size_t contar_e_neon(const uint64_t *a, const uint64_t *b, size_t n) {
+    size_t c = 0, i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint8x16_t v = vandq_u8(vreinterpretq_u8_u64(vld1q_u64(a + i)),
+                                vreinterpretq_u8_u64(vld1q_u64(b + i)));
+        c += vaddvq_u8(vcntq_u8(v));     /* no máximo 128: cabe no byte */
+    }
+    return c + contar_e_escalar(a + i, b + i, n - i);
+}
+
+static const NucleosTexto nucleos_neon = {
+    "neon", dobrar_neon, brancos_neon, diferenca_neon, contar_e_neon
+};
+#endif
+
+/* núcleos compilados, do mais simples ao mais largo */
+static const NucleosTexto *const nucleos_todos[] = {
+    &nucleos_escalar,
+#ifdef DQ_X86
+    &nucleos_sse2,
+#endif
+#ifdef DQ_AVX2
+    &nucleos_avx2,
+#endif
+#ifdef DQ_NEON
+    &nucleos_neon,
+#endif
+};
+#define N_NUCLEOS (sizeof(nucleos_todos) / sizeof(nucleos_todos[0]))
+
+/* 1 se a CPU atual executa 'k' */
+static int nucleos_suportados(const NucleosTexto *k) {
+#ifdef DQ_AVX2
+    if (k == &nucleos_avx2) return __builtin_cpu_supports("avx2");
+#endif
+    (void)k;
+    return 1;
+}
+
+static _Atomic(const NucleosTexto *) nucleos_atual = NULL;
+
+/**
+ * nucleosTexto()
+ * Núcleos em uso: o conjunto mais largo que a CPU suporta (com AVX2, a
+ * mistura nucleos_avx2_misto), ou o de DQ_NUCLEOS. A escolha é feita na
+ * primeira chamada (threads que chegarem juntas fazem a mesma escolha).
+ */
+const NucleosTexto *nucleosTexto(void) {
+    const NucleosTexto *k = atomic_load_explicit(&nucleos_atual, memory_order_acquire);
+    if (k) return k;
+    const char *pedido = getenv("DQ_NUCLEOS");
+    k = &nucleos_escalar;
+    for (size_t i = 0; i < N_NUCLEOS; ++i) {
+        if (!nucleos_suportados(nucleos_todos[i])) continue;
+        if (pedido && strcmp(pedido, nucleos_todos[i]->nome) == 0) {
+            k = nucleos_todos[i];
+            break;
+        }
+        if (!pedido) k = nucleos_todos[i];
+    }
+#ifdef DQ_AVX2
+    if (k == &nucleos_avx2 && !pedido) k = &nucleos_avx2_misto;
+#endif
+    atomic_store_explicit(&nucleos_atual, k, memory_order_release);
+    return k;
+}
+
+/* ordem de strcmp com os comprimentos já conhecidos; fica só para o
+   --bench-texto, que a compara com o strcmp da libc (mais rápido) */
+static inline int texto_comparar(const char *a, size_t na, const char *b, size_t nb) {
+    size_t n = na < nb ? na : nb;
+    size_t i = nucleosTexto()->diferenca((const unsigned char *)a, (const unsigned char *)b, n);
+    if (i < n) return (int)(unsigned char)a[i] - (int)(unsigned char)b[i];
+    return na < nb ? -1 : na > nb;
+}
+
+/* ===========================
+   Funções de hash (plugáveis e com semente)
+   =========================== */
+
+/* djb2 clássico (um byte por iteração): a referência de hash_djb2 */
+static uint64_t hash_djb2_bytes(const void *dados, size_t len, uint64_t semente) {
+    const unsigned char *p = dados;
+    uint64_t hash = 5381 ^ semente;
+    for (size_t i = 0; i < len; ++i)
+        hash = ((hash << 5) + hash) + p[i]; /* hash * 33 + c */
+    return hash;
+}
+
+/* djb2 (a semente entra no valor inicial). Em blocos de 8 bytes o mesmo
+   valor sai de h*33^8 + c0*33^7 + ... + c7: as multiplicações do bloco são
+   independentes, sem a cadeia de um byte por vez. Lanes de 64 bits não têm
+   multiplicação em SSE2/AVX2, então o ganho vem do paralelismo escalar. */
+uint64_t hash_djb2(const void *dados, size_t len, uint64_t semente) {
+    static const uint64_t pot[9] = {
+        1ull, 33ull, 1089ull, 35937ull, 1185921ull, 39135393ull, 1291467969ull,
+        42618442977ull, 1406408618241ull
+    };
+    const unsigned char *p = dados;
+    uint64_t hash = 5381 ^ semente;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        hash = hash * pot[8]
+             + (p[i] * pot[7] + p[i + 1] * pot[6])
+             + (p[i + 2] * pot[5] + p[i + 3] * pot[4])
+             + (p[i + 4] * pot[3] + p[i + 5] * pot[2])
+             + (p[i + 6] * pot[1] + p[i + 7]);
+    }
+    for (; i < len; ++i) hash = ((hash << 5) + hash) + p[i];
+    return hash;
+}
+
+/* FNV-1a de 64 bits (um byte por iteração, bem distribuído) */
+uint64_t hash_fnv1a(const void *dados, size_t len, uint64_t semente) {
+    const unsigned char *p = dados;
+    uint64_t hash = 0xcbf29ce484222325ull ^ semente;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/* multiplicação 64x64 -> 128 "dobrada" (xor das metades), base do wyhash */
+static inline uint64_t wy_mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+/* leituras sem alinhamento (memcpy vira um único load) */
+static inline uint64_t wy_r8(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t wy_r4(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t wy_r3(const unsigned char *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+/**
+ * hash_wy(dados, len, semente)
+ * Hash no estilo wyhash: consome 8/16/48 bytes por passo com multiplicações
+ * de 128 bits, então strings longas custam poucas iterações. É o padrão.
+ */
+uint64_t hash_wy(const void *dados, size_t len, uint64_t semente) {
+    static const uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull,
+                          k2 = 0x8ebc6af09c88c6e3ull, k3 = 0x589965cc75374cc3ull;
+    const unsigned char *p = dados;
+    uint64_t a, b;
+    semente ^= wy_mum(semente ^ k0, k1);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wy_r4(p) << 32) | wy_r4(p + ((len >> 3) << 2));
+            b = (wy_r4(p + len - 4) << 32) | wy_r4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wy_r3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t s1 = semente, s2 = semente;
+            do {
+                semente = wy_mum(wy_r8(p) ^ k1, wy_r8(p + 8) ^ semente);
+                s1 = wy_mum(wy_r8(p + 16) ^ k2, wy_r8(p + 24) ^ s1);
+                s2 = wy_mum(wy_r8(p + 32) ^ k3, wy_r8(p + 40) ^ s2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            semente ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            semente = wy_mum(wy_r8(p) ^ k1, wy_r8(p + 8) ^ semente);
+            p += 16;
+            i -= 16;
+        }
+        a = wy_r8(p + i - 16);
+        b = wy_r8(p + i - 8);
+    }
+    return wy_mum(k1 ^ len, wy_mum(a ^ k1, b ^ semente));
+}
+
+/* funções embutidas, por nome (usadas nos benchmarks e em HashConfig) */
+static const struct {
+    const char *nome;
+    FuncHash fn;
+} hash_embutidas[] = {
+    { "djb2", hash_djb2 },
+    { "fnv1a", hash_fnv1a },
+    { "wyhash", hash_wy },
+};
+#define N_HASH_EMBUTIDAS (sizeof(hash_embutidas) / sizeof(hash_embutidas[0]))
+
+/* semente imprevisível: /dev/urandom, ou relógio + endereços como reserva */
+uint64_t semente_aleatoria(void) {
+    uint64_t s = 0;
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (f) {
+        if (fread(&s, sizeof(s), 1, f) != 1) s = 0;
+        fclose(f);
+    }
+    if (s == 0) {
+        static uint64_t contador;
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        s = (uint64_t)ts.tv_nsec ^ ((uint64_t)ts.tv_sec << 32) ^
+            (uint64_t)(uintptr_t)&s ^ (++contador * 0x9e3779b97f4a7c15ull);
+    }
+    return s ? s : 1;
+}
+
+/* hash de um ponteiro (índices temporários chaveados por endereço) */
+static inline uint64_t hash_misturar_ptr(const void *p) {
+    return wy_mum((uint64_t)(uintptr_t)p ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull);
+}
+
+/* ===========================
+   Arena (alocador por região)
+   =========================== */
+
+/* alinhamento de toda alocação da arena */
+#define ARENA_ALINHAMENTO (sizeof(max_align_t))
+/* tamanho padrão de bloco quando arena_criar recebe 0 */
+#define ARENA_BLOCO_PADRAO ((size_t)64 * 1024)
+
+/* cria uma arena vazia; blocos são obtidos sob demanda */
+Arena *arena_criar(size_t tam_bloco) {
+    Arena *a = malloc(sizeof(Arena));
+    if (!a) return NULL;
+    memset(a, 0, sizeof(*a));
+    a->tam_bloco = tam_bloco ? tam_bloco : ARENA_BLOCO_PADRAO;
+    return a;
+}
+
+/* obtém um bloco novo com pelo menos 'min' bytes livres */
+static ArenaBloco *arena_novo_bloco(Arena *a, size_t min) {
+    size_t cap = a->tam_bloco;
+    if (cap < min) cap = min;
+    ArenaBloco *b = malloc(sizeof(ArenaBloco) + cap);
+    if (!b) return NULL;
+    b->prox = a->atual;
+    b->cap = cap;
+    b->usado = 0;
+    a->atual = b;
+    a->n_blocos += 1;
+    a->bytes_reservados += sizeof(ArenaBloco) + cap;
+    return b;
+}
+
+/* núcleo da arena: 'n' bytes com alinhamento 'alin' (potência de 2) */
+static void *arena_alloc_alin(Arena *a, size_t n, size_t alin) {
+    if (!a) return NULL;
+    ArenaBloco *b = a->atual;
+    size_t ini = b ? (b->usado + alin - 1) & ~(alin - 1) : 0;
+    if (!b || ini > b->cap || b->cap - ini < n) {
+        b = arena_novo_bloco(a, n);
+        if (!b) return NULL;
+        ini = 0;
+    }
+    void *p = (unsigned char *)b->dados + ini;
+    a->bytes_usados += ini + n - b->usado;
+    b->usado = ini + n;
+    a->n_alocacoes += 1;
+    INSTR_SOMAR(CONT_ARENA_ALOCACOES, 1);
+    return p;
+}
+
+/**
+ * arena_alloc(a, n)
+ * Entrega 'n' bytes alinhados da arena (avanço de ponteiro no bloco atual).
+ * A memória não é liberada individualmente: só em arena_liberar.
+ */
+void *arena_alloc(Arena *a, size_t n) {
+    return arena_alloc_alin(a, n, ARENA_ALINHAMENTO);
+}
+
+/* duplica string dentro da arena (strings não precisam de alinhamento) */
+char *arena_strdup(Arena *a, const char *s) {
+    if (!s) return NULL;
+    size_t n = strlen(s) + 1;
+    char *c = arena_alloc_alin(a, n, 1);
+    if (!c) return NULL;
+    memcpy(c, s, n);
+    return c;
+}
+
+/* esvazia a arena para reuso (ex.: uma partida após a outra): mantém só o
+   bloco mais antigo, sem devolvê-lo ao sistema */
+void arena_reiniciar(Arena *a) {
+    if (!a || !a->atual) return;
+    ArenaBloco *b = a->atual;
+    while (b->prox) {
+        ArenaBloco *t = b->prox;
+        free(b);
+        b = t;
+    }
+    b->usado = 0;
+    a->atual = b;
+    a->n_alocacoes = 0;
+    a->n_blocos = 1;
+    a->bytes_usados = 0;
+    a->bytes_reservados = sizeof(ArenaBloco) + b->cap;
+}
+
+/* libera a arena inteira (todos os nós e strings que ela possui) */
+void arena_liberar(Arena *a) {
+    if (!a) return;
+    ArenaBloco *b = a->atual;
+    while (b) {
+        ArenaBloco *t = b->prox;
+        free(b);
+        b = t;
+    }
+    free(a);
+}
+
+/* imprime os contadores da arena (e do heap) em stderr */
+void arena_relatorio(const char *rotulo, const Arena *a) {
+    fprintf(stderr, "[memoria] %s: heap %zu alocações / %zu liberações / %zu bytes",
+            rotulo, mem_heap.n_alocacoes, mem_heap.n_liberacoes, mem_heap.bytes);
+    if (a) {
+        fprintf(stderr, "; arena %zu pedidos / %zu blocos / %zu bytes usados / %zu reservados",
+                a->n_alocacoes, a->n_blocos, a->bytes_usados, a->bytes_reservados);
+    }
+    fprintf(stderr, "\n");
+}
+
+/* ===========================
+   Internação de strings (nomes, pistas e suspeitos)
+   =========================== */
+
+/* capacidade inicial do índice de internação (potência de 2) */
+#define INTERNER_CAP_INICIAL 64
+
+/* tabela global usada por salas, pistas coletadas e hash */
+static Interner *interner_global;
+
+/* cabeçalho de uma string internada a partir do ponteiro para os caracteres */
+#define STR_INTERNA(p) ((StrInterna *)((char *)(p) - offsetof(StrInterna, s)))
+
+/* cria uma tabela de internação vazia */
+Interner *interner_criar(void) {
+    Interner *in = malloc(sizeof(Interner));
+    if (!in) return NULL;
+    memset(in, 0, sizeof(*in));
+    in->arena = arena_criar(0);
+    in->semente = semente_aleatoria();
+    in->slots = calloc(INTERNER_CAP_INICIAL, sizeof(StrInterna *));
+    if (!in->arena || !in->slots) {
+        arena_liberar(in->arena);
+        free(in->slots);
+        free(in);
+        return NULL;
+    }
+    in->cap = INTERNER_CAP_INICIAL;
+    return in;
+}
+
+/* tabela global, criada no primeiro uso */
+Interner *interner_padrao(void) {
+    if (!interner_global) interner_global = interner_criar();
+    return interner_global;
+}
+
+/* procura o slot de 's' (ou o slot vazio onde ela entraria) */
+static StrInterna **interner_slot(Interner *in, const char *s, size_t len, uint32_t h) {
+    size_t mask = in->cap - 1;
+    size_t i = h & mask;
+    while (in->slots[i]) {
+        StrInterna *e = in->slots[i];
+        if (e->hash == h && e->len == len && memcmp(e->s, s, len) == 0) break;
+        i = (i + 1) & mask;
+    }
+    return &in->slots[i];
+}
+
+/* dobra o índice quando passa de 3/4 ocupado */
+static int interner_crescer(Interner *in) {
+    size_t nova = in->cap * 2;
+    StrInterna **slots = calloc(nova, sizeof(StrInterna *));
+    if (!slots) return -1;
+    for (size_t i = 0; i < in->cap; ++i) {
+        StrInterna *e = in->slots[i];
+        if (!e) continue;
+        size_t j = e->hash & (nova - 1);
+        while (slots[j]) j = (j + 1) & (nova - 1);
+        slots[j] = e;
+    }
+    free(in->slots);
+    in->slots = slots;
+    in->cap = nova;
+    return 0;
+}
+
+/* prepara o interner para receber mais 'extra' strings sem crescer no meio */
+int interner_reservar(Interner *in, size_t extra) {
+    if (!in) return -1;
+    size_t alvo = in->n + extra;
+    while (alvo * 4 > in->cap * 3)
+        if (interner_crescer(in) != 0) return -1;
+    if (alvo > in->cap_ids) {
+        StrInterna **tmp = realloc(in->por_id, alvo * sizeof(StrInterna *));
+        if (!tmp) return -1;
+        in->por_id = tmp;
+        in->cap_ids = alvo;
+    }
+    return 0;
+}
+
+/**
+ * internar(in, s)
+ * Retorna o ponteiro estável e único para o conteúdo de 's': strings iguais
+ * produzem sempre o mesmo ponteiro, então igualdade vira comparação de
+ * ponteiros. O ponteiro vale até interner_liberar. NULL se s == NULL.
+ */
+const char *internar(Interner *in, const char *s) {
+    if (!in || !s) return NULL;
+    size_t len = strlen(s);
+    uint32_t h = (uint32_t)hash_wy(s, len, in->semente);
+    StrInterna **slot = interner_slot(in, s, len, h);
+    if (*slot) return (*slot)->s;
+
+    if ((in->n + 1) * 4 > in->cap * 3) {
+        if (interner_crescer(in) != 0) return NULL;
+        slot = interner_slot(in, s, len, h);
+    }
+    if (in->n == in->cap_ids) {
+        size_t nova = in->cap_ids ? in->cap_ids * 2 : INTERNER_CAP_INICIAL;
+        StrInterna **tmp = realloc(in->por_id, nova * sizeof(StrInterna *));
+        if (!tmp) return NULL;
+        in->por_id = tmp;
+        in->cap_ids = nova;
+    }
+    StrInterna *e = arena_alloc(in->arena, sizeof(StrInterna) + len + 1);
+    if (!e) return NULL;
+    e->id = (uint32_t)in->n;
+    e->hash = h;
+    e->len = (uint32_t)len;
+    memcpy(e->s, s, len + 1);
+    in->por_id[in->n++] = e;
+    *slot = e;
+    return e->s;
+}
+
+/* como internar, mas não cria: NULL se 's' nunca foi internada */
+const char *interner_buscar(Interner *in, const char *s) {
+    if (!in || !s) return NULL;
+    size_t len = strlen(s);
+    StrInterna *e = *interner_slot(in, s, len, (uint32_t)hash_wy(s, len, in->semente));
+    return e ? e->s : NULL;
+}
+
+/* id estável de uma string internada */
+uint32_t interner_id(const char *interna) {
+    return STR_INTERNA(interna)->id;
+}
+
+/* comprimento de uma string internada (sem strlen) */
+static size_t interner_len(const char *interna) {
+    return STR_INTERNA(interna)->len;
+}
+
+/* string de um id (NULL se inválido) */
+const char *interner_str(const Interner *in, uint32_t id) {
+    return (in && id < in->n) ? in->por_id[id]->s : NULL;
+}
+
+/* libera a tabela e todas as strings internadas */
+void interner_liberar(Interner *in) {
+    if (!in) return;
+    arena_liberar(in->arena);
+    free(in->slots);
+    free(in->por_id);
+    if (in == interner_global) interner_global = NULL;
+    free(in);
+}
+
+/* imprime os contadores do interner em stderr */
+void interner_relatorio(const Interner *in) {
+    if (!in) return;
+    fprintf(stderr, "[memoria] interner: %zu strings distintas / %zu slots / %zu bytes na arena\n",
+            in->n, in->cap, in->arena->bytes_usados);
+}
+
+/* atalho: internar na tabela global */
+static const char *intern(const char *s) {
+    return internar(interner_padrao(), s);
+}
+
+/* ===========================
+   Funções de Sala (mansão)
+   =========================== */
+
+/**
+ * criarSalaEm(arena, nome, pista)
+ * Como criarSala, mas o nó vem da arena (se arena != NULL). Nome e pista
+ * são internados (compartilhados com a hash e com as pistas coletadas).
+ * Salas criadas em arena NÃO devem ser passadas a liberarSalas.
+ */
+Sala *criarSalaEm(Arena *arena, const char *nome, const char *pista) {
+    Sala *s = arena ? arena_alloc(arena, sizeof(Sala)) : mem_alloc(sizeof(Sala));
+    if (!s) {
+        fprintf(stderr, "Erro: falha alocação Sala.\n");
+        return NULL;
+    }
+    if (!nome) nome = "";
+    if (pista && pista[0] == '\0') pista = NULL;
+    s->nome = intern(nome);
+    s->pista = intern(pista);
+    s->esq = s->dir = NULL;
+    return s;
+}
+
+/**
+ * criarSala(nome, pista)
+ * Cria dinamicamente um cômodo com nome e pista (pista pode ser NULL).
+ * Retorna ponteiro para Sala ou NULL em caso de erro.
+ */
+Sala *criarSala(const char *nome, const char *pista) {
+    return criarSalaEm(NULL, nome, pista);
+}
+
+/* libera memória da árvore de salas (somente salas criadas no heap;
+   as strings são internadas e ficam com o interner). Iterativo: rotaciona
+   à direita até não haver filho esquerdo, então libera e segue à direita. */
+void liberarSalas(Sala *raiz) {
+    while (raiz) {
+        if (raiz->esq) {
+            Sala *e = raiz->esq;
+            raiz->esq = e->dir;
+            e->dir = raiz;
+            raiz = e;
+        } else {
+            Sala *d = raiz->dir;
+            mem_free(raiz);
+            raiz = d;
+        }
+    }
+}
+
+/* ===========================
+   Layout plano da mansão e mapa genérico
+   =========================== */
+
+#define SALA_NENHUMA UINT32_MAX
+#define SALA_SEM_PISTA UINT32_MAX
+
+/* mapa temporário ponteiro de string -> offset no pool (deduplica strings) */
+typedef struct PoolIndice {
+    const char **chaves;
+    uint32_t *offs;
+    size_t cap;
+} PoolIndice;
+
+/* offset de 's' no pool, copiando-a na primeira vez */
+static uint32_t pool_offset(PoolIndice *ix, MapaPlano *m, size_t *cap_pool, const char *s) {
+    size_t i = (size_t)hash_misturar_ptr(s) & (ix->cap - 1);
+    while (ix->chaves[i]) {
+        if (ix->chaves[i] == s) return ix->offs[i];
+        i = (i + 1) & (ix->cap - 1);
+    }
+    size_t len = strlen(s) + 1;
+    while (m->pool_len + len > *cap_pool) {
+        size_t nova = *cap_pool ? *cap_pool * 2 : 4096;
+        char *tmp = realloc(m->pool, nova);
+        if (!tmp) return SALA_SEM_PISTA;
+        m->pool = tmp;
+        *cap_pool = nova;
+    }
+    uint32_t off = (uint32_t)m->pool_len;
+    memcpy(m->pool + off, s, len);
+    m->pool_len += len;
+    ix->chaves[i] = s;
+    ix->offs[i] = off;
+    return off;
+}
+
+/* conta os nós da árvore (iterativo, pilha explícita que cresce) */
+static size_t contar_salas(const Sala *raiz) {
+    size_t n = 0, k = 0, cap = 64;
+    const Sala **pilha = malloc(cap * sizeof(*pilha));
+    if (!pilha || !raiz) {
+        free(pilha);
+        return 0;
+    }
+    pilha[k++] = raiz;
+    while (k > 0) {
+        const Sala *s = pilha[--k];
+        ++n;
+        if (k + 2 > cap) {
+            const Sala **tmp = realloc(pilha, cap * 2 * sizeof(*pilha));
+            if (!tmp) { free(pilha); return 0; }
+            pilha = tmp;
+            cap *= 2;
+        }
+        if (s->dir) pilha[k++] = s->dir;
+        if (s->esq) pilha[k++] = s->esq;
+    }
+    free(pilha);
+    return n;
+}
+
+/**
+ * mapaPlanoDeSalas(raiz)
+ * Converte a árvore de ponteiros para o layout plano: salas em ordem de
+ * largura num único vetor, filhos como índices de 32 bits, nomes e pistas
+ * num pool separado (cada string distinta uma única vez).
+ * Retorna NULL em caso de erro (ou árvore vazia / grande demais).
+ */
+MapaPlano *mapaPlanoDeSalas(const Sala *raiz) {
+    size_t n = contar_salas(raiz);
+    if (n == 0 || n >= SALA_NENHUMA) return NULL;
+    MapaPlano *m = calloc(1, sizeof(MapaPlano));
+    const Sala **fila = malloc(n * sizeof(*fila));
+    PoolIndice ix = { NULL, NULL, 16 };
+    while (ix.cap < 2 * n) ix.cap *= 2;   /* até 2 strings por sala */
+    ix.chaves = calloc(ix.cap, sizeof(*ix.chaves));
+    ix.offs = malloc(ix.cap * sizeof(*ix.offs));
+    if (m) m->salas = malloc(n * sizeof(SalaPlana));
+    if (!m || !m->salas || !fila || !ix.chaves || !ix.offs) goto erro;
+
+    size_t cap_pool = 0, ini = 0, fim = 0;
+    fila[fim++] = raiz;
+    while (ini < fim) {
+        const Sala *s = fila[ini];
+        SalaPlana *sp = &m->salas[ini++];
+        sp->nome = pool_offset(&ix, m, &cap_pool, s->nome ? s->nome : "");
+        sp->pista = s->pista ? pool_offset(&ix, m, &cap_pool, s->pista) : SALA_SEM_PISTA;
+        if (sp->nome == SALA_SEM_PISTA) goto erro;
+        sp->esq = sp->dir = SALA_NENHUMA;
+        if (s->esq) { sp->esq = (uint32_t)fim; fila[fim++] = s->esq; }
+        if (s->dir) { sp->dir = (uint32_t)fim; fila[fim++] = s->dir; }
+    }
+    m->n = (uint32_t)n;
+    free(fila);
+    free(ix.chaves);
+    free(ix.offs);
+    return m;
+
+erro:
+    fprintf(stderr, "Erro: falha ao converter mapa para layout plano.\n");
+    if (m) {
+        free(m->salas);
+        free(m->pool);
+    }
+    free(m);
+    free(fila);
+    free(ix.chaves);
+    free(ix.offs);
+    return NULL;
+}
+
+/* libera um mapa plano (vetor de salas + pool: duas liberações) */
+void liberarMapaPlano(MapaPlano *m) {
+    if (!m) return;
+    free(m->salas);
+    free(m->pool);
+    free(m);
+}
+
+/* --- operações do mapa sobre a árvore de ponteiros (NoMapa = Sala*) --- */
+
+static NoMapa salas_raiz(void *d) { return (NoMapa)(uintptr_t)d; }
+static const char *salas_nome(void *d, NoMapa no) {
+    (void)d;
+    return ((const Sala *)(uintptr_t)no)->nome;
+}
+static const char *salas_pista(void *d, NoMapa no) {
+    (void)d;
+    return ((const Sala *)(uintptr_t)no)->pista;
+}
+static NoMapa salas_esq(void *d, NoMapa no) {
+    (void)d;
+    return (NoMapa)(uintptr_t)((const Sala *)(uintptr_t)no)->esq;
+}
+static NoMapa salas_dir(void *d, NoMapa no) {
+    (void)d;
+    return (NoMapa)(uintptr_t)((const Sala *)(uintptr_t)no)->dir;
+}
+
+static const MapaOps mapa_salas_ops = { salas_raiz, salas_nome, salas_pista, salas_esq, salas_dir };
+
+/* --- operações do mapa sobre o layout plano (NoMapa = índice + 1) --- */
+
+static NoMapa plano_raiz(void *d) { return ((MapaPlano *)d)->n ? 1 : 0; }
+static const char *plano_nome(void *d, NoMapa no) {
+    MapaPlano *m = d;
+    return m->pool + m->salas[no - 1].nome;
+}
+static const char *plano_pista(void *d, NoMapa no) {
+    MapaPlano *m = d;
+    uint32_t off = m->salas[no - 1].pista;
+    return off == SALA_SEM_PISTA ? NULL : m->pool + off;
+}
+static NoMapa plano_esq(void *d, NoMapa no) {
+    uint32_t i = ((MapaPlano *)d)->salas[no - 1].esq;
+    return i == SALA_NENHUMA ? 0 : (NoMapa)i + 1;
+}
+static NoMapa plano_dir(void *d, NoMapa no) {
+    uint32_t i = ((MapaPlano *)d)->salas[no - 1].dir;
+    return i == SALA_NENHUMA ? 0 : (NoMapa)i + 1;
+}
+
+static const MapaOps mapa_plano_ops = { plano_raiz, plano_nome, plano_pista, plano_esq, plano_dir };
+
+/* visão genérica de uma árvore de salas */
+Mapa mapaDeSalas(Sala *raiz) {
+    Mapa m = { &mapa_salas_ops, raiz };
+    return m;
+}
+
+/* visão genérica de um mapa plano */
+Mapa mapaDePlano(MapaPlano *plano) {
+    Mapa m = { &mapa_plano_ops, plano };
+    return m;
+}
+
+/* ===========================
+   Funções para BST de pistas
+   =========================== */
+
+/* altura máxima de uma AVL com até 2^64 nós (< 1.44 * log2 n): dimensiona
+   as pilhas explícitas das travessias, que não usam recursão */
+#define PISTA_ALTURA_MAX 96
+
+static inline int pista_altura(const PistaNode *n) {
+    return n ? n->altura : 0;
+}
+
+static inline void pista_atualizar_altura(PistaNode *n) {
+    int he = pista_altura(n->esq), hd = pista_altura(n->dir);
+    n->altura = 1 + (he > hd ? he : hd);
+}
+
+static PistaNode *pista_rotacao_dir(PistaNode *n) {
+    PistaNode *e = n->esq;
+    n->esq = e->dir;
+    e->dir = n;
+    pista_atualizar_altura(n);
+    pista_atualizar_altura(e);
+    return e;
+}
+
+static PistaNode *pista_rotacao_esq(PistaNode *n) {
+    PistaNode *d = n->dir;
+    n->dir = d->esq;
+    d->esq = n;
+    pista_atualizar_altura(n);
+    pista_atualizar_altura(d);
+    return d;
+}
+
+/* restaura o invariante AVL em 'n' (filhos já balanceados); retorna a nova raiz */
+static PistaNode *pista_balancear(PistaNode *n) {
+    pista_atualizar_altura(n);
+    int fb = pista_altura(n->esq) - pista_altura(n->dir);
+    if (fb > 1) {
+        if (pista_altura(n->esq->esq) < pista_altura(n->esq->dir))
+            n->esq = pista_rotacao_esq(n->esq);
+        return pista_rotacao_dir(n);
+    }
+    if (fb < -1) {
+        if (pista_altura(n->dir->dir) < pista_altura(n->dir->esq))
+            n->dir = pista_rotacao_dir(n->dir);
+        return pista_rotacao_esq(n);
+    }
+    return n;
+}
+
+/* núcleo de inserirPistaEm; *nova = 1 quando a pista entrou agora */
+static PistaNode *pista_inserir(Arena *arena, PistaNode *raiz, const char *pista, int *nova) {
+    *nova = 0;
+    if (!pista || pista[0] == '\0') return raiz;
+    const char *p = intern(pista);
+    if (!p) return raiz;
+
+    /* desce guardando os ponteiros que apontam para cada nó do caminho */
+    PistaNode **caminho[PISTA_ALTURA_MAX];
+    int k = 0;
+    PistaNode **pp = &raiz;
+    while (*pp) {
+        if ((*pp)->pista == p) {
+            /* já coletada — não duplicar (internadas: igualdade = mesmo ponteiro) */
+            INSTR_SOMAR(CONT_BST_INSERCOES, 1);
+            INSTR_SOMAR(CONT_BST_COMPARACOES, (uint64_t)k);
+            INSTR_MAXIMO(CONT_BST_PROFUNDIDADE_MAX, (uint64_t)k);
+            return raiz;
+        }
+        caminho[k++] = pp;
+        int c = strcmp(p, (*pp)->pista);
+        pp = (c < 0) ? &(*pp)->esq : &(*pp)->dir;
+    }
+    INSTR_SOMAR(CONT_BST_INSERCOES, 1);
+    INSTR_SOMAR(CONT_BST_COMPARACOES, (uint64_t)k);
+    INSTR_MAXIMO(CONT_BST_PROFUNDIDADE_MAX, (uint64_t)k);
+
+    PistaNode *n = arena ? arena_alloc(arena, sizeof(PistaNode))
+                         : mem_alloc(sizeof(PistaNode));
+    if (!n) {
+        fprintf(stderr, "Erro: alocação PistaNode.\n");
+        return raiz;
+    }
+    n->pista = p;
+    n->esq = n->dir = NULL;
+    n->altura = 1;
+    *pp = n;
+    *nova = 1;
+
+    /* sobe rebalanceando; para quando a altura de uma subárvore não muda */
+    while (k > 0) {
+        PistaNode **q = caminho[--k];
+        int antes = (*q)->altura;
+        *q = pista_balancear(*q);
+        if ((*q)->altura == antes) break;
+    }
+    return raiz;
+}
+
+/* inserirPistaEm(arena, raiz, pista)
+ * Insere 'pista' na BST ordenada por strcmp. Evita duplicatas.
+ * A árvore é AVL: continua com altura O(log n) mesmo quando as pistas
+ * chegam em ordem alfabética, e a inserção é iterativa (sem recursão).
+ * Com arena != NULL, os nós vêm da arena (não usar liberarPistas).
+ * Retorna a raiz (possivelmente atualizada).
+ */
+PistaNode *inserirPistaEm(Arena *arena, PistaNode *raiz, const char *pista) {
+    int nova;
+    return pista_inserir(arena, raiz, pista, &nova);
+}
+
+/* inserirPista(raiz, pista): versão no heap (ver inserirPistaEm) */
+PistaNode *inserirPista(PistaNode *raiz, const char *pista) {
+    return inserirPistaEm(NULL, raiz, pista);
+}
+
+/* percorre a árvore em ordem (iterativo, pilha explícita) chamando 'visita' */
+static void pista_percorrer(PistaNode *raiz, void (*visita)(PistaNode *, void *), void *ctx) {
+    PistaNode *pilha[PISTA_ALTURA_MAX];
+    int k = 0;
+    PistaNode *n = raiz;
+    while (n || k > 0) {
+        while (n) {
+            pilha[k++] = n;
+            n = n->esq;
+        }
+        n = pilha[--k];
+        visita(n, ctx);
+        n = n->dir;
+    }
+}
+
+static void exibir_pista_visita(PistaNode *n, void *ctx) {
+    Saida *out = ctx;
+    saida_lit(out, " - ");
+    saida_texto(out, n->pista);
+    saida_char(out, '\n');
+}
+
+/* exibirPistas(out, raiz): percorre em ordem e imprime */
+void exibirPistas(Saida *out, PistaNode *raiz) {
+    pista_percorrer(raiz, exibir_pista_visita, out);
+}
+
+/* liberar BST de pistas (iterativo: rotaciona à direita até não haver
+   filho esquerdo, então libera o nó e segue pela direita) */
+void liberarPistas(PistaNode *raiz) {
+    while (raiz) {
+        if (raiz->esq) {
+            PistaNode *e = raiz->esq;
+            raiz->esq = e->dir;
+            e->dir = raiz;
+            raiz = e;
+        } else {
+            PistaNode *d = raiz->dir;
+            mem_free(raiz);
+            raiz = d;
+        }
+    }
+}
+
+/* ===========================
+   Tabela Hash (pista -> suspeito)
+   =========================== */
+
+/* carga máxima da tabela aberta: cresce ao passar de 7/8 */
+#define HASH_ABERTA_CARGA_NUM 7
+#define HASH_ABERTA_CARGA_DEN 8
+
+/* ---- Modo concorrente: leitura sem travas, escrita publicada (RCU) ----
+ *
+ * Leitores (encontrarSuspeito) nunca travam: entram numa seção de leitura
+ * anunciando a época global num slot próprio e percorrem baldes e listas
+ * por ponteiros atômicos. Escritores (inserirNaHash) são serializados por
+ * uma trava da tabela e só publicam: nó novo entra no topo do balde com um
+ * store release; troca de suspeito é um store atômico (as strings vêm de
+ * um interner da própria tabela e vivem até liberarHash); o crescimento
+ * monta um vetor de baldes novo (com cópias dos nós) e o publica de uma
+ * vez. O vetor antigo vai para a lista de aposentados e só é liberado
+ * quando todo leitor ativo entrou depois da aposentadoria.
+ */
+
+/* slots de leitores simultâneos (um por thread viva que já leu) */
+#define RCU_MAX_LEITORES 256
+
+/* slot de um leitor (uma linha de cache, para não haver falso compartilhamento) */
+typedef struct RcuLeitor {
+    atomic_uint_fast64_t epoca;        /* 0 = fora de seção de leitura */
+    atomic_int ocupado;
+    char pad[64 - sizeof(atomic_uint_fast64_t) - sizeof(atomic_int)];
+} RcuLeitor;
+
+static RcuLeitor rcu_leitores[RCU_MAX_LEITORES];
+static atomic_uint_fast64_t rcu_epoca = 1;
+static _Thread_local RcuLeitor *rcu_meu = NULL;
+
+#ifdef DQ_POSIX
+/* ao terminar a thread, o slot volta a ficar livre */
+static pthread_key_t rcu_chave;
+static pthread_once_t rcu_uma_vez = PTHREAD_ONCE_INIT;
+
+static void rcu_soltar_slot(void *p) {
+    RcuLeitor *l = p;
+    atomic_store(&l->epoca, 0);
+    atomic_store(&l->ocupado, 0);
+}
+
+static void rcu_criar_chave(void) {
+    pthread_key_create(&rcu_chave, rcu_soltar_slot);
+}
+#endif
+
+/* slot da thread atual (NULL se todos estiverem ocupados) */
+static RcuLeitor *rcu_slot(void) {
+    if (rcu_meu) return rcu_meu;
+#ifdef DQ_POSIX
+    pthread_once(&rcu_uma_vez, rcu_criar_chave);
+#endif
+    for (size_t i = 0; i < RCU_MAX_LEITORES; ++i) {
+        int livre = 0;
+        if (atomic_compare_exchange_strong(&rcu_leitores[i].ocupado, &livre, 1)) {
+            rcu_meu = &rcu_leitores[i];
+#ifdef DQ_POSIX
+            pthread_setspecific(rcu_chave, rcu_meu);
+#endif
+            return rcu_meu;
+        }
+    }
+    return NULL;
+}
+
+/* início da seção de leitura: anuncia a época antes de ler qualquer ponteiro */
+static inline void rcu_entrar(RcuLeitor *l) {
+    atomic_store(&l->epoca, atomic_load(&rcu_epoca));
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static inline void rcu_sair(RcuLeitor *l) {
+    atomic_store_explicit(&l->epoca, 0, memory_order_release);
+}
+
+/* nó de uma lista da tabela concorrente (chave imutável depois de publicado) */
+typedef struct HashNoC {
+    const char *chave;
+    _Atomic(const char *) suspeito;
+    uint32_t hash;
+    _Atomic(struct HashNoC *) prox;
+} HashNoC;
+
+/* vetor de baldes publicado de uma vez */
+typedef struct BaldesC {
+    size_t tam;                        /* potência de 2 */
+    _Atomic(HashNoC *) b[];
+} BaldesC;
+
+/* vetor de baldes aposentado, à espera dos leitores */
+typedef struct RcuAposentado {
+    BaldesC *baldes;
+    uint_fast64_t epoca;
+    struct RcuAposentado *prox;
+} RcuAposentado;
+
+/* estado do modo concorrente */
+typedef struct HashConc {
+    _Atomic(BaldesC *) baldes;
+    Interner *nomes;                   /* chaves e suspeitos (só o escritor usa) */
+    RcuAposentado *aposentados;
+    size_t n_aposentados, n_recolhidos;
+#ifdef DQ_POSIX
+    pthread_mutex_t trava;             /* só entre escritores */
+#endif
+} HashConc;
+
+static void conc_travar(HashConc *c) {
+#ifdef DQ_POSIX
+    pthread_mutex_lock(&c->trava);
+#else
+    (void)c;
+#endif
+}
+
+static void conc_destravar(HashConc *c) {
+#ifdef DQ_POSIX
+    pthread_mutex_unlock(&c->trava);
+#else
+    (void)c;
+#endif
+}
+
+static BaldesC *baldes_novos(size_t tam) {
+    BaldesC *bs = mem_alloc(sizeof(BaldesC) + tam * sizeof(_Atomic(HashNoC *)));
+    if (!bs) return NULL;
+    bs->tam = tam;
+    for (size_t i = 0; i < tam; ++i) atomic_init(&bs->b[i], NULL);
+    return bs;
+}
+
+/* libera um vetor de baldes e todos os nós dele (sem leitores nele) */
+static void baldes_liberar(BaldesC *bs) {
+    if (!bs) return;
+    for (size_t i = 0; i < bs->tam; ++i) {
+        HashNoC *e = atomic_load_explicit(&bs->b[i], memory_order_relaxed);
+        while (e) {
+            HashNoC *t = atomic_load_explicit(&e->prox, memory_order_relaxed);
+            mem_free(e);
+            e = t;
+        }
+    }
+    mem_free(bs);
+}
+
+/* libera os aposentados que nenhum leitor ativo pode estar vendo;
+   'tudo' = 1 na destruição da tabela */
+static void conc_recolher(HashConc *c, int tudo) {
+    uint_fast64_t minima = UINT_FAST64_MAX;
+    for (size_t i = 0; !tudo && i < RCU_MAX_LEITORES; ++i) {
+        uint_fast64_t e = atomic_load(&rcu_leitores[i].epoca);
+        if (e && e < minima) minima = e;
+    }
+    RcuAposentado **pp = &c->aposentados;
+    while (*pp) {
+        RcuAposentado *a = *pp;
+        if (tudo || a->epoca < minima) {
+            *pp = a->prox;
+            baldes_liberar(a->baldes);
+            mem_free(a);
+            c->n_recolhidos += 1;
+        } else {
+            pp = &a->prox;
+        }
+    }
+}
+
+static HashConc *conc_criar(size_t tam) {
+    HashConc *c = mem_calloc(1, sizeof(HashConc));
+    if (!c) return NULL;
+    BaldesC *bs = baldes_novos(tam);
+    c->nomes = interner_criar();
+    if (!bs || !c->nomes) {
+        mem_free(bs);
+        interner_liberar(c->nomes);
+        mem_free(c);
+        return NULL;
+    }
+    atomic_init(&c->baldes, bs);
+#ifdef DQ_POSIX
+    pthread_mutex_init(&c->trava, NULL);
+#endif
+    return c;
+}
+
+static void conc_liberar(HashConc *c) {
+    if (!c) return;
+    conc_recolher(c, 1);
+    baldes_liberar(atomic_load(&c->baldes));
+    interner_liberar(c->nomes);
+#ifdef DQ_POSIX
+    pthread_mutex_destroy(&c->trava);
+#endif
+    mem_free(c);
+}
+
+/* dobra os baldes: cópias dos nós num vetor novo, publicado de uma vez
+   (os leitores que estão no vetor antigo continuam vendo listas íntegras) */
+static int conc_crescer(HashConc *c) {
+    BaldesC *velho = atomic_load_explicit(&c->baldes, memory_order_relaxed);
+    BaldesC *novo = baldes_novos(velho->tam * 2);
+    RcuAposentado *a = mem_alloc(sizeof(RcuAposentado));
+    if (!novo || !a) {
+        mem_free(novo);
+        mem_free(a);
+        return -1;
+    }
+    size_t mask = novo->tam - 1;
+    for (size_t i = 0; i < velho->tam; ++i) {
+        for (HashNoC *e = atomic_load_explicit(&velho->b[i], memory_order_relaxed); e;
+             e = atomic_load_explicit(&e->prox, memory_order_relaxed)) {
+            HashNoC *cp = mem_alloc(sizeof(HashNoC));
+            if (!cp) {
+                baldes_liberar(novo);
+                mem_free(a);
+                return -1;
+            }
+            cp->chave = e->chave;
+            cp->hash = e->hash;
+            atomic_init(&cp->suspeito, atomic_load_explicit(&e->suspeito, memory_order_relaxed));
+            atomic_init(&cp->prox, atomic_load_explicit(&novo->b[e->hash & mask], memory_order_relaxed));
+            atomic_init(&novo->b[e->hash & mask], cp);
+        }
+    }
+    atomic_store(&c->baldes, novo);
+    /* a época avança: quem entrar daqui em diante só vê o vetor novo */
+    a->baldes = velho;
+    a->epoca = atomic_fetch_add(&rcu_epoca, 1);
+    a->prox = c->aposentados;
+    c->aposentados = a;
+    c->n_aposentados += 1;
+    return 0;
+}
+
+/**
+ * criarHashConfig(cfg)
+ * Cria a tabela conforme 'cfg' (organização, tamanho, função de hash e
+ * semente). Sem semente explícita, cada tabela sorteia a sua: quem monta um
+ * arquivo de caso não consegue prever colisões. Tamanhos em potência de 2
+ * usam máscara no lugar do módulo.
+ */
+HashTable *criarHashConfig(const HashConfig *cfg) {
+    size_t tam = cfg->tamanho ? cfg->tamanho : 1;
+    if (cfg->modo == HASH_ABERTA) {
+        size_t cap = tam;
+        tam = 8;
+        while (tam * HASH_ABERTA_CARGA_NUM < cap * HASH_ABERTA_CARGA_DEN) tam *= 2;
+    } else if (!cfg->modulo) {
+        size_t p2 = 1;
+        while (p2 < tam) p2 *= 2;
+        tam = p2;
+    }
+    HashTable *h = mem_calloc(1, sizeof(HashTable));
+    if (!h) return NULL;
+    if (cfg->modo == HASH_ABERTA)
+        h->slots = mem_calloc(tam, sizeof(HashSlot));
+    else if (cfg->modo == HASH_CONCORRENTE)
+        h->conc = conc_criar(tam);
+    else
+        h->buckets = mem_calloc(tam, sizeof(HashEntry *));
+    if (!h->slots && !h->buckets && !h->conc) {
+        mem_free(h);
+        return NULL;
+    }
+    h->modo = cfg->modo;
+    h->tamanho = tam;
+    h->mascara = (tam & (tam - 1)) == 0 ? tam - 1 : 0;
+    h->fn = cfg->fn ? cfg->fn : hash_wy;
+    h->semente = cfg->semente ? cfg->semente : semente_aleatoria();
+    h->arena = cfg->modo == HASH_ENCADEADA ? cfg->arena : NULL;
+    return h;
+}
+
+/* criar tabela hash com 'tamanho' buckets (arredondado para potência de 2);
+   entradas vêm da arena (se houver) */
+HashTable *criarHashEm(Arena *arena, size_t tamanho) {
+    HashConfig cfg = { HASH_ENCADEADA, tamanho, NULL, 0, 0, arena };
+    return criarHashConfig(&cfg);
+}
+
+/**
+ * criarHashAberta(capacidade)
+ * Cria a variante de endereçamento aberto (Robin Hood, sondagem linear):
+ * os slots ficam num único vetor contíguo e a tabela dobra de tamanho
+ * quando a carga passa de 7/8. 'capacidade' é só a estimativa inicial.
+ * Usa a mesma API: inserirNaHash / encontrarSuspeito / liberarHash.
+ */
+HashTable *criarHashAberta(size_t capacidade) {
+    HashConfig cfg = { HASH_ABERTA, capacidade, NULL, 0, 0, NULL };
+    return criarHashConfig(&cfg);
+}
+
+/* criar tabela hash com 'tamanho' buckets */
+HashTable *criarHash(size_t tamanho) {
+    return criarHashEm(NULL, tamanho);
+}
+
+/* posição inexistente no conjunto de suspeitos */
+#define SUSPEITO_NENHUM SIZE_MAX
+
+/* posição do suspeito (comparação por ponteiro) ou SUSPEITO_NENHUM */
+static size_t suspeito_pos(const SuspeitoSet *c, const char *nome) {
+    if (!c->cap_idx) {
+        /* conjunto estático (caso embutido): sem índice, nomes em ordem de
+           endereço como os deixa hashSuspeitos; busca binária */
+        size_t lo = 0, hi = c->n;
+        while (lo < hi) {
+            size_t m = lo + (hi - lo) / 2;
+            if (c->nomes[m] == nome) return m;
+            if ((uintptr_t)c->nomes[m] < (uintptr_t)nome) lo = m + 1;
+            else hi = m;
+        }
+        return SUSPEITO_NENHUM;
+    }
+    size_t mask = c->cap_idx - 1;
+    for (size_t i = (size_t)hash_misturar_ptr(nome) & mask; c->idx[i]; i = (i + 1) & mask)
+        if (c->nomes[c->idx[i] - 1] == nome) return c->idx[i] - 1;
+    return SUSPEITO_NENHUM;
+}
+
+/* dobra o índice (carga <= 1/2) e os vetores por posição */
+static int suspeito_crescer(SuspeitoSet *c) {
+    size_t cap = c->cap_idx ? c->cap_idx * 2 : 16;
+    uint32_t *idx = mem_calloc(cap, sizeof(uint32_t));
+    const char **nomes = mem_alloc(cap / 2 * sizeof(const char *));
+    uint32_t *refs = mem_alloc(cap / 2 * sizeof(uint32_t));
+    if (!idx || !nomes || !refs) {
+        mem_free(idx);
+        mem_free((void *)nomes);
+        mem_free(refs);
+        return -1;
+    }
+    for (size_t p = 0; p < c->n; ++p) {
+        size_t i = (size_t)hash_misturar_ptr(c->nomes[p]) & (cap - 1);
+        while (idx[i]) i = (i + 1) & (cap - 1);
+        idx[i] = (uint32_t)(p + 1);
+    }
+    if (c->n) {
+        memcpy((void *)nomes, (const void *)c->nomes, c->n * sizeof(const char *));
+        memcpy(refs, c->refs, c->n * sizeof(uint32_t));
+    }
+    mem_free(c->idx);
+    mem_free((void *)c->nomes);
+    mem_free(c->refs);
+    c->idx = idx;
+    c->nomes = nomes;
+    c->refs = refs;
+    c->cap_idx = cap;
+    return 0;
+}
+
+/* mais uma associação aponta para 'nome' (entra no conjunto se for novo) */
+static void suspeito_reter(SuspeitoSet *c, const char *nome) {
+    size_t p = suspeito_pos(c, nome);
+    if (p == SUSPEITO_NENHUM) {
+        if ((c->n + 1) * 2 > c->cap_idx && suspeito_crescer(c) != 0) {
+            fprintf(stderr, "Erro: alocar conjunto de suspeitos\n");
+            return;
+        }
+        size_t mask = c->cap_idx - 1;
+        size_t i = (size_t)hash_misturar_ptr(nome) & mask;
+        while (c->idx[i]) i = (i + 1) & mask;
+        p = c->n++;
+        c->idx[i] = (uint32_t)(p + 1);
+        c->nomes[p] = nome;
+        c->refs[p] = 0;
+    }
+    if (c->refs[p]++ == 0) c->vivos += 1;
+}
+
+/* uma associação deixou de apontar para 'nome' (a posição continua) */
+static void suspeito_soltar(SuspeitoSet *c, const char *nome) {
+    size_t p = suspeito_pos(c, nome);
+    if (p != SUSPEITO_NENHUM && c->refs[p] > 0 && --c->refs[p] == 0) c->vivos -= 1;
+}
+
+static void suspeito_liberar(SuspeitoSet *c) {
+    mem_free(c->idx);
+    mem_free((void *)c->nomes);
+    mem_free(c->refs);
+    memset(c, 0, sizeof(*c));
+}
+
+static void indice_nomes_liberar(IndiceNomes *ix) {
+    if (!ix) return;
+    mem_free(ix->chaves);
+    mem_free(ix->off);
+    mem_free(ix->ordem);
+    mem_free(ix->slots);
+    mem_free(ix);
+}
+
+/* hash de 'len' bytes com a função e a semente da tabela */
+static inline uint32_t hash_da_tabela(const HashTable *ht, const char *s, size_t len) {
+    return (uint32_t)ht->fn(s, len, ht->semente);
+}
+
+/* balde/slot ideal para um hash */
+static inline size_t hash_indice(const HashTable *ht, uint32_t h) {
+    return ht->mascara ? (h & ht->mascara) : (h % ht->tamanho);
+}
+
+/* igualdade de chave: ponteiro (internadas) antes de cair no strcmp */
+static inline int hash_chave_igual(const char *chave, uint32_t hc, const char *pista, uint32_t h) {
+    return hc == h && (chave == pista || strcmp(chave, pista) == 0);
+}
+
+/* colocação Robin Hood de 'novo' (chave ausente) a partir do slot 'i', onde
+   'novo.dist' já é a distância de 'i' ao slot ideal: quem está mais longe
+   do slot ideal fica com a posição */
+static void hash_aberta_colocar_de(HashSlot *slots, size_t tam, HashSlot novo, size_t i) {
+    size_t mask = tam - 1;
+    while (slots[i].chave) {
+        if (slots[i].dist < novo.dist) {
+            HashSlot t = slots[i];
+            slots[i] = novo;
+            novo = t;
+        }
+        i = (i + 1) & mask;
+        novo.dist += 1;
+    }
+    slots[i] = novo;
+}
+
+/* insere um slot já preenchido (chave ausente) nos slots de tamanho 'tam' */
+static void hash_aberta_colocar(HashSlot *slots, size_t tam, HashSlot novo) {
+    novo.dist = 0;
+    hash_aberta_colocar_de(slots, tam, novo, novo.hash & (tam - 1));
+}
+
+/* dobra o vetor de slots e reposiciona todas as entradas */
+static int hash_aberta_crescer(HashTable *ht) {
+    size_t nova = ht->tamanho * 2;
+    HashSlot *slots = mem_calloc(nova, sizeof(HashSlot));
+    if (!slots) return -1;
+    for (size_t i = 0; i < ht->tamanho; ++i)
+        if (ht->slots[i].chave) hash_aberta_colocar(slots, nova, ht->slots[i]);
+    mem_free(ht->slots);
+    ht->slots = slots;
+    ht->tamanho = nova;
+    return 0;
+}
+
+/* busca na tabela aberta: slot da chave 'pista' (de hash 'hash') ou NULL */
+static HashSlot *hash_aberta_buscar(const HashTable *ht, const char *pista, uint32_t hash) {
+    size_t mask = ht->tamanho - 1;
+    size_t i = hash & mask;
+    for (uint32_t dist = 0;; ++dist) {
+        HashSlot *sl = &ht->slots[i];
+        /* slot vazio ou vizinho mais perto do ideal: a chave não está aqui */
+        if (!sl->chave || sl->dist < dist) {
+            INSTR_SONDAS(dist + 1);
+            return NULL;
+        }
+        if (hash_chave_igual(sl->chave, sl->hash, pista, hash)) {
+            INSTR_SONDAS(dist + 1);
+            return sl;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+/* garante espaço para 'n' associações na tabela aberta (carga <= 7/8) */
+static int hash_aberta_reservar(HashTable *ht, size_t n) {
+    while (n * HASH_ABERTA_CARGA_DEN > ht->tamanho * HASH_ABERTA_CARGA_NUM)
+        if (hash_aberta_crescer(ht) != 0) return -1;
+    return 0;
+}
+
+/* sondagem e colocação numa só passada: pela invariante Robin Hood, se a
+   chave (internada) existe ela aparece antes do primeiro slot "mais rico".
+   Retorna 1 se inseriu, 0 se só substituiu o suspeito. Exige espaço livre. */
+static int hash_aberta_por(HashTable *ht, const char *pista, const char *suspeito,
+                           uint32_t hash) {
+    size_t mask = ht->tamanho - 1;
+    size_t i = hash & mask;
+    HashSlot novo = { pista, suspeito, hash, 0 };
+    for (;; i = (i + 1) & mask, novo.dist += 1) {
+        HashSlot *sl = &ht->slots[i];
+        if (!sl->chave) break;
+        if (sl->dist < novo.dist) {
+            /* a chave não existe: coloca aqui e empurra o resto adiante */
+            HashSlot t = *sl;
+            *sl = novo;
+            t.dist += 1;
+            hash_aberta_colocar_de(ht->slots, ht->tamanho, t, (i + 1) & mask);
+            suspeito_reter(&ht->sus, suspeito);
+            return 1;
+        }
+        if (sl->hash == hash && sl->chave == pista) {
+            suspeito_reter(&ht->sus, suspeito);
+            suspeito_soltar(&ht->sus, sl->suspeito);
+            sl->suspeito = suspeito;
+            return 0;
+        }
+    }
+    ht->slots[i] = novo;
+    suspeito_reter(&ht->sus, suspeito);
+    return 1;
+}
+
+/* inserção na tabela aberta (chave e suspeito já internados) */
+static void hash_aberta_inserir(HashTable *ht, const char *pista, const char *suspeito,
+                                uint32_t hash) {
+    if (hash_aberta_reservar(ht, ht->n + 1) != 0) {
+        fprintf(stderr, "Erro: alocar slots da hash\n");
+        return;
+    }
+    ht->n += (size_t)hash_aberta_por(ht, pista, suspeito, hash);
+}
+
+/* inserção no modo concorrente (um escritor por vez; leitores seguem livres) */
+static void conc_inserir(HashTable *ht, const char *pista, const char *suspeito) {
+    HashConc *c = ht->conc;
+    conc_travar(c);
+    pista = internar(c->nomes, pista);
+    suspeito = internar(c->nomes, suspeito);
+    if (!pista || !suspeito) {
+        conc_destravar(c);
+        return;
+    }
+    uint32_t hash = hash_da_tabela(ht, pista, strlen(pista));
+    BaldesC *bs = atomic_load_explicit(&c->baldes, memory_order_relaxed);
+    _Atomic(HashNoC *) *balde = &bs->b[hash & (bs->tam - 1)];
+    for (HashNoC *e = atomic_load_explicit(balde, memory_order_relaxed); e;
+         e = atomic_load_explicit(&e->prox, memory_order_relaxed)) {
+        if (e->chave == pista) {
+            suspeito_reter(&ht->sus, suspeito);
+            suspeito_soltar(&ht->sus, atomic_load_explicit(&e->suspeito, memory_order_relaxed));
+            atomic_store_explicit(&e->suspeito, suspeito, memory_order_release);
+            conc_destravar(c);
+            return;
+        }
+    }
+    HashNoC *novo = mem_alloc(sizeof(HashNoC));
+    if (!novo) {
+        fprintf(stderr, "Erro: alocar nó da hash\n");
+        conc_destravar(c);
+        return;
+    }
+    novo->chave = pista;
+    novo->hash = hash;
+    atomic_init(&novo->suspeito, suspeito);
+    atomic_init(&novo->prox, atomic_load_explicit(balde, memory_order_relaxed));
+    atomic_store_explicit(balde, novo, memory_order_release);
+    ht->n += 1;
+    suspeito_reter(&ht->sus, suspeito);
+    /* carga 1: dobra os baldes */
+    if (ht->n > bs->tam && conc_crescer(c) != 0)
+        fprintf(stderr, "Erro: crescer baldes da hash\n");
+    if (c->aposentados) conc_recolher(c, 0);
+    conc_destravar(c);
+}
+
+/* busca na lista de um vetor de baldes (dentro de uma seção de leitura) */
+static const char *conc_procurar(BaldesC *bs, const char *pista, uint32_t hash) {
+    uint32_t sondas = 0;
+    for (HashNoC *e = atomic_load_explicit(&bs->b[hash & (bs->tam - 1)], memory_order_acquire); e;
+         e = atomic_load_explicit(&e->prox, memory_order_acquire)) {
+        ++sondas;
+        if (e->hash == hash && strcmp(e->chave, pista) == 0) {
+            INSTR_SONDAS(sondas);
+            return atomic_load_explicit(&e->suspeito, memory_order_acquire);
+        }
+    }
+    INSTR_SONDAS(sondas);
+    return NULL;
+}
+
+/* leitura sem travas; só com todos os slots de leitor ocupados cai na trava */
+static const char *conc_buscar(HashTable *ht, const char *pista, uint32_t hash) {
+    HashConc *c = ht->conc;
+    RcuLeitor *l = rcu_slot();
+    if (!l) {
+        conc_travar(c);
+        const char *r = conc_procurar(atomic_load(&c->baldes), pista, hash);
+        conc_destravar(c);
+        return r;
+    }
+    rcu_entrar(l);
+    const char *r = conc_procurar(atomic_load_explicit(&c->baldes, memory_order_acquire), pista, hash);
+    rcu_sair(l);
+    return r;
+}
+
+/**
+ * criarHashConcorrente(tamanho)
+ * Tabela para leitura em muitas threads enquanto outra(s) inserem: buscas
+ * sem travas, inserções publicadas atomicamente e baldes antigos liberados
+ * só depois que os leitores saem deles. Cresce com carga 1.
+ * Listar/contar suspeitos continua sendo operação de uma thread só.
+ */
+HashTable *criarHashConcorrente(size_t tamanho) {
+    HashConfig cfg = { HASH_CONCORRENTE, tamanho, NULL, 0, 0, NULL };
+    return criarHashConfig(&cfg);
+}
+
+/**
+ * inserirNaHash(ht, pista, suspeito)
+ * Insere a associação pista -> suspeito na tabela hash.
+ * Se a chave já existe, sobrescreve o suspeito.
+ */
+void inserirNaHash(HashTable *ht, const char *pista, const char *suspeito) {
+    if (!ht || !pista || !suspeito) return;
+    if (ht->modo == HASH_MAPEADA || ht->modo == HASH_PERFEITA) {
+        fprintf(stderr, "Erro: hash do arquivo de caso (ou congelada) é somente leitura.\n");
+        return;
+    }
+    if (ht->modo == HASH_CONCORRENTE) {
+        conc_inserir(ht, pista, suspeito);
+        return;
+    }
+    pista = intern(pista);
+    suspeito = intern(suspeito);
+    if (!pista || !suspeito) return;
+    uint32_t hash = hash_da_tabela(ht, pista, interner_len(pista));
+    if (ht->modo == HASH_ABERTA) {
+        hash_aberta_inserir(ht, pista, suspeito, hash);
+        return;
+    }
+    size_t h = hash_indice(ht, hash);
+    /* procurar se já existe */
+    HashEntry *ent = ht->buckets[h];
+    while (ent) {
+        if (ent->chave == pista) {
+            /* sobrescreve o suspeito existente */
+            suspeito_reter(&ht->sus, suspeito);
+            suspeito_soltar(&ht->sus, ent->suspeito);
+            ent->suspeito = suspeito;
+            return;
+        }
+        ent = ent->prox;
+    }
+    /* não existe — criar novo */
+    HashEntry *novo = ht->arena ? arena_alloc(ht->arena, sizeof(HashEntry))
+                                : mem_alloc(sizeof(HashEntry));
+    if (!novo) {
+        fprintf(stderr, "Erro: alocar HashEntry\n");
+        return;
+    }
+    novo->chave = pista;
+    novo->suspeito = suspeito;
+    novo->hash = hash;
+    novo->prox = ht->buckets[h];
+    ht->buckets[h] = novo;
+    ht->n += 1;
+    suspeito_reter(&ht->sus, suspeito);
+}
+
+/**
+ * inserirNaHashLote(ht, pistas, suspeitos, n)
+ * Insere 'n' associações de uma vez. A tabela aberta é dimensionada uma
+ * única vez para o total e cada par é colocado numa só sondagem. Em
+ * qualquer modo, chave repetida sobrescreve o suspeito (vale a última),
+ * como em inserirNaHash.
+ */
+void inserirNaHashLote(HashTable *ht, const char *const *pistas,
+                       const char *const *suspeitos, size_t n) {
+    if (!ht || n == 0) return;
+    if (ht->modo == HASH_MAPEADA || ht->modo == HASH_PERFEITA) {
+        fprintf(stderr, "Erro: hash do arquivo de caso (ou congelada) é somente leitura.\n");
+        return;
+    }
+    if (ht->modo == HASH_CONCORRENTE) {
+        for (size_t i = 0; i < n; ++i) conc_inserir(ht, pistas[i], suspeitos[i]);
+        return;
+    }
+    if (ht->modo == HASH_ABERTA && hash_aberta_reservar(ht, ht->n + n) != 0) {
+        fprintf(stderr, "Erro: alocar slots da hash\n");
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const char *pista = intern(pistas[i]);
+        const char *suspeito = intern(suspeitos[i]);
+        if (!pista || !suspeito) continue;
+        uint32_t hash = hash_da_tabela(ht, pista, interner_len(pista));
+        if (ht->modo == HASH_ABERTA) {
+            ht->n += (size_t)hash_aberta_por(ht, pista, suspeito, hash);
+            continue;
+        }
+        size_t h = hash_indice(ht, hash);
+        HashEntry *ent = ht->buckets[h];
+        while (ent && ent->chave != pista) ent = ent->prox;
+        if (ent) {
+            suspeito_reter(&ht->sus, suspeito);
+            suspeito_soltar(&ht->sus, ent->suspeito);
+            ent->suspeito = suspeito;
+            continue;
+        }
+        HashEntry *novo = ht->arena ? arena_alloc(ht->arena, sizeof(HashEntry))
+                                    : mem_alloc(sizeof(HashEntry));
+        if (!novo) {
+            fprintf(stderr, "Erro: alocar HashEntry\n");
+            return;
+        }
+        novo->chave = pista;
+        novo->suspeito = suspeito;
+        novo->hash = hash;
+        novo->prox = ht->buckets[h];
+        ht->buckets[h] = novo;
+        ht->n += 1;
+        suspeito_reter(&ht->sus, suspeito);
+    }
+}
+
+/* marca de slot vazio na hash do arquivo */
+#define CASO_SLOT_VAZIO UINT32_MAX
+
+/* busca na hash mapeada do arquivo (mesma sondagem Robin Hood) */
+static const CasoSlot *caso_hash_buscar(const HashTable *ht, const char *pista, uint32_t hash) {
+    size_t mask = ht->tamanho - 1;
+    size_t i = hash & mask;
+    for (uint32_t dist = 0;; ++dist) {
+        const CasoSlot *sl = &ht->mslots[i];
+        if (sl->chave == CASO_SLOT_VAZIO || sl->dist < dist) {
+            INSTR_SONDAS(dist + 1);
+            return NULL;
+        }
+        if (sl->hash == hash && strcmp(ht->mpool + sl->chave, pista) == 0) {
+            INSTR_SONDAS(dist + 1);
+            return sl;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+/*
+ * Hash perfeita mínima (CHD simplificado): o hash de 64 bits da chave
+ * escolhe um balde (~PERFEITA_LAMBDA chaves por balde); o deslocamento do
+ * balde leva cada chave dele a uma posição própria em [0, n). Baldes de uma
+ * chave só guardam a posição direto (PERFEITA_DIRETO). Busca: um hash, um
+ * deslocamento, um slot, uma comparação.
+ */
+#define PERFEITA_LAMBDA 3
+#define PERFEITA_DIRETO 0x80000000u
+
+static inline uint32_t perfeita_balde(uint64_t h, size_t n_baldes) {
+    return (uint32_t)(((h >> 32) * (uint64_t)n_baldes) >> 32);
+}
+
+static inline uint32_t perfeita_pos(uint64_t h, uint32_t d, size_t n) {
+    if (d & PERFEITA_DIRETO) return d & ~PERFEITA_DIRETO;
+    uint64_t z = h ^ ((uint64_t)d + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 29)) * 0xbf58476d1ce4e5b9ull;
+    z ^= z >> 32;
+    return (uint32_t)(((z & 0xffffffffu) * (uint64_t)n) >> 32);
+}
+
+static const CasoSlot *perfeita_buscar(const HashTable *ht, const char *pista) {
+    if (ht->n == 0) return NULL;
+    size_t len = strlen(pista);
+    uint64_t h = hash_wy(pista, len, ht->semente);
+    const CasoSlot *sl = &ht->mslots[perfeita_pos(h, ht->desloc[perfeita_balde(h, ht->n_baldes)], ht->n)];
+    INSTR_SONDAS(1);
+    if (sl->hash != (uint32_t)h) return NULL;
+    /* a pista do próprio pool dispensa a comparação; senão, o comprimento
+       já medido para o hash vira um memcmp (limitado ao fim do pool) */
+    const char *chave = ht->mpool + sl->chave;
+    if (chave == pista) return sl;
+    return len < ht->mpool_len - sl->chave && memcmp(chave, pista, len + 1) == 0 ? sl : NULL;
+}
+
+/**
+ * encontrarSuspeito(ht, pista)
+ * Retorna o nome do suspeito associado à pista, ou NULL se não achar.
+ * A string retornada é a que está armazenada na hash (não liberar externamente).
+ */
+char *encontrarSuspeito(HashTable *ht, const char *pista) {
+    if (!ht || !pista) return NULL;
+    if (ht->modo == HASH_PERFEITA) {
+        const CasoSlot *sl = perfeita_buscar(ht, pista);
+        return sl ? (char *)(ht->mpool + sl->suspeito) : NULL;
+    }
+    uint32_t hash = hash_da_tabela(ht, pista, strlen(pista));
+    if (ht->modo == HASH_ABERTA) {
+        HashSlot *sl = hash_aberta_buscar(ht, pista, hash);
+        return sl ? (char *)sl->suspeito : NULL;
+    }
+    if (ht->modo == HASH_MAPEADA) {
+        const CasoSlot *sl = caso_hash_buscar(ht, pista, hash);
+        return sl ? (char *)(ht->mpool + sl->suspeito) : NULL;
+    }
+    if (ht->modo == HASH_CONCORRENTE) return (char *)conc_buscar(ht, pista, hash);
+    HashEntry *ent = ht->buckets[hash_indice(ht, hash)];
+    uint32_t sondas = 0;
+    for (; ent; ent = ent->prox) {
+        ++sondas;
+        if (hash_chave_igual(ent->chave, ent->hash, pista, hash)) break;
+    }
+    INSTR_SONDAS(sondas);
+    return ent ? (char *)ent->suspeito : NULL;
+}
+
+/* estruturas internas da tabela, menos o bloco congelado e a própria tabela */
+static void hash_liberar_conteudo(HashTable *ht) {
+    for (size_t i = 0; ht->buckets && !ht->arena && i < ht->tamanho; ++i) {
+        HashEntry *e = ht->buckets[i];
+        while (e) {
+            HashEntry *next = e->prox;
+            mem_free(e);
+            e = next;
+        }
+    }
+    suspeito_liberar(&ht->sus);
+    indice_nomes_liberar(ht->nomes);
+    conc_liberar(ht->conc);
+    mem_free(ht->buckets);
+    mem_free(ht->slots);
+}
+
+/* liberar tabela hash (entradas de arena ficam para arena_liberar) */
+void liberarHash(HashTable *ht) {
+    if (!ht) return;
+    hash_liberar_conteudo(ht);
+    mem_free(ht->congelado);
+    mem_free(ht);
+}
+
+/* cursor para percorrer as associações de qualquer variante da hash */
+typedef struct HashIter {
+    size_t i;
+    HashEntry *e;
+    HashNoC *c;
+} HashIter;
+
+/* próxima associação (1) ou fim (0); ordem depende da organização interna */
+static int hash_iter_prox(const HashTable *ht, HashIter *it,
+                          const char **chave, const char **suspeito) {
+    if (ht->modo == HASH_ABERTA) {
+        while (it->i < ht->tamanho) {
+            const HashSlot *sl = &ht->slots[it->i++];
+            if (sl->chave) {
+                *chave = sl->chave;
+                *suspeito = sl->suspeito;
+                return 1;
+            }
+        }
+        return 0;
+    }
+    if (ht->modo == HASH_MAPEADA || ht->modo == HASH_PERFEITA) {
+        while (it->i < ht->tamanho) {
+            const CasoSlot *sl = &ht->mslots[it->i++];
+            if (sl->chave != CASO_SLOT_VAZIO) {
+                *chave = ht->mpool + sl->chave;
+                *suspeito = ht->mpool + sl->suspeito;
+                return 1;
+            }
+        }
+        return 0;
+    }
+    if (ht->modo == HASH_CONCORRENTE) {
+        /* uma thread só (não concorre com escritores) */
+        BaldesC *bs = atomic_load(&ht->conc->baldes);
+        while (!it->c) {
+            if (it->i >= bs->tam) return 0;
+            it->c = atomic_load_explicit(&bs->b[it->i++], memory_order_acquire);
+        }
+        *chave = it->c->chave;
+        *suspeito = atomic_load_explicit(&it->c->suspeito, memory_order_acquire);
+        it->c = atomic_load_explicit(&it->c->prox, memory_order_acquire);
+        return 1;
+    }
+    while (!it->e) {
+        if (it->i >= ht->tamanho) return 0;
+        it->e = ht->buckets[it->i++];
+    }
+    *chave = it->e->chave;
+    *suspeito = it->e->suspeito;
+    it->e = it->e->prox;
+    return 1;
+}
+
+/* qsort: ponteiros para o mesmo pool, em ordem de endereço */
+static int comparar_ptr(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)*(const char *const *)a, y = (uintptr_t)*(const char *const *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * hashSuspeitos(ht)
+ * Suspeitos distintos da tabela. Nas tabelas montadas em memória o conjunto
+ * é mantido pelas inserções (e congelarHash o preserva, nas mesmas
+ * posições); na do arquivo de caso é montado no primeiro uso
+ * (o pool do arquivo guarda cada string uma vez, então ponteiros bastam).
+ */
+const SuspeitoSet *hashSuspeitos(HashTable *ht) {
+    if ((ht->modo == HASH_MAPEADA || ht->modo == HASH_PERFEITA) && !ht->sus_pronto) {
+        HashIter it = { 0, NULL, NULL };
+        const char *chave, *suspeito;
+        while (hash_iter_prox(ht, &it, &chave, &suspeito)) suspeito_reter(&ht->sus, suspeito);
+        ht->sus_pronto = 1;
+        /* posições na ordem do pool, não na dos slots (que muda com a
+           semente): caso_montar grava os suspeitos na ordem deste conjunto */
+        size_t n = ht->sus.n;
+        const char **ordem = malloc((n ? n : 1) * sizeof(const char *));
+        if (!ordem) return &ht->sus;
+        memcpy((void *)ordem, (const void *)ht->sus.nomes, n * sizeof(const char *));
+        qsort((void *)ordem, n, sizeof(const char *), comparar_ptr);
+        SuspeitoSet novo;
+        memset(&novo, 0, sizeof(novo));
+        for (size_t p = 0; p < n; ++p) suspeito_reter(&novo, ordem[p]);
+        it = (HashIter){ 0, NULL, NULL };
+        while (hash_iter_prox(ht, &it, &chave, &suspeito)) suspeito_reter(&novo, suspeito);
+        for (size_t p = 0; p < n; ++p) suspeito_soltar(&novo, ordem[p]);
+        free((void *)ordem);
+        if (novo.n == n) {
+            suspeito_liberar(&ht->sus);
+            ht->sus = novo;
+        } else {
+            suspeito_liberar(&novo);
+        }
+    }
+    return &ht->sus;
+}
+
+/* deslocamentos tentados por balde antes de trocar a semente */
+#define PERFEITA_TENTATIVAS (1u << 20)
+
+/*
+ * Distribui as 'n' chaves (hashes h[i]) em [0, n): baldes maiores primeiro,
+ * cada um com o menor deslocamento que leva todas as suas chaves a posições
+ * livres; baldes de uma chave ficam com as posições que sobraram.
+ * pos[i] = posição da chave i. Retorna 0, 1 (trocar a semente) ou -1.
+ */
+static int perfeita_montar(const uint64_t *h, size_t n, uint32_t *desloc, size_t n_baldes,
+                           uint32_t *pos) {
+    uint32_t *inicio = calloc(n_baldes + 1, sizeof(uint32_t)); /* balde -> 1a chave em 'ordem' */
+    uint32_t *ordem = malloc((n ? n : 1) * sizeof(uint32_t));  /* chaves agrupadas por balde */
+    uint32_t *baldes = malloc(n_baldes * sizeof(uint32_t));    /* do maior para o menor */
+    uint64_t *ocupado = calloc(n / 64 + 1, sizeof(uint64_t));
+    uint32_t *cont = NULL, *tent = NULL;
+    int ret = -1;
+    if (!inicio || !ordem || !baldes || !ocupado) goto fim;
+
+    size_t maior = 0;
+    for (size_t i = 0; i < n; ++i) inicio[perfeita_balde(h[i], n_baldes) + 1] += 1;
+    for (size_t b = 0; b < n_baldes; ++b) {
+        if (inicio[b + 1] > maior) maior = inicio[b + 1];
+        inicio[b + 1] += inicio[b];
+    }
+    for (size_t b = 0; b < n_baldes; ++b) baldes[b] = inicio[b];
+    for (size_t i = 0; i < n; ++i) ordem[baldes[perfeita_balde(h[i], n_baldes)]++] = (uint32_t)i;
+
+    /* contagem por tamanho: baldes em ordem decrescente de tamanho */
+    cont = calloc(maior + 1, sizeof(uint32_t));
+    tent = malloc((maior + 1) * sizeof(uint32_t));
+    if (!cont || !tent) goto fim;
+    for (size_t b = 0; b < n_baldes; ++b) cont[inicio[b + 1] - inicio[b]] += 1;
+    for (size_t t = maior + 1, acc = 0; t-- > 0;) {
+        uint32_t c = cont[t];
+        cont[t] = (uint32_t)acc;
+        acc += c;
+    }
+    for (size_t b = 0; b < n_baldes; ++b) baldes[cont[inicio[b + 1] - inicio[b]]++] = (uint32_t)b;
+
+    size_t k = 0, livre = 0;
+    for (; k < n_baldes; ++k) {
+        uint32_t b = baldes[k], t = inicio[b + 1] - inicio[b];
+        const uint32_t *chaves = ordem + inicio[b];
+        if (t < 2) break;
+        uint32_t d = 0;
+        for (;; ++d) {
+            if (d == PERFEITA_TENTATIVAS) {
+                ret = 1;
+                goto fim;
+            }
+            uint32_t j = 0;
+            for (; j < t; ++j) {
+                uint32_t p = perfeita_pos(h[chaves[j]], d, n);
+                uint64_t bit = (uint64_t)1 << (p % 64);
+                if (ocupado[p / 64] & bit) break;
+                ocupado[p / 64] |= bit;
+                tent[j] = p;
+            }
+            if (j == t) break;
+            while (j-- > 0) ocupado[tent[j] / 64] &= ~((uint64_t)1 << (tent[j] % 64));
+        }
+        desloc[b] = d;
+        for (uint32_t j = 0; j < t; ++j) pos[chaves[j]] = tent[j];
+    }
+    for (; k < n_baldes; ++k) {
+        uint32_t b = baldes[k];
+        desloc[b] = 0;
+        if (inicio[b + 1] == inicio[b]) continue;
+        while ((ocupado[livre / 64] >> (livre % 64)) & 1) ++livre;
+        ocupado[livre / 64] |= (uint64_t)1 << (livre % 64);
+        desloc[b] = PERFEITA_DIRETO | (uint32_t)livre;
+        pos[ordem[inicio[b]]] = (uint32_t)livre;
+    }
+    ret = 0;
+
+fim:
+    free(inicio);
+    free(ordem);
+    free(baldes);
+    free(ocupado);
+    free(cont);
+    free(tent);
+    return ret;
+}
+
+/* baldes da hash perfeita para 'n' chaves */
+static size_t perfeita_n_baldes(size_t n) {
+    return n / PERFEITA_LAMBDA + 1;
+}
+
+/* escolhe a semente e monta desloc/pos para as chaves (0 em sucesso);
+   'inicial' != 0 torna a escolha reprodutível: ela e as seguintes */
+static int perfeita_semear(const char *const *chaves, size_t n, uint64_t *h, uint32_t *desloc,
+                           size_t n_baldes, uint32_t *pos, uint64_t inicial, uint64_t *semente) {
+    for (int tentativa = 0; tentativa < 8; ++tentativa) {
+        *semente = inicial ? inicial + (uint64_t)tentativa : semente_aleatoria();
+        for (size_t i = 0; i < n; ++i) h[i] = hash_wy(chaves[i], strlen(chaves[i]), *semente);
+        int r = perfeita_montar(h, n, desloc, n_baldes, pos);
+        if (r <= 0) return r;
+    }
+    return -1;
+}
+
+/**
+ * congelarHash(ht)
+ * Troca a organização de uma tabela já povoada por uma hash perfeita
+ * mínima: slots, deslocamentos e strings num bloco único, e cada busca
+ * passa a ser uma sondagem e uma comparação. A tabela fica somente
+ * leitura; os suspeitos mantêm as posições de hashSuspeitos. Retorna 0
+ * em sucesso (a tabela fica como estava em caso de erro).
+ */
+int congelarHash(HashTable *ht) {
+    if (!ht) return -1;
+    if (ht->modo == HASH_PERFEITA) return 0;
+    if (ht->modo == HASH_CONCORRENTE) {
+        fprintf(stderr, "Erro: a hash concorrente não pode ser congelada.\n");
+        return -1;
+    }
+    const SuspeitoSet *sus = hashSuspeitos(ht);
+    size_t cap = 8;
+    while (cap < ht->n * 2) cap *= 2;
+    const char **vistos = calloc(cap, sizeof(const char *));
+    const char **chaves = malloc((ht->n ? ht->n : 1) * sizeof(const char *));
+    uint32_t *sp = malloc((ht->n ? ht->n : 1) * sizeof(uint32_t));
+    uint32_t *off_sus = malloc((sus->n ? sus->n : 1) * sizeof(uint32_t));
+    uint64_t *h = NULL;
+    uint32_t *pos = NULL;
+    char *bloco = NULL;
+    SuspeitoSet novo;
+    memset(&novo, 0, sizeof(novo));
+    int ret = -1;
+    if (!vistos || !chaves || !sp || !off_sus) goto fim;
+
+    /* associações distintas (chave repetida: vale a primeira vista) */
+    HashIter it = { 0, NULL, NULL };
+    const char *chave, *suspeito;
+    size_t n = 0, tam_pool = 0;
+    while (hash_iter_prox(ht, &it, &chave, &suspeito)) {
+        size_t j = (size_t)hash_misturar_ptr(chave) & (cap - 1);
+        while (vistos[j] && vistos[j] != chave) j = (j + 1) & (cap - 1);
+        if (vistos[j]) continue;
+        vistos[j] = chave;
+        size_t p = suspeito_pos(sus, suspeito);
+        if (p == SUSPEITO_NENHUM) goto fim;
+        chaves[n] = chave;
+        sp[n++] = (uint32_t)p;
+        tam_pool += strlen(chave) + 1;
+    }
+    for (size_t p = 0; p < sus->n; ++p) tam_pool += strlen(sus->nomes[p]) + 1;
+    if (n >= PERFEITA_DIRETO || tam_pool >= UINT32_MAX) {
+        fprintf(stderr, "Erro: tabela grande demais para congelar.\n");
+        goto fim;
+    }
+
+    /* bloco: CasoSlot[n] | desloc[n_baldes] | pool (suspeitos e pistas) */
+    size_t n_baldes = perfeita_n_baldes(n);
+    size_t tam_slots = n * sizeof(CasoSlot), tam_desloc = n_baldes * sizeof(uint32_t);
+    h = malloc((n ? n : 1) * sizeof(uint64_t));
+    pos = malloc((n ? n : 1) * sizeof(uint32_t));
+    bloco = mem_alloc(tam_slots + tam_desloc + tam_pool);
+    if (!h || !pos || !bloco) goto fim;
+    CasoSlot *slots = (CasoSlot *)(void *)bloco;
+    uint32_t *desloc = (uint32_t *)(void *)(bloco + tam_slots);
+    char *pool = bloco + tam_slots + tam_desloc;
+    uint64_t semente;
+    if (perfeita_semear(chaves, n, h, desloc, n_baldes, pos, 0, &semente) != 0) {
+        fprintf(stderr, "Erro: não foi possível montar a hash perfeita.\n");
+        goto fim;
+    }
+    size_t len_pool = 0;
+    for (size_t p = 0; p < sus->n; ++p) {
+        size_t len = strlen(sus->nomes[p]) + 1;
+        memcpy(pool + len_pool, sus->nomes[p], len);
+        off_sus[p] = (uint32_t)len_pool;
+        len_pool += len;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        size_t len = strlen(chaves[i]) + 1;
+        CasoSlot *sl = &slots[pos[i]];
+        memcpy(pool + len_pool, chaves[i], len);
+        sl->chave = (uint32_t)len_pool;
+        sl->suspeito = off_sus[sp[i]];
+        sl->hash = (uint32_t)h[i];
+        sl->dist = 0;
+        len_pool += len;
+    }
+
+    /* suspeitos nas mesmas posições (as sem associação seguem sem refs) */
+    for (size_t p = 0; p < sus->n; ++p) suspeito_reter(&novo, pool + off_sus[p]);
+    for (size_t i = 0; i < n; ++i) suspeito_reter(&novo, pool + off_sus[sp[i]]);
+    for (size_t p = 0; p < sus->n; ++p) suspeito_soltar(&novo, pool + off_sus[p]);
+    if (novo.n != sus->n) goto fim;
+
+    hash_liberar_conteudo(ht);
+    mem_free(ht->congelado);
+    ht->modo = HASH_PERFEITA;
+    ht->buckets = NULL;
+    ht->slots = NULL;
+    ht->conc = NULL;
+    ht->arena = NULL;
+    ht->nomes = NULL;
+    ht->tamanho = n;
+    ht->mascara = 0;
+    ht->n = n;
+    ht->fn = hash_wy;
+    ht->semente = semente;
+    ht->mslots = slots;
+    ht->desloc = desloc;
+    ht->n_baldes = n_baldes;
+    ht->mpool = pool;
+    ht->mpool_len = tam_pool;
+    ht->congelado = bloco;
+    ht->sus = novo;
+    ht->sus_pronto = 1;
+    memset(&novo, 0, sizeof(novo));
+    bloco = NULL;
+    ret = 0;
+
+fim:
+    suspeito_liberar(&novo);
+    mem_free(bloco);
+    free(vistos);
+    free((void *)chaves);
+    free(sp);
+    free(off_sus);
+    free(h);
+    free(pos);
+    return ret;
+}
+
+/* listar suspeitos únicos contidos na hash (para ajudar o jogador) */
+void listarSuspeitosHash(Saida *out, HashTable *ht) {
+    if (!ht) return;
+    const SuspeitoSet *c = hashSuspeitos(ht);
+    saida_lit(out, "Suspeitos conhecidos:\n");
+    if (c->vivos == 0) {
+        saida_lit(out, "  (nenhum suspeito cadastrado)\n");
+    }
+    for (size_t p = 0; p < c->n; ++p) {
+        if (!c->refs[p]) continue;
+        saida_lit(out, "  - ");
+        saida_texto(out, c->nomes[p]);
+        saida_char(out, '\n');
+    }
+}
+
+/* ===========================
+   Índice de suspeitos por nome normalizado
+   =========================== */
+
+/* U+00C0..U+00FF sem acento ('.' = mantém a letra, só em minúscula) */
+static const char latin1_sem_acento[65] =
+    "aaaaaa.ceeeeiiii.nooooo.ouuuuy.."
+    "aaaaaa.ceeeeiiii.nooooo.ouuuuy.y";
+
+/**
+ * normalizarNome(s, dest, cap)
+ * Chave de comparação de um nome: minúsculas, sem acentos do Latin-1
+ * (UTF-8: "Bibliotecário" -> "bibliotecario"), brancos das pontas
+ * removidos e brancos internos reduzidos a um espaço. A chave nunca é
+ * maior que 's'. Retorna o comprimento (truncado em cap - 1).
+ */
+size_t normalizarNome(const char *s, char *dest, size_t cap) {
+    const NucleosTexto *k = nucleosTexto();
+    const unsigned char *p = (const unsigned char *)s, *fim = p + strlen(s);
+    size_t n = 0;
+    int espaco = 0;
+    if (cap == 0) return 0;
+    p += k->brancos(p, (size_t)(fim - p));
+    while (p < fim && n + 1 < cap) {
+        if (isspace(*p)) {
+            p += k->brancos(p, (size_t)(fim - p));
+            espaco = 1;
+            continue;
+        }
+        if (espaco) {
+            dest[n++] = ' ';
+            espaco = 0;
+            if (n + 1 >= cap) break;
+        }
+        /* trecho ASCII visível: copiado e dobrado em bloco */
+        size_t lim = (size_t)(fim - p) < cap - 1 - n ? (size_t)(fim - p) : cap - 1 - n;
+        size_t r = k->dobrar(dest + n, p, lim);
+        if (r) {
+            n += r;
+            p += r;
+            continue;
+        }
+        unsigned char c = *p++;
+        if (c < 0x80) {
+            dest[n++] = (char)tolower(c);
+        } else if (c == 0xC3 && *p >= 0x80 && *p <= 0xBF) {
+            unsigned char d = *p++;
+            char base = latin1_sem_acento[d - 0x80];
+            if (base != '.') {
+                dest[n++] = base;
+            } else if (n + 2 < cap) {
+                /* letras sem forma sem acento (æ, ð, þ...): minúscula = +0x20 */
+                dest[n++] = (char)c;
+                dest[n++] = (char)(d <= 0x9E && d != 0x97 ? d + 0x20 : d);
+            } else {
+                break;
+            }
+        } else {
+            dest[n++] = (char)c;
+        }
+    }
+    dest[n] = '\0';
+    return n;
+}
+
+/* par chave/posição usado na ordenação do índice */
+typedef struct NomeOrdem {
+    const char *chave;
+    uint32_t pos;
+} NomeOrdem;
+
+static int nome_ordem_cmp(const void *a, const void *b) {
+    const NomeOrdem *x = a, *y = b;
+    int c = strcmp(x->chave, y->chave);
+    return c ? c : (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+/* chave normalizada do i-ésimo nome na ordem */
+static inline const char *indice_chave(const IndiceNomes *ix, size_t i) {
+    return ix->chaves + ix->off[ix->ordem[i]];
+}
+
+/* monta o índice para os 'c->n' suspeitos do conjunto */
+static IndiceNomes *indice_nomes_montar(const SuspeitoSet *c, uint64_t semente) {
+    IndiceNomes *ix = mem_calloc(1, sizeof(IndiceNomes));
+    if (!ix) return NULL;
+    size_t tam = 0;
+    for (size_t p = 0; p < c->n; ++p) tam += strlen(c->nomes[p]) + 1;
+    size_t cap = 16;
+    while (cap < c->n * 2) cap *= 2;
+    NomeOrdem *tmp = mem_alloc((c->n ? c->n : 1) * sizeof(NomeOrdem));
+    ix->chaves = mem_alloc(tam ? tam : 1);
+    ix->off = mem_alloc((c->n ? c->n : 1) * sizeof(uint32_t));
+    ix->ordem = mem_alloc((c->n ? c->n : 1) * sizeof(uint32_t));
+    ix->slots = mem_calloc(cap, sizeof(uint32_t));
+    if (!tmp || !ix->chaves || !ix->off || !ix->ordem || !ix->slots) {
+        mem_free(tmp);
+        indice_nomes_liberar(ix);
+        return NULL;
+    }
+    ix->n = c->n;
+    ix->cap_slots = cap;
+    ix->semente = semente;
+
+    /* chaves normalizadas, na ordem das posições */
+    size_t usado = 0;
+    for (size_t p = 0; p < c->n; ++p) {
+        ix->off[p] = (uint32_t)usado;
+        usado += normalizarNome(c->nomes[p], ix->chaves + usado, tam - usado) + 1;
+        tmp[p].chave = ix->chaves + ix->off[p];
+        tmp[p].pos = (uint32_t)p;
+    }
+    /* ordem alfabética das chaves: prefixos viram intervalos contíguos */
+    qsort(tmp, c->n, sizeof(NomeOrdem), nome_ordem_cmp);
+    for (size_t i = 0; i < c->n; ++i) ix->ordem[i] = tmp[i].pos;
+    mem_free(tmp);
+
+    /* hash da chave -> início do grupo de chaves iguais na ordem */
+    for (size_t i = 0; i < c->n; ++i) {
+        const char *k = indice_chave(ix, i);
+        if (i > 0 && strcmp(k, indice_chave(ix, i - 1)) == 0) continue;
+        size_t j = (size_t)hash_wy(k, strlen(k), semente) & (cap - 1);
+        while (ix->slots[j]) j = (j + 1) & (cap - 1);
+        ix->slots[j] = (uint32_t)(i + 1);
+    }
+    return ix;
+}
+
+/**
+ * hashIndiceNomes(ht)
+ * Índice dos suspeitos da tabela por nome normalizado (ver normalizarNome).
+ * Montado no primeiro uso e de novo só quando surgem suspeitos novos.
+ */
+const IndiceNomes *hashIndiceNomes(HashTable *ht) {
+    const SuspeitoSet *c = hashSuspeitos(ht);
+    if (ht->nomes && ht->nomes->n == c->n) return ht->nomes;
+    IndiceNomes *ix = indice_nomes_montar(c, ht->semente);
+    if (!ix) return ht->nomes;
+    indice_nomes_liberar(ht->nomes);
+    ht->nomes = ix;
+    return ix;
+}
+
+/**
+ * indiceNomesBuscar(ix, nome, ptr_ini, ptr_fim)
+ * Uma sondagem na hash do índice: os nomes iguais a 'nome' depois da
+ * normalização ficam em ix->ordem[*ini .. *fim). Retorna quantos são.
+ */
+size_t indiceNomesBuscar(const IndiceNomes *ix, const char *nome, size_t *ini, size_t *fim) {
+    char chave[128];
+    size_t len = normalizarNome(nome, chave, sizeof(chave));
+    *ini = *fim = 0;
+    if (!ix || ix->n == 0) return 0;
+    size_t mask = ix->cap_slots - 1;
+    for (size_t j = (size_t)hash_wy(chave, len, ix->semente) & mask; ix->slots[j];
+         j = (j + 1) & mask) {
+        size_t i = ix->slots[j] - 1;
+        if (strcmp(indice_chave(ix, i), chave) != 0) continue;
+        *ini = i;
+        *fim = i + 1;
+        while (*fim < ix->n && strcmp(indice_chave(ix, *fim), chave) == 0) *fim += 1;
+        return *fim - *ini;
+    }
+    return 0;
+}
+
+/**
+ * indiceNomesPrefixo(ix, prefixo, ptr_ini, ptr_fim)
+ * Nomes cuja chave começa com a chave de 'prefixo' (busca binária: não
+ * varre a lista): ficam em ix->ordem[*ini .. *fim). Retorna quantos são.
+ */
+size_t indiceNomesPrefixo(const IndiceNomes *ix, const char *prefixo, size_t *ini, size_t *fim) {
+    char chave[128];
+    size_t len = normalizarNome(prefixo, chave, sizeof(chave));
+    *ini = *fim = 0;
+    if (!ix) return 0;
+    size_t a = 0, b = ix->n;
+    while (a < b) {
+        size_t m = a + (b - a) / 2;
+        if (strncmp(indice_chave(ix, m), chave, len) < 0) a = m + 1; else b = m;
+    }
+    *ini = a;
+    b = ix->n;
+    while (a < b) {
+        size_t m = a + (b - a) / 2;
+        if (strncmp(indice_chave(ix, m), chave, len) <= 0) a = m + 1; else b = m;
+    }
+    *fim = a;
+    return *fim - *ini;
+}
+
+/* ===========================
+   Arquivo de caso binário (mapeado em memória)
+   =========================== */
+
+/*
+ * Formato (ordem de bytes nativa, conferida pelo campo 'endian'):
+ *   CasoCabecalho
+ *   SalaPlana[n_salas]       (mesmo layout de MapaPlano: raiz no índice 0)
+ *   CasoSlot[hash_cap]       (hash aberta pronta, pistas e suspeitos como offsets)
+ *   pool de strings          (terminadas em '\0')
+ * Com CASO_HASH_PERFEITA (versão 2) a hash é a de congelarHash:
+ *   CasoSlot[hash_n]         (um slot por associação)
+ *   uint32_t[hash_cap]       (deslocamento de cada balde)
+ * Cada seção começa alinhada em 8 bytes. Abrir um caso é mmap + conferir o
+ * cabeçalho: salas, hash e strings são lidos direto das páginas mapeadas.
+ */
+
+#define CASO_MAGIA "DQCASO1"
+#define CASO_VERSAO 2u
+#define CASO_VERSAO_MIN 1u     /* versão 1: sem 'flags', hash sempre aberta */
+#define CASO_ENDIAN 0x01020304u
+
+/* flags do cabeçalho */
+#define CASO_HASH_PERFEITA 1u
+
+typedef struct CasoCabecalho {
+    char magia[8];
+    uint32_t versao;
+    uint32_t endian;
+    uint64_t tam_arquivo;
+    uint32_t n_salas;
+    uint32_t hash_n;        /* associações pista -> suspeito */
+    uint32_t hash_cap;      /* slots (potência de 2) ou baldes (hash perfeita) */
+    uint32_t flags;         /* CASO_HASH_PERFEITA */
+    uint64_t hash_semente;  /* semente de hash_wy usada nos slots */
+    uint64_t off_salas;
+    uint64_t off_hash;
+    uint64_t off_pool;
+    uint64_t tam_pool;
+} CasoCabecalho;
+
+/* Caso aberto a partir do arquivo: mapa e hash apontam para o mapeamento */
+typedef struct CasoArquivo {
+    void *base;             /* início do arquivo na memória */
+    size_t tam;
+    int mapeado;            /* 1 = mmap, 0 = lido para o heap (sem POSIX) */
+    MapaPlano plano;        /* visão das salas (não é dona da memória) */
+    HashTable *ht;          /* HASH_MAPEADA */
+} CasoArquivo;
+
+/* índice temporário conteúdo -> offset, para montar o pool sem repetição */
+typedef struct PoolEscrita {
+    char *pool;
+    size_t len, cap;
+    uint32_t *offs;         /* slots de offsets (UINT32_MAX = vazio) */
+    size_t cap_ix, n_ix;
+} PoolEscrita;
+
+static int pool_escrita_crescer_ix(PoolEscrita *pe) {
+    size_t nova = pe->cap_ix ? pe->cap_ix * 2 : 256;
+    uint32_t *offs = malloc(nova * sizeof(uint32_t));
+    if (!offs) return -1;
+    memset(offs, 0xff, nova * sizeof(uint32_t));
+    for (size_t i = 0; i < pe->cap_ix; ++i) {
+        uint32_t off = pe->offs[i];
+        if (off == UINT32_MAX) continue;
+        const char *s = pe->pool + off;
+        size_t j = (size_t)hash_wy(s, strlen(s), 0) & (nova - 1);
+        while (offs[j] != UINT32_MAX) j = (j + 1) & (nova - 1);
+        offs[j] = off;
+    }
+    free(pe->offs);
+    pe->offs = offs;
+    pe->cap_ix = nova;
+    return 0;
+}
+
+/* offset de 's' no pool em construção (acrescenta se ainda não existir) */
+static uint32_t pool_escrita_add(PoolEscrita *pe, const char *s) {
+    if ((pe->n_ix + 1) * 2 > pe->cap_ix && pool_escrita_crescer_ix(pe) != 0) return UINT32_MAX;
+    size_t len = strlen(s);
+    size_t j = (size_t)hash_wy(s, len, 0) & (pe->cap_ix - 1);
+    while (pe->offs[j] != UINT32_MAX) {
+        if (strcmp(pe->pool + pe->offs[j], s) == 0) return pe->offs[j];
+        j = (j + 1) & (pe->cap_ix - 1);
+    }
+    if (pe->len + len + 1 > pe->cap) {
+        size_t nova = pe->cap ? pe->cap : 4096;
+        while (pe->len + len + 1 > nova) nova *= 2;
+        char *tmp = realloc(pe->pool, nova);
+        if (!tmp) return UINT32_MAX;
+        pe->pool = tmp;
+        pe->cap = nova;
+    }
+    if (pe->len + len + 1 >= UINT32_MAX) return UINT32_MAX;
+    uint32_t off = (uint32_t)pe->len;
+    memcpy(pe->pool + off, s, len + 1);
+    pe->len += len + 1;
+    pe->offs[j] = off;
+    pe->n_ix += 1;
+    return off;
+}
+
+/* coloca um slot (chave ausente) na hash do arquivo, estilo Robin Hood */
+static void caso_slot_colocar(CasoSlot *slots, size_t cap, CasoSlot novo) {
+    size_t i = novo.hash & (cap - 1);
+    novo.dist = 0;
+    while (slots[i].chave != CASO_SLOT_VAZIO) {
+        if (slots[i].dist < novo.dist) {
+            CasoSlot t = slots[i];
+            slots[i] = novo;
+            novo = t;
+        }
+        i = (i + 1) & (cap - 1);
+        novo.dist += 1;
+    }
+    slots[i] = novo;
+}
+
+static size_t alinhar8(size_t x) {
+    return (x + 7) & ~(size_t)7;
+}
+
+/* início dos deslocamentos da hash perfeita (logo depois dos slots) */
+static uint64_t caso_off_desloc(const CasoCabecalho *cab) {
+    return alinhar8(cab->off_hash + (uint64_t)cab->hash_n * sizeof(CasoSlot));
+}
+
+/* versão e flags que este programa sabe ler? */
+static int caso_versao_ok(const CasoCabecalho *cab) {
+    if (cab->versao < CASO_VERSAO_MIN || cab->versao > CASO_VERSAO || cab->endian != CASO_ENDIAN)
+        return 0;
+    return cab->versao == 1 ? cab->flags == 0 : (cab->flags & ~CASO_HASH_PERFEITA) == 0;
+}
+
+/* seção da hash coerente e dentro de um arquivo de 'tam' bytes? */
+static int caso_hash_ok(const CasoCabecalho *cab, uint64_t tam) {
+    if (cab->off_hash % 8 != 0 || cab->off_hash > tam) return 0;
+    if (!(cab->flags & CASO_HASH_PERFEITA))
+        return cab->hash_cap != 0 && (cab->hash_cap & (cab->hash_cap - 1)) == 0 &&
+               cab->hash_n < cab->hash_cap &&
+               cab->hash_cap <= (tam - cab->off_hash) / sizeof(CasoSlot);
+    if (cab->hash_cap != 0 && cab->hash_n < PERFEITA_DIRETO &&
+        cab->hash_n <= (tam - cab->off_hash) / sizeof(CasoSlot)) {
+        uint64_t off = caso_off_desloc(cab);
+        return off <= tam && cab->hash_cap <= (tam - off) / sizeof(uint32_t);
+    }
+    return 0;
+}
+
+/* hash perfeita de uma tabela congelada (chaves distintas), com semente
+   nova (a partir de *semente se != 0) e offsets no pool do arquivo */
+static int caso_montar_perfeita(PoolEscrita *pe, const HashTable *ht, CasoSlot **slots,
+                                uint32_t **desloc, size_t *n_baldes, uint64_t *semente) {
+    size_t n = ht->n;
+    const char **chaves = malloc((n ? n : 1) * sizeof(const char *));
+    uint32_t *off_chave = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint32_t *off_sus = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint64_t *h = malloc((n ? n : 1) * sizeof(uint64_t));
+    uint32_t *pos = malloc((n ? n : 1) * sizeof(uint32_t));
+    *n_baldes = perfeita_n_baldes(n);
+    *slots = malloc((n ? n : 1) * sizeof(CasoSlot));
+    *desloc = malloc(*n_baldes * sizeof(uint32_t));
+    int ret = -1;
+    if (!chaves || !off_chave || !off_sus || !h || !pos || !*slots || !*desloc) goto fim;
+    HashIter it = { 0, NULL, NULL };
+    const char *chave, *suspeito;
+    size_t i = 0;
+    while (i < n && hash_iter_prox(ht, &it, &chave, &suspeito)) {
+        off_chave[i] = pool_escrita_add(pe, chave);
+        off_sus[i] = pool_escrita_add(pe, suspeito);
+        if (off_chave[i] == UINT32_MAX || off_sus[i] == UINT32_MAX) goto fim;
+        chaves[i++] = chave;
+    }
+    if (i != n) goto fim;
+    if (perfeita_semear(chaves, n, h, *desloc, *n_baldes, pos, *semente, semente) != 0) {
+        fprintf(stderr, "Erro: não foi possível montar a hash perfeita.\n");
+        goto fim;
+    }
+    for (i = 0; i < n; ++i) {
+        CasoSlot *sl = &(*slots)[pos[i]];
+        sl->chave = off_chave[i];
+        sl->suspeito = off_sus[i];
+        sl->hash = (uint32_t)h[i];
+        sl->dist = 0;
+    }
+    ret = 0;
+
+fim:
+    free((void *)chaves);
+    free(off_chave);
+    free(off_sus);
+    free(h);
+    free(pos);
+    return ret;
+}
+
+/* Caso pronto para gravar: seções montadas, offsets contra o pool novo */
+typedef struct CasoMontado {
+    CasoCabecalho cab;
+    PoolEscrita pe;
+    SalaPlana *salas;
+    CasoSlot *slots;        /* caso_n_slots(&cab) slots */
+    uint32_t *desloc;       /* hash perfeita: cab.hash_cap baldes */
+} CasoMontado;
+
+/* slots gravados: um por associação na perfeita, hash_cap na aberta */
+static size_t caso_n_slots(const CasoCabecalho *cab) {
+    return (cab->flags & CASO_HASH_PERFEITA) ? cab->hash_n : cab->hash_cap;
+}
+
+static void caso_montado_liberar(CasoMontado *m) {
+    free(m->salas);
+    free(m->slots);
+    free(m->desloc);
+    free(m->pe.pool);
+    free(m->pe.offs);
+}
+
+/* monta salas, hash e pool de 'plano' + 'ht' (a hash aberta com semente
+   própria, ou perfeita se 'ht' foi congelada); 'semente' 0 = aleatória,
+   senão o mesmo caso dá sempre os mesmos bytes. 0 em sucesso */
+static int caso_montar(CasoMontado *m, const MapaPlano *plano, HashTable *ht, uint64_t semente) {
+    memset(m, 0, sizeof(*m));
+    m->salas = malloc((plano->n ? plano->n : 1) * sizeof(SalaPlana));
+    if (!m->salas) return -1;
+
+    /* salas: reescrever offsets contra o pool do arquivo */
+    for (uint32_t i = 0; i < plano->n; ++i) {
+        const SalaPlana *sp = &plano->salas[i];
+        m->salas[i] = *sp;
+        m->salas[i].nome = pool_escrita_add(&m->pe, plano->pool + sp->nome);
+        if (m->salas[i].nome == UINT32_MAX) return -1;
+        if (sp->pista != SALA_SEM_PISTA) {
+            m->salas[i].pista = pool_escrita_add(&m->pe, plano->pool + sp->pista);
+            if (m->salas[i].pista == UINT32_MAX) return -1;
+        }
+    }
+    /* suspeitos na ordem de hashSuspeitos: quem abre o caso lista igual */
+    const SuspeitoSet *sus = ht ? hashSuspeitos(ht) : NULL;
+    for (size_t p = 0; sus && p < sus->n; ++p)
+        if (pool_escrita_add(&m->pe, sus->nomes[p]) == UINT32_MAX) return -1;
+
+    /* hash: capacidade com carga <= 7/8, como a tabela aberta */
+    int perfeita = ht && ht->modo == HASH_PERFEITA;
+    size_t n = ht ? ht->n : 0, cap = 8, n_baldes = 0;
+    while (cap * HASH_ABERTA_CARGA_NUM < n * HASH_ABERTA_CARGA_DEN) cap *= 2;
+    if (!perfeita && !semente) semente = semente_aleatoria();
+    if (perfeita) {
+        if (caso_montar_perfeita(&m->pe, ht, &m->slots, &m->desloc, &n_baldes, &semente) != 0)
+            return -1;
+    } else {
+        m->slots = malloc(cap * sizeof(CasoSlot));
+        if (!m->slots) return -1;
+        memset(m->slots, 0xff, cap * sizeof(CasoSlot));
+    }
+    if (ht && !perfeita) {
+        HashIter it = { 0, NULL, NULL };
+        const char *chave, *suspeito;
+        while (hash_iter_prox(ht, &it, &chave, &suspeito)) {
+            CasoSlot sl;
+            sl.chave = pool_escrita_add(&m->pe, chave);
+            sl.suspeito = pool_escrita_add(&m->pe, suspeito);
+            if (sl.chave == UINT32_MAX || sl.suspeito == UINT32_MAX) return -1;
+            sl.hash = (uint32_t)hash_wy(chave, strlen(chave), semente);
+            caso_slot_colocar(m->slots, cap, sl);
+        }
+    }
+
+    CasoCabecalho *cab = &m->cab;
+    memcpy(cab->magia, CASO_MAGIA, sizeof(cab->magia));
+    cab->versao = CASO_VERSAO;
+    cab->endian = CASO_ENDIAN;
+    cab->n_salas = plano->n;
+    cab->hash_n = (uint32_t)n;
+    cab->hash_cap = (uint32_t)(perfeita ? n_baldes : cap);
+    cab->flags = perfeita ? CASO_HASH_PERFEITA : 0;
+    cab->hash_semente = semente;
+    cab->off_salas = alinhar8(sizeof(*cab));
+    cab->off_hash = alinhar8(cab->off_salas + (uint64_t)plano->n * sizeof(SalaPlana));
+    cab->off_pool = alinhar8(cab->off_hash + (uint64_t)caso_n_slots(cab) * sizeof(CasoSlot));
+    if (perfeita) cab->off_pool = alinhar8(caso_off_desloc(cab) + n_baldes * sizeof(uint32_t));
+    cab->tam_pool = m->pe.len;
+    cab->tam_arquivo = cab->off_pool + m->pe.len;
+    return 0;
+}
+
+/**
+ * casoSalvar(caminho, plano, ht)
+ * Grava mapa plano + associações de 'ht' no formato binário. A hash é
+ * montada já pronta (endereçamento aberto com semente própria, ou perfeita
+ * se 'ht' foi congelada), para que quem abre o arquivo não precise inserir
+ * nada. Retorna 0 em sucesso.
+ */
+int casoSalvar(const char *caminho, const MapaPlano *plano, HashTable *ht) {
+    CasoMontado m;
+    FILE *f = NULL;
+    int ret = -1;
+    if (caso_montar(&m, plano, ht, 0) != 0) goto fim;
+
+    const CasoCabecalho *cab = &m.cab;
+    size_t n_slots = caso_n_slots(cab);
+    f = fopen(caminho, "wb");
+    if (!f) {
+        fprintf(stderr, "Erro: não foi possível criar '%s'.\n", caminho);
+        goto fim;
+    }
+    static const char zeros[8];
+    size_t pos = 0;
+    int ok = fwrite(cab, sizeof(*cab), 1, f) == 1;
+    pos += sizeof(*cab);
+    ok = ok && fwrite(zeros, 1, cab->off_salas - pos, f) == cab->off_salas - pos;
+    pos = cab->off_salas;
+    ok = ok && fwrite(m.salas, sizeof(SalaPlana), plano->n, f) == plano->n;
+    pos += (size_t)plano->n * sizeof(SalaPlana);
+    ok = ok && fwrite(zeros, 1, cab->off_hash - pos, f) == cab->off_hash - pos;
+    pos = cab->off_hash;
+    ok = ok && fwrite(m.slots, sizeof(CasoSlot), n_slots, f) == n_slots;
+    pos += n_slots * sizeof(CasoSlot);
+    if (cab->flags & CASO_HASH_PERFEITA) {
+        ok = ok && fwrite(zeros, 1, caso_off_desloc(cab) - pos, f) == caso_off_desloc(cab) - pos;
+        ok = ok && fwrite(m.desloc, sizeof(uint32_t), cab->hash_cap, f) == cab->hash_cap;
+        pos = caso_off_desloc(cab) + (size_t)cab->hash_cap * sizeof(uint32_t);
+    }
+    ok = ok && fwrite(zeros, 1, cab->off_pool - pos, f) == cab->off_pool - pos;
+    ok = ok && fwrite(m.pe.pool, 1, m.pe.len, f) == m.pe.len;
+    if (fclose(f) != 0) ok = 0;
+    f = NULL;
+    if (!ok) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", caminho);
+        goto fim;
+    }
+    ret = 0;
+
+fim:
+    if (f) fclose(f);
+    caso_montado_liberar(&m);
+    return ret;
+}
+
+/* carrega o arquivo inteiro na memória (mmap ou leitura, sem POSIX) */
+static int caso_carregar_bytes(const char *caminho, CasoArquivo *c) {
+#ifdef DQ_POSIX
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    c->base = p;
+    c->tam = (size_t)st.st_size;
+    c->mapeado = 1;
+    return 0;
+#else
+    FILE *f = fopen(caminho, "rb");
+    if (!f) return -1;
+    if (fseek(f, 0, SEEK_END) != 0) { fclose(f); return -1; }
+    long tam = ftell(f);
+    rewind(f);
+    void *p = tam > 0 ? malloc((size_t)tam) : NULL;
+    if (!p || fread(p, 1, (size_t)tam, f) != (size_t)tam) {
+        free(p);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    c->base = p;
+    c->tam = (size_t)tam;
+    c->mapeado = 0;
+    return 0;
+#endif
+}
+
+static void caso_descarregar_bytes(CasoArquivo *c) {
+    if (!c->base) return;
+#ifdef DQ_POSIX
+    if (c->mapeado) {
+        munmap(c->base, c->tam);
+        return;
+    }
+#endif
+    free(c->base);
+}
+
+/* seção [off, off + n*tam) cabe no arquivo? */
+static int caso_secao_ok(const CasoArquivo *c, uint64_t off, uint64_t n, uint64_t tam) {
+    return off % 8 == 0 && off <= c->tam && n <= (c->tam - off) / (tam ? tam : 1);
+}
+
+/**
+ * casoAbrir(caminho)
+ * Mapeia o arquivo e confere apenas o cabeçalho (O(1) no tamanho do caso):
+ * o mapa e a hash leem direto das páginas mapeadas, sem malloc por nó.
+ * Para conferir cada offset do arquivo, use casoConferir.
+ * Retorna NULL em caso de erro.
+ */
+CasoArquivo *casoAbrir(const char *caminho) {
+    CasoArquivo *c = calloc(1, sizeof(CasoArquivo));
+    if (!c) return NULL;
+    if (caso_carregar_bytes(caminho, c) != 0) {
+        fprintf(stderr, "Erro: não foi possível abrir '%s'.\n", caminho);
+        free(c);
+        return NULL;
+    }
+    const CasoCabecalho *cab = c->base;
+    const char *motivo = NULL;
+    if (c->tam < sizeof(CasoCabecalho) || memcmp(cab->magia, CASO_MAGIA, 8) != 0)
+        motivo = "não é um arquivo de caso";
+    else if (!caso_versao_ok(cab))
+        motivo = "versão ou ordem de bytes incompatível";
+    else if (cab->tam_arquivo != c->tam || cab->n_salas == 0 ||
+             cab->n_salas == SALA_NENHUMA ||
+             !caso_secao_ok(c, cab->off_salas, cab->n_salas, sizeof(SalaPlana)) ||
+             !caso_hash_ok(cab, c->tam) ||
+             cab->off_pool > c->tam || cab->tam_pool != c->tam - cab->off_pool ||
+             cab->tam_pool == 0 || cab->tam_pool > UINT32_MAX ||
+             ((const char *)c->base)[c->tam - 1] != '\0')
+        motivo = "cabeçalho inconsistente";
+    if (!motivo) c->ht = mem_calloc(1, sizeof(HashTable));
+    if (motivo || !c->ht) {
+        fprintf(stderr, "Erro: '%s': %s.\n", caminho, motivo ? motivo : "sem memória");
+        caso_descarregar_bytes(c);
+        free(c);
+        return NULL;
+    }
+
+    const char *base = c->base;
+    c->plano.salas = (SalaPlana *)(uintptr_t)(base + cab->off_salas);
+    c->plano.n = cab->n_salas;
+    c->plano.pool = (char *)(uintptr_t)(base + cab->off_pool);
+    c->plano.pool_len = cab->tam_pool;
+
+    c->ht->modo = HASH_MAPEADA;
+    c->ht->tamanho = cab->hash_cap;
+    c->ht->mascara = cab->hash_cap - 1;
+    if (cab->flags & CASO_HASH_PERFEITA) {
+        c->ht->modo = HASH_PERFEITA;
+        c->ht->tamanho = cab->hash_n;
+        c->ht->mascara = 0;
+        c->ht->desloc = (const uint32_t *)(const void *)(base + caso_off_desloc(cab));
+        c->ht->n_baldes = cab->hash_cap;
+    }
+    c->ht->n = cab->hash_n;
+    c->ht->fn = hash_wy;
+    c->ht->semente = cab->hash_semente;
+    c->ht->mslots = (const CasoSlot *)(const void *)(base + cab->off_hash);
+    c->ht->mpool = c->plano.pool;
+    c->ht->mpool_len = c->plano.pool_len;
+    return c;
+}
+
+/* offset de string válido no pool? */
+static int caso_str_ok(const CasoArquivo *c, uint32_t off) {
+    return off < c->plano.pool_len;
+}
+
+/* forma de árvore: a sala 0 sem pai, as demais com exatamente um e todas
+   alcançáveis da raiz (sem ciclos nem pedaços soltos) */
+static int caso_arvore_ok(const MapaPlano *p) {
+    uint32_t n = p->n;
+    if (n == 0) return 0;
+    unsigned char *tem_pai = calloc(n, 1);
+    uint32_t *pilha = malloc((size_t)n * sizeof(uint32_t));
+    int ret = -1;
+    if (!tem_pai || !pilha) goto fim;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t f[2] = { p->salas[i].esq, p->salas[i].dir };
+        for (int k = 0; k < 2; ++k) {
+            if (f[k] == SALA_NENHUMA) continue;
+            if (f[k] == 0 || tem_pai[f[k]]) goto fim;
+            tem_pai[f[k]] = 1;
+        }
+    }
+    /* cada sala tem um só pai: a pilha nunca passa de n */
+    uint32_t k = 0, vistas = 0;
+    pilha[k++] = 0;
+    while (k > 0) {
+        const SalaPlana *sp = &p->salas[pilha[--k]];
+        ++vistas;
+        if (sp->esq != SALA_NENHUMA) pilha[k++] = sp->esq;
+        if (sp->dir != SALA_NENHUMA) pilha[k++] = sp->dir;
+    }
+    if (vistas == n) ret = 0;
+fim:
+    free(tem_pai);
+    free(pilha);
+    return ret;
+}
+
+/**
+ * casoConferir(c)
+ * Validação completa (O(tamanho do caso)): todos os offsets de strings e
+ * índices de filhos dentro dos limites, e as salas formando uma árvore a
+ * partir da sala 0. Para arquivos de origem duvidosa. Retorna 0 se o
+ * arquivo é consistente.
+ */
+int casoConferir(const CasoArquivo *c) {
+    for (uint32_t i = 0; i < c->plano.n; ++i) {
+        const SalaPlana *sp = &c->plano.salas[i];
+        if (!caso_str_ok(c, sp->nome) ||
+            (sp->pista != SALA_SEM_PISTA && !caso_str_ok(c, sp->pista)) ||
+            (sp->esq != SALA_NENHUMA && sp->esq >= c->plano.n) ||
+            (sp->dir != SALA_NENHUMA && sp->dir >= c->plano.n))
+            return -1;
+    }
+    if (caso_arvore_ok(&c->plano) != 0) return -1;
+    /* na perfeita os hash_n slots estão todos ocupados: nenhum vazio. Na
+       Robin Hood, hash_n ocupados (sobra vazio, hash_n < hash_cap) e cada
+       'dist' igual ao deslocamento real: a busca sempre termina */
+    int perfeita = c->ht->modo == HASH_PERFEITA;
+    size_t ocupados = 0;
+    for (size_t i = 0; i < c->ht->tamanho; ++i) {
+        const CasoSlot *sl = &c->ht->mslots[i];
+        if (sl->chave == CASO_SLOT_VAZIO && !perfeita) continue;
+        if (!caso_str_ok(c, sl->chave) || !caso_str_ok(c, sl->suspeito)) return -1;
+        if (!perfeita && sl->dist != ((i - (sl->hash & c->ht->mascara)) & c->ht->mascara)) return -1;
+        ++ocupados;
+    }
+    if (ocupados != c->ht->n) return -1;
+    /* hash perfeita: toda posição direta cai dentro dos slots */
+    for (size_t b = 0; perfeita && b < c->ht->n_baldes; ++b) {
+        uint32_t d = c->ht->desloc[b];
+        if ((d & PERFEITA_DIRETO) && (d & ~PERFEITA_DIRETO) >= c->ht->n) return -1;
+    }
+    return 0;
+}
+
+/* fecha o caso: desfaz o mapeamento (mapa e hash deixam de valer) */
+void casoFechar(CasoArquivo *c) {
+    if (!c) return;
+    liberarHash(c->ht);
+    caso_descarregar_bytes(c);
+    free(c);
+}
+
+/* ===========================
+   Caso embutido no executável (DQ_CASO_EMBUTIDO)
+   =========================== */
+
+/*
+ * casoGerarC grava um caso como fonte C: as mesmas seções do arquivo
+ * binário (salas, hash perfeita e pool de strings) em vetores const, mais
+ * o conjunto de suspeitos e o índice por nome já montados. Compilado com
+ * -DDQ_CASO_EMBUTIDO='"caso.h"', o executável traz o caso pronto: mapa
+ * plano e hash apontam para os dados estáticos, sem malloc nem inserções
+ * para montar a mansão (ver casoEmbutido). Catálogo e resumo das dicas,
+ * endereçados por ponteiro, continuam montados no primeiro uso.
+ */
+
+#ifdef DQ_CASO_EMBUTIDO
+#include DQ_CASO_EMBUTIDO
+
+static MapaPlano caso_embutido_plano = {
+    (SalaPlana *)caso_emb_salas, CASO_EMB_N_SALAS, (char *)caso_emb_pool, CASO_EMB_POOL_LEN
+};
+
+static IndiceNomes caso_embutido_nomes = {
+    (char *)caso_emb_nomes_chaves, (uint32_t *)caso_emb_nomes_off, (uint32_t *)caso_emb_nomes_ordem,
+    (uint32_t *)caso_emb_nomes_slots, CASO_EMB_N_SUSPEITOS, CASO_EMB_NOMES_CAP, CASO_EMB_SEMENTE
+};
+
+/* 'sus' sem índice (cap_idx 0): suspeito_pos faz busca binária por endereço */
+static HashTable caso_embutido_ht = {
+    .modo = HASH_PERFEITA,
+    .tamanho = CASO_EMB_HASH_N,
+    .n = CASO_EMB_HASH_N,
+    .fn = hash_wy,
+    .semente = CASO_EMB_SEMENTE,
+    .mslots = caso_emb_slots,
+    .mpool = caso_emb_pool,
+    .mpool_len = CASO_EMB_POOL_LEN,
+    .desloc = caso_emb_desloc,
+    .n_baldes = CASO_EMB_N_BALDES,
+    .sus = { (const char **)caso_emb_sus_nomes, (uint32_t *)caso_emb_sus_refs, NULL,
+             CASO_EMB_N_SUSPEITOS, 0, CASO_EMB_SUS_VIVOS },
+    .sus_pronto = 1,
+    .nomes = &caso_embutido_nomes,
+};
+#endif
+
+/**
+ * casoEmbutido(ptr_plano, ptr_ht)
+ * Mapa e hash do caso compilado no executável. Não são donos de memória:
+ * no fim use casoEmbutidoLiberar, não liberarHash. Retorna -1 se o
+ * programa foi compilado sem DQ_CASO_EMBUTIDO.
+ */
+int casoEmbutido(MapaPlano **plano, HashTable **ht) {
+#ifdef DQ_CASO_EMBUTIDO
+    *plano = &caso_embutido_plano;
+    *ht = &caso_embutido_ht;
+    return 0;
+#else
+    (void)plano;
+    (void)ht;
+    return -1;
+#endif
+}
+
+/* fim do caso embutido: suspeitos e índice vêm prontos do fonte gerado e
+   a hash é somente leitura, então nada foi alocado sobre ela */
+void casoEmbutidoLiberar(void) {
+}
+
+/* string do pool como literal C (bytes >= 0x80 passam como estão) */
+static void caso_c_literal(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\' || c == '?') fprintf(f, "\\%c", c);
+        else if (c < 0x20 || c == 0x7f) fprintf(f, "\\%03o", c);
+        else fputc(c, f);
+    }
+    fputs("\\000\"", f);
+}
+
+/* semente inicial da hash perfeita do fonte gerado (as tentativas seguintes
+   somam 1): fonte reprodutível para versionar ou gerar no build */
+#define CASO_C_SEMENTE UINT64_C(0x9e3779b97f4a7c15)
+
+/**
+ * casoGerarC(caminho, plano, ht)
+ * Grava o caso como fonte C para DQ_CASO_EMBUTIDO. A hash precisa estar
+ * congelada (congelarHash): o fonte leva a hash perfeita, com semente
+ * fixa (CASO_C_SEMENTE), e o mesmo caso gera sempre o mesmo fonte.
+ * Retorna 0 em sucesso.
+ */
+int casoGerarC(const char *caminho, const MapaPlano *plano, HashTable *ht) {
+    if (!ht || ht->modo != HASH_PERFEITA) {
+        fprintf(stderr, "Erro: o caso embutido precisa da hash congelada.\n");
+        return -1;
+    }
+    CasoMontado m;
+    HashTable v;
+    FILE *f = NULL;
+    int ret = -1;
+    memset(&v, 0, sizeof(v));
+    if (caso_montar(&m, plano, ht, CASO_C_SEMENTE) != 0) goto fim;
+    const CasoCabecalho *cab = &m.cab;
+
+    /* a hash como o executável a verá: os suspeitos e o índice montados
+       sobre ela vão para o fonte (nomes como offsets do pool) */
+    v.modo = HASH_PERFEITA;
+    v.tamanho = v.n = cab->hash_n;
+    v.fn = hash_wy;
+    v.semente = cab->hash_semente;
+    v.mslots = m.slots;
+    v.mpool = m.pe.pool;
+    v.mpool_len = m.pe.len;
+    v.desloc = m.desloc;
+    v.n_baldes = cab->hash_cap;
+    const SuspeitoSet *sus = hashSuspeitos(&v);
+    const IndiceNomes *ix = hashIndiceNomes(&v);
+    int completo = ix && ix->n == sus->n;
+    for (size_t p = 1; completo && p < sus->n; ++p)
+        completo = (uintptr_t)sus->nomes[p - 1] < (uintptr_t)sus->nomes[p];
+    for (size_t i = 0; completo && i < cab->hash_n; ++i)
+        completo = suspeito_pos(sus, m.pe.pool + m.slots[i].suspeito) != SUSPEITO_NENHUM;
+    if (!completo) {
+        fprintf(stderr, "Erro: memória insuficiente para os suspeitos do caso.\n");
+        goto fim;
+    }
+
+    f = fopen(caminho, "w");
+    if (!f) {
+        fprintf(stderr, "Erro: não foi possível criar '%s'.\n", caminho);
+        goto fim;
+    }
+
+    fprintf(f, "/* Caso embutido gerado por --gerar-c (não editar).\n"
+               "   Compilar com -DDQ_CASO_EMBUTIDO='\"%s\"'. */\n\n", caminho);
+    fprintf(f, "#define CASO_EMB_N_SALAS %uu\n", (unsigned)cab->n_salas);
+    fprintf(f, "#define CASO_EMB_HASH_N %uu\n", (unsigned)cab->hash_n);
+    fprintf(f, "#define CASO_EMB_N_BALDES %uu\n", (unsigned)cab->hash_cap);
+    fprintf(f, "#define CASO_EMB_SEMENTE UINT64_C(0x%016llx)\n", (unsigned long long)cab->hash_semente);
+    fprintf(f, "#define CASO_EMB_POOL_LEN %zuu\n", m.pe.len);
+    fprintf(f, "#define CASO_EMB_N_SUSPEITOS %zuu\n", sus->n);
+    fprintf(f, "#define CASO_EMB_SUS_VIVOS %zuu\n", sus->vivos);
+    fprintf(f, "#define CASO_EMB_NOMES_CAP %zuu\n\n", ix->cap_slots);
+
+    fprintf(f, "static const char caso_emb_pool[CASO_EMB_POOL_LEN + 1] =");
+    for (size_t off = 0; off < m.pe.len; off += strlen(m.pe.pool + off) + 1) {
+        fputs("\n    ", f);
+        caso_c_literal(f, m.pe.pool + off);
+    }
+    fprintf(f, ";\n\nstatic const SalaPlana caso_emb_salas[CASO_EMB_N_SALAS] = {\n");
+    for (uint32_t i = 0; i < cab->n_salas; ++i) {
+        const SalaPlana *sp = &m.salas[i];
+        fprintf(f, "    { %uu, ", (unsigned)sp->nome);
+        if (sp->pista == SALA_SEM_PISTA) fputs("SALA_SEM_PISTA, ", f);
+        else fprintf(f, "%uu, ", (unsigned)sp->pista);
+        if (sp->esq == SALA_NENHUMA) fputs("SALA_NENHUMA, ", f);
+        else fprintf(f, "%uu, ", (unsigned)sp->esq);
+        if (sp->dir == SALA_NENHUMA) fputs("SALA_NENHUMA },\n", f);
+        else fprintf(f, "%uu },\n", (unsigned)sp->dir);
+    }
+    /* vetores vazios não existem em C: sobra um slot que a busca nunca lê */
+    fprintf(f, "};\n\nstatic const CasoSlot caso_emb_slots[%zu] = {\n",
+            cab->hash_n ? (size_t)cab->hash_n : 1);
+    for (uint32_t i = 0; i < cab->hash_n; ++i) {
+        const CasoSlot *sl = &m.slots[i];
+        fprintf(f, "    { %uu, %uu, 0x%08xu, 0 },\n",
+                (unsigned)sl->chave, (unsigned)sl->suspeito, (unsigned)sl->hash);
+    }
+    if (cab->hash_n == 0) fputs("    { 0, 0, 0, 0 },\n", f);
+    fprintf(f, "};\n\nstatic const uint32_t caso_emb_desloc[CASO_EMB_N_BALDES] = {");
+    for (uint32_t b = 0; b < cab->hash_cap; ++b)
+        fprintf(f, "%s0x%08xu,", b % 6 ? " " : "\n    ", (unsigned)m.desloc[b]);
+
+    /* suspeitos na ordem de hashSuspeitos e índice por nome (sem
+       suspeitos, cada vetor leva uma entrada que ninguém lê) */
+    size_t ns = sus->n ? sus->n : 1;
+    fprintf(f, "\n};\n\nstatic const char *const caso_emb_sus_nomes[%zu] = {", ns);
+    for (size_t p = 0; p < ns; ++p)
+        fprintf(f, "%scaso_emb_pool + %zuu,", p % 4 ? " " : "\n    ",
+                sus->n ? (size_t)(sus->nomes[p] - m.pe.pool) : (size_t)0);
+    fprintf(f, "\n};\n\nstatic const uint32_t caso_emb_sus_refs[%zu] = {", ns);
+    for (size_t p = 0; p < ns; ++p)
+        fprintf(f, "%s%uu,", p % 8 ? " " : "\n    ", sus->n ? (unsigned)sus->refs[p] : 0u);
+    fputs("\n};\n\nstatic const char caso_emb_nomes_chaves[] =", f);
+    for (size_t p = 0; p < sus->n; ++p) {
+        fputs("\n    ", f);
+        caso_c_literal(f, ix->chaves + ix->off[p]);
+    }
+    if (sus->n == 0) fputs(" \"\"", f);
+    fprintf(f, ";\n\nstatic const uint32_t caso_emb_nomes_off[%zu] = {", ns);
+    for (size_t p = 0; p < ns; ++p)
+        fprintf(f, "%s%uu,", p % 8 ? " " : "\n    ", sus->n ? (unsigned)ix->off[p] : 0u);
+    fprintf(f, "\n};\n\nstatic const uint32_t caso_emb_nomes_ordem[%zu] = {", ns);
+    for (size_t p = 0; p < ns; ++p)
+        fprintf(f, "%s%uu,", p % 8 ? " " : "\n    ", sus->n ? (unsigned)ix->ordem[p] : 0u);
+    fputs("\n};\n\nstatic const uint32_t caso_emb_nomes_slots[CASO_EMB_NOMES_CAP] = {", f);
+    for (size_t j = 0; j < ix->cap_slots; ++j)
+        fprintf(f, "%s%uu,", j % 8 ? " " : "\n    ", (unsigned)ix->slots[j]);
+    fputs("\n};\n", f);
+
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    f = NULL;
+    if (!ok) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", caminho);
+        goto fim;
+    }
+    ret = 0;
+
+fim:
+    if (f) fclose(f);
+    hash_liberar_conteudo(&v);
+    caso_montado_liberar(&m);
+    return ret;
+}
+
+/* ===========================
+   Importação de casos em texto (TSV)
+   =========================== */
+
+/*
+ * Uma definição por linha, campos separados por TAB ('#' inicia comentário):
+ *   S <id> <nome> [<pista>]     sala; ids de 0 a n-1, a sala 0 é a raiz
+ *   L <pai> <esq|-> <dir|->     filhos de uma sala ('-' = sem filho)
+ *   P <pista> <suspeito>        associação pista -> suspeito
+ * A leitura é feita em blocos grandes. Uma primeira passada só conta salas e
+ * associações, para dimensionar arena, interner e hash uma única vez.
+ */
+
+/* tamanho de cada leitura do arquivo */
+#define IMPORT_BLOCO ((size_t)1 << 20)
+
+/* Estatísticas de uma importação */
+typedef struct ImportStats {
+    size_t bytes;
+    size_t linhas;
+    size_t salas;
+    size_t ligacoes;
+    size_t pares;
+    double segundos;
+} ImportStats;
+
+/* leitor de linhas sobre blocos de IMPORT_BLOCO bytes */
+typedef struct LeitorLinhas {
+    FILE *f;
+    char *buf;
+    size_t cap, ini, fim;
+    int eof;
+    size_t bytes;
+} LeitorLinhas;
+
+static int leitor_abrir(LeitorLinhas *l, FILE *f) {
+    memset(l, 0, sizeof(*l));
+    l->f = f;
+    l->cap = IMPORT_BLOCO;
+    l->buf = malloc(l->cap + 1);
+    return l->buf ? 0 : -1;
+}
+
+static void leitor_rebobinar(LeitorLinhas *l) {
+    rewind(l->f);
+    l->ini = l->fim = 0;
+    l->eof = 0;
+    l->bytes = 0;
+}
+
+/* próxima linha (terminada em '\0', sem '\n'/'\r'); NULL no fim do arquivo.
+   A linha vive no buffer do leitor até a próxima chamada. */
+static char *leitor_proxima(LeitorLinhas *l) {
+    for (;;) {
+        char *ini = l->buf + l->ini;
+        char *nl = memchr(ini, '\n', l->fim - l->ini);
+        if (nl || (l->eof && l->ini < l->fim)) {
+            char *fim = nl ? nl : l->buf + l->fim;
+            l->ini = nl ? (size_t)(nl - l->buf) + 1 : l->fim;
+            if (fim > ini && fim[-1] == '\r') --fim;
+            *fim = '\0';
+            return ini;
+        }
+        if (l->eof) return NULL;
+        /* linha incompleta: desloca para o início e lê outro bloco */
+        size_t resto = l->fim - l->ini;
+        if (resto == l->cap) {
+            char *tmp = realloc(l->buf, l->cap * 2 + 1);
+            if (!tmp) return NULL;
+            l->buf = tmp;
+            l->cap *= 2;
+        }
+        memmove(l->buf, l->buf + l->ini, resto);
+        l->ini = 0;
+        l->fim = resto;
+        size_t lidos = fread(l->buf + l->fim, 1, l->cap - l->fim, l->f);
+        l->fim += lidos;
+        l->bytes += lidos;
+        if (lidos == 0) l->eof = 1;
+    }
+}
+
+/* separa até 'max' campos por TAB (modifica a linha); retorna quantos */
+static int separar_campos(char *linha, char **campos, int max) {
+    int n = 0;
+    while (n < max) {
+        campos[n++] = linha;
+        char *tab = strchr(linha, '\t');
+        if (!tab) break;
+        *tab = '\0';
+        linha = tab + 1;
+    }
+    return n;
+}
+
+/* id de sala decimal em [0, n); -1 para '-' ; -2 se inválido */
+static long ler_id(const char *s, size_t n) {
+    if (s[0] == '-' && s[1] == '\0') return -1;
+    char *fim;
+    unsigned long v = strtoul(s, &fim, 10);
+    if (fim == s || *fim != '\0' || v >= n) return -2;
+    return (long)v;
+}
+
+/**
+ * importarCaso(caminho, arena, raiz, ht, st)
+ * Lê um caso em TSV: salas vão para um único vetor na arena, associações
+ * para uma hash aberta já no tamanho final, inseridas em lote. Retorna 0 em
+ * sucesso; em erro, informa a linha. 'st' (opcional) recebe as estatísticas.
+ */
+int importarCaso(const char *caminho, Arena *arena, Sala **raiz, HashTable **ht,
+                 ImportStats *st) {
+    ImportStats est;
+    memset(&est, 0, sizeof(est));
+    double t0 = agora_seg();
+    FILE *f = fopen(caminho, "rb");
+    if (!f) {
+        fprintf(stderr, "Erro: não foi possível abrir '%s'.\n", caminho);
+        return -1;
+    }
+    LeitorLinhas l;
+    Sala *salas = NULL;
+    unsigned char *tem_pai = NULL;
+    char **pares = NULL;          /* pista0, suspeito0, pista1, ... */
+    char *textos = NULL;          /* cópia dos campos das associações */
+    HashTable *h = NULL;
+    int ret = -1;
+    if (leitor_abrir(&l, f) != 0) goto fim;
+
+    /* 1a passada: contar salas, associações e bytes dos textos dos pares */
+    size_t n_salas = 0, n_pares = 0, bytes_pares = 0;
+    char *linha;
+    while ((linha = leitor_proxima(&l))) {
+        if (linha[0] == 'S' && linha[1] == '\t') n_salas++;
+        else if (linha[0] == 'P' && linha[1] == '\t') {
+            n_pares++;
+            bytes_pares += strlen(linha);
+        }
+    }
+    if (n_salas == 0 || n_salas >= SALA_NENHUMA) {
+        fprintf(stderr, "Erro: '%s' não define salas.\n", caminho);
+        goto fim;
+    }
+
+    /* dimensionamento único: vetor de salas na arena, interner e hash */
+    salas = arena_alloc(arena, n_salas * sizeof(Sala));
+    tem_pai = calloc(n_salas, 1);
+    pares = malloc((2 * n_pares + 1) * sizeof(char *));
+    textos = malloc(bytes_pares + 1);
+    HashConfig cfg = { HASH_ABERTA, n_pares, NULL, 0, 0, NULL };
+    h = criarHashConfig(&cfg);
+    if (!salas || !tem_pai || !pares || !textos || !h ||
+        interner_reservar(interner_padrao(), 2 * n_salas + 2 * n_pares) != 0) {
+        fprintf(stderr, "Erro: memória para importar '%s'.\n", caminho);
+        goto fim;
+    }
+    memset(salas, 0, n_salas * sizeof(Sala));
+
+    /* 2a passada: interpretar */
+    leitor_rebobinar(&l);
+    size_t np = 0, usados = 0;
+    while ((linha = leitor_proxima(&l))) {
+        est.linhas++;
+        if (linha[0] == '\0' || linha[0] == '#') continue;
+        char *c[5];
+        int k = separar_campos(linha, c, 5);
+        if (c[0][0] == 'S' && c[0][1] == '\0' && (k == 3 || k == 4)) {
+            long id = ler_id(c[1], n_salas);
+            if (id < 0 || salas[id].nome) goto linha_invalida;
+            salas[id].nome = intern(c[2]);
+            salas[id].pista = (k == 4 && c[3][0]) ? intern(c[3]) : NULL;
+            est.salas++;
+        } else if (c[0][0] == 'L' && c[0][1] == '\0' && k == 4) {
+            long pai = ler_id(c[1], n_salas), e = ler_id(c[2], n_salas), d = ler_id(c[3], n_salas);
+            if (pai < 0 || e < -1 || d < -1 || e == 0 || d == 0 || (e >= 0 && e == d))
+                goto linha_invalida;
+            if (salas[pai].esq || salas[pai].dir) goto linha_invalida;
+            if ((e >= 0 && tem_pai[e]) || (d >= 0 && tem_pai[d])) goto linha_invalida;
+            if (e >= 0) { tem_pai[e] = 1; salas[pai].esq = &salas[e]; }
+            if (d >= 0) { tem_pai[d] = 1; salas[pai].dir = &salas[d]; }
+            est.ligacoes++;
+        } else if (c[0][0] == 'P' && c[0][1] == '\0' && k == 3) {
+            /* campos copiados: a linha some na próxima leitura do bloco */
+            size_t lp = strlen(c[1]) + 1, ls = strlen(c[2]) + 1;
+            memcpy(textos + usados, c[1], lp);
+            pares[2 * np] = textos + usados;
+            usados += lp;
+            memcpy(textos + usados, c[2], ls);
+            pares[2 * np + 1] = textos + usados;
+            usados += ls;
+            np++;
+        } else {
+            goto linha_invalida;
+        }
+        continue;
+linha_invalida:
+        fprintf(stderr, "Erro: '%s', linha %zu: definição inválida.\n", caminho, est.linhas);
+        goto fim;
+    }
+    for (size_t i = 0; i < n_salas; ++i) {
+        if (!salas[i].nome) {
+            fprintf(stderr, "Erro: '%s': sala %zu não definida.\n", caminho, i);
+            goto fim;
+        }
+    }
+
+    /* associações em lote: sem procurar duplicatas a cada inserção */
+    {
+        const char **ps = malloc((np + 1) * sizeof(char *));
+        const char **ss = malloc((np + 1) * sizeof(char *));
+        if (!ps || !ss) {
+            free(ps);
+            free(ss);
+            goto fim;
+        }
+        for (size_t i = 0; i < np; ++i) {
+            ps[i] = pares[2 * i];
+            ss[i] = pares[2 * i + 1];
+        }
+        inserirNaHashLote(h, ps, ss, np);
+        free(ps);
+        free(ss);
+    }
+    est.pares = np;
+    est.bytes = l.bytes;
+    *raiz = &salas[0];
+    *ht = h;
+    h = NULL;
+    ret = 0;
+
+fim:
+    est.segundos = agora_seg() - t0;
+    if (st) *st = est;
+    liberarHash(h);
+    free(tem_pai);
+    free(pares);
+    free(textos);
+    free(l.buf);
+    fclose(f);
+    return ret;
+}
+
+/* imprime a vazão de uma importação em stderr */
+void importRelatorio(const ImportStats *st) {
+    double dt = st->segundos > 0 ? st->segundos : 1e-9;
+    fprintf(stderr, "[importação] %zu bytes, %zu linhas (%zu salas, %zu ligações, %zu pares) "
+            "em %.3f s: %.1f MB/s, %.0f linhas/s\n",
+            st->bytes, st->linhas, st->salas, st->ligacoes, st->pares, st->segundos,
+            (double)st->bytes / dt / 1e6, (double)st->linhas / dt);
+}
+
+/* ===========================
+   Gerador procedural de mansões
+   =========================== */
+
+/*
+ * Monta direto no layout plano uma mansão de 'salas' cômodos e a hash
+ * pista -> suspeito correspondente, pronta como a de um arquivo de caso
+ * (HASH_MAPEADA sobre o pool do próprio mapa: nada é internado, o que
+ * permite chegar a 10^8 salas). As salas ficam em pré-ordem: a sala j com
+ * subárvore de s salas tem o filho esquerdo em j+1 e o direito em j+1+E,
+ * com E = tamanho da subárvore esquerda sorteado a partir de (semente, j, s).
+ * Nomes, pistas e suspeitos dependem só de (semente, j): a mesma
+ * configuração gera o mesmo mapa, bit a bit, com qualquer número de threads.
+ */
+
+typedef enum FormaMansao {
+    FORMA_BALANCEADA = 0,      /* árvore completa */
+    FORMA_DEGENERADA,          /* uma corrente: cada sala tem um único filho */
+    FORMA_ALEATORIA            /* E uniforme em [0, s-1] (profundidade O(log n) esperada) */
+} FormaMansao;
+
+/* Parâmetros do gerador (mesma configuração = mesma mansão) */
+typedef struct GeradorConfig {
+    size_t salas;              /* 1 .. SALA_NENHUMA-1 */
+    FormaMansao forma;
+    double densidade;          /* fração das salas com pista (0..1) */
+    uint32_t suspeitos;        /* >= 1 */
+    uint64_t semente;
+    int threads;               /* 0 = núcleos disponíveis */
+} GeradorConfig;
+
+/* Mansão gerada: dona das salas, do pool e dos slots da hash */
+typedef struct MansaoGerada {
+    MapaPlano plano;
+    HashTable *ht;             /* HASH_MAPEADA: slots abaixo, strings em plano.pool */
+    CasoSlot *slots;
+    size_t pistas;
+    double segundos;
+} MansaoGerada;
+
+/* salas por bloco nas fases de strings */
+#define GERADOR_BLOCO 65536u
+/* regiões da hash colocadas em paralelo (potência de 2) */
+#define GERADOR_REGIOES 64u
+
+static const char *const gerador_tipos[16] = {
+    "Hall", "Sala de Estar", "Corredor", "Cozinha", "Biblioteca", "Quarto", "Jardim", "Adega",
+    "Sótão", "Escritório", "Capela", "Estufa", "Galeria", "Salão de Baile", "Despensa", "Torre",
+};
+static const char *const gerador_pistas[16] = {
+    "Pegadas de lama", "Chave perdida", "Lençol manchado", "Livro com página faltando",
+    "Gaveta perdida", "Bilhete rasgado", "Copo com batom", "Luva esquecida", "Vela apagada",
+    "Relógio parado", "Janela forçada", "Cinzas na lareira", "Botão arrancado",
+    "Mapa rabiscado", "Frasco vazio", "Fio de cabelo",
+};
+static const char *const gerador_suspeitos[16] = {
+    "Jardineiro", "Empregado", "Bibliotecário", "Mordomo", "Cozinheira", "Governanta",
+    "Motorista", "Herdeira", "Médico", "Coronel", "Viúva", "Sobrinho", "Advogado",
+    "Professora", "Pintor", "Enfermeira",
+};
+
+/* subárvore (ou trecho de corrente) a preencher: salas de 'ini' até 'fim' */
+typedef struct TarefaGerar {
+    uint32_t ini, tam;         /* raiz da tarefa e tamanho da subárvore dela */
+    uint32_t fim;              /* salas >= fim são de outra tarefa */
+} TarefaGerar;
+
+typedef enum FaseGerador {
+    GERAR_ESTRUTURA,           /* itens = tarefas: filhos de cada sala */
+    GERAR_CONTAR,              /* itens = blocos: bytes de strings e pistas */
+    GERAR_ESCREVER,            /* itens = blocos: pool, offsets e entradas da hash */
+    GERAR_ESPALHAR,            /* itens = blocos: entradas agrupadas por região */
+    GERAR_COLOCAR              /* itens = regiões: Robin Hood ordenado pelo slot ideal */
+} FaseGerador;
+
+typedef struct Gerador {
+    const GeradorConfig *cfg;
+    MansaoGerada *g;
+    uint64_t lim_pista;        /* sala com pista: sorteio < lim_pista */
+    TarefaGerar *tarefas;
+    size_t n_tarefas;
+    size_t n_blocos;
+    uint64_t *bytes;           /* por bloco: bytes de strings, depois o offset inicial */
+    uint32_t *pistas_bloco;    /* por bloco: pistas, depois a primeira */
+    uint32_t *off_suspeito;    /* suspeito -> offset no pool */
+    CasoSlot *entradas;        /* pista k (em ordem de sala) -> slot a colocar */
+    CasoSlot *ordem;           /* entradas agrupadas por região */
+    size_t *regiao_pos;        /* [bloco * regioes + r]: contagem, depois a posição */
+    size_t *regiao_ini;        /* início de cada região em 'ordem' (regioes + 1) */
+    size_t *regiao_sobra;      /* entradas colocadas (o resto transborda) */
+    uint32_t regioes, desl_regiao;
+    FaseGerador fase;
+    size_t n_itens;
+    _Atomic size_t prox;
+    atomic_int erro;
+} Gerador;
+
+/* sorteio de (semente, j, sal): splitmix64 */
+static inline uint64_t gerador_sorteio(uint64_t semente, uint64_t j, uint64_t sal) {
+    uint64_t z = semente + j * 0x9e3779b97f4a7c15ull + sal * 0xd1b54a32d192ed03ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* tamanho da subárvore esquerda da sala j, que tem s salas na subárvore */
+static uint32_t gerador_esquerda(const GeradorConfig *cfg, uint32_t j, uint32_t s) {
+    if (s <= 1) return 0;
+    if (cfg->forma == FORMA_DEGENERADA)
+        return gerador_sorteio(cfg->semente, j, 1) & 1 ? s - 1 : 0;
+    if (cfg->forma == FORMA_ALEATORIA)
+        return (uint32_t)(gerador_sorteio(cfg->semente, j, 1) % s);
+    /* completa: níveis cheios dos dois lados + o que couber do último nível */
+    uint32_t h = 0;
+    while (((uint64_t)2 << h) - 1 <= s) ++h;
+    uint64_t metade = (uint64_t)1 << (h - 1), ultimo = s - (((uint64_t)1 << h) - 1);
+    return (uint32_t)(metade - 1 + (ultimo < metade ? ultimo : metade));
+}
+
+/* grava os filhos da sala j; devolve as subárvores deles em e/d (tam 0 = nenhum) */
+static void gerador_sala(const Gerador *G, uint32_t j, uint32_t s, TarefaGerar *e, TarefaGerar *d) {
+    uint32_t esq = gerador_esquerda(G->cfg, j, s), dir = s - 1 - esq;
+    SalaPlana *sp = &G->g->plano.salas[j];
+    sp->esq = esq ? j + 1 : SALA_NENHUMA;
+    sp->dir = dir ? j + 1 + esq : SALA_NENHUMA;
+    *e = (TarefaGerar){ j + 1, esq, 0 };
+    *d = (TarefaGerar){ j + 1 + esq, dir, 0 };
+}
+
+/* preenche uma tarefa em profundidade (pilha explícita) */
+static int gerador_estrutura(const Gerador *G, TarefaGerar t, TarefaGerar **pilha, size_t *cap) {
+    size_t k = 0;
+    (*pilha)[k++] = t;
+    while (k > 0) {
+        TarefaGerar x = (*pilha)[--k], e, d;
+        gerador_sala(G, x.ini, x.tam, &e, &d);
+        if (k + 2 > *cap) {
+            TarefaGerar *tmp = realloc(*pilha, *cap * 2 * sizeof(TarefaGerar));
+            if (!tmp) return -1;
+            *pilha = tmp;
+            *cap *= 2;
+        }
+        if (d.tam && d.ini < t.fim) (*pilha)[k++] = d;
+        if (e.tam && e.ini < t.fim) (*pilha)[k++] = e;
+    }
+    return 0;
+}
+
+/* escreve "<a><sep><num>\0" em dest (NULL = só mede); devolve os bytes com o '\0' */
+static size_t gerador_texto(char *dest, const char *a, const char *sep, uint32_t num) {
+    char dig[10];
+    size_t nd = 0, la = strlen(a), ls = strlen(sep);
+    do {
+        dig[nd++] = (char)('0' + num % 10);
+        num /= 10;
+    } while (num);
+    if (dest) {
+        memcpy(dest, a, la);
+        memcpy(dest + la, sep, ls);
+        for (size_t i = 0; i < nd; ++i) dest[la + ls + i] = dig[nd - 1 - i];
+        dest[la + ls + nd] = '\0';
+    }
+    return la + ls + nd + 1;
+}
+
+static size_t gerador_suspeito_texto(char *dest, uint32_t k) {
+    const char *base = gerador_suspeitos[k % 16];
+    if (k < 16) {
+        size_t len = strlen(base) + 1;
+        if (dest) memcpy(dest, base, len);
+        return len;
+    }
+    return gerador_texto(dest, base, " ", k / 16 + 1);
+}
+
+/* sala com pista: sorteio (sal 2) abaixo deste limite */
+static uint64_t gerador_lim_pista(const GeradorConfig *cfg) {
+    return cfg->densidade >= 1 ? UINT64_MAX : (uint64_t)(cfg->densidade * 18446744073709551616.0);
+}
+
+/* nome da sala j, pista (se houver: devolve 1) e suspeito dela */
+static int gerador_pista(const Gerador *G, uint32_t j, uint32_t *sus) {
+    uint64_t r = gerador_sorteio(G->cfg->semente, j, 2);
+    if (r >= G->lim_pista && G->lim_pista != UINT64_MAX) return 0;
+    *sus = (uint32_t)(gerador_sorteio(G->cfg->semente, j, 3) % G->cfg->suspeitos);
+    return 1;
+}
+
+/* bytes de strings e pistas do bloco b */
+static void gerador_contar(Gerador *G, size_t b) {
+    uint32_t ini = (uint32_t)(b * GERADOR_BLOCO), fim = G->g->plano.n;
+    if (fim - ini > GERADOR_BLOCO) fim = ini + GERADOR_BLOCO;
+    uint64_t bytes = 0;
+    uint32_t pistas = 0, sus;
+    for (uint32_t j = ini; j < fim; ++j) {
+        uint64_t r = gerador_sorteio(G->cfg->semente, j, 4);
+        bytes += gerador_texto(NULL, gerador_tipos[r & 15], " ", j);
+        if (gerador_pista(G, j, &sus)) {
+            bytes += gerador_texto(NULL, gerador_pistas[(r >> 4) & 15], " #", j);
+            pistas += 1;
+        }
+    }
+    G->bytes[b] = bytes;
+    G->pistas_bloco[b] = pistas;
+}
+
+/* strings do bloco b no pool, offsets das salas e entradas da hash */
+static void gerador_escrever(Gerador *G, size_t b) {
+    MapaPlano *m = &G->g->plano;
+    uint32_t ini = (uint32_t)(b * GERADOR_BLOCO), fim = m->n;
+    if (fim - ini > GERADOR_BLOCO) fim = ini + GERADOR_BLOCO;
+    uint64_t off = G->bytes[b];
+    CasoSlot *ent = G->entradas + G->pistas_bloco[b];
+    size_t *cont = G->regiao_pos + b * G->regioes;
+    uint32_t sus;
+    for (uint32_t j = ini; j < fim; ++j) {
+        uint64_t r = gerador_sorteio(G->cfg->semente, j, 4);
+        SalaPlana *sp = &m->salas[j];
+        sp->nome = (uint32_t)off;
+        off += gerador_texto(m->pool + off, gerador_tipos[r & 15], " ", j);
+        sp->pista = SALA_SEM_PISTA;
+        if (!gerador_pista(G, j, &sus)) continue;
+        sp->pista = (uint32_t)off;
+        size_t len = gerador_texto(m->pool + off, gerador_pistas[(r >> 4) & 15], " #", j);
+        ent->chave = (uint32_t)off;
+        ent->suspeito = G->off_suspeito[sus];
+        ent->hash = (uint32_t)hash_wy(m->pool + off, len - 1, G->g->ht->semente);
+        ent->dist = 0;
+        cont[(ent->hash & G->g->ht->mascara) >> G->desl_regiao] += 1;
+        ++ent;
+        off += len;
+    }
+}
+
+/* copia as entradas do bloco b para as regiões, na ordem das salas */
+static void gerador_espalhar(Gerador *G, size_t b) {
+    size_t *pos = G->regiao_pos + b * G->regioes;
+    const CasoSlot *ent = G->entradas + G->pistas_bloco[b];
+    size_t n = (b + 1 < G->n_blocos ? G->pistas_bloco[b + 1] : G->g->pistas) - G->pistas_bloco[b];
+    for (size_t i = 0; i < n; ++i) {
+        size_t r = (ent[i].hash & G->g->ht->mascara) >> G->desl_regiao;
+        G->ordem[pos[r]++] = ent[i];
+    }
+}
+
+/* região r: ordena pelo slot ideal e coloca em sequência; o que passar do
+   fim da região fica para a colocação Robin Hood final. A ordenação é por
+   contagem (estável): as entradas chegam em ordem de sala, então empates
+   ficam na ordem do offset da pista. 0 em sucesso, -1 sem memória */
+static int gerador_colocar(Gerador *G, size_t r) {
+    const HashTable *ht = G->g->ht;
+    CasoSlot *v = G->ordem + G->regiao_ini[r];
+    size_t n = G->regiao_ini[r + 1] - G->regiao_ini[r];
+    size_t prox = r << G->desl_regiao, fim = (r + 1) << G->desl_regiao, i = 0;
+    uint32_t *ini = calloc(fim - prox + 1, sizeof(uint32_t));
+    CasoSlot *tmp = malloc((n ? n : 1) * sizeof(CasoSlot));
+    if (!ini || !tmp) {
+        free(ini);
+        free(tmp);
+        return -1;
+    }
+    memcpy(tmp, v, n * sizeof(CasoSlot));
+    for (size_t k = 0; k < n; ++k) ini[(tmp[k].hash & ht->mascara) - prox + 1] += 1;
+    for (size_t k = prox + 1; k < fim; ++k) ini[k - prox] += ini[k - prox - 1];
+    for (size_t k = 0; k < n; ++k) v[ini[(tmp[k].hash & ht->mascara) - prox]++] = tmp[k];
+    free(ini);
+    free(tmp);
+    for (; i < n; ++i) {
+        size_t ideal = v[i].hash & ht->mascara, p = ideal > prox ? ideal : prox;
+        if (p >= fim) break;
+        v[i].dist = (uint32_t)(p - ideal);
+        G->g->slots[p] = v[i];
+        prox = p + 1;
+    }
+    G->regiao_sobra[r] = i;
+    return 0;
+}
+
+/* corpo das threads: pega itens da fase atual até acabarem */
+static void *gerador_rodar(void *arg) {
+    Gerador *G = arg;
+    size_t cap = 64;
+    TarefaGerar *pilha = G->fase == GERAR_ESTRUTURA ? malloc(cap * sizeof(TarefaGerar)) : NULL;
+    if (G->fase == GERAR_ESTRUTURA && !pilha) atomic_store(&G->erro, 1);
+    for (;;) {
+        size_t i = atomic_fetch_add(&G->prox, 1);
+        if (i >= G->n_itens || atomic_load(&G->erro)) break;
+        switch (G->fase) {
+        case GERAR_ESTRUTURA:
+            if (gerador_estrutura(G, G->tarefas[i], &pilha, &cap) != 0) atomic_store(&G->erro, 1);
+            break;
+        case GERAR_CONTAR: gerador_contar(G, i); break;
+        case GERAR_ESCREVER: gerador_escrever(G, i); break;
+        case GERAR_ESPALHAR: gerador_espalhar(G, i); break;
+        case GERAR_COLOCAR:
+            if (gerador_colocar(G, i) != 0) atomic_store(&G->erro, 1);
+            break;
+        }
+    }
+    free(pilha);
+    return NULL;
+}
+
+/* roda uma fase com cfg->threads threads (a atual é uma delas) */
+static int gerador_fase(Gerador *G, FaseGerador fase, size_t n_itens, int n_threads) {
+    G->fase = fase;
+    G->n_itens = n_itens;
+    atomic_store(&G->prox, 0);
+#ifdef DQ_POSIX
+    pthread_t th[64];
+    int iniciadas = 0;
+    if (n_threads > 64) n_threads = 64;
+    for (int i = 1; i < n_threads && (size_t)i < n_itens; ++i, ++iniciadas)
+        if (pthread_create(&th[iniciadas], NULL, gerador_rodar, G) != 0) break;
+    gerador_rodar(G);
+    for (int i = 0; i < iniciadas; ++i) pthread_join(th[i], NULL);
+#else
+    (void)n_threads;
+    gerador_rodar(G);
+#endif
+    return atomic_load(&G->erro) ? -1 : 0;
+}
+
+/* divide a árvore em tarefas: expande a partir da raiz em largura até haver
+   'alvo' subárvores (a corrente degenerada vira trechos consecutivos) */
+static int gerador_tarefas(Gerador *G, size_t alvo) {
+    uint32_t n = G->g->plano.n;
+    size_t cap = 2 * alvo + 2, ini = 0, k = 0;
+    G->tarefas = malloc(cap * sizeof(TarefaGerar));
+    if (!G->tarefas) return -1;
+    if (G->cfg->forma == FORMA_DEGENERADA) {
+        /* na corrente a sala j sempre tem subárvore de n - j salas */
+        for (size_t t = 0; t < alvo && t < n; ++t) {
+            uint32_t a = (uint32_t)((uint64_t)n * t / alvo), b = (uint32_t)((uint64_t)n * (t + 1) / alvo);
+            if (a < b) G->tarefas[k++] = (TarefaGerar){ a, n - a, b };
+        }
+        G->n_tarefas = k;
+        return 0;
+    }
+    G->tarefas[k++] = (TarefaGerar){ 0, n, n };
+    while (k - ini < alvo && ini < k) {
+        TarefaGerar t = G->tarefas[ini++], e, d;
+        gerador_sala(G, t.ini, t.tam, &e, &d);
+        if (k + 2 > cap) {
+            TarefaGerar *tmp = realloc(G->tarefas, cap * 2 * sizeof(TarefaGerar));
+            if (!tmp) return -1;
+            G->tarefas = tmp;
+            cap *= 2;
+        }
+        if (e.tam) G->tarefas[k++] = (TarefaGerar){ e.ini, e.tam, e.ini + e.tam };
+        if (d.tam) G->tarefas[k++] = (TarefaGerar){ d.ini, d.tam, d.ini + d.tam };
+    }
+    memmove(G->tarefas, G->tarefas + ini, (k - ini) * sizeof(TarefaGerar));
+    G->n_tarefas = k - ini;
+    return 0;
+}
+
+/* libera uma mansão gerada (mapa e hash deixam de valer) */
+void liberarMansaoGerada(MansaoGerada *g) {
+    if (!g) return;
+    liberarHash(g->ht);
+    free(g->slots);
+    free(g->plano.salas);
+    free(g->plano.pool);
+    free(g);
+}
+
+/**
+ * mansaoSoltar(g, plano)
+ * Devolve o que a mansão já não usa: os slots da hash depois de
+ * congelarHash (a perfeita tem bloco próprio) e, com 'plano', as salas e
+ * o pool quando o mapa foi copiado (ver mapaCompactar). A hash ainda
+ * mapeada fica intacta: as pistas dela estão no pool.
+ */
+void mansaoSoltar(MansaoGerada *g, int plano) {
+    if (!g || g->ht->modo != HASH_PERFEITA) return;
+    free(g->slots);
+    g->slots = NULL;
+    if (!plano) return;
+    free(g->plano.salas);
+    free(g->plano.pool);
+    g->plano.salas = NULL;
+    g->plano.pool = NULL;
+    g->plano.n = 0;
+    g->plano.pool_len = 0;
+}
+
+/**
+ * gerarMansao(cfg)
+ * Gera a mansão descrita em 'cfg' em paralelo: estrutura (subárvores
+ * independentes por thread), strings e hash (blocos de salas e regiões de
+ * slots). Use mapaDePlano(&g->plano) e g->ht como um caso carregado; casoSalvar
+ * grava o resultado. Retorna NULL se a configuração for inválida ou faltar
+ * memória.
+ */
+MansaoGerada *gerarMansao(const GeradorConfig *cfg) {
+    if (cfg->salas == 0 || cfg->salas >= SALA_NENHUMA || cfg->suspeitos == 0 ||
+        !(cfg->densidade >= 0 && cfg->densidade <= 1)) {
+        fprintf(stderr, "Erro: gerador: configuração inválida.\n");
+        return NULL;
+    }
+    double t0 = agora_seg();
+    int n_threads = cfg->threads > 0 ? cfg->threads : nucleos_disponiveis();
+    Gerador G;
+    memset(&G, 0, sizeof(G));
+    G.cfg = cfg;
+    G.lim_pista = gerador_lim_pista(cfg);
+    atomic_init(&G.prox, 0);
+    atomic_init(&G.erro, 0);
+    MansaoGerada *g = calloc(1, sizeof(MansaoGerada));
+    const char *motivo = "sem memória";
+    if (!g) goto erro;
+    g->plano.n = (uint32_t)cfg->salas;
+    g->plano.salas = malloc(cfg->salas * sizeof(SalaPlana));
+    g->ht = mem_calloc(1, sizeof(HashTable));
+    G.g = g;
+    if (!g->plano.salas || !g->ht) goto erro;
+
+    /* estrutura: cada tarefa é uma subárvore (ou trecho) só de uma thread */
+    if (gerador_tarefas(&G, (size_t)n_threads * 16) != 0 ||
+        gerador_fase(&G, GERAR_ESTRUTURA, G.n_tarefas, n_threads) != 0)
+        goto erro;
+
+    /* strings: mede por bloco, soma os prefixos e escreve em paralelo */
+    G.n_blocos = (cfg->salas + GERADOR_BLOCO - 1) / GERADOR_BLOCO;
+    G.bytes = malloc(G.n_blocos * sizeof(uint64_t));
+    G.pistas_bloco = malloc(G.n_blocos * sizeof(uint32_t));
+    G.off_suspeito = malloc(cfg->suspeitos * sizeof(uint32_t));
+    if (!G.bytes || !G.pistas_bloco || !G.off_suspeito ||
+        gerador_fase(&G, GERAR_CONTAR, G.n_blocos, n_threads) != 0)
+        goto erro;
+    uint64_t pool = 0;
+    for (uint32_t k = 0; k < cfg->suspeitos; ++k) pool += gerador_suspeito_texto(NULL, k);
+    size_t pistas = 0;
+    for (size_t b = 0; b < G.n_blocos; ++b) {
+        uint64_t t = G.bytes[b];
+        uint32_t p = G.pistas_bloco[b];
+        G.bytes[b] = pool;
+        G.pistas_bloco[b] = (uint32_t)pistas;
+        pool += t;
+        pistas += p;
+    }
+    if (pool >= UINT32_MAX) {
+        motivo = "strings passam dos offsets de 32 bits";
+        goto erro;
+    }
+    g->pistas = pistas;
+    g->plano.pool_len = (size_t)pool;
+    g->plano.pool = malloc((size_t)pool);
+    if (!g->plano.pool) goto erro;
+    for (uint32_t k = 0, off = 0; k < cfg->suspeitos; ++k) {
+        G.off_suspeito[k] = off;
+        off += (uint32_t)gerador_suspeito_texto(g->plano.pool + off, k);
+    }
+
+    /* hash: carga <= 7/8 como a tabela aberta; semente derivada da do gerador */
+    size_t cap = 8;
+    while (cap * HASH_ABERTA_CARGA_NUM < pistas * HASH_ABERTA_CARGA_DEN) cap *= 2;
+    if (cap > UINT32_MAX) goto erro;
+    G.regioes = 1;
+    while (G.regioes < GERADOR_REGIOES && G.regioes * 8 < cap) G.regioes *= 2;
+    while (((size_t)G.regioes << G.desl_regiao) < cap) ++G.desl_regiao;
+    HashTable *ht = g->ht;
+    ht->modo = HASH_MAPEADA;
+    ht->tamanho = cap;
+    ht->mascara = cap - 1;
+    ht->n = pistas;
+    ht->fn = hash_wy;
+    ht->semente = gerador_sorteio(cfg->semente, 0, 5) | 1;
+    ht->mpool = g->plano.pool;
+    g->slots = malloc(cap * sizeof(CasoSlot));
+    G.entradas = malloc((pistas ? pistas : 1) * sizeof(CasoSlot));
+    G.regiao_pos = calloc(G.n_blocos * G.regioes, sizeof(size_t));
+    G.regiao_ini = malloc((G.regioes + 1) * sizeof(size_t));
+    G.regiao_sobra = malloc(G.regioes * sizeof(size_t));
+    if (!g->slots || !G.entradas || !G.regiao_pos || !G.regiao_ini || !G.regiao_sobra ||
+        gerador_fase(&G, GERAR_ESCREVER, G.n_blocos, n_threads) != 0)
+        goto erro;
+    ht->mslots = g->slots;
+    memset(g->slots, 0xff, cap * sizeof(CasoSlot));
+
+    /* posições por (região, bloco): a ordem final não depende das threads */
+    size_t acc = 0;
+    for (uint32_t r = 0; r < G.regioes; ++r) {
+        G.regiao_ini[r] = acc;
+        for (size_t b = 0; b < G.n_blocos; ++b) {
+            size_t c = G.regiao_pos[b * G.regioes + r];
+            G.regiao_pos[b * G.regioes + r] = acc;
+            acc += c;
+        }
+    }
+    G.regiao_ini[G.regioes] = acc;
+    G.ordem = malloc((pistas ? pistas : 1) * sizeof(CasoSlot));
+    if (!G.ordem || gerador_fase(&G, GERAR_ESPALHAR, G.n_blocos, n_threads) != 0) goto erro;
+    free(G.entradas);
+    G.entradas = NULL;
+    if (gerador_fase(&G, GERAR_COLOCAR, G.regioes, n_threads) != 0) goto erro;
+    /* o que transbordou de cada região entra com a inserção Robin Hood comum */
+    for (uint32_t r = 0; r < G.regioes; ++r)
+        for (size_t i = G.regiao_ini[r] + G.regiao_sobra[r]; i < G.regiao_ini[r + 1]; ++i)
+            caso_slot_colocar(g->slots, cap, G.ordem[i]);
+
+    free(G.tarefas);
+    free(G.bytes);
+    free(G.pistas_bloco);
+    free(G.off_suspeito);
+    free(G.ordem);
+    free(G.regiao_pos);
+    free(G.regiao_ini);
+    free(G.regiao_sobra);
+    g->segundos = agora_seg() - t0;
+    return g;
+
+erro:
+    fprintf(stderr, "Erro: gerador: %s.\n", motivo);
+    free(G.tarefas);
+    free(G.bytes);
+    free(G.pistas_bloco);
+    free(G.off_suspeito);
+    free(G.entradas);
+    free(G.ordem);
+    free(G.regiao_pos);
+    free(G.regiao_ini);
+    free(G.regiao_sobra);
+    liberarMansaoGerada(g);
+    return NULL;
+}
+
+/* resumo da geração em stderr */
+void gerarRelatorio(const GeradorConfig *cfg, const MansaoGerada *g) {
+    static const char *const formas[3] = { "balanceada", "degenerada", "aleatória" };
+    fprintf(stderr, "[gerador] %u salas (%s), %zu pistas, %u suspeitos, semente %llu, "
+            "%zu bytes de strings, %.3f s\n",
+            g->plano.n, formas[cfg->forma], g->pistas, cfg->suspeitos,
+            (unsigned long long)cfg->semente, g->plano.pool_len, g->segundos);
+}
+
+/* ===========================
+   Mansão sob demanda (salas carregadas ao entrar)
+   =========================== */
+
+/*
+ * Mapa cujas salas só existem enquanto a exploração passa por elas: ao
+ * chegar numa sala ela é lida do arquivo de caso (fseek/fread do registro e
+ * das strings; nada é mapeado nem lido por inteiro) ou recalculada pelo
+ * gerador a partir de (semente, j, s), e fica numa cache de no máximo
+ * 'residentes' salas com despejo LRU. A hash pista -> suspeito recebe só as
+ * pistas das salas já carregadas. Assim a memória acompanha as salas
+ * visitadas, não o tamanho da mansão.
+ * O texto de nome/pista vale até a próxima sala carregada (a sessão copia
+ * ou interna antes). Mapas sob demanda não têm catálogo nem resumo: montar
+ * qualquer um deles carregaria a mansão inteira.
+ */
+
+#define SOB_FIM UINT32_MAX
+#define SOB_RESIDENTES_PADRAO 1024
+
+/* sala na cache: filhos já resolvidos e o texto "nome\0pista\0" */
+typedef struct SalaResidente {
+    NoMapa id;                 /* 0 = slot sem sala */
+    NoMapa esq, dir;           /* 0 = nenhum */
+    char *texto;
+    size_t cap_texto;
+    uint32_t len_nome;
+    int tem_pista;
+    uint32_t ante, prox;       /* lista LRU: cabeça = mais recente */
+} SalaResidente;
+
+typedef struct MapaSob {
+    /* fonte: gerador (f == NULL) ou arquivo de caso */
+    GeradorConfig cfg;
+    Gerador gen;               /* só cfg e lim_pista (gerador_pista) */
+    FILE *f;
+    CasoCabecalho cab;
+    /* cache */
+    SalaResidente *salas;
+    uint32_t n, cap;
+    uint32_t cabeca, cauda;
+    uint32_t *indice;          /* id -> slot, endereçamento aberto (SOB_FIM = vazio) */
+    size_t mascara;
+    char *tmp;                 /* strings lidas do arquivo */
+    size_t cap_tmp;
+    HashTable *ht;             /* pistas das salas carregadas até agora */
+    size_t cargas, acertos, despejos;
+} MapaSob;
+
+static size_t sob_hash(NoMapa id) {
+    return (size_t)((id * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+static void sob_tirar(MapaSob *m, uint32_t k) {
+    SalaResidente *r = &m->salas[k];
+    if (r->ante != SOB_FIM) m->salas[r->ante].prox = r->prox;
+    else m->cabeca = r->prox;
+    if (r->prox != SOB_FIM) m->salas[r->prox].ante = r->ante;
+    else m->cauda = r->ante;
+}
+
+/* 'k' entra na lista como a mais recente ('frente') ou a próxima a sair */
+static void sob_por(MapaSob *m, uint32_t k, int frente) {
+    SalaResidente *r = &m->salas[k];
+    if (frente) {
+        r->ante = SOB_FIM;
+        r->prox = m->cabeca;
+        if (m->cabeca != SOB_FIM) m->salas[m->cabeca].ante = k;
+        else m->cauda = k;
+        m->cabeca = k;
+    } else {
+        r->prox = SOB_FIM;
+        r->ante = m->cauda;
+        if (m->cauda != SOB_FIM) m->salas[m->cauda].prox = k;
+        else m->cabeca = k;
+        m->cauda = k;
+    }
+}
+
+/* tira 'id' do índice, puxando para trás quem vinha depois na sondagem */
+static void sob_desindexar(MapaSob *m, NoMapa id) {
+    size_t i = sob_hash(id) & m->mascara;
+    while (m->salas[m->indice[i]].id != id) i = (i + 1) & m->mascara;
+    for (size_t j = (i + 1) & m->mascara; m->indice[j] != SOB_FIM; j = (j + 1) & m->mascara) {
+        size_t ideal = sob_hash(m->salas[m->indice[j]].id) & m->mascara;
+        if (((j - ideal) & m->mascara) >= ((j - i) & m->mascara)) {
+            m->indice[i] = m->indice[j];
+            i = j;
+        }
+    }
+    m->indice[i] = SOB_FIM;
+}
+
+static int sob_texto_reservar(SalaResidente *r, size_t n) {
+    if (n <= r->cap_texto) return 0;
+    size_t cap = r->cap_texto ? r->cap_texto : 64;
+    while (cap < n) cap *= 2;
+    char *t = realloc(r->texto, cap);
+    if (!t) return -1;
+    r->texto = t;
+    r->cap_texto = cap;
+    return 0;
+}
+
+/* sala j (subárvore de s salas) recalculada como gerarMansao a escreveria */
+static int sob_gerar(MapaSob *m, NoMapa id, SalaResidente *r) {
+    uint32_t j = (uint32_t)id - 1, s = (uint32_t)(id >> 32), sus;
+    uint32_t e = gerador_esquerda(&m->cfg, j, s), d = s - 1 - e;
+    r->esq = e ? (NoMapa)e << 32 | (j + 2) : 0;
+    r->dir = d ? (NoMapa)d << 32 | ((NoMapa)j + 2 + e) : 0;
+    uint64_t x = gerador_sorteio(m->cfg.semente, j, 4);
+    size_t ln = gerador_texto(NULL, gerador_tipos[x & 15], " ", j), lp = 1;
+    r->tem_pista = gerador_pista(&m->gen, j, &sus);
+    if (r->tem_pista) lp = gerador_texto(NULL, gerador_pistas[(x >> 4) & 15], " #", j);
+    if (sob_texto_reservar(r, ln + lp) != 0) return -1;
+    gerador_texto(r->texto, gerador_tipos[x & 15], " ", j);
+    r->len_nome = (uint32_t)ln - 1;
+    r->texto[ln] = '\0';
+    if (!r->tem_pista) return 0;
+    const char *pista = r->texto + ln;
+    gerador_texto(r->texto + ln, gerador_pistas[(x >> 4) & 15], " #", j);
+    if (!encontrarSuspeito(m->ht, pista)) {
+        char nome[48];
+        gerador_suspeito_texto(nome, sus);
+        inserirNaHash(m->ht, pista, nome);
+    }
+    return 0;
+}
+
+static int sob_ler(MapaSob *m, uint64_t off, void *dest, size_t n) {
+    return fseek(m->f, (long)off, SEEK_SET) == 0 && fread(dest, 1, n, m->f) == n ? 0 : -1;
+}
+
+/* string do pool no offset 'off' para m->tmp (em pedaços de 64 bytes) */
+static int sob_ler_texto(MapaSob *m, uint32_t off, size_t *len) {
+    size_t n = 0;
+    if (off >= m->cab.tam_pool || fseek(m->f, (long)(m->cab.off_pool + off), SEEK_SET) != 0) return -1;
+    for (;;) {
+        if (n + 64 > m->cap_tmp) {
+            size_t cap = m->cap_tmp ? m->cap_tmp * 2 : 256;
+            char *t = realloc(m->tmp, cap);
+            if (!t) return -1;
+            m->tmp = t;
+            m->cap_tmp = cap;
+        }
+        size_t lidos = fread(m->tmp + n, 1, 64, m->f);
+        char *z = memchr(m->tmp + n, '\0', lidos);
+        if (z) {
+            *len = (size_t)(z - m->tmp);
+            return 0;
+        }
+        if (lidos < 64) return -1;
+        n += lidos;
+    }
+}
+
+/* suspeito da pista na hash do arquivo (mesma sondagem de caso_hash_buscar
+   ou de perfeita_buscar), deixado em m->tmp; 0 = achou */
+static int sob_suspeito(MapaSob *m, const char *pista, size_t len) {
+    if (m->cab.flags & CASO_HASH_PERFEITA) {
+        uint64_t h = hash_wy(pista, len, m->cab.hash_semente);
+        uint32_t d;
+        CasoSlot sl;
+        size_t n;
+        if (m->cab.hash_n == 0 ||
+            sob_ler(m, caso_off_desloc(&m->cab) + (uint64_t)perfeita_balde(h, m->cab.hash_cap) * sizeof(d),
+                    &d, sizeof(d)) != 0)
+            return -1;
+        uint32_t p = perfeita_pos(h, d, m->cab.hash_n);
+        if (p >= m->cab.hash_n ||
+            sob_ler(m, m->cab.off_hash + (uint64_t)p * sizeof(CasoSlot), &sl, sizeof(sl)) != 0 ||
+            sl.hash != (uint32_t)h || sob_ler_texto(m, sl.chave, &n) != 0 ||
+            n != len || memcmp(m->tmp, pista, len) != 0)
+            return -1;
+        return sob_ler_texto(m, sl.suspeito, &n);
+    }
+    uint32_t hash = (uint32_t)hash_wy(pista, len, m->cab.hash_semente);
+    size_t mask = m->cab.hash_cap - 1, i = hash & mask, n;
+    for (uint32_t dist = 0; dist < m->cab.hash_cap; ++dist, i = (i + 1) & mask) {
+        CasoSlot sl;
+        if (sob_ler(m, m->cab.off_hash + i * sizeof(CasoSlot), &sl, sizeof(sl)) != 0) return -1;
+        if (sl.chave == CASO_SLOT_VAZIO || sl.dist < dist) return -1;
+        if (sl.hash != hash || sob_ler_texto(m, sl.chave, &n) != 0) continue;
+        if (n == len && memcmp(m->tmp, pista, len) == 0) return sob_ler_texto(m, sl.suspeito, &n);
+    }
+    return -1;
+}
+
+/* sala j lida do arquivo: registro, nome, pista e o suspeito dela */
+static int sob_ler_sala(MapaSob *m, NoMapa id, SalaResidente *r) {
+    uint32_t j = (uint32_t)id - 1;
+    SalaPlana sp;
+    size_t ln, lp = 0;
+    if (j >= m->cab.n_salas || sob_ler(m, m->cab.off_salas + (uint64_t)j * sizeof(SalaPlana), &sp, sizeof(sp)) != 0)
+        return -1;
+    r->esq = sp.esq == SALA_NENHUMA ? 0 : (NoMapa)sp.esq + 1;
+    r->dir = sp.dir == SALA_NENHUMA ? 0 : (NoMapa)sp.dir + 1;
+    if (sob_ler_texto(m, sp.nome, &ln) != 0 || sob_texto_reservar(r, ln + 2) != 0) return -1;
+    memcpy(r->texto, m->tmp, ln + 1);
+    r->len_nome = (uint32_t)ln;
+    r->tem_pista = sp.pista != SALA_SEM_PISTA;
+    if (r->tem_pista && (sob_ler_texto(m, sp.pista, &lp) != 0 || sob_texto_reservar(r, ln + lp + 2) != 0))
+        return -1;
+    memcpy(r->texto + ln + 1, r->tem_pista ? m->tmp : "", lp + 1);
+    const char *pista = r->texto + ln + 1;
+    if (r->tem_pista && !encontrarSuspeito(m->ht, pista) && sob_suspeito(m, pista, lp) == 0)
+        inserirNaHash(m->ht, pista, m->tmp);
+    return 0;
+}
+
+/* sala 'id' residente (carrega se preciso, despejando a menos usada) */
+static SalaResidente *sob_obter(MapaSob *m, NoMapa id) {
+    size_t i = sob_hash(id) & m->mascara;
+    for (; m->indice[i] != SOB_FIM; i = (i + 1) & m->mascara) {
+        uint32_t k = m->indice[i];
+        if (m->salas[k].id != id) continue;
+        m->acertos += 1;
+        if (m->cabeca != k) {
+            sob_tirar(m, k);
+            sob_por(m, k, 1);
+        }
+        return &m->salas[k];
+    }
+    uint32_t k;
+    if (m->n < m->cap) {
+        k = m->n++;
+    } else {
+        k = m->cauda;
+        sob_tirar(m, k);
+        if (m->salas[k].id) {
+            sob_desindexar(m, m->salas[k].id);
+            m->despejos += 1;
+        }
+    }
+    SalaResidente *r = &m->salas[k];
+    r->id = 0;
+    if ((m->f ? sob_ler_sala(m, id, r) : sob_gerar(m, id, r)) != 0) {
+        /* slot vazio: é o primeiro a ser reaproveitado */
+        sob_por(m, k, 0);
+        fprintf(stderr, "Erro: sala %llu não pôde ser carregada.\n", (unsigned long long)(uint32_t)id);
+        return NULL;
+    }
+    m->cargas += 1;
+    r->id = id;
+    sob_por(m, k, 1);
+    i = sob_hash(id) & m->mascara;
+    while (m->indice[i] != SOB_FIM) i = (i + 1) & m->mascara;
+    m->indice[i] = k;
+    return r;
+}
+
+static NoMapa sob_raiz(void *d) {
+    MapaSob *m = d;
+    return m->f ? 1 : (NoMapa)m->cfg.salas << 32 | 1;
+}
+
+static const char *sob_nome(void *d, NoMapa no) {
+    SalaResidente *r = sob_obter(d, no);
+    return r ? r->texto : "?";
+}
+
+static const char *sob_pista(void *d, NoMapa no) {
+    SalaResidente *r = sob_obter(d, no);
+    return r && r->tem_pista ? r->texto + r->len_nome + 1 : NULL;
+}
+
+static NoMapa sob_esq(void *d, NoMapa no) {
+    SalaResidente *r = sob_obter(d, no);
+    return r ? r->esq : 0;
+}
+
+static NoMapa sob_dir(void *d, NoMapa no) {
+    SalaResidente *r = sob_obter(d, no);
+    return r ? r->dir : 0;
+}
+
+static const MapaOps mapa_sob_ops = { sob_raiz, sob_nome, sob_pista, sob_esq, sob_dir };
+
+/* liberarMapaSob(m): cache, hash das pistas vistas e o arquivo */
+void liberarMapaSob(MapaSob *m) {
+    if (!m) return;
+    for (uint32_t i = 0; m->salas && i < m->cap; ++i) free(m->salas[i].texto);
+    free(m->salas);
+    free(m->indice);
+    free(m->tmp);
+    liberarHash(m->ht);
+    if (m->f) fclose(m->f);
+    free(m);
+}
+
+static MapaSob *sob_criar(size_t residentes) {
+    MapaSob *m = calloc(1, sizeof(MapaSob));
+    if (!m) return NULL;
+    if (residentes < 2) residentes = 2;
+    if (residentes > UINT32_MAX / 4) residentes = UINT32_MAX / 4;
+    size_t cap_ix = 4;
+    while (cap_ix < residentes * 2) cap_ix *= 2;
+    m->cap = (uint32_t)residentes;
+    m->cabeca = m->cauda = SOB_FIM;
+    m->mascara = cap_ix - 1;
+    m->salas = calloc(residentes, sizeof(SalaResidente));
+    m->indice = malloc(cap_ix * sizeof(uint32_t));
+    m->ht = criarHashAberta(64);
+    if (!m->salas || !m->indice || !m->ht) {
+        liberarMapaSob(m);
+        return NULL;
+    }
+    memset(m->indice, 0xff, cap_ix * sizeof(uint32_t));
+    return m;
+}
+
+/**
+ * mapaSobDemandaGerado(cfg, residentes)
+ * Mansão de gerarMansao(cfg) (mesmos nomes, pistas, suspeitos e formato),
+ * mas calculada sala a sala conforme a exploração chega nela, com até
+ * 'residentes' salas na memória (0 = SOB_RESIDENTES_PADRAO).
+ */
+MapaSob *mapaSobDemandaGerado(const GeradorConfig *cfg, size_t residentes) {
+    if (cfg->salas == 0 || cfg->salas >= SALA_NENHUMA || cfg->suspeitos == 0 ||
+        !(cfg->densidade >= 0 && cfg->densidade <= 1)) {
+        fprintf(stderr, "Erro: gerador: configuração inválida.\n");
+        return NULL;
+    }
+    MapaSob *m = sob_criar(residentes ? residentes : SOB_RESIDENTES_PADRAO);
+    if (!m) return NULL;
+    m->cfg = *cfg;
+    m->gen.cfg = &m->cfg;
+    m->gen.lim_pista = gerador_lim_pista(cfg);
+    return m;
+}
+
+/**
+ * mapaSobDemandaArquivo(caminho, residentes)
+ * Caso gravado por casoSalvar, lido sala a sala: só o cabeçalho é conferido
+ * na abertura; registros, strings e slots da hash são lidos do arquivo ao
+ * carregar cada sala. Retorna NULL se o arquivo não for um caso válido.
+ */
+MapaSob *mapaSobDemandaArquivo(const char *caminho, size_t residentes) {
+    MapaSob *m = sob_criar(residentes ? residentes : SOB_RESIDENTES_PADRAO);
+    if (!m) return NULL;
+    const char *motivo = NULL;
+    CasoCabecalho *cab = &m->cab;
+    m->f = fopen(caminho, "rb");
+    long tam = m->f && fseek(m->f, 0, SEEK_END) == 0 ? ftell(m->f) : -1;
+    if (tam < 0 || sob_ler(m, 0, cab, sizeof(*cab)) != 0 || memcmp(cab->magia, CASO_MAGIA, 8) != 0)
+        motivo = "não é um arquivo de caso";
+    else if (!caso_versao_ok(cab))
+        motivo = "versão ou ordem de bytes incompatível";
+    else if (cab->tam_arquivo != (uint64_t)tam || cab->n_salas == 0 || cab->n_salas == SALA_NENHUMA ||
+             cab->off_salas > cab->tam_arquivo ||
+             cab->n_salas > (cab->tam_arquivo - cab->off_salas) / sizeof(SalaPlana) ||
+             !caso_hash_ok(cab, cab->tam_arquivo) ||
+             cab->off_pool > cab->tam_arquivo || cab->tam_pool != cab->tam_arquivo - cab->off_pool)
+        motivo = "cabeçalho inconsistente";
+    if (motivo) {
+        fprintf(stderr, "Erro: '%s': %s.\n", caminho, motivo);
+        liberarMapaSob(m);
+        return NULL;
+    }
+    return m;
+}
+
+/* mapaDeSobDemanda(m): Mapa sobre as salas carregadas conforme o uso */
+Mapa mapaDeSobDemanda(MapaSob *m) {
+    Mapa mapa = { &mapa_sob_ops, m };
+    return mapa;
+}
+
+/* mapaSobHash(m): pista -> suspeito das salas carregadas até agora */
+HashTable *mapaSobHash(MapaSob *m) {
+    return m->ht;
+}
+
+/* mapaSobRelatorio(m): cargas, acertos e despejos da cache (stderr) */
+void mapaSobRelatorio(const MapaSob *m) {
+    fprintf(stderr, "[sob demanda] %zu cargas, %zu acertos, %zu despejos; %u de %u salas residentes, "
+            "%zu pistas conhecidas\n",
+            m->cargas, m->acertos, m->despejos, m->n, m->cap, m->ht->n);
+}
+
+/* ===========================
+   Mapa compacto (salas de 16 bytes, textos por id)
+   =========================== */
+
+/*
+ * Para mansões de 10^8 salas: nada de ponteiros nem de offsets por sala.
+ * As salas vão em pré-ordem (o filho esquerdo é sempre a sala seguinte:
+ * basta um bit), a pista é um id (o slot dela na hash perfeita, que já
+ * guarda o texto e o suspeito) e o nome cabe na própria sala: até 7 bytes
+ * inline ("Cozinha"), senão um id de texto base mais um sufixo numérico
+ * ("Cozinha " + 4711). Os textos próprios (bases e pistas fora da hash)
+ * ficam uma única vez num pool com offsets de 64 bits.
+ */
+
+/* SalaCompacta.dir: bit do filho esquerdo e índice do direito */
+#define COMPACTA_TEM_ESQ 0x80000000u
+#define COMPACTA_SEM_DIR 0x7fffffffu
+/* nome[7] com este bit: base + número em vez de texto inline */
+#define COMPACTA_CODIFICADO 0x80u
+/* número do nome ausente (o nome é a base inteira) */
+#define COMPACTA_SEM_NUMERO 0x7fffffffu
+/* maior nome remontado (base + até 10 dígitos + '\0') */
+#define COMPACTA_NOME_MAX 64
+
+/* Cômodo compacto (16 bytes, sem ponteiros) */
+typedef struct SalaCompacta {
+    uint32_t dir;       /* COMPACTA_TEM_ESQ | índice do filho direito (COMPACTA_SEM_DIR) */
+    uint32_t pista;     /* id da pista (SALA_SEM_PISTA se não houver) */
+    unsigned char nome[8];  /* inline terminado em '\0', ou base (4 bytes) + número (31 bits) */
+} SalaCompacta;
+
+/* Mansão compacta: salas em pré-ordem, textos próprios e a hash das pistas */
+typedef struct MapaCompacto {
+    SalaCompacta *salas;
+    uint32_t n;
+    const HashTable *ht;       /* HASH_PERFEITA: ids < base_pistas são slots dela */
+    uint32_t base_pistas;
+    uint64_t *textos;          /* id - base_pistas (ou id de base) -> offset em pool */
+    uint32_t n_textos;
+    char *pool;
+    size_t pool_len;
+} MapaCompacto;
+
+/* nomes remontados: um anel de 4 por thread, então o texto devolvido vale
+   até a quarta chamada seguinte (contrato em MapaOps) */
+static _Thread_local char compacto_nomes[4][COMPACTA_NOME_MAX];
+static _Thread_local unsigned compacto_prox_nome;
+
+static const char *compacto_texto(const MapaCompacto *m, uint32_t id) {
+    return m->pool + m->textos[id];
+}
+
+static const char *compacto_nome(const MapaCompacto *m, const SalaCompacta *s) {
+    if (!(s->nome[7] & COMPACTA_CODIFICADO)) return (const char *)s->nome;
+    uint32_t base = (uint32_t)s->nome[0] | (uint32_t)s->nome[1] << 8 |
+                    (uint32_t)s->nome[2] << 16 | (uint32_t)s->nome[3] << 24;
+    uint32_t num = (uint32_t)s->nome[4] | (uint32_t)s->nome[5] << 8 |
+                   (uint32_t)s->nome[6] << 16 | (uint32_t)(s->nome[7] & 0x7f) << 24;
+    const char *b = compacto_texto(m, base);
+    if (num == COMPACTA_SEM_NUMERO) return b;
+    char *buf = compacto_nomes[compacto_prox_nome++ % 4];
+    size_t lb = strlen(b), nd = 0;
+    char dig[10];
+    do {
+        dig[nd++] = (char)('0' + num % 10);
+        num /= 10;
+    } while (num);
+    memcpy(buf, b, lb);
+    for (size_t i = 0; i < nd; ++i) buf[lb + i] = dig[nd - 1 - i];
+    buf[lb + nd] = '\0';
+    return buf;
+}
+
+/* --- operações do mapa compacto (NoMapa = índice + 1) --- */
+
+static NoMapa compacto_raiz(void *d) { return ((MapaCompacto *)d)->n ? 1 : 0; }
+static const char *compacto_nome_op(void *d, NoMapa no) {
+    MapaCompacto *m = d;
+    return compacto_nome(m, &m->salas[no - 1]);
+}
+static const char *compacto_pista(void *d, NoMapa no) {
+    MapaCompacto *m = d;
+    uint32_t id = m->salas[no - 1].pista;
+    if (id == SALA_SEM_PISTA) return NULL;
+    if (id < m->base_pistas) return m->ht->mpool + m->ht->mslots[id].chave;
+    return compacto_texto(m, id - m->base_pistas);
+}
+static NoMapa compacto_esq(void *d, NoMapa no) {
+    return ((MapaCompacto *)d)->salas[no - 1].dir & COMPACTA_TEM_ESQ ? no + 1 : 0;
+}
+static NoMapa compacto_dir(void *d, NoMapa no) {
+    uint32_t i = ((MapaCompacto *)d)->salas[no - 1].dir & ~COMPACTA_TEM_ESQ;
+    return i == COMPACTA_SEM_DIR ? 0 : (NoMapa)i + 1;
+}
+
+static const MapaOps mapa_compacto_ops = {
+    compacto_raiz, compacto_nome_op, compacto_pista, compacto_esq, compacto_dir
+};
+
+/* visão genérica de um mapa compacto */
+Mapa mapaDeCompacto(MapaCompacto *m) {
+    Mapa r = { &mapa_compacto_ops, m };
+    return r;
+}
+
+/* deduplicação dos textos próprios durante a montagem (por conteúdo) */
+typedef struct CompactoIndice {
+    uint32_t *ids;             /* id + 1 (0 = vazio) */
+    size_t cap;                /* potência de 2, carga <= 1/2 */
+    size_t cap_pool;
+} CompactoIndice;
+
+/* id do texto s[0..len) (copiado para o pool na primeira vez); UINT32_MAX sem memória */
+static uint32_t compacto_internar(MapaCompacto *m, CompactoIndice *ix, const char *s, size_t len) {
+    if (2 * ((size_t)m->n_textos + 1) > ix->cap) {
+        size_t cap = ix->cap ? ix->cap * 2 : 64;
+        uint32_t *ids = calloc(cap, sizeof(uint32_t));
+        uint64_t *t = realloc(m->textos, cap / 2 * sizeof(uint64_t));
+        if (t) m->textos = t;
+        if (!ids || !t) {
+            free(ids);
+            return UINT32_MAX;
+        }
+        for (uint32_t i = 0; i < m->n_textos; ++i) {
+            const char *x = compacto_texto(m, i);
+            size_t j = hash_wy(x, strlen(x), 0) & (cap - 1);
+            while (ids[j]) j = (j + 1) & (cap - 1);
+            ids[j] = i + 1;
+        }
+        free(ix->ids);
+        ix->ids = ids;
+        ix->cap = cap;
+    }
+    size_t j = hash_wy(s, len, 0) & (ix->cap - 1);
+    for (; ix->ids[j]; j = (j + 1) & (ix->cap - 1)) {
+        const char *x = compacto_texto(m, ix->ids[j] - 1);
+        if (strncmp(x, s, len) == 0 && x[len] == '\0') return ix->ids[j] - 1;
+    }
+    while (m->pool_len + len + 1 > ix->cap_pool) {
+        size_t nova = ix->cap_pool ? ix->cap_pool * 2 : 4096;
+        char *tmp = realloc(m->pool, nova);
+        if (!tmp) return UINT32_MAX;
+        m->pool = tmp;
+        ix->cap_pool = nova;
+    }
+    memcpy(m->pool + m->pool_len, s, len);
+    m->pool[m->pool_len + len] = '\0';
+    m->textos[m->n_textos] = m->pool_len;
+    m->pool_len += len + 1;
+    ix->ids[j] = m->n_textos + 1;
+    return m->n_textos++;
+}
+
+/* nome inline (até 7 bytes) ou base + sufixo numérico sem zero à esquerda */
+static int compacto_codificar_nome(MapaCompacto *m, CompactoIndice *ix, SalaCompacta *s,
+                                   const char *nome) {
+    size_t len = strlen(nome), k = len;
+    memset(s->nome, 0, sizeof(s->nome));
+    if (len < sizeof(s->nome)) {
+        memcpy(s->nome, nome, len);
+        return 0;
+    }
+    while (k > 0 && nome[k - 1] >= '0' && nome[k - 1] <= '9' && len - k < 10) --k;
+    uint32_t num = COMPACTA_SEM_NUMERO;
+    if (k < len && k > 0 && (nome[k] != '0' || k + 1 == len) &&
+        !(nome[k - 1] >= '0' && nome[k - 1] <= '9') && k + 11 <= COMPACTA_NOME_MAX) {
+        uint64_t v = 0;
+        for (size_t i = k; i < len; ++i) v = v * 10 + (uint64_t)(nome[i] - '0');
+        if (v < COMPACTA_SEM_NUMERO) num = (uint32_t)v;
+    }
+    if (num == COMPACTA_SEM_NUMERO) k = len;
+    uint32_t base = compacto_internar(m, ix, nome, k);
+    if (base == UINT32_MAX) return -1;
+    for (int i = 0; i < 4; ++i) s->nome[i] = (unsigned char)(base >> (8 * i));
+    for (int i = 0; i < 3; ++i) s->nome[4 + i] = (unsigned char)(num >> (8 * i));
+    s->nome[7] = (unsigned char)(COMPACTA_CODIFICADO | (num >> 24));
+    return 0;
+}
+
+void liberarMapaCompacto(MapaCompacto *m) {
+    if (!m) return;
+    free(m->salas);
+    free(m->textos);
+    free(m->pool);
+    free(m);
+}
+
+/**
+ * mapaCompactar(mapa, ht)
+ * Copia qualquer mapa não sob demanda para o layout compacto. Com 'ht'
+ * congelada (HASH_PERFEITA) as pistas dela viram o id do slot e o texto
+ * fica só na hash; o mapa de origem pode ser liberado depois, a hash não.
+ * Retorna NULL em caso de erro (ou mapa vazio / grande demais).
+ */
+MapaCompacto *mapaCompactar(Mapa *mapa, const HashTable *ht) {
+    typedef struct { NoMapa no; uint32_t pai; } Item;   /* pai = UINT32_MAX: raiz ou esquerdo */
+    const MapaOps *op = mapa->ops;
+    MapaCompacto *m = op == &mapa_sob_ops ? NULL : calloc(1, sizeof(MapaCompacto));
+    CompactoIndice ix = { NULL, 0, 0 };
+    Item *pilha = malloc(64 * sizeof(Item));
+    size_t k = 0, cap = 64, cap_salas = 0;
+    if (!m || !pilha) goto erro;
+    if (ht && ht->modo == HASH_PERFEITA) {
+        m->ht = ht;
+        m->base_pistas = (uint32_t)ht->n;
+    }
+    NoMapa raiz = op->raiz(mapa->dados);
+    if (raiz) pilha[k++] = (Item){ raiz, UINT32_MAX };
+    while (k > 0) {
+        Item it = pilha[--k];
+        if (m->n >= COMPACTA_SEM_DIR) goto erro;
+        if (m->n == cap_salas) {
+            size_t c = cap_salas ? cap_salas * 2 : 1024;
+            SalaCompacta *tmp = realloc(m->salas, c * sizeof(SalaCompacta));
+            if (!tmp) goto erro;
+            m->salas = tmp;
+            cap_salas = c;
+        }
+        uint32_t j = m->n++;
+        SalaCompacta *s = &m->salas[j];
+        s->dir = COMPACTA_SEM_DIR;
+        if (it.pai != UINT32_MAX) m->salas[it.pai].dir = (m->salas[it.pai].dir & COMPACTA_TEM_ESQ) | j;
+        if (compacto_codificar_nome(m, &ix, s, op->nome(mapa->dados, it.no)) != 0) goto erro;
+        const char *pista = op->pista(mapa->dados, it.no);
+        s->pista = SALA_SEM_PISTA;
+        if (pista) {
+            const CasoSlot *sl = m->ht ? perfeita_buscar(m->ht, pista) : NULL;
+            uint32_t id = sl ? (uint32_t)(sl - m->ht->mslots)
+                             : compacto_internar(m, &ix, pista, strlen(pista));
+            if (id == UINT32_MAX) goto erro;
+            s->pista = sl ? id : m->base_pistas + id;
+        }
+        if (k + 2 > cap) {
+            Item *tmp = realloc(pilha, cap * 2 * sizeof(Item));
+            if (!tmp) goto erro;
+            pilha = tmp;
+            cap *= 2;
+        }
+        /* o esquerdo sai da pilha logo depois: é a sala j + 1 */
+        NoMapa e = op->esq(mapa->dados, it.no), d = op->dir(mapa->dados, it.no);
+        if (d) pilha[k++] = (Item){ d, j };
+        if (e) {
+            pilha[k++] = (Item){ e, UINT32_MAX };
+            s->dir |= COMPACTA_TEM_ESQ;
+        }
+    }
+    if (m->n == 0) goto erro;
+    /* a sobra do último dobro volta para o sistema */
+    SalaCompacta *justo = realloc(m->salas, (size_t)m->n * sizeof(SalaCompacta));
+    if (justo) m->salas = justo;
+    free(pilha);
+    free(ix.ids);
+    return m;
+
+erro:
+    fprintf(stderr, "Erro: falha ao compactar o mapa.\n");
+    free(pilha);
+    free(ix.ids);
+    liberarMapaCompacto(m);
+    return NULL;
+}
+
+/* ===========================
+   Catálogo de pistas e resumo das subárvores
+   =========================== */
+
+#define CATALOGO_NENHUMA UINT32_MAX
+
+/* acima disso o catálogo não monta as máscaras por suspeito */
+#define CATALOGO_MAX_MASCARAS ((size_t)64 << 20)
+
+/* pistas do mapa com ids densos (0..n-1, na ordem de strcmp) e o suspeito
+   de cada uma */
+typedef struct Catalogo {
+    const char **pistas;       /* id -> pista (o ponteiro que o mapa devolve) */
+    uint32_t *suspeito;        /* id -> posição em hashSuspeitos (CATALOGO_NENHUMA = nenhum) */
+    size_t n, cap;
+    const char **chaves;       /* endereçamento aberto pelo ponteiro da pista */
+    uint32_t *ids;
+    size_t cap_slots;          /* potência de 2, carga <= 1/2 */
+    const char *const *nomes;  /* posição -> suspeito (hashSuspeitos na montagem) */
+    size_t n_suspeitos;
+    size_t palavras;           /* uint64_t num bitset de pistas */
+    uint64_t *mascaras;        /* suspeito * palavras: pistas dele (NULL = grande demais) */
+    size_t salas;
+    uint32_t profundidade;     /* maior profundidade (raiz = 0) */
+} Catalogo;
+
+/* id da pista 'pista' (mesmo ponteiro devolvido pelo mapa) ou CATALOGO_NENHUMA */
+static uint32_t catalogo_id(const Catalogo *cat, const char *pista) {
+    if (!pista || pista[0] == '\0' || cat->cap_slots == 0) return CATALOGO_NENHUMA;
+    size_t mask = cat->cap_slots - 1;
+    for (size_t i = hash_misturar_ptr(pista) & mask;; i = (i + 1) & mask) {
+        if (cat->chaves[i] == pista) return cat->ids[i];
+        if (!cat->chaves[i]) return CATALOGO_NENHUMA;
+    }
+}
+
+/* refaz o índice ponteiro -> id com 'cap' slots */
+static int catalogo_indexar(Catalogo *cat, size_t cap) {
+    const char **chaves = mem_calloc(cap, sizeof(char *));
+    uint32_t *ids = mem_alloc(cap * sizeof(uint32_t));
+    if (!chaves || !ids) {
+        mem_free((void *)chaves);
+        mem_free(ids);
+        return -1;
+    }
+    for (size_t id = 0; id < cat->n; ++id) {
+        size_t i = hash_misturar_ptr(cat->pistas[id]) & (cap - 1);
+        while (chaves[i]) i = (i + 1) & (cap - 1);
+        chaves[i] = cat->pistas[id];
+        ids[i] = (uint32_t)id;
+    }
+    mem_free((void *)cat->chaves);
+    mem_free(cat->ids);
+    cat->chaves = chaves;
+    cat->ids = ids;
+    cat->cap_slots = cap;
+    return 0;
+}
+
+static int catalogo_crescer_slots(Catalogo *cat) {
+    return catalogo_indexar(cat, cat->cap_slots ? cat->cap_slots * 2 : 64);
+}
+
+/* pista e suspeito juntos, para ordenar */
+typedef struct PistaSuspeito {
+    const char *pista;
+    uint32_t suspeito;
+} PistaSuspeito;
+
+static int pista_suspeito_cmp(const void *a, const void *b) {
+    return strcmp(((const PistaSuspeito *)a)->pista, ((const PistaSuspeito *)b)->pista);
+}
+
+/* renumera as pistas na ordem de strcmp (a da BST de pistas) e monta as
+   máscaras por suspeito */
+static int catalogo_ordenar(Catalogo *cat) {
+    PistaSuspeito *v = malloc((cat->n ? cat->n : 1) * sizeof(PistaSuspeito));
+    if (!v) return -1;
+    for (size_t i = 0; i < cat->n; ++i) v[i] = (PistaSuspeito){ cat->pistas[i], cat->suspeito[i] };
+    qsort(v, cat->n, sizeof(PistaSuspeito), pista_suspeito_cmp);
+    for (size_t i = 0; i < cat->n; ++i) {
+        cat->pistas[i] = v[i].pista;
+        cat->suspeito[i] = v[i].suspeito;
+    }
+    free(v);
+    if (catalogo_indexar(cat, cat->cap_slots) != 0) return -1;
+
+    cat->palavras = (cat->n + 63) / 64;
+    if (cat->n_suspeitos * cat->palavras * sizeof(uint64_t) > CATALOGO_MAX_MASCARAS) return 0;
+    cat->mascaras = mem_calloc(cat->n_suspeitos * cat->palavras + 1, sizeof(uint64_t));
+    if (!cat->mascaras) return -1;
+    for (size_t id = 0; id < cat->n; ++id) {
+        uint32_t sp = cat->suspeito[id];
+        if (sp != CATALOGO_NENHUMA)
+            cat->mascaras[sp * cat->palavras + id / 64] |= (uint64_t)1 << (id % 64);
+    }
+    return 0;
+}
+
+/* registra a pista (se ainda não estiver) com o suspeito que a hash dá */
+static int catalogo_adicionar(Catalogo *cat, HashTable *ht, const SuspeitoSet *sus,
+                              const char *pista) {
+    if (!pista || pista[0] == '\0' || catalogo_id(cat, pista) != CATALOGO_NENHUMA) return 0;
+    if (2 * (cat->n + 1) > cat->cap_slots && catalogo_crescer_slots(cat) != 0) return -1;
+    if (cat->n == cat->cap) {
+        size_t cap = cat->cap ? cat->cap * 2 : 64;
+        const char **p = realloc((void *)cat->pistas, cap * sizeof(char *));
+        if (p) cat->pistas = p;
+        uint32_t *s = realloc(cat->suspeito, cap * sizeof(uint32_t));
+        if (s) cat->suspeito = s;
+        if (!p || !s) return -1;
+        cat->cap = cap;
+    }
+    const char *nome = encontrarSuspeito(ht, pista);
+    size_t pos = nome ? suspeito_pos(sus, nome) : SUSPEITO_NENHUM;
+    size_t i = hash_misturar_ptr(pista) & (cat->cap_slots - 1);
+    while (cat->chaves[i]) i = (i + 1) & (cat->cap_slots - 1);
+    cat->chaves[i] = pista;
+    cat->ids[i] = (uint32_t)cat->n;
+    cat->pistas[cat->n] = pista;
+    cat->suspeito[cat->n] = pos == SUSPEITO_NENHUM ? CATALOGO_NENHUMA : (uint32_t)pos;
+    cat->n += 1;
+    return 0;
+}
+
+void catalogoLiberar(Catalogo *cat) {
+    if (!cat) return;
+    free((void *)cat->pistas);
+    free(cat->suspeito);
+    mem_free((void *)cat->chaves);
+    mem_free(cat->ids);
+    mem_free(cat->mascaras);
+    mem_free(cat);
+}
+
+/**
+ * catalogoMontar(mapa, ht)
+ * Uma passada pelo mapa: dá um id denso a cada pista distinta (em ordem
+ * alfabética), guarda a posição do suspeito dela em hashSuspeitos(ht) e
+ * mede a mansão (salas e profundidade). Quem usa o catálogo não consulta
+ * mais a hash. Mapas sob demanda ficam sem catálogo (NULL).
+ */
+Catalogo *catalogoMontar(Mapa *mapa, HashTable *ht) {
+    typedef struct { NoMapa no; uint32_t prof; } Item;
+    const MapaOps *op = mapa->ops;
+    if (op == &mapa_sob_ops) return NULL;
+    const SuspeitoSet *sus = hashSuspeitos(ht);
+    Catalogo *cat = mem_calloc(1, sizeof(Catalogo));
+    Item *pilha = NULL;
+    size_t k = 0, cap = 64;
+    if (!cat || !(pilha = malloc(cap * sizeof(Item)))) goto erro;
+    cat->nomes = sus->nomes;
+    cat->n_suspeitos = sus->n;
+    NoMapa raiz = op->raiz(mapa->dados);
+    if (raiz) pilha[k++] = (Item){ raiz, 0 };
+    while (k > 0) {
+        Item it = pilha[--k];
+        cat->salas += 1;
+        if (it.prof > cat->profundidade) cat->profundidade = it.prof;
+        if (catalogo_adicionar(cat, ht, sus, op->pista(mapa->dados, it.no)) != 0) goto erro;
+        if (k + 2 > cap) {
+            Item *tmp = realloc(pilha, cap * 2 * sizeof(Item));
+            if (!tmp) goto erro;
+            pilha = tmp;
+            cap *= 2;
+        }
+        NoMapa e = op->esq(mapa->dados, it.no), d = op->dir(mapa->dados, it.no);
+        if (d) pilha[k++] = (Item){ d, it.prof + 1 };
+        if (e) pilha[k++] = (Item){ e, it.prof + 1 };
+    }
+    free(pilha);
+    pilha = NULL;
+    if (catalogo_ordenar(cat) != 0) goto erro;
+    return cat;
+
+erro:
+    fprintf(stderr, "Erro: catálogo de pistas\n");
+    free(pilha);
+    catalogoLiberar(cat);
+    return NULL;
+}
+
+/* catalogoBuscar(cat, pista): id pelo texto (busca binária, os ids estão
+   em ordem alfabética) ou CATALOGO_NENHUMA; serve a pistas que não vêm do
+   mapa, como as de um registro de partidas */
+uint32_t catalogoBuscar(const Catalogo *cat, const char *pista) {
+    size_t lo = 0, hi = cat->n;
+    while (lo < hi) {
+        size_t m = lo + (hi - lo) / 2;
+        int c = strcmp(cat->pistas[m], pista);
+        if (c == 0) return (uint32_t)m;
+        if (c < 0) lo = m + 1;
+        else hi = m;
+    }
+    return CATALOGO_NENHUMA;
+}
+
+/* o catálogo custa uma volta pelo mapa e uma busca na hash por pista: só
+   compensa depois de tantos comandos quanto associações na hash (antes
+   disso as pistas vão para a BST, que não precisa de nada montado) */
+static int catalogo_compensa(const HashTable *ht, size_t comandos) {
+    return comandos >= ht->n;
+}
+
+/* pistas coletadas como bitset pelos ids do catálogo: inserir, descartar
+   repetida e consultar são operações de um bit */
+typedef struct ConjuntoPistas {
+    const Catalogo *cat;
+    uint64_t *bits;            /* cat->palavras palavras (BufCow: dividido entre bifurcações) */
+    uint32_t *ids;             /* ids ligados, na ordem de coleta (para limpar) */
+    size_t n, cap;
+} ConjuntoPistas;
+
+/* conjuntoIniciar(c, cat): conjunto vazio sobre as pistas de 'cat' */
+int conjuntoIniciar(ConjuntoPistas *c, const Catalogo *cat) {
+    memset(c, 0, sizeof(*c));
+    c->cat = cat;
+    c->bits = cow_alocar((cat->palavras ? cat->palavras : 1) * sizeof(uint64_t), 1);
+    return c->bits ? 0 : -1;
+}
+
+/* conjuntoLiberar(c): como os buffers da Sessao, fora de mem_stats (um
+   conjunto por thread) */
+void conjuntoLiberar(ConjuntoPistas *c) {
+    cow_soltar(c->bits);
+    free(c->ids);
+    memset(c, 0, sizeof(*c));
+}
+
+/* esvazia desligando só os bits ligados (custa o que foi coletado); um
+   bitset ainda dividido com outra bifurcação é trocado por um zerado */
+int conjuntoLimpar(ConjuntoPistas *c) {
+    if (cow_compartilhado(c->bits)) {
+        uint64_t *b = cow_alocar((c->cat->palavras ? c->cat->palavras : 1) * sizeof(uint64_t), 1);
+        if (!b) return -1;
+        cow_soltar(c->bits);
+        c->bits = b;
+    } else {
+        for (size_t i = 0; i < c->n; ++i) c->bits[c->ids[i] / 64] = 0;
+    }
+    c->n = 0;
+    return 0;
+}
+
+/* liga o id 'i': 1 se entrou agora, 0 se já estava, -1 sem memória */
+static int conjunto_ligar(ConjuntoPistas *c, uint32_t i) {
+    uint64_t bit = (uint64_t)1 << (i % 64);
+    if (c->bits[i / 64] & bit) return 0;
+    if (cow_compartilhado(c->bits)) {
+        size_t tam = (c->cat->palavras ? c->cat->palavras : 1) * sizeof(uint64_t);
+        uint64_t *b = cow_escrever(c->bits, tam, tam);
+        if (!b) return -1;
+        c->bits = b;
+    }
+    if (c->n == c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 16;
+        uint32_t *ids = realloc(c->ids, cap * sizeof(uint32_t));
+        if (!ids) return -1;
+        c->ids = ids;
+        c->cap = cap;
+    }
+    c->bits[i / 64] |= bit;
+    c->ids[c->n++] = i;
+    return 1;
+}
+
+/**
+ * conjuntoInserir(c, pista, ptr_id)
+ * Retorna 1 se 'pista' entrou agora, 0 se já estava e -1 se ela não é do
+ * catálogo. Guarda o id em *id (se id != NULL).
+ */
+int conjuntoInserir(ConjuntoPistas *c, const char *pista, uint32_t *id) {
+    uint32_t i = catalogo_id(c->cat, pista);
+    if (id) *id = i;
+    if (i == CATALOGO_NENHUMA) return -1;
+    return conjunto_ligar(c, i);
+}
+
+/* conjuntoBifurcar(dest, orig): 'dest' começa igual a 'orig', dividindo o
+   bitset até a primeira escrita de um dos dois (os ids são copiados) */
+int conjuntoBifurcar(ConjuntoPistas *dest, const ConjuntoPistas *orig) {
+    memset(dest, 0, sizeof(*dest));
+    dest->cat = orig->cat;
+    if (orig->n) {
+        dest->ids = malloc(orig->n * sizeof(uint32_t));
+        if (!dest->ids) return -1;
+        memcpy(dest->ids, orig->ids, orig->n * sizeof(uint32_t));
+        dest->n = dest->cap = orig->n;
+    }
+    dest->bits = cow_compartilhar(orig->bits);
+    return 0;
+}
+
+/* conjuntoContem(c, pista): 1 se 'pista' já foi coletada */
+int conjuntoContem(const ConjuntoPistas *c, const char *pista) {
+    uint32_t i = catalogo_id(c->cat, pista);
+    return i != CATALOGO_NENHUMA && ((c->bits[i / 64] >> (i % 64)) & 1);
+}
+
+/* conjuntoExibir(out, c): como exibirPistas (ids já estão em ordem alfabética) */
+void conjuntoExibir(Saida *out, const ConjuntoPistas *c) {
+    for (size_t w = 0; w < c->cat->palavras; ++w) {
+        for (uint64_t x = c->bits[w]; x; x &= x - 1) {
+            saida_lit(out, " - ");
+            saida_texto(out, c->cat->pistas[w * 64 + bits_primeiro(x)]);
+            saida_char(out, '\n');
+        }
+    }
+}
+
+/**
+ * conjuntoContarPorSuspeito(c, cont)
+ * cont[s] = pistas coletadas do suspeito na posição 's' (cat->n_suspeitos
+ * posições): popcount do bitset com a máscara de cada suspeito, ou uma
+ * passada pelos ids coletados quando o catálogo não tem máscaras.
+ */
+void conjuntoContarPorSuspeito(const ConjuntoPistas *c, uint32_t *cont) {
+    const Catalogo *cat = c->cat;
+    if (!cat->mascaras) {
+        memset(cont, 0, cat->n_suspeitos * sizeof(uint32_t));
+        for (size_t i = 0; i < c->n; ++i)
+            if (cat->suspeito[c->ids[i]] != CATALOGO_NENHUMA) cont[cat->suspeito[c->ids[i]]] += 1;
+        return;
+    }
+    for (size_t sp = 0; sp < cat->n_suspeitos; ++sp) {
+        const uint64_t *m = cat->mascaras + sp * cat->palavras;
+        uint32_t n = 0;
+        for (size_t w = 0; w < cat->palavras; ++w) n += bits_contar(c->bits[w] & m[w]);
+        cont[sp] = n;
+    }
+}
+
+/* acima disso o resumo não é montado (e as dicas ficam desligadas) */
+#define RESUMO_MAX_BYTES ((size_t)256 << 20)
+
+/**
+ * Resumo de cada subárvore, montado de baixo para cima uma única vez: as
+ * pistas alcançáveis (bitset pelos ids do catálogo) e, por suspeito, o
+ * máximo de pistas dele num único caminho descendo dali. O máximo é exato
+ * quando nenhuma pista se repete num caminho; com repetição é um teto.
+ */
+typedef struct ResumoMapa {
+    Catalogo *cat;
+    size_t n;                  /* salas */
+    size_t palavras;           /* uint64_t por sala em 'bits' */
+    uint64_t *bits;            /* sala -> pistas alcançáveis dali (ela inclusive) */
+    uint32_t *n_pistas;        /* sala -> bits ligados */
+    uint16_t *maximo;          /* sala * n_suspeitos + s -> pistas de s num caminho (satura) */
+    NoMapa *nos;               /* endereçamento aberto: nó do mapa */
+    uint32_t *idx;             /* ... e o índice da sala dele */
+    size_t cap;                /* potência de 2, carga <= 1/2 */
+} ResumoMapa;
+
+void resumoLiberar(ResumoMapa *r) {
+    if (!r) return;
+    catalogoLiberar(r->cat);
+    mem_free(r->bits);
+    mem_free(r->n_pistas);
+    mem_free(r->maximo);
+    mem_free(r->nos);
+    mem_free(r->idx);
+    mem_free(r);
+}
+
+/* resumoSala(r, no): índice da sala no resumo (SALA_NENHUMA se não for do mapa) */
+uint32_t resumoSala(const ResumoMapa *r, NoMapa no) {
+    size_t mask = r->cap - 1;
+    for (size_t i = hash_misturar_ptr((const void *)(uintptr_t)no) & mask;; i = (i + 1) & mask) {
+        if (r->nos[i] == no) return r->idx[i];
+        if (!r->nos[i]) return SALA_NENHUMA;
+    }
+}
+
+/* resumoAlcanca(r, sala, pista): 1 se 'pista' (ponteiro do mapa) pode ser
+   coletada na sala ou abaixo dela */
+int resumoAlcanca(const ResumoMapa *r, uint32_t sala, const char *pista) {
+    uint32_t id = catalogo_id(r->cat, pista);
+    if (sala == SALA_NENHUMA || id == CATALOGO_NENHUMA) return 0;
+    return (int)((r->bits[sala * r->palavras + id / 64] >> (id % 64)) & 1);
+}
+
+/* resumoPistasAbaixo(r, sala): pistas distintas alcançáveis dali */
+uint32_t resumoPistasAbaixo(const ResumoMapa *r, uint32_t sala) {
+    return sala == SALA_NENHUMA ? 0 : r->n_pistas[sala];
+}
+
+/* resumoMaximo(r, sala, s): máximo de pistas do suspeito na posição 's' de
+   hashSuspeitos num só caminho a partir da sala */
+uint32_t resumoMaximo(const ResumoMapa *r, uint32_t sala, size_t s) {
+    if (sala == SALA_NENHUMA || s >= r->cat->n_suspeitos) return 0;
+    return r->maximo[sala * r->cat->n_suspeitos + s];
+}
+
+/**
+ * resumoMontar(mapa, ht)
+ * Numera as salas em pré-ordem (filhos sempre depois do pai) e preenche o
+ * resumo na ordem inversa, juntando o dos filhos ao da sala. Retorna NULL
+ * se faltar memória, se o resumo passar de RESUMO_MAX_BYTES ou se o mapa
+ * for sob demanda.
+ */
+ResumoMapa *resumoMontar(Mapa *mapa, HashTable *ht) {
+    typedef struct { NoMapa no; uint32_t pai; int lado; } Item;
+    const MapaOps *op = mapa->ops;
+    if (op == &mapa_sob_ops) return NULL;
+    ResumoMapa *r = mem_calloc(1, sizeof(ResumoMapa));
+    NoMapa *ordem = NULL;
+    uint32_t *filhos = NULL;
+    Item *pilha = NULL;
+    if (!r || !(r->cat = catalogoMontar(mapa, ht))) goto erro;
+    const Catalogo *cat = r->cat;
+    size_t ns = cat->n_suspeitos;
+    r->n = cat->salas;
+    r->palavras = cat->palavras;
+    r->cap = 16;
+    while (r->cap < 2 * r->n) r->cap *= 2;
+    size_t bytes = r->n * (r->palavras * sizeof(uint64_t) + sizeof(uint32_t) + ns * sizeof(uint16_t))
+                   + r->cap * (sizeof(NoMapa) + sizeof(uint32_t));
+    if (bytes > RESUMO_MAX_BYTES) {
+        fprintf(stderr, "Aviso: o resumo das subárvores ocuparia %zu MiB; dicas desligadas.\n",
+                bytes >> 20);
+        resumoLiberar(r);
+        return NULL;
+    }
+    size_t n = r->n ? r->n : 1;
+    r->bits = mem_calloc(n * (r->palavras ? r->palavras : 1), sizeof(uint64_t));
+    r->n_pistas = mem_alloc(n * sizeof(uint32_t));
+    r->maximo = mem_calloc(n * (ns ? ns : 1), sizeof(uint16_t));
+    r->nos = mem_calloc(r->cap, sizeof(NoMapa));
+    r->idx = mem_alloc(r->cap * sizeof(uint32_t));
+    ordem = malloc(n * sizeof(NoMapa));
+    filhos = malloc(2 * n * sizeof(uint32_t));
+    pilha = malloc((n + 1) * sizeof(Item));
+    if (!r->bits || !r->n_pistas || !r->maximo || !r->nos || !r->idx || !ordem || !filhos || !pilha)
+        goto erro;
+
+    /* pré-ordem: 'esq' sai da pilha antes de 'dir' */
+    size_t k = 0, i = 0;
+    NoMapa raiz = op->raiz(mapa->dados);
+    if (raiz) pilha[k++] = (Item){ raiz, SALA_NENHUMA, 0 };
+    while (k > 0 && i < r->n) {
+        Item it = pilha[--k];
+        ordem[i] = it.no;
+        filhos[2 * i] = filhos[2 * i + 1] = SALA_NENHUMA;
+        if (it.pai != SALA_NENHUMA) filhos[2 * it.pai + it.lado] = (uint32_t)i;
+        size_t h = hash_misturar_ptr((const void *)(uintptr_t)it.no) & (r->cap - 1);
+        while (r->nos[h]) h = (h + 1) & (r->cap - 1);
+        r->nos[h] = it.no;
+        r->idx[h] = (uint32_t)i;
+        NoMapa e = op->esq(mapa->dados, it.no), d = op->dir(mapa->dados, it.no);
+        if (d) pilha[k++] = (Item){ d, (uint32_t)i, 1 };
+        if (e) pilha[k++] = (Item){ e, (uint32_t)i, 0 };
+        ++i;
+    }
+
+    /* de baixo para cima: união dos bitsets e máximo dos filhos */
+    for (size_t j = r->n; j-- > 0;) {
+        uint64_t *b = r->bits + j * r->palavras;
+        uint16_t *m = r->maximo + j * ns;
+        for (int lado = 0; lado < 2; ++lado) {
+            uint32_t f = filhos[2 * j + lado];
+            if (f == SALA_NENHUMA) continue;
+            const uint64_t *bf = r->bits + (size_t)f * r->palavras;
+            const uint16_t *mf = r->maximo + (size_t)f * ns;
+            for (size_t w = 0; w < r->palavras; ++w) b[w] |= bf[w];
+            for (size_t s = 0; s < ns; ++s) if (mf[s] > m[s]) m[s] = mf[s];
+        }
+        uint32_t id = catalogo_id(cat, op->pista(mapa->dados, ordem[j]));
+        if (id != CATALOGO_NENHUMA) {
+            b[id / 64] |= (uint64_t)1 << (id % 64);
+            uint32_t s = cat->suspeito[id];
+            if (s != CATALOGO_NENHUMA && m[s] < UINT16_MAX) m[s] += 1;
+        }
+        uint32_t c = 0;
+        for (size_t w = 0; w < r->palavras; ++w) c += bits_contar(b[w]);
+        r->n_pistas[j] = c;
+    }
+    free(ordem);
+    free(filhos);
+    free(pilha);
+    return r;
+
+erro:
+    fprintf(stderr, "Erro: resumo das subárvores\n");
+    free(ordem);
+    free(filhos);
+    free(pilha);
+    resumoLiberar(r);
+    return NULL;
+}
+
+/* ===========================
+   Exploração + coleta de pistas
+   =========================== */
+
+/* Resumo montado no primeiro pedido de dica, não na abertura do jogo: custa
+   salas × pistas/64 palavras e a maioria das partidas não pede dica. De
+   quem cria (resumoLiberar(resumo) no fim); uma thread só */
+typedef struct DicasAdiadas {
+    Mapa *mapa;
+    HashTable *ht;
+    ResumoMapa *resumo;        /* NULL depois de 'tentou' = não coube */
+    int tentou;
+} DicasAdiadas;
+
+/* Estado de uma exploração em andamento (uma partida) */
+typedef struct Sessao {
+    Saida *out;                /* para onde vai o texto da partida */
+    Mapa *mapa;
+    HashTable *ht;
+    Arena *arena;              /* nós da BST de pistas (NULL = heap) */
+    NoMapa atual;              /* sala onde o jogador está */
+    unsigned char *caminho;    /* lado de cada movimento desde 'base', bit = 1: direita (BufCow) */
+    size_t n_hist;             /* salas visitadas (a raiz + um por movimento) */
+    size_t cap_hist;           /* bytes de 'caminho' */
+    FILE *derrame;             /* movimentos antes de 'base' (NULL = todos na memória) */
+    size_t base;               /* movimentos já gravados em 'derrame' (múltiplo de 8) */
+    size_t movimentos;         /* comandos processados na partida */
+    PistaNode *pistas;         /* BST de pistas coletadas */
+    ConjuntoPistas *colecao;   /* bitset de pistas coletadas (NULL = só a BST) */
+    uint32_t *votos;           /* pistas coletadas por suspeito (posições de hashSuspeitos) */
+    size_t *acusaveis;         /* posições com votos > 0, na ordem da 1a pista */
+    size_t n_acusaveis, cap_votos;
+    size_t lider;              /* posição com mais pistas (SUSPEITO_NENHUM = nenhuma) */
+    const ResumoMapa *resumo;  /* para o comando 'p' (NULL = sem dicas) */
+    DicasAdiadas *dicas;       /* sem 'resumo': montado no primeiro 'p' (ou NULL) */
+    int quieto;                /* 1 = nenhuma saída por sala */
+    int encerrada;             /* 1 = o jogador saiu */
+} Sessao;
+
+/* mostra a sala atual e a quem a pista dela aponta */
+static void sessao_mostrar(const Sessao *s) {
+    if (s->quieto) return;
+    const MapaOps *op = s->mapa->ops;
+    const char *pista = op->pista(s->mapa->dados, s->atual);
+    Saida *out = s->out;
+    saida_lit(out, "\nVocê está na sala: ");
+    saida_texto(out, op->nome(s->mapa->dados, s->atual));
+    saida_char(out, '\n');
+    if (pista && pista[0] != '\0') {
+        saida_lit(out, "Pista encontrada: \"");
+        saida_texto(out, pista);
+        saida_lit(out, "\"\n");
+        /* mostrar suspeito relacionado (se existir na hash) */
+        char *sus = encontrarSuspeito(s->ht, pista);
+        if (sus) {
+            saida_lit(out, "  (Essa pista aponta para: ");
+            saida_texto(out, sus);
+            saida_lit(out, ")\n");
+        } else {
+            saida_lit(out, "  (Nenhum suspeito conhecido para esta pista)\n");
+        }
+    } else {
+        saida_lit(out, "Nenhuma pista nesta sala.\n");
+    }
+}
+
+/* garante contadores para 'n' suspeitos (novos zerados) */
+static int sessao_votos_crescer(Sessao *s, size_t n) {
+    size_t cap = s->cap_votos ? s->cap_votos : 8;
+    while (cap < n) cap *= 2;
+    uint32_t *votos = realloc(s->votos, cap * sizeof(uint32_t));
+    if (votos) s->votos = votos;
+    size_t *acus = realloc(s->acusaveis, cap * sizeof(size_t));
+    if (acus) s->acusaveis = acus;
+    if (!votos || !acus) {
+        fprintf(stderr, "Erro: contadores de suspeitos\n");
+        return -1;
+    }
+    memset(s->votos + s->cap_votos, 0, (cap - s->cap_votos) * sizeof(uint32_t));
+    s->cap_votos = cap;
+    return 0;
+}
+
+/* mais um voto para o suspeito na posição 'p' de hashSuspeitos */
+static void sessao_votar_pos(Sessao *s, size_t p) {
+    if (p >= s->cap_votos && sessao_votos_crescer(s, s->ht->sus.n) != 0) return;
+    if (s->votos[p]++ == 0) s->acusaveis[s->n_acusaveis++] = p;
+    /* empate: continua na frente quem chegou lá primeiro */
+    if (s->lider == SUSPEITO_NENHUM || s->votos[p] > s->votos[s->lider]) s->lider = p;
+}
+
+/* pista nova na coleção: mais um voto para o suspeito dela */
+static void sessao_votar(Sessao *s, const char *pista) {
+    const char *sus = encontrarSuspeito(s->ht, pista);
+    if (!sus) return;
+    size_t p = suspeito_pos(hashSuspeitos(s->ht), sus);
+    if (p != SUSPEITO_NENHUM) sessao_votar_pos(s, p);
+}
+
+/* coleta 'pista': no bitset (o catálogo já sabe o suspeito) ou na BST */
+static void sessao_coletar(Sessao *s, const char *pista) {
+    uint32_t id;
+    int nova = s->colecao ? conjuntoInserir(s->colecao, pista, &id) : -1;
+    if (nova > 0) {
+        uint32_t p = s->colecao->cat->suspeito[id];
+        if (p != CATALOGO_NENHUMA) sessao_votar_pos(s, p);
+    } else if (nova < 0) {
+        /* sem coleção, ou pista fora do catálogo */
+        s->pistas = pista_inserir(s->arena, s->pistas, pista, &nova);
+        if (nova) sessao_votar(s, pista);
+    }
+}
+
+static void sessao_votar_visita(PistaNode *n, void *ctx) {
+    Sessao *s = ctx;
+    if (s->colecao) sessao_coletar(s, n->pista);
+    else sessao_votar(s, n->pista);
+}
+
+/* buffer do caminho a partir do qual os movimentos vão para o derrame */
+#define SESSAO_DERRAME_BLOCO 4096
+
+/* grava o buffer cheio do caminho no arquivo de derrame e o esvazia */
+static int sessao_derramar(Sessao *s) {
+    if (fseek(s->derrame, (long)(s->base / 8), SEEK_SET) != 0 ||
+        fwrite(s->caminho, 1, s->cap_hist, s->derrame) != s->cap_hist) {
+        fprintf(stderr, "Erro: gravação do histórico\n");
+        return -1;
+    }
+    s->base += s->cap_hist * 8;
+    return 0;
+}
+
+/* lê 'n' bytes do caminho derramado, a partir do byte 'ini' */
+static int sessao_ler_derrame(const Sessao *s, unsigned char *dest, size_t ini, size_t n) {
+    if (fseek(s->derrame, (long)ini, SEEK_SET) != 0 || fread(dest, 1, n, s->derrame) != n) {
+        fprintf(stderr, "Erro: leitura do histórico\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* conta a sala atual no histórico e põe o lado do movimento no caminho
+   (lado < 0 na raiz). Buffer cheio vai para o derrame (se houver) ou
+   dobra; ainda dividido com uma bifurcação, é copiado antes */
+static int sessao_registrar(Sessao *s, int lado) {
+    if (lado >= 0) {
+        size_t k = s->n_hist - 1 - s->base;
+        if (k / 8 == s->cap_hist && s->derrame && s->cap_hist >= SESSAO_DERRAME_BLOCO &&
+            !cow_compartilhado(s->caminho)) {
+            if (sessao_derramar(s) != 0) return -1;
+            k = 0;
+        }
+        if (k / 8 == s->cap_hist || cow_compartilhado(s->caminho)) {
+            size_t nova = k / 8 < s->cap_hist ? s->cap_hist : s->cap_hist ? s->cap_hist * 2 : 8;
+            unsigned char *c = cow_escrever(s->caminho, nova, (k + 7) / 8);
+            if (!c) {
+                fprintf(stderr, "Erro: histórico\n");
+                return -1;
+            }
+            s->caminho = c;
+            s->cap_hist = nova;
+        }
+        unsigned char bit = (unsigned char)(1u << (k % 8));
+        s->caminho[k / 8] = lado ? (unsigned char)(s->caminho[k / 8] | bit)
+                                 : (unsigned char)(s->caminho[k / 8] & ~bit);
+    }
+    s->n_hist += 1;
+    return 0;
+}
+
+/* chegada na sala atual: registra a visita e coleta a pista */
+static int sessao_entrar(Sessao *s, int lado) {
+    const MapaOps *op = s->mapa->ops;
+    if (sessao_registrar(s, lado) != 0) return -1;
+    const char *pista = op->pista(s->mapa->dados, s->atual);
+    /* coletar (evita duplicatas); só pista nova conta */
+    if (pista && pista[0] != '\0') sessao_coletar(s, pista);
+    sessao_mostrar(s);
+    return 0;
+}
+
+/* volta a sessão à raiz, sem visitas nem pistas (-1 sem memória) */
+static int sessao_limpar(Sessao *s) {
+    s->atual = s->mapa->ops->raiz(s->mapa->dados);
+    s->n_hist = 0;
+    s->base = 0;
+    s->movimentos = 0;
+    s->pistas = NULL;
+    s->encerrada = 0;
+    for (size_t i = 0; i < s->n_acusaveis; ++i) s->votos[s->acusaveis[i]] = 0;
+    s->n_acusaveis = 0;
+    s->lider = SUSPEITO_NENHUM;
+    return s->colecao ? conjuntoLimpar(s->colecao) : 0;
+}
+
+/**
+ * sessaoReiniciar(s, pistas)
+ * Começa uma nova partida na mesma sessão: volta à raiz do mapa, zera o
+ * histórico e os contadores (os buffers são reaproveitados) e parte da BST
+ * 'pistas'. Com coleção, as pistas de 'pistas' são copiadas para o bitset.
+ * Retorna -1 se o mapa estiver vazio (ou faltar memória).
+ */
+int sessaoReiniciar(Sessao *s, PistaNode *pistas) {
+    if (sessao_limpar(s) != 0) {
+        s->encerrada = 1;
+        return -1;
+    }
+    if (!s->colecao) s->pistas = pistas;
+    pista_percorrer(pistas, sessao_votar_visita, s);
+    if (!s->atual) {
+        if (!s->quieto) saida_lit(s->out, "Mapa vazio.\n");
+        s->encerrada = 1;
+        return -1;
+    }
+    return sessao_entrar(s, -1);
+}
+
+/* sessaoPreparar(s, out, mapa, ht, arena, quieto): sessão ainda fora do
+   mapa; quem chama pode pôr resumo e coleção antes de sessaoReiniciar */
+void sessaoPreparar(Sessao *s, Saida *out, Mapa *mapa, HashTable *ht, Arena *arena, int quieto) {
+    memset(s, 0, sizeof(*s));
+    s->out = out;
+    s->mapa = mapa;
+    s->ht = ht;
+    s->arena = arena;
+    s->quieto = quieto;
+}
+
+/* sessaoDerramar(s, arq): partidas longas; passado SESSAO_DERRAME_BLOCO
+   bytes de caminho, os movimentos mais antigos vão para 'arq' (aberto em
+   "w+b", de quem chama) em vez de o buffer dobrar. Antes de sessaoReiniciar */
+void sessaoDerramar(Sessao *s, FILE *arq) {
+    s->derrame = arq;
+}
+
+/* sessaoIniciar(s, out, mapa, ht, arena, pistas, quieto): prepara a sessão
+   e entra na primeira sala */
+int sessaoIniciar(Sessao *s, Saida *out, Mapa *mapa, HashTable *ht, Arena *arena,
+                  PistaNode *pistas, int quieto) {
+    sessaoPreparar(s, out, mapa, ht, arena, quieto);
+    return sessaoReiniciar(s, pistas);
+}
+
+/* opções de movimento a partir da sala atual */
+static void sessao_menu(const Sessao *s) {
+    const MapaOps *op = s->mapa->ops;
+    saida_lit(s->out, "Escolha uma opção:\n");
+    if (op->esq(s->mapa->dados, s->atual)) saida_lit(s->out, "  (e) Ir para a esquerda\n");
+    if (op->dir(s->mapa->dados, s->atual)) saida_lit(s->out, "  (d) Ir para a direita\n");
+    if (s->resumo || (s->dicas && !s->dicas->tentou)) saida_lit(s->out, "  (p) Pedir uma dica\n");
+    saida_lit(s->out, "  (s) Sair da exploração\nOpção: ");
+}
+
+/* pistas ao alcance por um dos lados da sala atual */
+static void sessao_dica_lado(const Sessao *s, const char *rotulo, NoMapa filho) {
+    saida_texto(s->out, rotulo);
+    if (!filho) {
+        saida_lit(s->out, "sem passagem.\n");
+        return;
+    }
+    saida_uint(s->out, resumoPistasAbaixo(s->resumo, resumoSala(s->resumo, filho)));
+    saida_lit(s->out, " pista(s) ao alcance.\n");
+}
+
+/* dica: o que ainda dá para coletar descendo da sala atual (consultas ao
+   resumo, sem percorrer a subárvore) */
+static void sessao_dica(const Sessao *s) {
+    const MapaOps *op = s->mapa->ops;
+    const ResumoMapa *r = s->resumo;
+    const SuspeitoSet *sus = &s->ht->sus;
+    NoMapa e = op->esq(s->mapa->dados, s->atual), d = op->dir(s->mapa->dados, s->atual);
+    uint32_t se = e ? resumoSala(r, e) : SALA_NENHUMA, sd = d ? resumoSala(r, d) : SALA_NENHUMA;
+    Saida *out = s->out;
+    saida_lit(out, "Dica:\n");
+    sessao_dica_lado(s, "  À esquerda: ", e);
+    sessao_dica_lado(s, "  À direita: ", d);
+    int alguem = 0;
+    for (size_t p = 0; p < sus->n; ++p) {
+        uint32_t tem = p < s->cap_votos ? s->votos[p] : 0;
+        uint32_t mais = resumoMaximo(r, se, p), md = resumoMaximo(r, sd, p);
+        if (md > mais) mais = md;
+        if (tem >= 2 || tem + mais < 2) continue;
+        saida_texto(out, alguem ? ", " : "  Ainda dá para reunir 2 pistas contra: ");
+        saida_texto(out, sus->nomes[p]);
+        saida_lit(out, " (");
+        saida_uint(out, tem);
+        saida_lit(out, " + até ");
+        saida_uint(out, mais);
+        saida_char(out, ')');
+        alguem = 1;
+    }
+    saida_texto(out, alguem ? "\n" : "  Nenhum suspeito novo pode chegar a 2 pistas por aqui.\n");
+}
+
+/* resumo da sessão, montado agora se ficou para o primeiro pedido */
+static const ResumoMapa *sessao_resumo(Sessao *s) {
+    if (!s->resumo && s->dicas) {
+        if (!s->dicas->tentou) {
+            s->dicas->tentou = 1;
+            s->dicas->resumo = resumoMontar(s->dicas->mapa, s->dicas->ht);
+        }
+        s->resumo = s->dicas->resumo;
+    }
+    return s->resumo;
+}
+
+/**
+ * sessaoComando(s, escolha)
+ * Aplica um comando: 'e' esquerda, 'd' direita, 's' sair ('p' pede uma
+ * dica quando a sessão tem resumo, ou dicas adiadas; não conta como
+ * movimento). Caminho inexistente ou comando inválido só avisa e mostra a
+ * sala de novo (a visita não é registrada outra vez). Retorna 1 quando a
+ * partida termina.
+ */
+int sessaoComando(Sessao *s, char escolha) {
+    const MapaOps *op = s->mapa->ops;
+    NoMapa prox = 0;
+    const char *aviso = "Opção inválida. Use 'e', 'd' ou 's'.";
+    if (s->encerrada) return 1;
+    if (escolha == 'p' && (s->resumo || s->dicas)) {
+        if (sessao_resumo(s)) {
+            if (!s->quieto) sessao_dica(s);
+        } else if (!s->quieto) {
+            saida_lit(s->out, "Dicas indisponíveis: o resumo deste mapa não cabe na memória.\n");
+        }
+        return 0;
+    }
+    s->movimentos += 1;
+    if (escolha == 's') {
+        if (!s->quieto) saida_lit(s->out, "Saindo da exploração.\n");
+        s->encerrada = 1;
+        return 1;
+    } else if (escolha == 'e') {
+        prox = op->esq(s->mapa->dados, s->atual);
+        aviso = "Caminho à esquerda não disponível.";
+    } else if (escolha == 'd') {
+        prox = op->dir(s->mapa->dados, s->atual);
+        aviso = "Caminho à direita não disponível.";
+    }
+    if (prox) {
+        s->atual = prox;
+        if (sessao_entrar(s, escolha == 'd') != 0) s->encerrada = 1;
+        return s->encerrada;
+    }
+    if (!s->quieto) {
+        saida_texto(s->out, aviso);
+        saida_char(s->out, '\n');
+    }
+    sessao_mostrar(s);
+    return 0;
+}
+
+/* mostrar histórico de visitas: o caminho é decodificado a partir da raiz
+   (a parte derramada, lida em blocos) */
+void sessaoHistorico(const Sessao *s) {
+    if (s->quieto) return;
+    Saida *out = s->out;
+    if (s->n_hist == 0) {
+        saida_lit(out, "\nNenhuma sala visitada.\n");
+        return;
+    }
+    const MapaOps *op = s->mapa->ops;
+    NoMapa sala = op->raiz(s->mapa->dados);
+    unsigned char bloco[512];
+    saida_lit(out, "\nHistórico de salas visitadas:\n");
+    for (size_t i = 0; sala; ++i) {
+        saida_lit(out, "  ");
+        saida_uint(out, i + 1);
+        saida_lit(out, ". ");
+        saida_texto(out, op->nome(s->mapa->dados, sala));
+        saida_char(out, '\n');
+        if (i + 1 == s->n_hist) break;
+        unsigned char b;
+        if (i < s->base) {
+            size_t byte = i / 8, n = s->base / 8 - byte;
+            if (i % (8 * sizeof(bloco)) == 0 &&
+                sessao_ler_derrame(s, bloco, byte, n < sizeof(bloco) ? n : sizeof(bloco)) != 0)
+                break;
+            b = bloco[byte % sizeof(bloco)];
+        } else {
+            b = s->caminho[(i - s->base) / 8];
+        }
+        sala = (b >> (i % 8)) & 1 ? op->dir(s->mapa->dados, sala) : op->esq(s->mapa->dados, sala);
+    }
+}
+
+/* sessaoPistasDe(s, suspeito): pistas coletadas que apontam para 'suspeito' */
+uint32_t sessaoPistasDe(const Sessao *s, const char *suspeito) {
+    const SuspeitoSet *c = &s->ht->sus;
+    size_t p = suspeito_pos(c, suspeito);
+    if (p == SUSPEITO_NENHUM) p = suspeito_pos(c, interner_buscar(interner_global, suspeito));
+    return p < s->cap_votos ? s->votos[p] : 0;
+}
+
+/* sessaoLider(s, ptr_cont): suspeito com mais pistas até agora (NULL = nenhum) */
+const char *sessaoLider(const Sessao *s, uint32_t *cont) {
+    if (cont) *cont = s->lider == SUSPEITO_NENHUM ? 0 : s->votos[s->lider];
+    return s->lider == SUSPEITO_NENHUM ? NULL : s->ht->sus.nomes[s->lider];
+}
+
+/* libera histórico e contadores (as pistas pertencem a quem chamou) */
+void sessaoLiberar(Sessao *s) {
+    cow_soltar(s->caminho);
+    free(s->votos);
+    free(s->acusaveis);
+    s->caminho = NULL;
+    s->votos = NULL;
+    s->acusaveis = NULL;
+    s->derrame = NULL;
+    s->n_hist = s->cap_hist = s->base = 0;
+    s->n_acusaveis = s->cap_votos = 0;
+}
+
+/* primeiro caractere não branco da linha, em minúscula ('\0' se vazia) */
+static char escolha_de_linha(const char *buf) {
+    size_t n = strlen(buf);
+    size_t i = nucleosTexto()->brancos((const unsigned char *)buf, n);
+    return i < n ? (char)tolower((unsigned char)buf[i]) : '\0';
+}
+
+/* um comando do jogador ('linha' NULL = fim da entrada, vale como 's') e a
+   resposta: o menu seguinte ou, se a exploração acabou, o histórico.
+   Retorna 1 quando a exploração termina */
+static int sessao_passo(Sessao *s, const char *linha) {
+    sessaoComando(s, linha ? escolha_de_linha(linha) : 's');
+    if (!s->encerrada) {
+        sessao_menu(s);
+        return 0;
+    }
+    sessaoHistorico(s);
+    return 1;
+}
+
+/* jogarSessao(s): lê os comandos do jogador até ele sair e mostra o histórico */
+void jogarSessao(Sessao *s) {
+    char buf[128];
+    if (s->encerrada) {
+        sessaoHistorico(s);
+        return;
+    }
+    sessao_menu(s);
+    while (!sessao_passo(s, ler_linha_de(s->out, buf, sizeof(buf)) ? buf : NULL)) {}
+}
+
+/**
+ * explorarMapaEm(out, arena, mapa, ht, ponteiro_raiz_pistas)
+ * Permite navegar pela mansão (arvore binaria). Ao entrar numa sala, exibe
+ * a pista (se existir), insere na BST de pistas e mostra a quem a pista aponta
+ * (consultando a hash). As pistas coletadas são alocadas na arena (se houver).
+ * Funciona sobre qualquer representação do mapa (ver Mapa).
+ *
+ * Comandos: 'e' esquerda, 'd' direita, 's' sair (fim da entrada = sair).
+ */
+void explorarMapaEm(Saida *out, Arena *arena, Mapa *mapa, HashTable *ht,
+                    PistaNode **pistasRoot) {
+    Sessao s;
+    if (sessaoIniciar(&s, out, mapa, ht, arena, *pistasRoot, 0) == 0) jogarSessao(&s);
+    *pistasRoot = s.pistas;
+    sessaoLiberar(&s);
+}
+
+/* explorarSalasEm(arena, inicio, ht, ponteiro_raiz_pistas): sobre a árvore
+   de ponteiros */
+void explorarSalasEm(Arena *arena, Sala *inicio, HashTable *ht, PistaNode **pistasRoot) {
+    Mapa m = mapaDeSalas(inicio);
+    explorarMapaEm(saidaPadrao(), arena, &m, ht, pistasRoot);
+}
+
+/* explorarSalas(inicio, ht, ponteiro_raiz_pistas): versão no heap */
+void explorarSalas(Sala *inicio, HashTable *ht, PistaNode **pistasRoot) {
+    explorarSalasEm(NULL, inicio, ht, pistasRoot);
+}
+
+/* ===========================
+   Retratos de sessão (salvar / restaurar / bifurcar)
+   =========================== */
+
+/*
+ * Retrato: o estado de uma partida num blob binário, sem strings.
+ *   byte 0      RETRATO_VERSAO
+ *   byte 1      RETRATO_* (encerrada, formato da seção de pistas)
+ *   varint      movimentos
+ *   varint      profundidade P (movimentos que entraram numa sala)
+ *   (P+7)/8     lado de cada movimento, bit k = 1: direita
+ *   pistas      lista: varint n + n varints de ids do catálogo, na ordem de coleta
+ *               bitset: varint b + b bytes (bit i = id i), sem zeros no fim,
+ *               + varint líder+1 (a ordem de coleta, que desempata, se perde)
+ * Sala atual e histórico saem do caminho. A seção de pistas (a menor das
+ * duas formas) só existe com coleção; sem ela, as pistas do caminho são
+ * coletadas de novo na restauração.
+ */
+
+#define RETRATO_VERSAO 1u
+#define RETRATO_ENCERRADA 1u
+#define RETRATO_LISTA 2u
+#define RETRATO_BITSET 4u
+
+/* varint LEB128: 7 bits por byte, o bit alto indica continuação */
+static size_t varint_tam(uint64_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+static unsigned char *varint_por(unsigned char *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+static int varint_ler(const unsigned char **p, const unsigned char *fim, uint64_t *v) {
+    uint64_t x = 0;
+    for (unsigned desl = 0; *p < fim && desl < 64; desl += 7) {
+        unsigned char b = *(*p)++;
+        x |= (uint64_t)(b & 0x7f) << desl;
+        if (!(b & 0x80)) {
+            *v = x;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * sessaoRetratar(s, ptr_len)
+ * Serializa a partida em andamento (ver o formato acima). O blob (liberar
+ * com free) não depende de endereços: vale para qualquer sessão sobre o
+ * mesmo mapa e catálogo. Retorna NULL se faltar memória.
+ */
+unsigned char *sessaoRetratar(const Sessao *s, size_t *len) {
+    size_t prof = s->n_hist ? s->n_hist - 1 : 0;
+    const ConjuntoPistas *c = s->colecao;
+    size_t lista = 0, bitset = 0, bytes_bits = 0;
+    if (c) {
+        uint32_t maior = 0;
+        lista = varint_tam(c->n);
+        for (size_t i = 0; i < c->n; ++i) {
+            lista += varint_tam(c->ids[i]);
+            if (c->ids[i] > maior) maior = c->ids[i];
+        }
+        bytes_bits = c->n ? maior / 8 + 1 : 0;
+        bitset = varint_tam(bytes_bits) + bytes_bits + varint_tam(s->lider + 1);
+    }
+    int usa_bitset = c && bitset < lista;
+    size_t cap = 2 + varint_tam(s->movimentos) + varint_tam(prof) + (prof + 7) / 8 +
+                 (c ? (usa_bitset ? bitset : lista) : 0);
+    unsigned char *blob = malloc(cap), *p = blob;
+    if (!blob) return NULL;
+    *p++ = RETRATO_VERSAO;
+    *p++ = (unsigned char)((s->encerrada ? RETRATO_ENCERRADA : 0) |
+                           (c ? (usa_bitset ? RETRATO_BITSET : RETRATO_LISTA) : 0));
+    p = varint_por(p, s->movimentos);
+    p = varint_por(p, prof);
+    if (prof) {
+        size_t arq = s->base / 8;
+        if (arq && sessao_ler_derrame(s, p, 0, arq) != 0) {
+            free(blob);
+            return NULL;
+        }
+        memcpy(p + arq, s->caminho, (prof + 7) / 8 - arq);
+    }
+    if (prof % 8) p[prof / 8] &= (unsigned char)((1u << (prof % 8)) - 1);
+    p += (prof + 7) / 8;
+    if (usa_bitset) {
+        size_t b = bytes_bits;
+        p = varint_por(p, b);
+        memset(p, 0, b);
+        for (size_t i = 0; i < c->n; ++i) p[c->ids[i] / 8] |= (unsigned char)(1u << (c->ids[i] % 8));
+        p += b;
+        p = varint_por(p, s->lider + 1);
+    } else if (c) {
+        p = varint_por(p, c->n);
+        for (size_t i = 0; i < c->n; ++i) p = varint_por(p, c->ids[i]);
+    }
+    *len = (size_t)(p - blob);
+    return blob;
+}
+
+/* pista de id 'id' entra na coleção da sessão (com voto, se for nova) */
+static int sessao_coletar_id(Sessao *s, uint64_t id) {
+    const Catalogo *cat = s->colecao->cat;
+    if (id >= cat->n) return -1;
+    int nova = conjunto_ligar(s->colecao, (uint32_t)id);
+    if (nova < 0) return -1;
+    if (nova && cat->suspeito[id] != CATALOGO_NENHUMA) sessao_votar_pos(s, cat->suspeito[id]);
+    return 0;
+}
+
+/**
+ * sessaoRestaurar(s, blob, len)
+ * Refaz na sessão 's' (preparada sobre o mesmo mapa; com coleção se o
+ * retrato tiver pistas) a partida de 'blob', em O(len): desce o caminho
+ * registrando o histórico e liga as pistas pelos ids. Nada é mostrado.
+ * Retorna -1 se o blob for inválido para este mapa (a sessão precisa então
+ * de sessaoReiniciar).
+ */
+int sessaoRestaurar(Sessao *s, const unsigned char *blob, size_t len) {
+    const unsigned char *p = blob, *fim = blob + len;
+    uint64_t movs, prof;
+    if (len < 2 || p[0] != RETRATO_VERSAO) return -1;
+    unsigned flags = p[1];
+    p += 2;
+    if ((flags & ~7u) || (flags & (RETRATO_LISTA | RETRATO_BITSET)) == (RETRATO_LISTA | RETRATO_BITSET) ||
+        varint_ler(&p, fim, &movs) != 0 || varint_ler(&p, fim, &prof) != 0 ||
+        prof > (uint64_t)(fim - p) * 8)
+        return -1;
+    int com_pistas = (flags & (RETRATO_LISTA | RETRATO_BITSET)) != 0;
+    if (com_pistas && !s->colecao) return -1;
+    const unsigned char *lados = p;
+    p += (prof + 7) / 8;
+    if (sessao_limpar(s) != 0 || !s->atual) return -1;
+
+    /* caminho: histórico e sala atual; sem a seção, as pistas dele */
+    const MapaOps *op = s->mapa->ops;
+    for (uint64_t k = 0;; ++k) {
+        int lado = k ? (lados[(k - 1) / 8] >> ((k - 1) % 8)) & 1 : -1;
+        if (sessao_registrar(s, lado) != 0) return -1;
+        const char *pista = com_pistas ? NULL : op->pista(s->mapa->dados, s->atual);
+        if (pista && pista[0] != '\0') sessao_coletar(s, pista);
+        if (k == prof) break;
+        int prox_lado = (lados[k / 8] >> (k % 8)) & 1;
+        NoMapa prox = prox_lado ? op->dir(s->mapa->dados, s->atual) : op->esq(s->mapa->dados, s->atual);
+        if (!prox) return -1;
+        s->atual = prox;
+    }
+
+    uint64_t n, id;
+    if (flags & RETRATO_LISTA) {
+        if (varint_ler(&p, fim, &n) != 0) return -1;
+        for (uint64_t i = 0; i < n; ++i)
+            if (varint_ler(&p, fim, &id) != 0 || sessao_coletar_id(s, id) != 0) return -1;
+    } else if (flags & RETRATO_BITSET) {
+        if (varint_ler(&p, fim, &n) != 0 || n > (uint64_t)(fim - p)) return -1;
+        for (uint64_t b = 0; b < n; ++b)
+            for (unsigned x = p[b]; x; x &= x - 1)
+                if (sessao_coletar_id(s, b * 8 + (unsigned)bits_primeiro(x)) != 0) return -1;
+        p += n;
+        if (varint_ler(&p, fim, &id) != 0) return -1;
+        if (id && id - 1 < s->cap_votos && s->lider != SUSPEITO_NENHUM &&
+            s->votos[id - 1] == s->votos[s->lider])
+            s->lider = (size_t)(id - 1);
+    }
+    if (p != fim) return -1;
+    s->movimentos = (size_t)movs;
+    s->encerrada = (flags & RETRATO_ENCERRADA) != 0;
+    return 0;
+}
+
+static void sessao_copiar_pista(PistaNode *n, void *ctx) {
+    Sessao *s = ctx;
+    int nova;
+    s->pistas = pista_inserir(s->arena, s->pistas, n->pista, &nova);
+}
+
+/**
+ * sessaoBifurcar(filho, pai, colecao)
+ * 'filho' continua do ponto onde 'pai' está (mesmo mapa, saída e arena).
+ * Caminho e bitset de pistas ficam divididos até a primeira escrita de
+ * qualquer um dos dois (copy-on-write): bifurcar custa os contadores por
+ * suspeito e os ids coletados. Com coleção no pai, 'colecao' recebe a do
+ * filho (conjuntoLiberar depois de sessaoLiberar); sem ela, a BST do pai é
+ * copiada na arena. Retorna 0 em sucesso, -1 se faltar memória ou se o pai
+ * derrama o caminho num arquivo (o filho então não é criado).
+ */
+int sessaoBifurcar(Sessao *filho, const Sessao *pai, ConjuntoPistas *colecao) {
+    if (pai->derrame) return -1;
+    *filho = *pai;
+    filho->caminho = cow_compartilhar(pai->caminho);
+    filho->votos = NULL;
+    filho->acusaveis = NULL;
+    filho->cap_votos = 0;
+    filho->colecao = NULL;
+    filho->pistas = NULL;
+    if (pai->cap_votos) {
+        filho->votos = malloc(pai->cap_votos * sizeof(uint32_t));
+        filho->acusaveis = malloc(pai->cap_votos * sizeof(size_t));
+        if (!filho->votos || !filho->acusaveis) goto erro;
+        memcpy(filho->votos, pai->votos, pai->cap_votos * sizeof(uint32_t));
+        memcpy(filho->acusaveis, pai->acusaveis, pai->n_acusaveis * sizeof(size_t));
+        filho->cap_votos = pai->cap_votos;
+    }
+    if (pai->colecao) {
+        if (!colecao || conjuntoBifurcar(colecao, pai->colecao) != 0) goto erro;
+        filho->colecao = colecao;
+    }
+    pista_percorrer(pai->pistas, sessao_copiar_pista, filho);
+    return 0;
+
+erro:
+    sessaoLiberar(filho);
+    return -1;
+}
+
+/* ===========================
+   Verificação final (julgamento)
+   =========================== */
+
+/* contexto da contagem durante a travessia */
+typedef struct ContagemCtx {
+    HashTable *ht;
+    const SuspeitoSet *sus;
+    uint32_t *cont;
+} ContagemCtx;
+
+static void contar_pista_visita(PistaNode *n, void *ctx) {
+    ContagemCtx *c = ctx;
+    char *sus = encontrarSuspeito(c->ht, n->pista);
+    size_t p = sus ? suspeito_pos(c->sus, sus) : SUSPEITO_NENHUM;
+    if (p != SUSPEITO_NENHUM) c->cont[p] += 1;
+}
+
+/**
+ * contar_pistas_por_suspeito(raiz, ht)
+ * Atravessa a BST de pistas e conta quantas apontam para cada suspeito.
+ * Retorna um vetor indexado pelas posições de hashSuspeitos(ht) (liberar
+ * com mem_free), ou NULL se faltar memória.
+ */
+uint32_t *contar_pistas_por_suspeito(PistaNode *raiz, HashTable *ht) {
+    const SuspeitoSet *sus = hashSuspeitos(ht);
+    ContagemCtx c = { ht, sus, mem_calloc(sus->n ? sus->n : 1, sizeof(uint32_t)) };
+    if (!c.cont) return NULL;
+    pista_percorrer(raiz, contar_pista_visita, &c);
+    return c.cont;
+}
+
+/* resultado de uma acusação */
+typedef enum Veredito {
+    VEREDITO_CANCELADO,      /* nenhum nome informado */
+    VEREDITO_IMPROCEDENTE,   /* nenhuma pista coletada aponta para o nome */
+    VEREDITO_INOCENTADO,     /* menos de 2 pistas */
+    VEREDITO_CULPADO         /* 2 pistas ou mais */
+} Veredito;
+
+/**
+ * julgarAcusacao(pistasRoot, ht, acusado, ptr_cont)
+ * Julgamento sem interação: conta as pistas coletadas que apontam para
+ * 'acusado' (sem diferenciar maiúsculas/minúsculas) e guarda o total em
+ * *cont (se cont != NULL).
+ */
+Veredito julgarAcusacao(PistaNode *pistasRoot, HashTable *ht, const char *acusado, int *cont) {
+    if (cont) *cont = 0;
+    if (!acusado || acusado[0] == '\0') return VEREDITO_CANCELADO;
+
+    /* contar quantas pistas apontam para cada suspeito */
+    uint32_t *contagem = contar_pistas_por_suspeito(pistasRoot, ht);
+    if (!contagem) return VEREDITO_CANCELADO;
+
+    /* primeiro suspeito com pistas cujo nome normalizado bate */
+    const IndiceNomes *ix = hashIndiceNomes(ht);
+    size_t ini, fim;
+    int achou = 0;
+    int n = 0;
+    indiceNomesBuscar(ix, acusado, &ini, &fim);
+    for (size_t i = ini; i < fim; ++i) {
+        if (contagem[ix->ordem[i]]) {
+            achou = 1;
+            n = (int)contagem[ix->ordem[i]];
+            break;
+        }
+    }
+    mem_free(contagem);
+
+    if (cont) *cont = n;
+    if (!achou) return VEREDITO_IMPROCEDENTE;
+    return n >= 2 ? VEREDITO_CULPADO : VEREDITO_INOCENTADO;
+}
+
+/* imprime o resultado do julgamento */
+static void imprimir_veredito(Saida *out, Veredito v, const char *acusado, int cont) {
+    switch (v) {
+    case VEREDITO_CANCELADO:
+        saida_lit(out, "Nenhum nome informado. Acusação cancelada.\n");
+        break;
+    case VEREDITO_IMPROCEDENTE:
+        saida_lit(out, "\nO nome '");
+        saida_texto(out, acusado);
+        saida_lit(out, "' não corresponde a nenhum suspeito com pistas coletadas.\n"
+                       "Resultado: Acusação improcedente.\n");
+        break;
+    default:
+        saida_lit(out, "\nVocê acusou: ");
+        saida_texto(out, acusado);
+        saida_lit(out, "\nNúmero de pistas que apontam para esse suspeito: ");
+        saida_uint(out, (size_t)cont);
+        saida_char(out, '\n');
+        if (v == VEREDITO_CULPADO) {
+            saida_lit(out, "Veredito: Você reuniu evidências suficientes. Suspeito considerado CULPADO.\n");
+        } else {
+            saida_lit(out, "Veredito: Evidências insuficientes (são necessárias pelo menos 2 pistas). Suspeito inocentado.\n");
+        }
+        break;
+    }
+}
+
+/**
+ * sessaoJulgar(s, acusado, ptr_cont)
+ * Como julgarAcusacao, mas com os contadores que a sessão mantém durante a
+ * exploração: o nome é achado com uma sondagem no índice normalizado.
+ */
+Veredito sessaoJulgar(const Sessao *s, const char *acusado, int *cont) {
+    if (cont) *cont = 0;
+    if (!acusado || acusado[0] == '\0') return VEREDITO_CANCELADO;
+    const IndiceNomes *ix = hashIndiceNomes(s->ht);
+    size_t ini, fim;
+    indiceNomesBuscar(ix, acusado, &ini, &fim);
+    for (size_t i = ini; i < fim; ++i) {
+        size_t p = ix->ordem[i];
+        if (p < s->cap_votos && s->votos[p]) {
+            if (cont) *cont = (int)s->votos[p];
+            return s->votos[p] >= 2 ? VEREDITO_CULPADO : VEREDITO_INOCENTADO;
+        }
+    }
+    return VEREDITO_IMPROCEDENTE;
+}
+
+/* nome digitado que não bate com nenhum suspeito: se for o começo de um só,
+   completa; se for de vários, sugere */
+static void acusacao_completar(Saida *out, HashTable *ht, char *buf, size_t tam) {
+    const IndiceNomes *ix = hashIndiceNomes(ht);
+    const SuspeitoSet *c = &ht->sus;
+    size_t ini, fim, unico = SUSPEITO_NENHUM, vivos = 0;
+    if (buf[0] == '\0' || indiceNomesBuscar(ix, buf, &ini, &fim) > 0) return;
+    indiceNomesPrefixo(ix, buf, &ini, &fim);
+    for (size_t i = ini; i < fim; ++i) {
+        size_t p = ix->ordem[i];
+        if (!c->refs[p]) continue;
+        if (vivos++ == 0) unico = p;
+    }
+    if (vivos == 1 && strlen(c->nomes[unico]) < tam) {
+        strcpy(buf, c->nomes[unico]);
+        saida_lit(out, "(completado: ");
+        saida_texto(out, buf);
+        saida_lit(out, ")\n");
+    } else if (vivos > 1) {
+        saida_lit(out, "(sugestões:");
+        for (size_t i = ini, k = 0; i < fim && k < 8; ++i) {
+            if (!c->refs[ix->ordem[i]]) continue;
+            saida_texto(out, k++ ? ", " : " ");
+            saida_texto(out, c->nomes[ix->ordem[i]]);
+        }
+        saida_texto(out, vivos > 8 ? ", ...)\n" : ")\n");
+    }
+}
+
+/* mostra pistas e suspeitos e pede o nome acusado; 0 = não há o que acusar */
+static int acusacao_mostrar(Saida *out, PistaNode *pistasRoot, const ConjuntoPistas *colecao,
+                            HashTable *ht) {
+    if (!pistasRoot && (!colecao || colecao->n == 0)) {
+        saida_lit(out, "\nVocê não coletou pistas suficientes para acusar alguém.\n");
+        return 0;
+    }
+
+    /* mostrar as pistas coletadas */
+    saida_lit(out, "\nPistas coletadas (em ordem):\n");
+    if (colecao) conjuntoExibir(out, colecao);
+    exibirPistas(out, pistasRoot);
+
+    /* mostrar suspeitos conhecidos para ajudar o jogador */
+    saida_char(out, '\n');
+    listarSuspeitosHash(out, ht);
+
+    /* solicitar acusação */
+    saida_lit(out, "\nQuem você acusa? Digite o nome do suspeito: ");
+    return 1;
+}
+
+/* mostra pistas e suspeitos e lê o nome acusado; 0 = não há o que acusar */
+static int acusacao_pedir(Saida *out, PistaNode *pistasRoot, const ConjuntoPistas *colecao,
+                          HashTable *ht, char *buf, size_t tam) {
+    if (!acusacao_mostrar(out, pistasRoot, colecao, ht)) return 0;
+    ler_linha_de(out, buf, tam);
+    acusacao_completar(out, ht, buf, tam);
+    return 1;
+}
+
+/**
+ * verificarSuspeitoFinal(out, pistasRoot, ht)
+ * Pede ao jogador para acusar um suspeito; verifica se há pelo menos 2 pistas
+ * que apontem para esse suspeito e imprime o resultado do julgamento.
+ */
+void verificarSuspeitoFinal(Saida *out, PistaNode *pistasRoot, HashTable *ht) {
+    char buf[128];
+    if (!acusacao_pedir(out, pistasRoot, NULL, ht, buf, sizeof(buf))) return;
+    int cont = 0;
+    Veredito v = julgarAcusacao(pistasRoot, ht, buf, &cont);
+    imprimir_veredito(out, v, buf, cont);
+}
+
+/* julga o nome digitado (já completado) com os contadores da sessão */
+static Veredito sessao_acusar(Sessao *s, char *buf) {
+    int cont = 0;
+    Veredito v = sessaoJulgar(s, buf, &cont);
+    imprimir_veredito(s->out, v, buf, cont);
+    return v;
+}
+
+/* verificarSuspeitoSessao(s): o mesmo, usando os contadores da sessão */
+void verificarSuspeitoSessao(Sessao *s) {
+    char buf[128];
+    if (!acusacao_pedir(s->out, s->pistas, s->colecao, s->ht, buf, sizeof(buf))) return;
+    sessao_acusar(s, buf);
+}
+
+/* ===========================
+   Partida passo a passo (uma entrada, uma resposta)
+   =========================== */
+
+/*
+ * A mesma partida de jogarSessao + verificarSuspeitoSessao, sem ler nada:
+ * quem chama entrega uma linha de cada vez a partidaPasso e recebe em
+ * s.out a resposta inteira, terminando no próximo prompt. Serve a um
+ * laço de eventos com milhares de partidas abertas (ver servidorJogo).
+ */
+
+typedef enum FasePartida {
+    PARTIDA_EXPLORANDO = 0,    /* espera um comando ('e', 'd', 'p', 's') */
+    PARTIDA_ACUSANDO,          /* espera o nome do acusado */
+    PARTIDA_FIM                /* veredito dado (ou nada a acusar) */
+} FasePartida;
+
+typedef struct Partida {
+    Sessao s;                  /* preparada por quem chama (sessaoPreparar) */
+    FasePartida fase;
+    Veredito veredito;         /* PARTIDA_FIM depois de uma acusação */
+    int acusou;
+} Partida;
+
+/* exploração encerrada: pede a acusação, se houver o que acusar */
+static FasePartida partida_acusacao(Partida *p) {
+    Sessao *s = &p->s;
+    p->fase = acusacao_mostrar(s->out, s->pistas, s->colecao, s->ht) ? PARTIDA_ACUSANDO
+                                                                     : PARTIDA_FIM;
+    return p->fase;
+}
+
+/**
+ * partidaComecar(p)
+ * (Re)começa a partida na raiz e escreve a primeira resposta: a sala
+ * inicial e o menu. Retorna a fase (PARTIDA_FIM só com o mapa vazio).
+ */
+FasePartida partidaComecar(Partida *p) {
+    p->acusou = 0;
+    p->veredito = VEREDITO_CANCELADO;
+    p->fase = PARTIDA_EXPLORANDO;
+    if (sessaoReiniciar(&p->s, NULL) != 0) return partida_acusacao(p);
+    sessao_menu(&p->s);
+    return p->fase;
+}
+
+/**
+ * partidaPasso(p, linha)
+ * Consome uma linha do jogador ('linha' NULL = fim da entrada: sai da
+ * exploração ou cancela a acusação) e escreve a resposta. Não bloqueia.
+ * Retorna a fase seguinte.
+ */
+FasePartida partidaPasso(Partida *p, const char *linha) {
+    Sessao *s = &p->s;
+    if (p->fase == PARTIDA_EXPLORANDO) {
+        if (sessao_passo(s, linha)) partida_acusacao(p);
+    } else if (p->fase == PARTIDA_ACUSANDO) {
+        char buf[128];
+        size_t n = linha ? strlen(linha) : 0;
+        if (n >= sizeof(buf)) n = sizeof(buf) - 1;
+        memcpy(buf, linha ? linha : "", n);
+        buf[n] = '\0';
+        acusacao_completar(s->out, s->ht, buf, sizeof(buf));
+        p->veredito = sessao_acusar(s, buf);
+        p->acusou = 1;
+        p->fase = PARTIDA_FIM;
+    }
+    return p->fase;
+}
+
+/* ===========================
+   Partidas gravadas (replay)
+   =========================== */
+
+/* totais de uma execução de partidas gravadas */
+typedef struct ReplayStats {
+    size_t partidas;
+    size_t movimentos;
+    size_t vereditos[4];       /* indexado por Veredito */
+    size_t sem_acusacao;
+    double segundos;
+} ReplayStats;
+
+/**
+ * replayPartida(s, linha, st)
+ * Joga uma partida gravada na sessão 's', sem prompts: 'linha' é a sequência
+ * de comandos ("eeds"; espaços são ignorados), opcionalmente seguida de ':'
+ * e do nome do acusado ("ed:Empregado"). Se não houver 's', a partida
+ * termina quando os comandos acabam. Retorna -1 se o mapa estiver vazio.
+ */
+int replayPartida(Sessao *s, const char *linha, ReplayStats *st) {
+    INSTR_FASE(t_explorar);
+    if (sessaoReiniciar(s, NULL) != 0) return -1;
+    const char *p = linha;
+    for (; *p && *p != ':'; ++p) {
+        if (isspace((unsigned char)*p)) continue;
+        if (sessaoComando(s, (char)tolower((unsigned char)*p))) break;
+    }
+    while (*p && *p != ':') ++p;
+    sessaoHistorico(s);
+    INSTR_FASE_FIM(t_explorar, CONT_NS_EXPLORACAO);
+    st->partidas += 1;
+    st->movimentos += s->movimentos;
+    if (*p != ':') {
+        st->sem_acusacao += 1;
+        return 0;
+    }
+
+    /* nome do acusado, sem brancos nas pontas */
+    char nome[128];
+    ++p;
+    while (isspace((unsigned char)*p)) ++p;
+    size_t len = strlen(p);
+    while (len > 0 && isspace((unsigned char)p[len - 1])) --len;
+    if (len >= sizeof(nome)) len = sizeof(nome) - 1;
+    memcpy(nome, p, len);
+    nome[len] = '\0';
+
+    INSTR_FASE(t_veredito);
+    int cont = 0;
+    Veredito v = sessaoJulgar(s, nome, &cont);
+    st->vereditos[v] += 1;
+    if (!s->quieto) imprimir_veredito(s->out, v, nome, cont);
+    INSTR_FASE_FIM(t_veredito, CONT_NS_VEREDITO);
+    return 0;
+}
+
+/* resumo de uma execução em stderr */
+void replayRelatorio(const ReplayStats *st) {
+    double seg = st->segundos > 0 ? st->segundos : 1e-9;
+    fprintf(stderr, "[replay] %zu partidas, %zu comandos em %.3f s "
+            "(%.0f partidas/s, %.1f ns/comando)\n",
+            st->partidas, st->movimentos, st->segundos, (double)st->partidas / seg,
+            st->movimentos ? st->segundos * 1e9 / (double)st->movimentos : 0.0);
+    fprintf(stderr, "[replay] culpados=%zu inocentados=%zu improcedentes=%zu "
+            "canceladas=%zu sem acusação=%zu\n",
+            st->vereditos[VEREDITO_CULPADO], st->vereditos[VEREDITO_INOCENTADO],
+            st->vereditos[VEREDITO_IMPROCEDENTE], st->vereditos[VEREDITO_CANCELADO],
+            st->sem_acusacao);
+}
+
+/* entre partidas: com 'comandos' jogados o catálogo já compensa? Monta uma
+   vez só (sem ele, ou sem memória, a sessão segue na BST) */
+static void replay_talvez_catalogo(Sessao *s, ConjuntoPistas *c, Catalogo **cat, int *tentou,
+                                   size_t comandos) {
+    if (*tentou || !catalogo_compensa(s->ht, comandos)) return;
+    *tentou = 1;
+    *cat = catalogoMontar(s->mapa, s->ht);
+    if (*cat && conjuntoIniciar(c, *cat) == 0) s->colecao = c;
+}
+
+/**
+ * executarReplay(out, mapa, ht, movs, arquivo, repeticoes, quieto, derrame)
+ * Joga 'repeticoes' vezes as partidas gravadas: a sequência 'movs' (linha de
+ * comando) ou cada linha de 'arquivo' ("-" = stdin, lido uma vez só; linhas
+ * vazias e começadas por '#' são ignoradas). As pistas de cada partida vão
+ * para uma arena reaproveitada entre partidas (BST) até os comandos jogados
+ * pagarem o catálogo (catalogo_compensa); daí em diante, para o bitset da
+ * sessão. 'derrame' (ou NULL) vai para sessaoDerramar. Retorna 0 em
+ * sucesso.
+ */
+int executarReplay(Saida *out, Mapa *mapa, HashTable *ht, const char *movs,
+                   const char *arquivo, size_t repeticoes, int quieto, FILE *derrame) {
+    ReplayStats st;
+    memset(&st, 0, sizeof(st));
+    Arena *partida = arena_criar(0);
+    Catalogo *cat = NULL;
+    ConjuntoPistas colecao;
+    FILE *f = NULL;
+    LeitorLinhas l;
+    Sessao s;
+    int ret = -1, tentou_catalogo = 0;
+    memset(&l, 0, sizeof(l));
+    memset(&colecao, 0, sizeof(colecao));
+    sessaoPreparar(&s, out, mapa, ht, partida, quieto);
+    sessaoDerramar(&s, derrame);
+    if (!partida) goto fim;
+    if (arquivo) {
+        f = strcmp(arquivo, "-") == 0 ? stdin : fopen(arquivo, "rb");
+        if (!f) {
+            fprintf(stderr, "Erro: não foi possível abrir '%s'.\n", arquivo);
+            goto fim;
+        }
+        if (f == stdin) repeticoes = 1;
+        if (leitor_abrir(&l, f) != 0) goto fim;
+    }
+
+    double t0 = agora_seg();
+    for (size_t r = 0; r < repeticoes; ++r) {
+        if (!arquivo) {
+            replay_talvez_catalogo(&s, &colecao, &cat, &tentou_catalogo, st.movimentos);
+            arena_reiniciar(partida);
+            if (replayPartida(&s, movs, &st) != 0) goto fim;
+            continue;
+        }
+        if (r > 0) leitor_rebobinar(&l);
+        char *linha;
+        while ((linha = leitor_proxima(&l))) {
+            if (linha[0] == '\0' || linha[0] == '#') continue;
+            replay_talvez_catalogo(&s, &colecao, &cat, &tentou_catalogo, st.movimentos);
+            arena_reiniciar(partida);
+            if (replayPartida(&s, linha, &st) != 0) goto fim;
+        }
+    }
+    saidaDescarregar(out);
+    st.segundos = agora_seg() - t0;
+    replayRelatorio(&st);
+    ret = 0;
+
+fim:
+    sessaoLiberar(&s);
+    conjuntoLiberar(&colecao);
+    catalogoLiberar(cat);
+    free(l.buf);
+    if (f && f != stdin) fclose(f);
+    arena_liberar(partida);
+    return ret;
+}
+
+/* ===========================
+   Sessões em paralelo
+   =========================== */
+
+/* sessões que uma thread pega de cada vez do contador compartilhado */
+#define PARALELO_LOTE 256
+
+/**
+ * prepararCompartilhado(mapa, ht)
+ * Deixa mapa e hash prontos para leitura simultânea: monta agora o que
+ * seria montado no primeiro uso (conjunto e índice de suspeitos) e interna
+ * todas as pistas do mapa, para que as sessões só consultem o interner.
+ * Depois disso as sessões não escrevem em nada compartilhado.
+ * Retorna 0 em sucesso.
+ */
+int prepararCompartilhado(Mapa *mapa, HashTable *ht) {
+    const MapaOps *op = mapa->ops;
+    if (!interner_padrao() || !hashIndiceNomes(ht)) return -1;
+    NoMapa *pilha = NULL;
+    size_t k = 0, cap = 0;
+    NoMapa raiz = op->raiz(mapa->dados);
+    if (raiz) {
+        cap = 64;
+        pilha = malloc(cap * sizeof(NoMapa));
+        if (!pilha) return -1;
+        pilha[k++] = raiz;
+    }
+    while (k > 0) {
+        NoMapa n = pilha[--k];
+        const char *pista = op->pista(mapa->dados, n);
+        if (pista && pista[0] != '\0' && !intern(pista)) break;
+        if (k + 2 > cap) {
+            NoMapa *tmp = realloc(pilha, cap * 2 * sizeof(NoMapa));
+            if (!tmp) break;
+            pilha = tmp;
+            cap *= 2;
+        }
+        NoMapa e = op->esq(mapa->dados, n), d = op->dir(mapa->dados, n);
+        if (d) pilha[k++] = d;
+        if (e) pilha[k++] = e;
+    }
+    free(pilha);
+    return k == 0 ? 0 : -1;
+}
+
+/* estado compartilhado pelas threads: só 'proxima' é escrito */
+typedef struct PoolSessoes {
+    Mapa *mapa;
+    HashTable *ht;
+    const Catalogo *cat;           /* pistas do mapa (NULL = BST em cada sessão) */
+    const char *const *partidas;   /* partidas gravadas, usadas em ciclo */
+    size_t n_partidas;
+    size_t total;                  /* sessões a jogar */
+    atomic_size_t proxima;         /* próxima sessão a distribuir */
+} PoolSessoes;
+
+/* uma thread do pool: sessão, arena e totais próprios */
+typedef struct Trabalhador {
+    PoolSessoes *pool;
+    ReplayStats st;
+    int erro;
+#ifdef DQ_POSIX
+    pthread_t th;
+#endif
+} Trabalhador;
+
+static void *trabalhador_rodar(void *arg) {
+    Trabalhador *t = arg;
+    PoolSessoes *p = t->pool;
+    Arena *arena = arena_criar(0);
+    ConjuntoPistas colecao;
+    Sessao s;
+    memset(&colecao, 0, sizeof(colecao));
+    sessaoPreparar(&s, NULL, p->mapa, p->ht, arena, 1);
+    if (!arena || (p->cat && conjuntoIniciar(&colecao, p->cat) != 0)) {
+        t->erro = 1;
+        conjuntoLiberar(&colecao);
+        arena_liberar(arena);
+        return NULL;
+    }
+    if (p->cat) s.colecao = &colecao;
+    for (;;) {
+        size_t ini = atomic_fetch_add_explicit(&p->proxima, PARALELO_LOTE, memory_order_relaxed);
+        if (ini >= p->total) break;
+        size_t fim = p->total - ini < PARALELO_LOTE ? p->total : ini + PARALELO_LOTE;
+        for (size_t i = ini; i < fim; ++i) {
+            arena_reiniciar(arena);
+            if (replayPartida(&s, p->partidas[i % p->n_partidas], &t->st) != 0) {
+                t->erro = 1;
+                goto sair;
+            }
+        }
+    }
+sair:
+    sessaoLiberar(&s);
+    conjuntoLiberar(&colecao);
+    arena_liberar(arena);
+    return NULL;
+}
+
+/* soma os totais de uma thread aos do pool */
+static void replay_somar(ReplayStats *dst, const ReplayStats *src) {
+    dst->partidas += src->partidas;
+    dst->movimentos += src->movimentos;
+    dst->sem_acusacao += src->sem_acusacao;
+    for (size_t v = 0; v < 4; ++v) dst->vereditos[v] += src->vereditos[v];
+}
+
+/**
+ * executarParalelo(mapa, ht, partidas, n_partidas, total, n_threads, st)
+ * Joga 'total' sessões silenciosas (as partidas gravadas, em ciclo) em
+ * 'n_threads' threads. Cada thread tem a sua Sessao, o seu bitset de pistas
+ * e a sua arena; mapa, hash e catálogo são só lidos (chamar prepararCompartilhado antes) e as sessões são
+ * distribuídas em lotes por um contador atômico, sem travas. Sem POSIX,
+ * tudo roda na thread atual. Totais e tempo ficam em *st.
+ */
+int executarParalelo(Mapa *mapa, HashTable *ht, const char *const *partidas, size_t n_partidas,
+                     size_t total, int n_threads, ReplayStats *st) {
+    memset(st, 0, sizeof(*st));
+    if (n_partidas == 0) return 0;
+#ifndef DQ_POSIX
+    n_threads = 1;
+#endif
+    if (n_threads < 1) n_threads = 1;
+    Trabalhador *ts = calloc((size_t)n_threads, sizeof(Trabalhador));
+    if (!ts) return -1;
+    /* catálogo compartilhado (só lido); cada thread tem o seu bitset */
+    Catalogo *cat = catalogoMontar(mapa, ht);
+    PoolSessoes pool = { mapa, ht, cat, partidas, n_partidas, total, 0 };
+    atomic_init(&pool.proxima, 0);
+
+    double t0 = agora_seg();
+    int iniciadas = 0;
+    for (int i = 0; i < n_threads; ++i) ts[i].pool = &pool;
+#ifdef DQ_POSIX
+    /* a thread atual é o trabalhador 0 */
+    for (int i = 1; i < n_threads; ++i, ++iniciadas)
+        if (pthread_create(&ts[i].th, NULL, trabalhador_rodar, &ts[i]) != 0) break;
+#endif
+    trabalhador_rodar(&ts[0]);
+#ifdef DQ_POSIX
+    for (int i = 1; i <= iniciadas; ++i) pthread_join(ts[i].th, NULL);
+#endif
+    st->segundos = agora_seg() - t0;
+
+    int ret = 0;
+    for (int i = 0; i <= iniciadas; ++i) {
+        replay_somar(st, &ts[i].st);
+        if (ts[i].erro) ret = -1;
+    }
+    free(ts);
+    catalogoLiberar(cat);
+    return ret;
+}
+
+/* lê as partidas gravadas de 'arquivo' (linhas vazias e '#' ignoradas) para
+   a arena; o vetor de ponteiros é do chamador (free) */
+static const char **carregar_partidas(const char *arquivo, Arena *a, size_t *n) {
+    FILE *f = strcmp(arquivo, "-") == 0 ? stdin : fopen(arquivo, "rb");
+    LeitorLinhas l;
+    const char **v = NULL;
+    size_t cap = 0;
+    *n = 0;
+    if (!f) {
+        fprintf(stderr, "Erro: não foi possível abrir '%s'.\n", arquivo);
+        return NULL;
+    }
+    if (leitor_abrir(&l, f) == 0) {
+        char *linha;
+        while ((linha = leitor_proxima(&l))) {
+            if (linha[0] == '\0' || linha[0] == '#') continue;
+            if (*n == cap) {
+                cap = cap ? cap * 2 : 64;
+                const char **tmp = realloc((void *)v, cap * sizeof(char *));
+                if (!tmp) break;
+                v = tmp;
+            }
+            if (!(v[*n] = arena_strdup(a, linha))) break;
+            *n += 1;
+        }
+        free(l.buf);
+    }
+    if (f != stdin) fclose(f);
+    return v;
+}
+
+/**
+ * executarReplayParalelo(mapa, ht, movs, arquivo, repeticoes, n_threads)
+ * Como executarReplay, mas silencioso e com as partidas repartidas entre
+ * 'n_threads' threads. O arquivo é lido para a memória antes de começar.
+ */
+int executarReplayParalelo(Mapa *mapa, HashTable *ht, const char *movs, const char *arquivo,
+                           size_t repeticoes, int n_threads) {
+    Arena *a = arena_criar(0);
+    const char **partidas = NULL;
+    size_t n = 0;
+    int ret = -1;
+    if (!a) return -1;
+    if (arquivo) {
+        partidas = carregar_partidas(arquivo, a, &n);
+    } else if ((partidas = malloc(sizeof(char *)))) {
+        partidas[0] = movs;
+        n = 1;
+    }
+    if (partidas && prepararCompartilhado(mapa, ht) == 0) {
+        ReplayStats st;
+        ret = executarParalelo(mapa, ht, partidas, n, n * repeticoes, n_threads, &st);
+        fprintf(stderr, "[replay] %d thread(s)\n", n_threads);
+        replayRelatorio(&st);
+    }
+    free((void *)partidas);
+    arena_liberar(a);
+    return ret;
+}
+
+/**
+ * benchSessoes(mapa, ht, total, max_threads)
+ * Gera partidas aleatórias (semente fixa) sobre o caso carregado e mede
+ * sessões/s com 1, 2, 4... threads até 'max_threads' (0 = núcleos).
+ */
+int benchSessoes(Mapa *mapa, HashTable *ht, size_t total, int max_threads) {
+    enum { N_PARTIDAS = 4096 };
+    const SuspeitoSet *c = hashSuspeitos(ht);
+    Arena *a = arena_criar(0);
+    const char **partidas = malloc(N_PARTIDAS * sizeof(char *));
+    int ret = -1;
+    if (!a || !partidas || prepararCompartilhado(mapa, ht) != 0) goto fim;
+
+    /* até 12 movimentos e a acusação de um suspeito qualquer */
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < N_PARTIDAS; ++i) {
+        char buf[160];
+        size_t n = 0;
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        size_t movs = 1 + x % 12;
+        for (size_t k = 0; k < movs; ++k) buf[n++] = (x >> (8 + 2 * k)) & 1 ? 'd' : 'e';
+        buf[n++] = 's';
+        buf[n] = '\0';
+        if (c->n) snprintf(buf + n, sizeof(buf) - n, ":%s", c->nomes[(x >> 40) % c->n]);
+        if (!(partidas[i] = arena_strdup(a, buf))) goto fim;
+    }
+
+    int max = max_threads > 0 ? max_threads : nucleos_disponiveis();
+    printf("Sessões em paralelo: %zu sessões por rodada, %d núcleo(s), até %d thread(s)\n",
+           total, nucleos_disponiveis(), max);
+    double base = 0;
+    for (int t = 1;; t = t * 2 > max && t < max ? max : t * 2) {
+        ReplayStats st;
+        if (executarParalelo(mapa, ht, partidas, N_PARTIDAS, total, t, &st) != 0) goto fim;
+        double vazao = (double)st.partidas / (st.segundos > 0 ? st.segundos : 1e-9);
+        if (t == 1) base = vazao;
+        printf("  threads=%-3d %12.0f sessões/s  %8.1f ns/sessão  speedup %5.2fx\n",
+               t, vazao, 1e9 / vazao, vazao / base);
+        if (t >= max) break;
+    }
+    ret = 0;
+
+fim:
+    free((void *)partidas);
+    arena_liberar(a);
+    return ret;
+}
+
+/* ===========================
+   Julgamento em lote (análise de partidas)
+   =========================== */
+
+/*
+ * Partidas já terminadas julgadas de uma vez, sem Sessao nem BST: cada
+ * partida é um bitset de pistas pelos ids do catálogo (o mesmo layout de
+ * ConjuntoPistas.bits, cat->palavras palavras) e o nome acusado. A contagem
+ * é o popcount do bitset com a máscara do suspeito; as partidas são
+ * repartidas em faixas contíguas entre as threads.
+ */
+
+/* nomes lembrados por thread (os acusados de um lote se repetem muito) */
+#define LOTE_CACHE_NOMES 64
+
+/* totais de julgarLote */
+typedef struct LoteStats {
+    size_t partidas;
+    size_t vereditos[4];       /* indexado por Veredito */
+    double segundos;
+} LoteStats;
+
+/* o lote inteiro, só lido pelas threads (saídas em posições disjuntas) */
+typedef struct Lote {
+    const Catalogo *cat;
+    const IndiceNomes *ix;
+    const uint64_t *bits;
+    const char *const *acusados;
+    Veredito *vereditos;
+    uint32_t *conts;
+} Lote;
+
+/* uma faixa [ini, fim) do lote, numa thread */
+typedef struct ParteLote {
+    const Lote *lote;
+    size_t ini, fim;
+    size_t vereditos[4];
+#ifdef DQ_POSIX
+    pthread_t th;
+#endif
+} ParteLote;
+
+/* pistas do suspeito 'sp' num bitset de partida */
+static uint32_t lote_contar(const Catalogo *cat, const uint64_t *b, size_t sp) {
+    uint32_t n = 0;
+    if (cat->mascaras) {
+        const uint64_t *m = cat->mascaras + sp * cat->palavras;
+        /* poucas palavras: o laço direto sai mais barato que a chamada */
+        if (cat->palavras > 4) return (uint32_t)nucleosTexto()->contar_e(b, m, cat->palavras);
+        for (size_t w = 0; w < cat->palavras; ++w) n += bits_contar(b[w] & m[w]);
+        return n;
+    }
+    /* catálogo sem máscaras (grande demais): pelos bits ligados */
+    for (size_t w = 0; w < cat->palavras; ++w)
+        for (uint64_t x = b[w]; x; x &= x - 1)
+            n += cat->suspeito[w * 64 + bits_primeiro(x)] == sp;
+    return n;
+}
+
+static void *parte_lote_rodar(void *arg) {
+    ParteLote *p = arg;
+    const Lote *l = p->lote;
+    const Catalogo *cat = l->cat;
+    struct { const char *nome; size_t ini, fim; } cache[LOTE_CACHE_NOMES];
+    memset(cache, 0, sizeof(cache));
+    for (size_t i = p->ini; i < p->fim; ++i) {
+        const char *acusado = l->acusados[i];
+        Veredito v = VEREDITO_CANCELADO;
+        uint32_t n = 0;
+        if (acusado && acusado[0] != '\0') {
+            /* mesmo ponteiro, mesma faixa no índice: uma normalização por nome */
+            size_t c = hash_misturar_ptr(acusado) % LOTE_CACHE_NOMES;
+            if (cache[c].nome != acusado) {
+                indiceNomesBuscar(l->ix, acusado, &cache[c].ini, &cache[c].fim);
+                cache[c].nome = acusado;
+            }
+            /* como julgarAcusacao: o primeiro homônimo com pistas */
+            const uint64_t *b = l->bits + i * cat->palavras;
+            v = VEREDITO_IMPROCEDENTE;
+            for (size_t k = cache[c].ini; k < cache[c].fim; ++k) {
+                size_t sp = l->ix->ordem[k];
+                if (sp >= cat->n_suspeitos || !(n = lote_contar(cat, b, sp))) continue;
+                v = n >= 2 ? VEREDITO_CULPADO : VEREDITO_INOCENTADO;
+                break;
+            }
+        }
+        if (l->vereditos) l->vereditos[i] = v;
+        if (l->conts) l->conts[i] = n;
+        p->vereditos[v] += 1;
+    }
+    return NULL;
+}
+
+/**
+ * julgarLote(cat, ht, bits, acusados, n, n_threads, vereditos, conts, st)
+ * Julga 'n' partidas terminadas numa chamada, com as regras de
+ * julgarAcusacao. A partida i coletou as pistas ligadas em
+ * bits + i * cat->palavras (ids de 'cat', ver catalogoBuscar) e acusou
+ * acusados[i] (NULL ou "" = cancelada). Veredito e contagem de cada uma
+ * vão para vereditos[i] e conts[i] (qualquer dos dois pode ser NULL);
+ * os totais e o tempo, para *st. 'n_threads' threads (1 sem POSIX).
+ */
+int julgarLote(const Catalogo *cat, HashTable *ht, const uint64_t *bits,
+               const char *const *acusados, size_t n, int n_threads, Veredito *vereditos,
+               uint32_t *conts, LoteStats *st) {
+    memset(st, 0, sizeof(*st));
+    /* o índice é montado aqui, antes das threads (depois só é lido) */
+    Lote lote = { cat, hashIndiceNomes(ht), bits, acusados, vereditos, conts };
+    if (!lote.ix) return -1;
+#ifndef DQ_POSIX
+    n_threads = 1;
+#endif
+    if (n_threads < 1) n_threads = 1;
+    if ((size_t)n_threads > n) n_threads = n ? (int)n : 1;
+    ParteLote *ps = calloc((size_t)n_threads, sizeof(ParteLote));
+    if (!ps) return -1;
+    for (int i = 0; i < n_threads; ++i) {
+        ps[i].lote = &lote;
+        ps[i].ini = n * (size_t)i / (size_t)n_threads;
+        ps[i].fim = n * (size_t)(i + 1) / (size_t)n_threads;
+    }
+
+    double t0 = agora_seg();
+    int iniciadas = 0;
+#ifdef DQ_POSIX
+    for (int i = 1; i < n_threads; ++i, ++iniciadas)
+        if (pthread_create(&ps[i].th, NULL, parte_lote_rodar, &ps[i]) != 0) break;
+#endif
+    /* a thread atual fica com a primeira faixa e com as que não ganharam thread */
+    parte_lote_rodar(&ps[0]);
+    for (int i = iniciadas + 1; i < n_threads; ++i) parte_lote_rodar(&ps[i]);
+#ifdef DQ_POSIX
+    for (int i = 1; i <= iniciadas; ++i) pthread_join(ps[i].th, NULL);
+#endif
+    st->segundos = agora_seg() - t0;
+
+    st->partidas = n;
+    for (int i = 0; i < n_threads; ++i)
+        for (size_t v = 0; v < 4; ++v) st->vereditos[v] += ps[i].vereditos[v];
+    free(ps);
+    return 0;
+}
+
+/**
+ * benchLote(mapa, ht, total, max_threads)
+ * Sorteia partidas terminadas (semente fixa) sobre o caso carregado: até
+ * 12 pistas do catálogo e a acusação de um suspeito qualquer. Mede
+ * vereditos/s de julgarLote com 1, 2, 4... threads até 'max_threads'
+ * (0 = núcleos).
+ */
+int benchLote(Mapa *mapa, HashTable *ht, size_t total, int max_threads) {
+    Catalogo *cat = catalogoMontar(mapa, ht);
+    uint64_t *bits = NULL;
+    const char **acusados = NULL;
+    int ret = -1;
+    if (!cat || cat->n == 0 || total == 0) {
+        fprintf(stderr, "Erro: o caso não tem pistas para julgar.\n");
+        goto fim;
+    }
+    /* no máximo RESUMO_MAX_BYTES de bitsets: o resto são voltas no mesmo lote */
+    size_t por_partida = cat->palavras * sizeof(uint64_t);
+    size_t n = total < RESUMO_MAX_BYTES / por_partida ? total : RESUMO_MAX_BYTES / por_partida;
+    if (n == 0) n = 1;
+    bits = calloc(n, por_partida);
+    acusados = malloc(n * sizeof(char *));
+    if (!bits || !acusados) goto fim;
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < n; ++i) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        uint64_t *b = bits + i * cat->palavras;
+        for (size_t k = 0, pistas = 1 + x % 12; k < pistas; ++k) {
+            uint32_t id = (uint32_t)((x >> (8 + 4 * k)) * 0x2545f4914f6cdd1dull % cat->n);
+            b[id / 64] |= (uint64_t)1 << (id % 64);
+        }
+        acusados[i] = cat->n_suspeitos ? cat->nomes[(x >> 40) % cat->n_suspeitos] : NULL;
+    }
+
+    int max = max_threads > 0 ? max_threads : nucleos_disponiveis();
+    size_t voltas = (total + n - 1) / n;
+    printf("Julgamento em lote: %zu partidas (%zu x %zu), %zu pista(s), %zu suspeito(s), "
+           "%s\n", n * voltas, voltas, n, cat->n, cat->n_suspeitos,
+           cat->mascaras ? "com máscaras" : "sem máscaras");
+    double base = 0;
+    for (int t = 1;; t = t * 2 > max && t < max ? max : t * 2) {
+        LoteStats st, tot;
+        memset(&tot, 0, sizeof(tot));
+        for (size_t r = 0; r < voltas; ++r) {
+            if (julgarLote(cat, ht, bits, acusados, n, t, NULL, NULL, &st) != 0) goto fim;
+            tot.partidas += st.partidas;
+            tot.segundos += st.segundos;
+            for (size_t v = 0; v < 4; ++v) tot.vereditos[v] += st.vereditos[v];
+        }
+        double vazao = (double)tot.partidas / (tot.segundos > 0 ? tot.segundos : 1e-9);
+        if (t == 1) base = vazao;
+        printf("  threads=%-3d %12.0f vereditos/s  %8.1f ns/veredito  speedup %5.2fx"
+               "  (culpados %zu)\n",
+               t, vazao, 1e9 / vazao, vazao / base, tot.vereditos[VEREDITO_CULPADO]);
+        if (t >= max) break;
+    }
+    ret = 0;
+
+fim:
+    free(bits);
+    free((void *)acusados);
+    catalogoLiberar(cat);
+    return ret;
+}
+
+/* ===========================
+   Servidor de partidas (laço de eventos)
+   =========================== */
+
+/*
+ * Protocolo em linhas de texto sobre TCP: o cliente manda uma linha por vez
+ * e recebe a resposta de partidaPasso terminada por um byte '\0' (o prompt
+ * seguinte vem junto). Ao conectar chega a primeira resposta; depois do
+ * veredito a partida recomeça na mesma conexão (na mesma resposta). Cada
+ * thread tem o seu epoll e o seu socket de escuta (SO_REUSEPORT: o kernel
+ * reparte as conexões); mapa, hash, catálogo e resumo são só lidos.
+ * Catálogo e resumo são montados por uma thread à parte enquanto o
+ * servidor já atende: até ficarem prontos as partidas usam a BST e não
+ * têm dicas; cada conexão passa a usá-los na partida seguinte.
+ */
+
+/* maior linha aceita do jogador (o resto da linha é descartado) */
+#define CONEXAO_LINHA 128
+
+/* eventos tratados por chamada a epoll_wait */
+#define SERVIDOR_EVENTOS 256
+
+/* pedido de parada (SIGINT / SIGTERM), conferido a cada volta do laço de
+   cada thread: atômico (sem trava, vale no tratador), não sig_atomic_t */
+static atomic_int servidor_parar = 0;
+
+#ifdef DQ_EPOLL
+static void servidor_tratar_sinal(int sig) {
+    (void)sig;
+    atomic_store_explicit(&servidor_parar, 1, memory_order_relaxed);
+}
+
+/* para servidor e cliente: descritores até o limite rígido do processo */
+static void descritores_maximos(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static int descritor_sem_bloqueio(int fd) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    return fl >= 0 && fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0 ? 0 : -1;
+}
+
+/* estado compartilhado pelas threads do servidor */
+typedef struct Servidor {
+    Mapa *mapa;
+    HashTable *ht;
+    ResumoMapa *resumo;            /* valem depois de 'pronto' (acquire) */
+    Catalogo *cat;                 /* sem resumo (grande demais) */
+    atomic_int pronto;             /* 1 = a montagem terminou (mesmo sem nada) */
+    atomic_size_t conexoes;        /* aceitas desde o início */
+    atomic_size_t partidas;        /* terminadas (com ou sem acusação) */
+    atomic_size_t comandos;        /* linhas recebidas */
+} Servidor;
+
+/* Uma conexão: a partida dela e a resposta ainda não enviada */
+typedef struct Conexao {
+    int fd;
+    Partida p;
+    int com_dicas;             /* já pegou catálogo e resumo de Servidor */
+    ConjuntoPistas colecao;
+    Arena *arena;              /* pistas da BST quando não há catálogo */
+    Saida *out;                /* memória: respostas a enviar */
+    size_t enviado;            /* bytes de out->buf já escritos no socket */
+    char linha[CONEXAO_LINHA];
+    size_t n_linha;
+    int esperando_saida;       /* 1 = socket cheio, registrado em EPOLLOUT */
+    struct Conexao *ant, *prox;
+} Conexao;
+
+/* uma thread do servidor: epoll, escuta e as conexões dela */
+typedef struct LacoServidor {
+    Servidor *srv;
+    int ep, escuta;
+    Conexao *conexoes;         /* lista duplamente encadeada */
+    int erro;
+    pthread_t th;
+} LacoServidor;
+
+static void conexao_fechar(LacoServidor *l, Conexao *c) {
+    if (c->ant) c->ant->prox = c->prox;
+    else l->conexoes = c->prox;
+    if (c->prox) c->prox->ant = c->ant;
+    close(c->fd);
+    sessaoLiberar(&c->p.s);
+    conjuntoLiberar(&c->colecao);
+    arena_liberar(c->arena);
+    saidaLiberar(c->out);
+    free(c);
+}
+
+static Conexao *conexao_nova(LacoServidor *l, int fd) {
+    Servidor *srv = l->srv;
+    Conexao *c = calloc(1, sizeof(Conexao));
+    if (!c) return NULL;
+    c->fd = fd;
+    c->out = saidaMemoria();
+    c->arena = arena_criar(4096);
+    if (!c->out || !c->arena) {
+        arena_liberar(c->arena);
+        saidaLiberar(c->out);
+        free(c);
+        return NULL;
+    }
+    sessaoPreparar(&c->p.s, c->out, srv->mapa, srv->ht, c->arena, 0);
+    c->prox = l->conexoes;
+    if (c->prox) c->prox->ant = c;
+    l->conexoes = c;
+    return c;
+}
+
+/* começa (ou recomeça) a partida da conexão, já com catálogo e resumo se a
+   montagem terminou; -1 = mapa vazio */
+static int conexao_comecar(Servidor *srv, Conexao *c) {
+    if (!c->com_dicas && atomic_load_explicit(&srv->pronto, memory_order_acquire)) {
+        const Catalogo *cat = srv->resumo ? srv->resumo->cat : srv->cat;
+        c->com_dicas = 1;
+        c->p.s.resumo = srv->resumo;
+        if (cat && conjuntoIniciar(&c->colecao, cat) == 0) c->p.s.colecao = &c->colecao;
+    }
+    arena_reiniciar(c->arena);
+    return partidaComecar(&c->p) == PARTIDA_FIM ? -1 : 0;
+}
+
+/* escreve o que puder da resposta; 1 = ficou resto (socket cheio), -1 = erro */
+static int conexao_enviar(LacoServidor *l, Conexao *c) {
+    Saida *o = c->out;
+    while (c->enviado < o->len) {
+        ssize_t w = send(c->fd, o->buf + c->enviado, o->len - c->enviado, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c->esperando_saida) {
+                struct epoll_event ev = { EPOLLOUT, { .ptr = c } };
+                if (epoll_ctl(l->ep, EPOLL_CTL_MOD, c->fd, &ev) != 0) return -1;
+                c->esperando_saida = 1;
+            }
+            return 1;
+        }
+        if (w <= 0) return -1;
+        c->enviado += (size_t)w;
+    }
+    o->len = 0;
+    c->enviado = 0;
+    if (c->esperando_saida) {
+        struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+        if (epoll_ctl(l->ep, EPOLL_CTL_MOD, c->fd, &ev) != 0) return -1;
+        c->esperando_saida = 0;
+    }
+    return 0;
+}
+
+/* uma linha completa: passo da partida e o '\0' que fecha a resposta */
+static int conexao_linha(Servidor *srv, Conexao *c) {
+    c->linha[c->n_linha] = '\0';
+    if (c->n_linha > 0 && c->linha[c->n_linha - 1] == '\r') c->linha[c->n_linha - 1] = '\0';
+    c->n_linha = 0;
+    atomic_fetch_add_explicit(&srv->comandos, 1, memory_order_relaxed);
+    int ret = 0;
+    if (partidaPasso(&c->p, c->linha) == PARTIDA_FIM) {
+        atomic_fetch_add_explicit(&srv->partidas, 1, memory_order_relaxed);
+        saida_lit(c->out, "\n=== Nova partida ===\n");
+        ret = conexao_comecar(srv, c);
+    }
+    saida_char(c->out, '\0');
+    return c->out->erro ? -1 : ret;
+}
+
+/* dados chegaram: consome as linhas inteiras; -1 = fechar a conexão */
+static int conexao_ler(LacoServidor *l, Conexao *c) {
+    char buf[4096];
+    for (;;) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        if (n == 0) return -1;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] != '\n') {
+                if (c->n_linha < CONEXAO_LINHA - 1) c->linha[c->n_linha++] = buf[i];
+                continue;
+            }
+            if (conexao_linha(l->srv, c) != 0) {
+                conexao_enviar(l, c);
+                return -1;
+            }
+        }
+        /* socket cheio: pára de ler até a resposta sair (EPOLLOUT) */
+        int r = conexao_enviar(l, c);
+        if (r != 0) return r < 0 ? -1 : 0;
+    }
+}
+
+static void laco_aceitar(LacoServidor *l) {
+    for (;;) {
+        int fd = accept(l->escuta, NULL, NULL);
+        if (fd < 0) return;
+        int um = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+        Conexao *c = descritor_sem_bloqueio(fd) == 0 ? conexao_nova(l, fd) : NULL;
+        if (!c) {
+            close(fd);
+            continue;
+        }
+        atomic_fetch_add_explicit(&l->srv->conexoes, 1, memory_order_relaxed);
+        struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+        if (epoll_ctl(l->ep, EPOLL_CTL_ADD, fd, &ev) != 0 || conexao_comecar(l->srv, c) != 0) {
+            conexao_fechar(l, c);
+            continue;
+        }
+        saida_char(c->out, '\0');
+        if (conexao_enviar(l, c) < 0) conexao_fechar(l, c);
+    }
+}
+
+static void *laco_servidor_rodar(void *arg) {
+    LacoServidor *l = arg;
+    struct epoll_event evs[SERVIDOR_EVENTOS];
+    while (!atomic_load_explicit(&servidor_parar, memory_order_relaxed)) {
+        int n = epoll_wait(l->ep, evs, SERVIDOR_EVENTOS, 200);
+        if (n < 0 && errno != EINTR) {
+            l->erro = 1;
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            Conexao *c = evs[i].data.ptr;
+            if (!c) {
+                laco_aceitar(l);
+                continue;
+            }
+            int r = 0;
+            if (evs[i].events & (EPOLLERR | EPOLLHUP)) r = -1;
+            else if (c->esperando_saida) r = conexao_enviar(l, c) < 0 ? -1 : 0;
+            /* resposta enviada por inteiro: pode haver linhas na fila */
+            if (r == 0 && !c->esperando_saida) r = conexao_ler(l, c);
+            if (r < 0) conexao_fechar(l, c);
+        }
+    }
+    while (l->conexoes) conexao_fechar(l, l->conexoes);
+    return NULL;
+}
+
+/* socket de escuta em 'porta' (todas as interfaces), não bloqueante */
+static int servidor_escutar(int porta) {
+    int fd = socket(AF_INET6, SOCK_STREAM, 0);
+    int um = 1, zero = 0;
+    if (fd < 0) return -1;
+    struct sockaddr_in6 end;
+    memset(&end, 0, sizeof(end));
+    end.sin6_family = AF_INET6;
+    end.sin6_addr = in6addr_any;
+    end.sin6_port = htons((uint16_t)porta);
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));   /* IPv4 também */
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &um, sizeof(um)) != 0 ||
+        bind(fd, (struct sockaddr *)&end, sizeof(end)) != 0 || listen(fd, 4096) != 0 ||
+        descritor_sem_bloqueio(fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+/* thread de montagem: resumo para as dicas; sem ele, só o catálogo */
+static void *servidor_montar(void *arg) {
+    Servidor *srv = arg;
+    double t0 = agora_seg();
+    srv->resumo = resumoMontar(srv->mapa, srv->ht);
+    if (!srv->resumo) srv->cat = catalogoMontar(srv->mapa, srv->ht);
+    atomic_store_explicit(&srv->pronto, 1, memory_order_release);
+    fprintf(stderr, "[servidor] %s em %.3f s\n",
+            srv->resumo ? "catálogo e dicas prontos" : srv->cat ? "catálogo pronto (sem dicas)"
+                                                             : "sem catálogo",
+            agora_seg() - t0);
+    return NULL;
+}
+
+/**
+ * servidorJogo(mapa, ht, porta, n_threads)
+ * Serve partidas pela rede em 'porta' (ver o protocolo acima) com
+ * 'n_threads' laços de eventos, até SIGINT ou SIGTERM. Cada conexão tem
+ * a sua Partida, como as sessões de executarParalelo. Retorna 0 se parou
+ * sem erro; -1 sem epoll (fora do Linux).
+ */
+int servidorJogo(Mapa *mapa, HashTable *ht, int porta, int n_threads) {
+#ifdef DQ_EPOLL
+    if (n_threads < 1) n_threads = 1;
+    Servidor srv = { mapa, ht, NULL, NULL, 0, 0, 0, 0 };
+    LacoServidor *ls = calloc((size_t)n_threads, sizeof(LacoServidor));
+    pthread_t montador;
+    int iniciadas = 0, montando = 0, ret = -1;
+    atomic_init(&srv.pronto, 0);
+    atomic_init(&srv.conexoes, 0);
+    atomic_init(&srv.partidas, 0);
+    atomic_init(&srv.comandos, 0);
+    if (!ls || prepararCompartilhado(mapa, ht) != 0) goto fim;
+    descritores_maximos();
+    for (int i = 0; i < n_threads; ++i) {
+        ls[i].srv = &srv;
+        ls[i].ep = epoll_create1(0);
+        ls[i].escuta = servidor_escutar(porta);
+        struct epoll_event ev = { EPOLLIN, { .ptr = NULL } };
+        if (ls[i].ep < 0 || ls[i].escuta < 0 ||
+            epoll_ctl(ls[i].ep, EPOLL_CTL_ADD, ls[i].escuta, &ev) != 0) {
+            fprintf(stderr, "Erro: não foi possível escutar na porta %d.\n", porta);
+            n_threads = i + 1;
+            goto fim;
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = servidor_tratar_sinal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "[servidor] porta %d, %d thread(s)\n", porta, n_threads);
+    /* sem a thread de montagem, monta antes de atender */
+    montando = pthread_create(&montador, NULL, servidor_montar, &srv) == 0;
+    if (!montando) servidor_montar(&srv);
+    double t0 = agora_seg();
+    /* a thread atual é o laço 0 */
+    for (int i = 1; i < n_threads; ++i, ++iniciadas)
+        if (pthread_create(&ls[i].th, NULL, laco_servidor_rodar, &ls[i]) != 0) break;
+    laco_servidor_rodar(&ls[0]);
+    for (int i = 1; i <= iniciadas; ++i) pthread_join(ls[i].th, NULL);
+    fprintf(stderr, "[servidor] %zu conexões, %zu partidas, %zu comandos em %.1f s\n",
+            atomic_load(&srv.conexoes), atomic_load(&srv.partidas),
+            atomic_load(&srv.comandos), agora_seg() - t0);
+    ret = 0;
+    for (int i = 0; i <= iniciadas; ++i)
+        if (ls[i].erro) ret = -1;
+
+fim:
+    for (int i = 0; ls && i < n_threads; ++i) {
+        if (ls[i].escuta > 0) close(ls[i].escuta);
+        if (ls[i].ep > 0) close(ls[i].ep);
+    }
+    if (montando) pthread_join(montador, NULL);
+    free(ls);
+    catalogoLiberar(srv.cat);
+    resumoLiberar(srv.resumo);
+    return ret;
+#else
+    (void)mapa;
+    (void)ht;
+    (void)porta;
+    (void)n_threads;
+    fprintf(stderr, "Erro: o servidor precisa de epoll (Linux).\n");
+    return -1;
+#endif
+}
+
+/* ===========================
+   Cliente de carga (para servidorJogo)
+   =========================== */
+
+/* fim do prompt de acusação: a resposta pede um nome, não um comando */
+#define CARGA_PROMPT_ACUSAR "suspeito: "
+
+#ifdef DQ_EPOLL
+/* uma conexão do cliente: o roteiro da partida e o que falta mandar */
+typedef struct ConexaoCarga {
+    int fd;
+    const char *roteiro;       /* partida gravada, como em replayPartida */
+    const char *pos;           /* próximo comando do roteiro */
+    int fase;                  /* 0 = explorando, 1 = saiu, 2 = acusou */
+    size_t partidas;           /* terminadas nesta conexão */
+    uint64_t t_envio;          /* ns: envio da linha que espera resposta */
+    char cauda[16];            /* fim da resposta em curso */
+    size_t n_cauda;
+} ConexaoCarga;
+
+/* uma thread do cliente: as conexões dela e as latências medidas */
+typedef struct LacoCarga {
+    ConexaoCarga *cs;
+    size_t n, abertas;
+    const char *const *partidas;
+    size_t n_partidas, por_conexao, proxima;
+    const struct addrinfo *end;
+    uint64_t *lat;             /* ns por linha respondida */
+    size_t n_lat, cap_lat;
+    size_t vereditos, erros;
+    pthread_t th;
+} LacoCarga;
+
+static uint64_t agora_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* manda a próxima linha do roteiro (depois de 's', o nome do acusado) */
+static int carga_enviar(ConexaoCarga *c) {
+    char linha[CONEXAO_LINHA + 1];
+    size_t n = 0;
+    const char *p = c->pos;
+    if (c->fase == 0) {
+        while (*p && *p != ':' && isspace((unsigned char)*p)) ++p;
+        char cmd = *p && *p != ':' ? (char)tolower((unsigned char)*p++) : 's';
+        linha[n++] = cmd;
+        if (cmd == 's') c->fase = 1;
+    } else {
+        /* fase 1 com o prompt de acusação: o nome depois do ':' */
+        const char *nome = strchr(c->roteiro, ':');
+        nome = nome ? nome + 1 : "";
+        n = strlen(nome);
+        if (n > CONEXAO_LINHA - 1) n = CONEXAO_LINHA - 1;
+        memcpy(linha, nome, n);
+        c->fase = 2;
+    }
+    linha[n++] = '\n';
+    c->pos = p;
+    c->t_envio = agora_ns();
+    /* linhas curtas: cabem no buffer do socket, nunca ficam pela metade */
+    if (send(c->fd, linha, n, MSG_NOSIGNAL) != (ssize_t)n) return -1;
+    return 0;
+}
+
+/* começa a próxima partida da conexão (ou fecha, se já jogou todas) */
+static void carga_proxima_partida(LacoCarga *l, ConexaoCarga *c) {
+    c->roteiro = c->pos = l->partidas[l->proxima++ % l->n_partidas];
+    c->fase = 0;
+}
+
+/* uma resposta inteira chegou (o '\0'): registra e responde */
+static int carga_resposta(LacoCarga *l, ConexaoCarga *c) {
+    const size_t np = sizeof(CARGA_PROMPT_ACUSAR) - 1;
+    int acusar = c->n_cauda >= np &&
+                 memcmp(c->cauda + c->n_cauda - np, CARGA_PROMPT_ACUSAR, np) == 0;
+    c->n_cauda = 0;
+    if (c->t_envio) {
+        if (l->n_lat == l->cap_lat) {
+            size_t cap = l->cap_lat ? l->cap_lat * 2 : 4096;
+            uint64_t *tmp = realloc(l->lat, cap * sizeof(uint64_t));
+            if (!tmp) return -1;
+            l->lat = tmp;
+            l->cap_lat = cap;
+        }
+        l->lat[l->n_lat++] = agora_ns() - c->t_envio;
+    } else {
+        /* primeira resposta (ao conectar) */
+        carga_proxima_partida(l, c);
+    }
+    if (c->fase == 2 || (c->fase == 1 && !acusar)) {
+        if (c->fase == 2) l->vereditos += 1;
+        if (++c->partidas >= l->por_conexao) return 1;
+        carga_proxima_partida(l, c);
+    }
+    return carga_enviar(c);
+}
+
+static void carga_fechar(LacoCarga *l, ConexaoCarga *c) {
+    if (c->fd < 0) return;
+    close(c->fd);
+    c->fd = -1;
+    l->abertas -= 1;
+}
+
+static int carga_ler(LacoCarga *l, ConexaoCarga *c) {
+    char buf[8192];
+    for (;;) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        if (n == 0) return -1;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] != '\0') {
+                if (c->n_cauda == sizeof(c->cauda)) {
+                    memmove(c->cauda, c->cauda + 1, sizeof(c->cauda) - 1);
+                    c->n_cauda -= 1;
+                }
+                c->cauda[c->n_cauda++] = buf[i];
+                continue;
+            }
+            int r = carga_resposta(l, c);
+            if (r != 0) return r;
+        }
+    }
+}
+
+static int carga_conectar(const struct addrinfo *end) {
+    for (const struct addrinfo *a = end; a; a = a->ai_next) {
+        int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, a->ai_addr, a->ai_addrlen) == 0 && descritor_sem_bloqueio(fd) == 0) {
+            int um = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+            return fd;
+        }
+        close(fd);
+    }
+    return -1;
+}
+
+static void *laco_carga_rodar(void *arg) {
+    LacoCarga *l = arg;
+    struct epoll_event evs[SERVIDOR_EVENTOS];
+    int ep = epoll_create1(0);
+    if (ep < 0) {
+        l->erros = l->n;
+        return NULL;
+    }
+    for (size_t i = 0; i < l->n; ++i) {
+        ConexaoCarga *c = &l->cs[i];
+        c->fd = carga_conectar(l->end);
+        struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+        if (c->fd < 0) {
+            l->erros += 1;
+            continue;
+        }
+        l->abertas += 1;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev) != 0) {
+            l->erros += 1;
+            carga_fechar(l, c);
+        }
+    }
+    while (l->abertas > 0 && !atomic_load_explicit(&servidor_parar, memory_order_relaxed)) {
+        int n = epoll_wait(ep, evs, SERVIDOR_EVENTOS, 200);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            ConexaoCarga *c = evs[i].data.ptr;
+            int r = carga_ler(l, c);
+            if (r < 0) l->erros += 1;
+            if (r != 0) carga_fechar(l, c);
+        }
+    }
+    for (size_t i = 0; i < l->n; ++i) carga_fechar(l, &l->cs[i]);
+    close(ep);
+    return NULL;
+}
+
+static int comparar_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* percentil 'q' (0..1) de 'v' ordenado, em microssegundos */
+static double percentil_us(const uint64_t *v, size_t n, double q) {
+    if (n == 0) return 0;
+    size_t i = (size_t)(q * (double)(n - 1) + 0.5);
+    return (double)v[i] / 1e3;
+}
+#endif
+
+/**
+ * clienteCarga(endereco, conexoes, partidas, n, por_conexao, n_threads)
+ * Abre 'conexoes' conexões com servidorJogo em "HOST:PORTA" e joga em cada
+ * uma 'por_conexao' partidas gravadas (em ciclo, como em replayPartida),
+ * sempre uma linha por vez. Mede a latência de cada linha (envio até o
+ * '\0' da resposta) e mostra percentis e vazão. Retorna 0 se tudo correu
+ * bem; -1 se alguma conexão falhou.
+ */
+int clienteCarga(const char *endereco, size_t conexoes, const char *const *partidas, size_t n,
+                 size_t por_conexao, int n_threads) {
+#ifdef DQ_EPOLL
+    const char *dp = strrchr(endereco, ':');
+    if (!dp || n == 0 || conexoes == 0) {
+        fprintf(stderr, "Erro: use --carga HOST:PORTA.\n");
+        return -1;
+    }
+    char host[256];
+    size_t nh = (size_t)(dp - endereco);
+    if (nh >= sizeof(host)) nh = sizeof(host) - 1;
+    memcpy(host, endereco, nh);
+    host[nh] = '\0';
+    struct addrinfo dica, *end = NULL;
+    memset(&dica, 0, sizeof(dica));
+    dica.ai_family = AF_UNSPEC;
+    dica.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(nh ? host : NULL, dp + 1, &dica, &end) != 0) {
+        fprintf(stderr, "Erro: endereço inválido '%s'.\n", endereco);
+        return -1;
+    }
+    if (n_threads < 1) n_threads = 1;
+    if ((size_t)n_threads > conexoes) n_threads = (int)conexoes;
+    if (por_conexao == 0) por_conexao = 1;
+    descritores_maximos();
+    signal(SIGPIPE, SIG_IGN);
+
+    LacoCarga *ls = calloc((size_t)n_threads, sizeof(LacoCarga));
+    ConexaoCarga *cs = calloc(conexoes, sizeof(ConexaoCarga));
+    int ret = -1, iniciadas = 0;
+    if (!ls || !cs) goto fim;
+    for (int i = 0; i < n_threads; ++i) {
+        size_t ini = conexoes * (size_t)i / (size_t)n_threads;
+        size_t fim_i = conexoes * (size_t)(i + 1) / (size_t)n_threads;
+        LacoCarga *l = &ls[i];
+        l->cs = cs + ini;
+        l->n = fim_i - ini;
+        l->partidas = partidas;
+        l->n_partidas = n;
+        l->por_conexao = por_conexao;
+        l->proxima = ini;          /* threads começam em partidas diferentes */
+        l->end = end;
+    }
+    double t0 = agora_seg();
+    for (int i = 1; i < n_threads; ++i, ++iniciadas)
+        if (pthread_create(&ls[i].th, NULL, laco_carga_rodar, &ls[i]) != 0) break;
+    laco_carga_rodar(&ls[0]);
+    for (int i = 1; i <= iniciadas; ++i) pthread_join(ls[i].th, NULL);
+    double seg = agora_seg() - t0;
+
+    /* latências de todas as threads juntas */
+    size_t total = 0, vereditos = 0, erros = 0;
+    for (int i = 0; i <= iniciadas; ++i) total += ls[i].n_lat;
+    uint64_t *lat = malloc((total ? total : 1) * sizeof(uint64_t));
+    if (!lat) goto fim;
+    total = 0;
+    for (int i = 0; i <= iniciadas; ++i) {
+        memcpy(lat + total, ls[i].lat, ls[i].n_lat * sizeof(uint64_t));
+        total += ls[i].n_lat;
+        vereditos += ls[i].vereditos;
+        erros += ls[i].erros;
+    }
+    qsort(lat, total, sizeof(uint64_t), comparar_u64);
+    fprintf(stderr, "[carga] %zu conexão(ões), %d thread(s), %zu linha(s), %zu veredito(s), "
+                    "%zu erro(s) em %.3f s\n",
+            conexoes, iniciadas + 1, total, vereditos, erros, seg);
+    fprintf(stderr, "[carga] %.0f linhas/s; latência p50 %.1f us, p99 %.1f us, "
+                    "p99.9 %.1f us, máx %.1f us\n",
+            (double)total / (seg > 0 ? seg : 1e-9), percentil_us(lat, total, 0.5),
+            percentil_us(lat, total, 0.99), percentil_us(lat, total, 0.999),
+            total ? (double)lat[total - 1] / 1e3 : 0.0);
+    free(lat);
+    ret = erros ? -1 : 0;
+
+fim:
+    for (int i = 0; ls && i < n_threads; ++i) free(ls[i].lat);
+    free(ls);
+    free(cs);
+    freeaddrinfo(end);
+    return ret;
+#else
+    (void)endereco;
+    (void)conexoes;
+    (void)partidas;
+    (void)n;
+    (void)por_conexao;
+    (void)n_threads;
+    fprintf(stderr, "Erro: o cliente de carga precisa de epoll (Linux).\n");
+    return -1;
+#endif
+}
+
+/* ===========================
+   Resolvedor de caminhos (balanceamento de casos)
+   =========================== */
+
+/*
+ * Percorre todos os caminhos da raiz até uma folha e, em cada um, vê quais
+ * suspeitos juntam 2 pistas ou mais (a regra de verificarSuspeitoFinal).
+ * As subárvores esq/dir viram tarefas que as threads ociosas roubam das
+ * outras. O caminho até uma tarefa é uma lista encadeada de Prefixo do
+ * filho para o pai: todas as tarefas abaixo de uma sala compartilham os
+ * mesmos nós, sem cópia dos conjuntos de pistas.
+ */
+
+/* não divide subárvores que não podem ter mais do que 2^CORTE folhas */
+#define RESOLVER_CORTE 4
+
+/* um passo do caminho, compartilhado por todas as tarefas abaixo dele */
+typedef struct Prefixo {
+    const struct Prefixo *pai;
+    uint32_t pista;            /* id no catálogo (CATALOGO_NENHUMA = sala sem pista) */
+    uint32_t prof;
+    char mov;                  /* 'e' ou 'd' (a raiz não tem) */
+} Prefixo;
+
+/* subárvore a resolver: 'no' está na profundidade 'prof', logo abaixo de 'pai' */
+typedef struct TarefaCaminho {
+    NoMapa no;
+    const Prefixo *pai;
+    uint32_t prof;
+    char mov;
+} TarefaCaminho;
+
+/* fila de tarefas de uma thread: a dona usa o fim, as outras roubam do início */
+typedef struct FilaTarefas {
+    TarefaCaminho *v;
+    size_t ini, fim, cap;
+    atomic_size_t tam;         /* fim - ini, para olhar sem a trava */
+#ifdef DQ_POSIX
+    pthread_mutex_t trava;
+#endif
+} FilaTarefas;
+
+static void fila_travar(FilaTarefas *f) {
+#ifdef DQ_POSIX
+    pthread_mutex_lock(&f->trava);
+#else
+    (void)f;
+#endif
+}
+
+static void fila_destravar(FilaTarefas *f) {
+#ifdef DQ_POSIX
+    pthread_mutex_unlock(&f->trava);
+#else
+    (void)f;
+#endif
+}
+
+static int fila_por(FilaTarefas *f, TarefaCaminho t) {
+    int ok = 1;
+    fila_travar(f);
+    if (f->fim == f->cap) {
+        /* desliza para o começo antes de pedir mais memória */
+        size_t n = f->fim - f->ini;
+        if (f->ini > 0) {
+            memmove(f->v, f->v + f->ini, n * sizeof(TarefaCaminho));
+        } else {
+            size_t cap = f->cap ? f->cap * 2 : 64;
+            TarefaCaminho *v = realloc(f->v, cap * sizeof(TarefaCaminho));
+            if (v) {
+                f->v = v;
+                f->cap = cap;
+            } else {
+                ok = 0;
+            }
+        }
+        f->ini = 0;
+        f->fim = n;
+    }
+    if (ok) {
+        f->v[f->fim++] = t;
+        atomic_store_explicit(&f->tam, f->fim - f->ini, memory_order_relaxed);
+    }
+    fila_destravar(f);
+    return ok;
+}
+
+/* 'dona' = 1 tira a mais nova (fim); 0 rouba a mais antiga (início) */
+static int fila_tirar(FilaTarefas *f, TarefaCaminho *t, int dona) {
+    int ok = 0;
+    fila_travar(f);
+    if (f->fim > f->ini) {
+        *t = dona ? f->v[--f->fim] : f->v[f->ini++];
+        atomic_store_explicit(&f->tam, f->fim - f->ini, memory_order_relaxed);
+        ok = 1;
+    }
+    fila_destravar(f);
+    return ok;
+}
+
+/**
+ * Totais do resolvedor. 'condena' é indexado pela posição do suspeito em
+ * hashSuspeitos (liberar com resolverLiberarStats).
+ */
+typedef struct ResolverStats {
+    uint64_t caminhos;         /* folhas = caminhos raiz -> folha */
+    uint64_t sem_culpado;      /* nenhum suspeito com 2 pistas */
+    uint64_t ambiguos;         /* 2 suspeitos ou mais com 2 pistas */
+    uint64_t salas;            /* salas visitadas nas tarefas */
+    uint64_t tarefas, roubos;
+    uint64_t *condena;         /* caminhos em que cada suspeito tem 2 pistas ou mais */
+    size_t n_suspeitos;
+    uint32_t profundidade;
+    size_t pistas;             /* pistas distintas no mapa */
+    int threads;
+    double segundos;
+} ResolverStats;
+
+struct PoolResolver;
+
+/* uma thread do resolvedor: contadores do caminho atual e totais próprios */
+typedef struct Resolvedor {
+    struct PoolResolver *pool;
+    FilaTarefas fila;
+    Arena *arena;              /* prefixos publicados por esta thread */
+    uint32_t *presente;        /* id da pista -> vezes no caminho atual */
+    uint32_t *votos;           /* suspeito -> pistas distintas no caminho */
+    uint32_t *acima;           /* suspeitos com 2 pistas ou mais */
+    uint32_t *acima_pos;       /* suspeito -> posição em 'acima' */
+    size_t n_acima;
+    /* caminho atual, por profundidade */
+    char *movs;
+    uint32_t *ids;
+    const Prefixo **prefixos;  /* NULL = ainda não publicado */
+    uint64_t *marca;           /* listagem: última folha que escreveu cada pista */
+    Saida *lista;              /* listagem: linhas desta thread */
+    ResolverStats st;
+    int erro;
+#ifdef DQ_POSIX
+    pthread_t th;
+#endif
+} Resolvedor;
+
+/* estado compartilhado: mapa e catálogo só são lidos */
+typedef struct PoolResolver {
+    Mapa *mapa;
+    const Catalogo *cat;
+    Resolvedor *rs;
+    int n;
+    atomic_size_t pendentes;   /* tarefas criadas e ainda não terminadas */
+    Saida *lista;              /* NULL = sem listagem */
+#ifdef DQ_POSIX
+    pthread_mutex_t trava_lista;
+#endif
+} PoolResolver;
+
+/* pista 'id' entra no caminho: só a primeira ocorrência conta */
+static inline void resolver_coletar(Resolvedor *r, uint32_t id) {
+    if (id == CATALOGO_NENHUMA || r->presente[id]++ != 0) return;
+    uint32_t s = r->pool->cat->suspeito[id];
+    if (s != CATALOGO_NENHUMA && ++r->votos[s] == 2) {
+        r->acima_pos[s] = (uint32_t)r->n_acima;
+        r->acima[r->n_acima++] = s;
+    }
+}
+
+/* desfaz resolver_coletar ao voltar pelo caminho */
+static inline void resolver_devolver(Resolvedor *r, uint32_t id) {
+    if (id == CATALOGO_NENHUMA || --r->presente[id] != 0) return;
+    uint32_t s = r->pool->cat->suspeito[id];
+    if (s != CATALOGO_NENHUMA && r->votos[s]-- == 2) {
+        uint32_t ult = r->acima[--r->n_acima];
+        r->acima[r->acima_pos[s]] = ult;
+        r->acima_pos[ult] = r->acima_pos[s];
+    }
+}
+
+/* passa as linhas acumuladas para a saída compartilhada */
+static void resolver_despejar_lista(Resolvedor *r) {
+    PoolResolver *p = r->pool;
+    if (!r->lista || r->lista->len == 0) return;
+#ifdef DQ_POSIX
+    pthread_mutex_lock(&p->trava_lista);
+#endif
+    saida_escrever(p->lista, r->lista->buf, r->lista->len);
+#ifdef DQ_POSIX
+    pthread_mutex_unlock(&p->trava_lista);
+#endif
+    r->lista->len = 0;
+}
+
+/* "movimentos<TAB>pistas<TAB>condenados" do caminho que termina em 'prof' */
+static void resolver_listar(Resolvedor *r, uint32_t prof) {
+    const Catalogo *cat = r->pool->cat;
+    Saida *o = r->lista;
+    if (prof == 0) saida_char(o, '-');
+    else saida_escrever(o, r->movs + 1, prof);
+    saida_char(o, '\t');
+    int primeira = 1;
+    for (uint32_t k = 0; k <= prof; ++k) {
+        uint32_t id = r->ids[k];
+        if (id == CATALOGO_NENHUMA || r->marca[id] == r->st.caminhos) continue;
+        r->marca[id] = r->st.caminhos;
+        if (!primeira) saida_lit(o, "; ");
+        saida_texto(o, cat->pistas[id]);
+        primeira = 0;
+    }
+    saida_char(o, '\t');
+    if (r->n_acima == 0) saida_char(o, '-');
+    for (size_t i = 0; i < r->n_acima; ++i) {
+        if (i) saida_lit(o, ", ");
+        saida_texto(o, cat->nomes[r->acima[i]]);
+    }
+    saida_char(o, '\n');
+    if (o->len >= SAIDA_BUFFER) resolver_despejar_lista(r);
+}
+
+/* fim de um caminho: soma o resultado dele */
+static void resolver_folha(Resolvedor *r, uint32_t prof) {
+    r->st.caminhos += 1;
+    if (r->n_acima == 0) r->st.sem_culpado += 1;
+    else if (r->n_acima > 1) r->st.ambiguos += 1;
+    for (size_t i = 0; i < r->n_acima; ++i) r->st.condena[r->acima[i]] += 1;
+    if (r->lista) resolver_listar(r, prof);
+}
+
+/* publica os passos do caminho atual até 'prof' (só os que faltam) */
+static const Prefixo *resolver_publicar(Resolvedor *r, uint32_t prof) {
+    uint32_t k = prof + 1;
+    while (k > 0 && !r->prefixos[k - 1]) --k;
+    for (; k <= prof; ++k) {
+        Prefixo *p = arena_alloc(r->arena, sizeof(Prefixo));
+        if (!p) return NULL;
+        p->pai = k ? r->prefixos[k - 1] : NULL;
+        p->pista = r->ids[k];
+        p->prof = k;
+        p->mov = r->movs[k];
+        r->prefixos[k] = p;
+    }
+    return r->prefixos[prof];
+}
+
+/* percorre a subárvore da tarefa em profundidade, oferecendo as subárvores
+   direitas às outras threads enquanto a própria fila estiver curta */
+static void resolver_tarefa(Resolvedor *r, const TarefaCaminho *t, TarefaCaminho *pilha) {
+    PoolResolver *p = r->pool;
+    const MapaOps *op = p->mapa->ops;
+    void *dados = p->mapa->dados;
+    const Catalogo *cat = p->cat;
+    int dividir = p->n > 1;
+
+    /* refaz os contadores a partir do prefixo compartilhado, da raiz para
+       baixo (a ordem dos suspeitos fica igual à de uma thread só) */
+    for (const Prefixo *q = t->pai; q; q = q->pai) {
+        r->movs[q->prof] = q->mov;
+        r->ids[q->prof] = q->pista;
+        r->prefixos[q->prof] = q;
+    }
+    for (uint32_t k = 0; k < t->prof; ++k) resolver_coletar(r, r->ids[k]);
+
+    /* no == 0 marca a volta de uma sala (desfaz a pista dela) */
+    size_t k = 0;
+    pilha[k++] = *t;
+    while (k > 0) {
+        TarefaCaminho f = pilha[--k];
+        uint32_t d = f.prof;
+        if (!f.no) {
+            resolver_devolver(r, r->ids[d]);
+            continue;
+        }
+        r->st.salas += 1;
+        r->movs[d] = f.mov;
+        r->ids[d] = catalogo_id(cat, op->pista(dados, f.no));
+        r->prefixos[d] = NULL;
+        resolver_coletar(r, r->ids[d]);
+        NoMapa e = op->esq(dados, f.no), dir = op->dir(dados, f.no);
+        if (!e && !dir) {
+            resolver_folha(r, d);
+            resolver_devolver(r, r->ids[d]);
+            continue;
+        }
+        pilha[k++] = (TarefaCaminho){ 0, NULL, d, 0 };
+        if (e && dir && dividir && d + RESOLVER_CORTE < cat->profundidade &&
+            atomic_load_explicit(&r->fila.tam, memory_order_relaxed) < 2) {
+            const Prefixo *pai = resolver_publicar(r, d);
+            if (pai) {
+                atomic_fetch_add(&p->pendentes, 1);
+                if (fila_por(&r->fila, (TarefaCaminho){ dir, pai, d + 1, 'd' })) {
+                    r->st.tarefas += 1;
+                    dir = 0;
+                } else {
+                    atomic_fetch_sub(&p->pendentes, 1);
+                }
+            }
+        }
+        if (dir) pilha[k++] = (TarefaCaminho){ dir, NULL, d + 1, 'd' };
+        if (e) pilha[k++] = (TarefaCaminho){ e, NULL, d + 1, 'e' };
+    }
+
+    for (const Prefixo *q = t->pai; q; q = q->pai) resolver_devolver(r, q->pista);
+}
+
+/* própria fila primeiro; depois rouba das outras, a partir da vizinha */
+static int resolver_pegar(Resolvedor *r, TarefaCaminho *t) {
+    PoolResolver *p = r->pool;
+    if (fila_tirar(&r->fila, t, 1)) return 1;
+    int eu = (int)(r - p->rs);
+    for (int i = 1; i < p->n; ++i) {
+        Resolvedor *v = &p->rs[(eu + i) % p->n];
+        if (atomic_load_explicit(&v->fila.tam, memory_order_relaxed) && fila_tirar(&v->fila, t, 0)) {
+            r->st.roubos += 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *resolvedor_rodar(void *arg) {
+    Resolvedor *r = arg;
+    PoolResolver *p = r->pool;
+    TarefaCaminho *pilha = malloc(((size_t)p->cat->profundidade * 2 + 4) * sizeof(TarefaCaminho));
+    TarefaCaminho t;
+    if (!pilha) {
+        r->erro = 1;
+        /* as tarefas da fila ainda ficam para as outras threads */
+    }
+    for (;;) {
+        if (pilha && resolver_pegar(r, &t)) {
+            resolver_tarefa(r, &t, pilha);
+            atomic_fetch_sub(&p->pendentes, 1);
+            continue;
+        }
+        if (atomic_load(&p->pendentes) == 0) break;
+#ifdef DQ_POSIX
+        sched_yield();
+#endif
+    }
+    resolver_despejar_lista(r);
+    free(pilha);
+    return NULL;
+}
+
+static int resolvedor_iniciar(Resolvedor *r, PoolResolver *p) {
+    const Catalogo *cat = p->cat;
+    size_t prof = (size_t)cat->profundidade + 1, ns = cat->n_suspeitos ? cat->n_suspeitos : 1;
+    r->pool = p;
+#ifdef DQ_POSIX
+    pthread_mutex_init(&r->fila.trava, NULL);
+#endif
+    atomic_init(&r->fila.tam, 0);
+    r->arena = arena_criar(0);
+    r->presente = mem_calloc(cat->n ? cat->n : 1, sizeof(uint32_t));
+    r->votos = mem_calloc(ns, sizeof(uint32_t));
+    r->acima = mem_alloc(ns * sizeof(uint32_t));
+    r->acima_pos = mem_alloc(ns * sizeof(uint32_t));
+    r->movs = mem_alloc(prof);
+    r->ids = mem_alloc(prof * sizeof(uint32_t));
+    r->prefixos = mem_calloc(prof, sizeof(Prefixo *));
+    r->st.condena = mem_calloc(ns, sizeof(uint64_t));
+    r->st.n_suspeitos = cat->n_suspeitos;
+    if (p->lista) {
+        /* marca começa fora do alcance do contador de folhas */
+        r->marca = mem_alloc((cat->n ? cat->n : 1) * sizeof(uint64_t));
+        if (r->marca) memset(r->marca, 0xff, (cat->n ? cat->n : 1) * sizeof(uint64_t));
+        r->lista = saidaMemoria();
+        if (!r->marca || !r->lista) return -1;
+    }
+    if (!r->arena || !r->presente || !r->votos || !r->acima || !r->acima_pos || !r->movs ||
+        !r->ids || !r->prefixos || !r->st.condena) return -1;
+    return 0;
+}
+
+static void resolvedor_liberar(Resolvedor *r) {
+#ifdef DQ_POSIX
+    if (r->pool) pthread_mutex_destroy(&r->fila.trava);
+#endif
+    free(r->fila.v);
+    arena_liberar(r->arena);
+    mem_free(r->presente);
+    mem_free(r->votos);
+    mem_free(r->acima);
+    mem_free(r->acima_pos);
+    mem_free(r->movs);
+    mem_free(r->ids);
+    mem_free((void *)r->prefixos);
+    mem_free(r->marca);
+    saidaLiberar(r->lista);
+    mem_free(r->st.condena);
+}
+
+void resolverLiberarStats(ResolverStats *st) {
+    mem_free(st->condena);
+    st->condena = NULL;
+}
+
+/**
+ * resolverCaminhos(mapa, ht, n_threads, lista, st)
+ * Resolve todos os caminhos raiz -> folha em 'n_threads' threads (0 =
+ * núcleos). Com 'lista' != NULL escreve uma linha por caminho: movimentos
+ * ("-" = só a raiz), pistas coletadas na ordem e suspeitos com 2 pistas ou
+ * mais; a ordem das linhas entre threads não é fixa. Totais em *st.
+ * Retorna 0 em sucesso.
+ */
+int resolverCaminhos(Mapa *mapa, HashTable *ht, int n_threads, Saida *lista, ResolverStats *st) {
+    memset(st, 0, sizeof(*st));
+    Catalogo *cat = catalogoMontar(mapa, ht);
+    if (!cat) return -1;
+#ifndef DQ_POSIX
+    n_threads = 1;
+#endif
+    if (n_threads < 1) n_threads = nucleos_disponiveis();
+    PoolResolver pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.mapa = mapa;
+    pool.cat = cat;
+    pool.n = n_threads;
+    pool.lista = lista;
+    atomic_init(&pool.pendentes, 0);
+#ifdef DQ_POSIX
+    pthread_mutex_init(&pool.trava_lista, NULL);
+#endif
+    Resolvedor *rs = calloc((size_t)n_threads, sizeof(Resolvedor));
+    pool.rs = rs;
+    int ret = -1, iniciadas = 0;
+    if (!rs) goto fim;
+    for (int i = 0; i < n_threads; ++i)
+        if (resolvedor_iniciar(&rs[i], &pool) != 0) goto fim;
+    st->condena = mem_calloc(cat->n_suspeitos ? cat->n_suspeitos : 1, sizeof(uint64_t));
+    if (!st->condena) goto fim;
+    st->n_suspeitos = cat->n_suspeitos;
+    st->profundidade = cat->profundidade;
+    st->pistas = cat->n;
+    st->threads = n_threads;
+
+    double t0 = agora_seg();
+    NoMapa raiz = mapa->ops->raiz(mapa->dados);
+    if (raiz) {
+        atomic_store(&pool.pendentes, 1);
+        if (!fila_por(&rs[0].fila, (TarefaCaminho){ raiz, NULL, 0, 0 })) goto fim;
+        rs[0].st.tarefas = 1;
+    }
+#ifdef DQ_POSIX
+    /* a thread atual é o resolvedor 0 */
+    for (int i = 1; i < n_threads; ++i, ++iniciadas)
+        if (pthread_create(&rs[i].th, NULL, resolvedor_rodar, &rs[i]) != 0) break;
+#endif
+    resolvedor_rodar(&rs[0]);
+#ifdef DQ_POSIX
+    for (int i = 1; i <= iniciadas; ++i) pthread_join(rs[i].th, NULL);
+#endif
+    st->segundos = agora_seg() - t0;
+
+    ret = 0;
+    for (int i = 0; i <= iniciadas; ++i) {
+        const ResolverStats *s = &rs[i].st;
+        st->caminhos += s->caminhos;
+        st->sem_culpado += s->sem_culpado;
+        st->ambiguos += s->ambiguos;
+        st->salas += s->salas;
+        st->tarefas += s->tarefas;
+        st->roubos += s->roubos;
+        for (size_t j = 0; j < st->n_suspeitos; ++j) st->condena[j] += s->condena[j];
+        if (rs[i].erro) ret = -1;
+    }
+
+fim:
+    if (ret != 0) resolverLiberarStats(st);
+    for (int i = 0; rs && i < n_threads; ++i) resolvedor_liberar(&rs[i]);
+    free(rs);
+#ifdef DQ_POSIX
+    pthread_mutex_destroy(&pool.trava_lista);
+#endif
+    catalogoLiberar(cat);
+    return ret;
+}
+
+/* largura de printf para 's' ocupar 'colunas' na tela: %-*s conta bytes,
+   então soma os de continuação do UTF-8 */
+static int largura_colunas(const char *s, int colunas) {
+    for (; *s; ++s)
+        if (((unsigned char)*s & 0xc0u) == 0x80u) ++colunas;
+    return colunas;
+}
+
+/* resumo do resolvedor em stderr (nomes de hashSuspeitos(ht)) */
+void resolverRelatorio(const ResolverStats *st, HashTable *ht) {
+    const SuspeitoSet *sus = hashSuspeitos(ht);
+    double total = st->caminhos ? (double)st->caminhos : 1.0;
+    fprintf(stderr, "[resolver] %llu caminhos, %llu salas, profundidade máxima %u, "
+            "%zu pistas distintas\n", (unsigned long long)st->caminhos,
+            (unsigned long long)st->salas, st->profundidade, st->pistas);
+    fprintf(stderr, "[resolver] %d thread(s), %.3f s, %llu tarefas, %llu roubadas\n",
+            st->threads, st->segundos, (unsigned long long)st->tarefas,
+            (unsigned long long)st->roubos);
+    fprintf(stderr, "[resolver] sem culpado: %llu (%.1f%%)  mais de um culpado: %llu (%.1f%%)\n",
+            (unsigned long long)st->sem_culpado, 100.0 * (double)st->sem_culpado / total,
+            (unsigned long long)st->ambiguos, 100.0 * (double)st->ambiguos / total);
+    fprintf(stderr, "[resolver] caminhos em que cada suspeito reúne 2 pistas ou mais:\n");
+    for (size_t i = 0; i < st->n_suspeitos && i < sus->n; ++i) {
+        if (!sus->refs[i] && !st->condena[i]) continue;
+        fprintf(stderr, "  %-*s %12llu  (%5.1f%%)\n", largura_colunas(sus->nomes[i], 24),
+                sus->nomes[i], (unsigned long long)st->condena[i],
+                100.0 * (double)st->condena[i] / total);
+    }
+}
+
+/* ===========================
+   Pegada de memória (--pegada)
+   =========================== */
+
+/* uma linha do relatório; tam = 0 para o que não tem nó de tamanho fixo */
+static void pegada_linha(const char *nome, size_t tam, size_t qtd, size_t bytes) {
+    int largura = largura_colunas(nome, 34);
+    if (tam) printf("  %-*s %5zu B %13zu %16zu\n", largura, nome, tam, qtd, bytes);
+    else printf("  %-*s %7s %13zu %16zu\n", largura, nome, "", qtd, bytes);
+}
+
+/* bytes de uma string internada (cabeçalho + texto) */
+static size_t pegada_interna(const char *s) {
+    return sizeof(StrInterna) + strlen(s) + 1;
+}
+
+/* árvore de ponteiros: salas e strings distintas (nomes e pistas) */
+static size_t pegada_salas(Mapa *mapa, size_t *n_salas) {
+    const MapaOps *op = mapa->ops;
+    size_t cap = 1024, n = 0, k = 0, bytes = 0, n_str = 0, cap_p = 64;
+    const char **vistos = calloc(cap, sizeof(char *));
+    NoMapa *pilha = malloc(cap_p * sizeof(NoMapa));
+    NoMapa raiz = op->raiz(mapa->dados);
+    if (!vistos || !pilha) goto fim;
+    if (raiz) pilha[k++] = raiz;
+    while (k > 0) {
+        NoMapa no = pilha[--k];
+        const char *s[2] = { op->nome(mapa->dados, no), op->pista(mapa->dados, no) };
+        ++n;
+        for (int i = 0; i < 2; ++i) {
+            if (!s[i]) continue;
+            if (2 * (n_str + 1) > cap) {
+                const char **v = calloc(cap * 2, sizeof(char *));
+                if (!v) goto fim;
+                for (size_t j = 0; j < cap; ++j) {
+                    if (!vistos[j]) continue;
+                    size_t p = hash_misturar_ptr(vistos[j]) & (cap * 2 - 1);
+                    while (v[p]) p = (p + 1) & (cap * 2 - 1);
+                    v[p] = vistos[j];
+                }
+                free((void *)vistos);
+                vistos = v;
+                cap *= 2;
+            }
+            size_t p = hash_misturar_ptr(s[i]) & (cap - 1);
+            while (vistos[p] && vistos[p] != s[i]) p = (p + 1) & (cap - 1);
+            if (vistos[p]) continue;
+            vistos[p] = s[i];
+            n_str += 1;
+            bytes += pegada_interna(s[i]);
+        }
+        if (k + 2 > cap_p) {
+            NoMapa *tmp = realloc(pilha, cap_p * 2 * sizeof(NoMapa));
+            if (!tmp) goto fim;
+            pilha = tmp;
+            cap_p *= 2;
+        }
+        NoMapa e = op->esq(mapa->dados, no), d = op->dir(mapa->dados, no);
+        if (d) pilha[k++] = d;
+        if (e) pilha[k++] = e;
+    }
+    pegada_linha("Sala (árvore de ponteiros)", sizeof(Sala), n, n * sizeof(Sala));
+    pegada_linha("  strings internadas (nome, pista)", 0, n_str, bytes);
+fim:
+    free((void *)vistos);
+    free(pilha);
+    *n_salas = n;
+    return n * sizeof(Sala) + bytes;
+}
+
+/* hash pista -> suspeito, com os suspeitos e o índice de nomes */
+static size_t pegada_hash(HashTable *ht) {
+    size_t total = sizeof(HashTable), b;
+    const SuspeitoSet *sus = hashSuspeitos(ht);
+    switch (ht->modo) {
+    case HASH_ENCADEADA:
+        b = ht->tamanho * sizeof(HashEntry *);
+        pegada_linha("HashEntry* (baldes)", sizeof(HashEntry *), ht->tamanho, b);
+        pegada_linha("HashEntry", sizeof(HashEntry), ht->n, ht->n * sizeof(HashEntry));
+        total += b + ht->n * sizeof(HashEntry);
+        break;
+    case HASH_ABERTA:
+        b = ht->tamanho * sizeof(HashSlot);
+        pegada_linha("HashSlot (aberta)", sizeof(HashSlot), ht->tamanho, b);
+        total += b;
+        break;
+    case HASH_MAPEADA:
+        /* strings no pool do mapa (ou do arquivo) */
+        b = ht->tamanho * sizeof(CasoSlot);
+        pegada_linha("CasoSlot (mapeada)", sizeof(CasoSlot), ht->tamanho, b);
+        total += b;
+        break;
+    case HASH_PERFEITA: {
+        b = ht->n * sizeof(CasoSlot) + ht->n_baldes * sizeof(uint32_t);
+        pegada_linha("CasoSlot (perfeita)", sizeof(CasoSlot), ht->n, ht->n * sizeof(CasoSlot));
+        pegada_linha("  deslocamentos dos baldes", sizeof(uint32_t), ht->n_baldes,
+                     ht->n_baldes * sizeof(uint32_t));
+        size_t pool = 0;
+        for (size_t i = 0; i < ht->n; ++i) pool += strlen(ht->mpool + ht->mslots[i].chave) + 1;
+        for (size_t p = 0; p < sus->n; ++p) pool += strlen(sus->nomes[p]) + 1;
+        pegada_linha("  pool (pistas e suspeitos)", 0, ht->n + sus->n, pool);
+        total += b + pool;
+        break;
+    }
+    case HASH_CONCORRENTE:
+        pegada_linha("hash concorrente (não medida)", 0, ht->n, 0);
+        break;
+    }
+    if (ht->modo == HASH_ENCADEADA || ht->modo == HASH_ABERTA) {
+        /* chaves são as pistas do mapa; os suspeitos são strings à parte */
+        size_t nomes = 0;
+        for (size_t p = 0; p < sus->n; ++p) nomes += pegada_interna(sus->nomes[p]);
+        pegada_linha("  strings internadas (suspeitos)", 0, sus->n, nomes);
+        total += nomes;
+    }
+    b = sus->n * (sizeof(char *) + sizeof(uint32_t)) + sus->cap_idx * sizeof(uint32_t);
+    pegada_linha("SuspeitoSet", 0, sus->n, b);
+    total += b;
+    const IndiceNomes *ix = hashIndiceNomes(ht);
+    if (ix) {
+        b = ix->n * 2 * sizeof(uint32_t) + ix->cap_slots * sizeof(uint32_t);
+        for (size_t i = 0; i < ix->n; ++i) b += strlen(ix->chaves + ix->off[i]) + 1;
+        pegada_linha("IndiceNomes", 0, ix->n, b);
+        total += b;
+    }
+    return total;
+}
+
+static size_t pegada_catalogo(const Catalogo *cat) {
+    size_t b = cat->cap * (sizeof(char *) + sizeof(uint32_t)) +
+               cat->cap_slots * (sizeof(char *) + sizeof(uint32_t));
+    size_t m = cat->mascaras ? cat->n_suspeitos * cat->palavras * sizeof(uint64_t) : 0;
+    pegada_linha("Catalogo (ids das pistas)", 0, cat->n, b);
+    pegada_linha("  máscaras por suspeito", 0, cat->mascaras ? cat->n_suspeitos : 0, m);
+    return sizeof(Catalogo) + b + m;
+}
+
+/**
+ * pegadaRelatorio(mapa, ht, alvo)
+ * Bytes de cada estrutura do caso carregado (mapa, hash, catálogo e resumo
+ * como o jogo os monta), os de uma sessão e a projeção do total por sala
+ * para 'alvo' salas. Mapas sob demanda não são medidos.
+ */
+int pegadaRelatorio(Mapa *mapa, HashTable *ht, size_t alvo) {
+    const MapaOps *op = mapa->ops;
+    size_t n = 0, b_mapa = 0;
+    if (op == &mapa_sob_ops) {
+        fprintf(stderr, "Erro: --pegada não mede mapas sob demanda.\n");
+        return -1;
+    }
+    printf("Tamanho dos nós (ponteiro de %zu bytes):\n", sizeof(void *));
+    printf("  Sala %zu B + 2 strings, SalaPlana %zu B, SalaCompacta %zu B, PistaNode %zu B + 1 string,\n"
+           "  HashEntry %zu B + 2 strings, HashSlot %zu B, CasoSlot %zu B, StrInterna %zu B + texto\n",
+           sizeof(Sala), sizeof(SalaPlana), sizeof(SalaCompacta), sizeof(PistaNode),
+           sizeof(HashEntry), sizeof(HashSlot), sizeof(CasoSlot), sizeof(StrInterna));
+
+    printf("\n  %-34s %8s %13s %16s\n", "estrutura", "nó", "quantidade", "bytes");
+    if (op == &mapa_plano_ops) {
+        const MapaPlano *p = mapa->dados;
+        n = p->n;
+        pegada_linha("SalaPlana", sizeof(SalaPlana), n, n * sizeof(SalaPlana));
+        pegada_linha("  pool (nomes e pistas)", 0, 1, p->pool_len);
+        b_mapa = n * sizeof(SalaPlana) + p->pool_len;
+    } else if (op == &mapa_compacto_ops) {
+        const MapaCompacto *c = mapa->dados;
+        n = c->n;
+        pegada_linha("SalaCompacta", sizeof(SalaCompacta), n, n * sizeof(SalaCompacta));
+        pegada_linha("  textos próprios (offsets)", sizeof(uint64_t), c->n_textos,
+                     c->n_textos * sizeof(uint64_t));
+        pegada_linha("  pool (pistas fora da hash)", 0, 1, c->pool_len);
+        b_mapa = n * sizeof(SalaCompacta) + c->n_textos * sizeof(uint64_t) + c->pool_len;
+    } else {
+        b_mapa = pegada_salas(mapa, &n);
+    }
+    size_t b_hash = pegada_hash(ht);
+
+    /* o que a partida monta: o resumo (dicas) ou, sem ele, só o catálogo */
+    ResumoMapa *r = resumoMontar(mapa, ht);
+    Catalogo *cat = r ? r->cat : catalogoMontar(mapa, ht);
+    size_t b_cat = cat ? pegada_catalogo(cat) : 0, b_resumo = 0;
+    if (r) {
+        size_t ns = cat->n_suspeitos;
+        b_resumo = r->n * (r->palavras * sizeof(uint64_t) + sizeof(uint32_t) + ns * sizeof(uint16_t)) +
+                   r->cap * (sizeof(NoMapa) + sizeof(uint32_t));
+        pegada_linha("ResumoMapa (dicas)", 0, r->n, b_resumo);
+    } else {
+        pegada_linha("ResumoMapa (desligado: grande demais)", 0, 0, 0);
+    }
+    size_t total = b_mapa + b_hash + b_cat + b_resumo;
+    pegada_linha("total", 0, n, total);
+    printf("  %.1f B/sala (mapa %.1f, hash %.1f, catálogo %.1f, resumo %.1f)\n",
+           (double)total / (double)n, (double)b_mapa / (double)n, (double)b_hash / (double)n,
+           (double)b_cat / (double)n, (double)b_resumo / (double)n);
+
+    /* por sessão: BST de pistas (sem catálogo) ou o bitset */
+    if (cat) {
+        printf("\nPor sessão: bitset de %zu B, ou PistaNode %zu B por pista coletada (sem catálogo)\n",
+               cat->palavras * sizeof(uint64_t), sizeof(PistaNode));
+    }
+
+    /* o resumo não entra: acima de RESUMO_MAX_BYTES ele nem é montado */
+    double por_sala = (double)(b_mapa + b_hash + b_cat) / (double)n;
+    printf("Projeção para %zu salas: %.2f GiB (mapa + hash + catálogo, %.1f B/sala)\n", alvo,
+           por_sala * (double)alvo / (1024.0 * 1024.0 * 1024.0), por_sala);
+    if (r) resumoLiberar(r);
+    else catalogoLiberar(cat);
+    return 0;
+}
+
+/* ===========================
+   Benchmarks
+   =========================== */
+
+/* mede inserção de n pistas e n buscas com acerto + n sem acerto */
+static void bench_hash_variante(const char *rotulo, HashTable *ht, const char **pistas,
+                                const char **ausentes, const char **suspeitos, size_t n) {
+    double t0 = agora_seg();
+    for (size_t i = 0; i < n; ++i) inserirNaHash(ht, pistas[i], suspeitos[i & 15]);
+    double t1 = agora_seg();
+    size_t achados = 0;
+    for (size_t i = 0; i < n; ++i) achados += encontrarSuspeito(ht, pistas[i]) != NULL;
+    double t2 = agora_seg();
+    for (size_t i = 0; i < n; ++i) achados += encontrarSuspeito(ht, ausentes[i]) != NULL;
+    double t3 = agora_seg();
+    printf("%-18s n=%zu  inserção %8.1f ns/op  busca(acerto) %8.1f ns/op  "
+           "busca(falha) %8.1f ns/op  [%zu achados, %zu slots]\n",
+           rotulo, n, (t1 - t0) * 1e9 / (double)n, (t2 - t1) * 1e9 / (double)n,
+           (t3 - t2) * 1e9 / (double)n, achados, ht->tamanho);
+    liberarHash(ht);
+}
+
+/* --bench-hash [n]: encadeada (31 baldes e n baldes) contra a tabela aberta */
+static void bench_hash(size_t n) {
+    const char **pistas = malloc(n * sizeof(char *));
+    const char **ausentes = malloc(n * sizeof(char *));
+    const char *suspeitos[16];
+    char buf[64];
+    if (!pistas || !ausentes) {
+        fprintf(stderr, "Erro: memória para o benchmark\n");
+        free(pistas);
+        free(ausentes);
+        return;
+    }
+    /* strings internadas antes: o custo medido é só o da tabela */
+    for (size_t i = 0; i < 16; ++i) {
+        snprintf(buf, sizeof(buf), "Suspeito %zu", i);
+        suspeitos[i] = intern(buf);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf), "pista gerada %zu", i);
+        pistas[i] = intern(buf);
+        snprintf(buf, sizeof(buf), "pista ausente %zu", i);
+        ausentes[i] = intern(buf);
+    }
+    /* com 31 baldes o custo é quadrático: acima disso o teste levaria minutos */
+    if (n <= 200000)
+        bench_hash_variante("encadeada(31)", criarHash(31), pistas, ausentes, suspeitos, n);
+    else
+        printf("%-18s n=%zu  (omitida: O(n^2) com 31 baldes)\n", "encadeada(31)", n);
+    bench_hash_variante("encadeada(n)", criarHash(n), pistas, ausentes, suspeitos, n);
+    bench_hash_variante("aberta(cresce)", criarHashAberta(0), pistas, ausentes, suspeitos, n);
+    free(pistas);
+    free(ausentes);
+}
+
+/* histograma do comprimento das cadeias de uma tabela encadeada */
+static void bench_histograma_cadeias(const char *rotulo, const HashTable *ht) {
+    size_t hist[9] = { 0 }, maior = 0;
+    for (size_t i = 0; i < ht->tamanho; ++i) {
+        size_t c = 0;
+        for (const HashEntry *e = ht->buckets[i]; e; e = e->prox) ++c;
+        hist[c < 8 ? c : 8] += 1;
+        if (c > maior) maior = c;
+    }
+    printf("  %-22s baldes=%zu  cadeias:", rotulo, ht->tamanho);
+    for (size_t c = 0; c < 9; ++c) printf(" %s%zu=%zu", c == 8 ? ">=" : "", c, hist[c]);
+    printf("  maior=%zu\n", maior);
+}
+
+/* vazão de uma função de hash sobre um conjunto de chaves */
+static void bench_vazao_hash(const char *rotulo, FuncHash fn, const char **chaves,
+                             const size_t *lens, size_t n, size_t repeticoes) {
+    uint64_t acc = 0;
+    size_t bytes = 0;
+    double t0 = agora_seg();
+    for (size_t r = 0; r < repeticoes; ++r)
+        for (size_t i = 0; i < n; ++i) {
+            acc ^= fn(chaves[i], lens[i], r);
+            bytes += lens[i];
+        }
+    double dt = agora_seg() - t0;
+    printf("  %-22s %8.2f Mhash/s  %7.2f GB/s  (x=%016llx)\n", rotulo,
+           (double)(n * repeticoes) / dt * 1e-6, (double)bytes / dt * 1e-9,
+           (unsigned long long)acc);
+}
+
+/* cópia de string para os benchmarks (strdup não é C padrão) */
+static char *bench_copia(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *c = malloc(n);
+    if (c) memcpy(c, s, n);
+    return c;
+}
+
+#ifdef DQ_POSIX
+/* uma thread do benchmark concorrente (leitora ou escritora) */
+typedef struct BenchConc {
+    HashTable *ht;
+    const char **chaves;       /* pistas pré-inseridas */
+    const char **suspeitos;
+    size_t n;
+    atomic_int *parar;
+    size_t ops, falhas;
+    pthread_t th;
+} BenchConc;
+
+static void *bench_conc_leitor(void *arg) {
+    BenchConc *b = arg;
+    size_t i = (size_t)(uintptr_t)b % b->n, ops = 0, falhas = 0;
+    while (!atomic_load_explicit(b->parar, memory_order_relaxed)) {
+        for (int k = 0; k < 64; ++k) {
+            falhas += encontrarSuspeito(b->ht, b->chaves[i]) == NULL;
+            if (++i == b->n) i = 0;
+        }
+        ops += 64;
+    }
+    b->ops = ops;
+    b->falhas = falhas;
+    return NULL;
+}
+
+/* escritor: metade pistas novas (faz a tabela crescer), metade trocas */
+static void *bench_conc_escritor(void *arg) {
+    BenchConc *b = arg;
+    char buf[64];
+    size_t ops = 0;
+    while (!atomic_load_explicit(b->parar, memory_order_relaxed)) {
+        if (ops & 1) {
+            inserirNaHash(b->ht, b->chaves[(ops * 7919) % b->n], b->suspeitos[ops & 15]);
+        } else {
+            snprintf(buf, sizeof(buf), "pista ao vivo %zu", ops);
+            inserirNaHash(b->ht, buf, b->suspeitos[ops & 15]);
+        }
+        ++ops;
+    }
+    b->ops = ops;
+    return NULL;
+}
+#endif
+
+/* --bench-hash-concorrente [n]: buscas/s com 1, 4, 16 e 64 leitoras
+   enquanto uma escritora insere e troca associações ao vivo */
+static void bench_hash_concorrente(size_t n) {
+#ifdef DQ_POSIX
+    static const int leitoras[] = { 1, 4, 16, 64 };
+    const char **chaves = malloc(n * sizeof(char *));
+    const char *suspeitos[16];
+    char buf[64];
+    if (!chaves) return;
+    for (size_t i = 0; i < 16; ++i) {
+        snprintf(buf, sizeof(buf), "Suspeito %zu", i);
+        suspeitos[i] = intern(buf);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf), "pista gerada %zu", i);
+        chaves[i] = intern(buf);
+    }
+    printf("Hash concorrente: %zu pistas pré-inseridas, 1 escritora, %d núcleo(s)\n",
+           n, nucleos_disponiveis());
+    for (size_t r = 0; r < sizeof(leitoras) / sizeof(leitoras[0]); ++r) {
+        HashTable *ht = criarHashConcorrente(64);
+        BenchConc *bs = calloc((size_t)leitoras[r] + 1, sizeof(BenchConc));
+        atomic_int parar;
+        if (!ht || !bs) {
+            liberarHash(ht);
+            free(bs);
+            break;
+        }
+        atomic_init(&parar, 0);
+        for (size_t i = 0; i < n; ++i) inserirNaHash(ht, chaves[i], suspeitos[i & 15]);
+        size_t aposentados0 = ht->conc->n_aposentados, recolhidos0 = ht->conc->n_recolhidos;
+
+        int criadas = 0;
+        for (int t = 0; t <= leitoras[r]; ++t, ++criadas) {
+            bs[t] = (BenchConc){ ht, chaves, suspeitos, n, &parar, 0, 0, 0 };
+            if (pthread_create(&bs[t].th, NULL, t == 0 ? bench_conc_escritor : bench_conc_leitor,
+                               &bs[t]) != 0)
+                break;
+        }
+        double t0 = agora_seg();
+        struct timespec pausa = { 0, 300 * 1000 * 1000 };
+        nanosleep(&pausa, NULL);
+        atomic_store(&parar, 1);
+        for (int t = 0; t < criadas; ++t) pthread_join(bs[t].th, NULL);
+        double dt = agora_seg() - t0;
+
+        size_t buscas = 0, falhas = 0;
+        for (int t = 1; t < criadas; ++t) {
+            buscas += bs[t].ops;
+            falhas += bs[t].falhas;
+        }
+        printf("  leitoras=%-3d %9.2f Mbuscas/s (%7.2f por leitora)  escritas %8.0f/s  "
+               "crescimentos=%zu liberados=%zu  falhas=%zu\n",
+               leitoras[r], (double)buscas / dt * 1e-6,
+               (double)buscas / dt * 1e-6 / (criadas > 1 ? criadas - 1 : 1),
+               (double)bs[0].ops / dt, ht->conc->n_aposentados - aposentados0,
+               ht->conc->n_recolhidos - recolhidos0, falhas);
+        liberarHash(ht);
+        free(bs);
+    }
+    free(chaves);
+#else
+    (void)n;
+    printf("Hash concorrente: requer threads POSIX.\n");
+#endif
+}
+
+/* --bench-hash-funcs [n]: vazão (chaves curtas e longas) e distribuição
+   das cadeias para cada função embutida */
+static void bench_funcoes_hash(size_t n) {
+    char **curtas = malloc(n * sizeof(char *));
+    char **longas = malloc(n * sizeof(char *));
+    size_t *lc = malloc(n * sizeof(size_t));
+    size_t *ll = malloc(n * sizeof(size_t));
+    char buf[160];
+    if (!curtas || !longas || !lc || !ll) {
+        fprintf(stderr, "Erro: memória para o benchmark\n");
+        free(curtas); free(longas); free(lc); free(ll);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf), "pista gerada %zu", i);
+        curtas[i] = bench_copia(buf);
+        lc[i] = strlen(buf);
+        snprintf(buf, sizeof(buf), "Relatório do perito: fragmento %zu encontrado junto à "
+                 "janela norte, com marcas de lama e fibras azuis", i);
+        longas[i] = bench_copia(buf);
+        ll[i] = strlen(buf);
+    }
+    size_t rep = 20000000 / n + 1;
+    printf("Vazão, chaves curtas (~16 bytes):\n");
+    for (size_t k = 0; k < N_HASH_EMBUTIDAS; ++k)
+        bench_vazao_hash(hash_embutidas[k].nome, hash_embutidas[k].fn,
+                         (const char **)curtas, lc, n, rep);
+    printf("Vazão, chaves longas (~110 bytes):\n");
+    for (size_t k = 0; k < N_HASH_EMBUTIDAS; ++k)
+        bench_vazao_hash(hash_embutidas[k].nome, hash_embutidas[k].fn,
+                         (const char **)longas, ll, n, rep);
+
+    printf("Cadeias com %zu chaves curtas (tabela encadeada):\n", n);
+    for (size_t k = 0; k < N_HASH_EMBUTIDAS; ++k) {
+        for (int modulo = 0; modulo <= 1; ++modulo) {
+            HashConfig cfg = { HASH_ENCADEADA, n, hash_embutidas[k].fn, 0, modulo, NULL };
+            HashTable *ht = criarHashConfig(&cfg);
+            if (!ht) continue;
+            for (size_t i = 0; i < n; ++i) inserirNaHash(ht, curtas[i], "x");
+            snprintf(buf, sizeof(buf), "%s (%s)", hash_embutidas[k].nome,
+                     modulo ? "módulo" : "máscara");
+            bench_histograma_cadeias(buf, ht);
+            liberarHash(ht);
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        free(curtas[i]);
+        free(longas[i]);
+    }
+    free(curtas); free(longas); free(lc); free(ll);
+}
+
+/* tempo por item de uma rodada de bench_texto (ns) e soma de conferência */
+typedef struct BenchTexto {
+    double ns;
+    uint64_t soma;
+} BenchTexto;
+
+/* uma operação de texto sobre todas as strings, 'rep' vezes */
+static BenchTexto bench_texto_rodada(int op, char **v, const size_t *lens, size_t n, size_t rep) {
+    char dest[256];
+    BenchTexto r = { 0, 0 };
+    double t0 = agora_seg();
+    for (size_t k = 0; k < rep; ++k) {
+        for (size_t i = 0; i < n; ++i) {
+            const char *a = v[i], *b = v[(i + 1) % n];
+            switch (op) {
+            case 0: r.soma += normalizarNome(a, dest, sizeof(dest)) + (unsigned char)dest[0]; break;
+            case 1: r.soma += nucleosTexto()->brancos((const unsigned char *)a, lens[i]); break;
+            case 2: r.soma += texto_comparar(a, lens[i], b, lens[(i + 1) % n]) < 0; break;
+            case 3: r.soma += strcmp(a, b) < 0; break;
+            case 4: r.soma += hash_djb2_bytes(a, lens[i], k); break;
+            default: r.soma += hash_djb2(a, lens[i], k); break;
+            }
+        }
+    }
+    r.ns = (agora_seg() - t0) * 1e9 / (double)(n * rep);
+    return r;
+}
+
+/* mede 'op' com cada conjunto de núcleos que a CPU executa */
+static void bench_texto_nucleos(const char *rotulo, int op, char **v, const size_t *lens,
+                                size_t n, size_t rep) {
+    uint64_t ref = 0;
+    printf("  %-26s", rotulo);
+    for (size_t i = 0; i < N_NUCLEOS; ++i) {
+        if (!nucleos_suportados(nucleos_todos[i])) continue;
+        atomic_store(&nucleos_atual, nucleos_todos[i]);
+        BenchTexto r = bench_texto_rodada(op, v, lens, n, rep);
+        if (i == 0) ref = r.soma;
+        printf("  %s %6.1f ns%s", nucleos_todos[i]->nome, r.ns, r.soma == ref ? "" : " (DIVERGE)");
+    }
+    printf("\n");
+}
+
+/* contar_e de cada conjunto de núcleos sobre dois bitsets de 'n' palavras
+   (as de um bitset de partida contra a máscara de um suspeito) */
+static void bench_contar_nucleos(size_t n, size_t rep) {
+    uint64_t *a = malloc(2 * n * sizeof(uint64_t)), *b = a + n;
+    uint64_t x = 0x2545f4914f6cdd1dull, ref = 0;
+    if (!a) return;
+    for (size_t i = 0; i < 2 * n; ++i) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        a[i] = x;
+    }
+    printf("  %-26s", "contar bits (a & b, 1 KB)");
+    for (size_t i = 0; i < N_NUCLEOS; ++i) {
+        if (!nucleos_suportados(nucleos_todos[i])) continue;
+        uint64_t soma = 0;
+        double t0 = agora_seg();
+        for (size_t k = 0; k < rep; ++k) soma += nucleos_todos[i]->contar_e(a, b + k % 2, n - 1);
+        double ns = (agora_seg() - t0) * 1e9 / (double)rep;
+        if (i == 0) ref = soma;
+        printf("  %s %6.1f ns%s", nucleos_todos[i]->nome, ns, soma == ref ? "" : " (DIVERGE)");
+    }
+    printf("\n");
+    free(a);
+}
+
+/* gera 'n' strings a partir do formato (um %zu) */
+static char **bench_texto_gerar(const char *fmt, size_t n, size_t *lens) {
+    char **v = malloc(n * sizeof(char *));
+    char buf[256];
+    if (!v) return NULL;
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf), fmt, i);
+        lens[i] = strlen(buf);
+        v[i] = bench_copia(buf);
+    }
+    return v;
+}
+
+/* núcleos de texto contra as versões escalares (byte a byte) */
+static void bench_texto(size_t n) {
+    static const char *const fmts[4] = {
+        "  Suspeita MARIA da Silva %zu",
+        "Relatório DO PERITO: fragmento %zu encontrado junto à janela norte, "
+        "com MARCAS de lama e fibras azuis",
+        "                                        %zu",
+        "Relatório do perito: fragmento encontrado junto à janela norte %zu",
+    };
+    size_t *lens[4];
+    char **v[4];
+    const NucleosTexto *antes = nucleosTexto();
+    for (int f = 0; f < 4; ++f) {
+        lens[f] = malloc(n * sizeof(size_t));
+        v[f] = lens[f] ? bench_texto_gerar(fmts[f], n, lens[f]) : NULL;
+        if (!v[f]) {
+            fprintf(stderr, "Erro: memória para o benchmark\n");
+            return;
+        }
+    }
+    size_t rep = 5000000 / n + 1;
+    printf("Núcleos de texto: %zu strings, %zu rodadas (em uso: %s)\n", n, rep, antes->nome);
+    bench_texto_nucleos("normalizarNome (~30 B)", 0, v[0], lens[0], n, rep);
+    bench_texto_nucleos("normalizarNome (~110 B)", 0, v[1], lens[1], n, rep);
+    bench_texto_nucleos("pular brancos (~45 B)", 1, v[2], lens[2], n, rep);
+    bench_texto_nucleos("comparar (prefixo ~64 B)", 2, v[3], lens[3], n, rep);
+    bench_contar_nucleos(128, rep * 64);
+    atomic_store(&nucleos_atual, antes);
+    printf("  %-26s  strcmp %6.1f ns\n", "comparar, libc", bench_texto_rodada(3, v[3], lens[3], n, rep).ns);
+    for (int f = 0; f < 2; ++f) {
+        BenchTexto a = bench_texto_rodada(4, v[f], lens[f], n, rep);
+        BenchTexto b = bench_texto_rodada(5, v[f], lens[f], n, rep);
+        printf("  djb2 (%s)%*s  byte a byte %6.1f ns  blocos de 8 %6.1f ns%s\n",
+               f ? "~110 B" : "~30 B", f ? 12 : 13, "", a.ns, b.ns,
+               a.soma == b.soma ? "" : " (DIVERGE)");
+    }
+    for (int f = 0; f < 4; ++f) {
+        for (size_t i = 0; i < n; ++i) free(v[f][i]);
+        free(v[f]);
+        free(lens[f]);
+    }
+}
+
+/* ===========================
+   Suíte de benchmarks (--bench)
+   =========================== */
+
+/* Estado de um caso em execução, no molde do Google Benchmark: o corpo monta
+   os dados, mede o laço 'while (bench_continuar(st))' e desmonta tudo fora
+   do tempo medido. bench_pausar/bench_retomar tiram trechos do laço. */
+typedef struct BenchEstado {
+    size_t arg;                /* parâmetro do caso (salas, pistas, carga em %) */
+    int var;                   /* variante (carga de trabalho, organização da hash) */
+    size_t iteracoes;          /* voltas pedidas pelo executor */
+    size_t feitas;             /* chamadas de bench_continuar */
+    size_t itens;              /* itens processados por volta (para itens/s) */
+    double real, cpu;          /* tempo medido, sem as pausas */
+    double real0, cpu0;        /* início do trecho em andamento */
+    int erro;                  /* 1 = faltou memória; o caso é descartado */
+    const char *falha;         /* resultado errado (com erro = 1): em vez de "memória" */
+} BenchEstado;
+
+/* um caso registrado: nome (como aparece na saída), corpo e parâmetros */
+typedef struct BenchCaso {
+    const char *nome;
+    void (*corpo)(BenchEstado *st);
+    size_t arg;
+    int var;
+} BenchCaso;
+
+/* medição final de um caso (uma linha da tabela, um objeto do JSON) */
+typedef struct BenchResultado {
+    const char *nome;
+    size_t iteracoes;
+    double real_ns, cpu_ns;    /* por volta */
+    double itens_s;            /* 0 = o caso não conta itens */
+    const char *falha;         /* caso com erro: o que deu errado (NULL = memória) */
+} BenchResultado;
+
+/* baldes/slots fixos dos casos de carga: n = BENCH_HASH_SLOTS * carga / 100 */
+#define BENCH_HASH_SLOTS 16384
+#define BENCH_MAX_ITER 1000000000u
+
+/* o compilador não pode descartar o que vai para cá */
+static volatile size_t bench_sumidouro;
+
+/* tempo de CPU do processo em segundos (os casos rodam numa thread só) */
+static double cpu_seg(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void bench_retomar(BenchEstado *st) {
+    st->real0 = agora_seg();
+    st->cpu0 = cpu_seg();
+}
+
+static void bench_pausar(BenchEstado *st) {
+    st->real += agora_seg() - st->real0;
+    st->cpu += cpu_seg() - st->cpu0;
+}
+
+/* condição do laço medido: liga o relógio na primeira volta e desliga
+   depois da última (ou se o corpo marcou erro) */
+static int bench_continuar(BenchEstado *st) {
+    if (st->feitas++ == 0) bench_retomar(st);
+    if (st->feitas <= st->iteracoes && !st->erro) return 1;
+    bench_pausar(st);
+    return 0;
+}
+
+static uint64_t bench_aleatorio(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+/* n strings internadas "<prefixo> 00000000", ..., na ordem de strcmp */
+static const char **bench_nomes(const char *prefixo, size_t n) {
+    const char **v = malloc((n ? n : 1) * sizeof(char *));
+    char buf[64];
+    for (size_t i = 0; v && i < n; ++i) {
+        snprintf(buf, sizeof(buf), "%s %08zu", prefixo, i);
+        if (!(v[i] = intern(buf))) {
+            free((void *)v);
+            return NULL;
+        }
+    }
+    return v;
+}
+
+/* embaralha v (Fisher-Yates) com semente fixa: toda execução mede o mesmo */
+static void bench_embaralhar(const char **v, size_t n) {
+    uint64_t x = 0x2545f4914f6cdd1dull;
+    for (size_t i = n; i > 1; --i) {
+        size_t j = bench_aleatorio(&x) % i;
+        const char *t = v[i - 1];
+        v[i - 1] = v[j];
+        v[j] = t;
+    }
+}
+
+/* 16 suspeitos internados */
+static void bench_suspeitos(const char *sus[16]) {
+    char buf[32];
+    for (int i = 0; i < 16; ++i) {
+        snprintf(buf, sizeof(buf), "Suspeito %d", i);
+        sus[i] = intern(buf);
+    }
+}
+
+/* árvore completa com n salas em ordem de largura (filhos de i: 2i+1, 2i+2);
+   v tem n posições de trabalho. Sem arena, desfaz o que criou se faltar memória. */
+static Sala *bench_arvore(Arena *a, const char **nomes, const char **pistas, size_t n, Sala **v) {
+    for (size_t i = 0; i < n; ++i) {
+        if (!(v[i] = criarSalaEm(a, nomes[i], pistas ? pistas[i] : NULL))) {
+            while (!a && i > 0) mem_free(v[--i]);
+            return NULL;
+        }
+        if (i > 0) {
+            Sala *pai = v[(i - 1) / 2];
+            if (i & 1) pai->esq = v[i];
+            else pai->dir = v[i];
+        }
+    }
+    return n ? v[0] : NULL;
+}
+
+/* mansão de n salas, uma pista por sala, cada pista com um dos 16 suspeitos */
+typedef struct BenchMansao {
+    Arena *arena;              /* salas */
+    Sala *raiz;
+    HashTable *ht;             /* aberta, no heap */
+    const char **pistas;       /* pista da sala i */
+    const char *sus[16];
+    size_t n;
+} BenchMansao;
+
+static void bench_mansao_liberar(BenchMansao *m) {
+    if (m->ht) liberarHash(m->ht);
+    arena_liberar(m->arena);
+    free((void *)m->pistas);
+    memset(m, 0, sizeof(*m));
+}
+
+static int bench_mansao(BenchMansao *m, size_t n) {
+    memset(m, 0, sizeof(*m));
+    m->n = n;
+    bench_suspeitos(m->sus);
+    const char **nomes = bench_nomes("Sala", n);
+    Sala **v = malloc((n ? n : 1) * sizeof(Sala *));
+    m->arena = arena_criar(0);
+    m->pistas = bench_nomes("pista", n);
+    m->ht = criarHashAberta(n);
+    if (nomes && v && m->arena && m->pistas && m->ht)
+        m->raiz = bench_arvore(m->arena, nomes, m->pistas, n, v);
+    free((void *)nomes);
+    free(v);
+    if (!m->raiz) {
+        bench_mansao_liberar(m);
+        return -1;
+    }
+    for (size_t i = 0; i < n; ++i) inserirNaHash(m->ht, m->pistas[i], m->sus[i & 15]);
+    return 0;
+}
+
+/* criarSala/<heap|arena>/n: monta a árvore completa (var 1 = na arena) */
+static void bench_criar_salas(BenchEstado *st) {
+    size_t n = st->arg;
+    const char **nomes = bench_nomes("Sala", n), **pistas = bench_nomes("pista", n);
+    Sala **v = malloc(n * sizeof(Sala *));
+    Arena *a = st->var ? arena_criar(0) : NULL;
+    if (!nomes || !pistas || !v || (st->var && !a)) st->erro = 1;
+    st->itens = n;
+    while (bench_continuar(st)) {
+        Sala *raiz = bench_arvore(a, nomes, pistas, n, v);
+        bench_pausar(st);
+        if (!raiz) st->erro = 1;
+        if (a) arena_reiniciar(a);
+        else liberarSalas(raiz);
+        bench_retomar(st);
+    }
+    arena_liberar(a);
+    free(v);
+    free((void *)nomes);
+    free((void *)pistas);
+}
+
+/* liberarSalas/n: só a liberação; a árvore é remontada fora do tempo */
+static void bench_liberar_salas(BenchEstado *st) {
+    size_t n = st->arg;
+    const char **nomes = bench_nomes("Sala", n), **pistas = bench_nomes("pista", n);
+    Sala **v = malloc(n * sizeof(Sala *));
+    if (!nomes || !pistas || !v) st->erro = 1;
+    st->itens = n;
+    while (bench_continuar(st)) {
+        bench_pausar(st);
+        Sala *raiz = bench_arvore(NULL, nomes, pistas, n, v);
+        if (!raiz) st->erro = 1;
+        bench_retomar(st);
+        liberarSalas(raiz);
+    }
+    free(v);
+    free((void *)nomes);
+    free((void *)pistas);
+}
+
+/* inserirPista/<aleatoria|ordenada|duplicadas>/n: n inserções numa BST
+   vazia; duplicadas sorteia entre n/16 pistas distintas */
+static void bench_inserir_pistas(BenchEstado *st) {
+    size_t n = st->arg, distintas = st->var == 2 ? n / 16 + 1 : n;
+    const char **base = bench_nomes("pista", distintas);
+    const char **seq = malloc(n * sizeof(char *));
+    if (!base || !seq) {
+        st->erro = 1;
+    } else {
+        uint64_t x = 0x9e3779b97f4a7c15ull;
+        for (size_t i = 0; i < n; ++i)
+            seq[i] = st->var == 2 ? base[bench_aleatorio(&x) % distintas] : base[i];
+        if (st->var == 0) bench_embaralhar(seq, n);
+    }
+    st->itens = n;
+    while (bench_continuar(st)) {
+        PistaNode *raiz = NULL;
+        for (size_t i = 0; i < n; ++i) raiz = inserirPista(raiz, seq[i]);
+        bench_pausar(st);
+        liberarPistas(raiz);
+        bench_retomar(st);
+    }
+    free((void *)seq);
+    free((void *)base);
+}
+
+/* tabela vazia com BENCH_HASH_SLOTS baldes (var 0) ou slots (var 1) */
+static HashTable *bench_hash_vazia(int aberta) {
+    if (aberta) return criarHashAberta(BENCH_HASH_SLOTS / HASH_ABERTA_CARGA_DEN * HASH_ABERTA_CARGA_NUM);
+    return criarHash(BENCH_HASH_SLOTS);
+}
+
+/* inserirNaHash/<encadeada|aberta>/carga:c — n = slots * c / 100 inserções
+   numa tabela do tamanho fixo, sem crescer */
+static void bench_hash_inserir(BenchEstado *st) {
+    size_t n = BENCH_HASH_SLOTS * st->arg / 100;
+    const char **pistas = bench_nomes("pista", n);
+    const char *sus[16];
+    bench_suspeitos(sus);
+    if (!pistas) st->erro = 1;
+    else bench_embaralhar(pistas, n);
+    st->itens = n;
+    while (bench_continuar(st)) {
+        bench_pausar(st);
+        HashTable *ht = bench_hash_vazia(st->var);
+        if (!ht) st->erro = 1;
+        bench_retomar(st);
+        for (size_t i = 0; ht && i < n; ++i) inserirNaHash(ht, pistas[i], sus[i & 15]);
+        bench_pausar(st);
+        if (ht) liberarHash(ht);
+        bench_retomar(st);
+    }
+    free((void *)pistas);
+}
+
+/* encontrarSuspeito/<encadeada|aberta|perfeita>/<acerto|falha>/carga:c
+   (var = organização * 2 + falha; perfeita = aberta depois de congelarHash),
+   buscas em ordem embaralhada */
+static void bench_hash_buscar(BenchEstado *st) {
+    size_t n = BENCH_HASH_SLOTS * st->arg / 100;
+    const char **pistas = bench_nomes("pista", n);
+    const char **ausentes = bench_nomes("ausente", n);
+    const char **busca = (st->var & 1) ? ausentes : pistas;
+    const char *sus[16];
+    HashTable *ht = bench_hash_vazia(st->var >> 1);
+    bench_suspeitos(sus);
+    if (!pistas || !ausentes || !ht) {
+        st->erro = 1;
+    } else {
+        for (size_t i = 0; i < n; ++i) inserirNaHash(ht, pistas[i], sus[i & 15]);
+        if ((st->var >> 1) == 2 && congelarHash(ht) != 0) st->erro = 1;
+        bench_embaralhar(busca, n);
+    }
+    st->itens = n;
+    while (bench_continuar(st)) {
+        size_t achados = 0;
+        for (size_t i = 0; i < n; ++i) achados += encontrarSuspeito(ht, busca[i]) != NULL;
+        bench_sumidouro += achados;
+    }
+    if (ht) liberarHash(ht);
+    free((void *)pistas);
+    free((void *)ausentes);
+}
+
+/* contar_pistas_por_suspeito/n (BST com as n pistas) e, para comparar,
+   conjuntoContarPorSuspeito/n (var 1: bitset sobre o catálogo) */
+static void bench_contar(BenchEstado *st) {
+    BenchMansao m;
+    PistaNode *raiz = NULL;
+    Catalogo *cat = NULL;
+    ConjuntoPistas c;
+    uint32_t cont[16];
+    memset(&c, 0, sizeof(c));
+    if (bench_mansao(&m, st->arg) != 0) {
+        st->erro = 1;
+    } else if (st->var == 0) {
+        const char **seq = malloc(m.n * sizeof(char *));
+        if (seq) {
+            memcpy((void *)seq, m.pistas, m.n * sizeof(char *));
+            bench_embaralhar(seq, m.n);
+            for (size_t i = 0; i < m.n; ++i) raiz = inserirPista(raiz, seq[i]);
+        }
+        if (!seq || !raiz) st->erro = 1;
+        free((void *)seq);
+    } else {
+        Mapa mapa = mapaDeSalas(m.raiz);
+        cat = catalogoMontar(&mapa, m.ht);
+        if (!cat || conjuntoIniciar(&c, cat) != 0) st->erro = 1;
+        for (size_t i = 0; !st->erro && i < m.n; ++i) conjuntoInserir(&c, m.pistas[i], NULL);
+    }
+    st->itens = m.n;
+    while (bench_continuar(st)) {
+        if (st->var == 0) {
+            uint32_t *v = contar_pistas_por_suspeito(raiz, m.ht);
+            if (!v) st->erro = 1;
+            else bench_sumidouro += v[0];
+            mem_free(v);
+        } else {
+            conjuntoContarPorSuspeito(&c, cont);
+            bench_sumidouro += cont[0];
+        }
+    }
+    liberarPistas(raiz);
+    conjuntoLiberar(&c);
+    catalogoLiberar(cat);
+    bench_mansao_liberar(&m);
+}
+
+/* partida/<bst|bitset>/n: BENCH_PARTIDAS partidas gravadas (caminhada
+   aleatória até as folhas, 's' e acusação) numa mansão de n salas */
+#define BENCH_PARTIDAS 256
+static void bench_partidas(BenchEstado *st) {
+    BenchMansao m;
+    Catalogo *cat = NULL;
+    ConjuntoPistas c;
+    Saida *out = saidaMemoria();
+    Arena *partida = arena_criar(0);
+    char *roteiros = malloc(BENCH_PARTIDAS * 64);
+    Mapa mapa;
+    Sessao s;
+    ReplayStats rst;
+    memset(&c, 0, sizeof(c));
+    memset(&rst, 0, sizeof(rst));
+    if (bench_mansao(&m, st->arg) != 0 || !out || !partida || !roteiros) {
+        st->erro = 1;
+        mapa = mapaDeSalas(NULL);
+    } else {
+        mapa = mapaDeSalas(m.raiz);
+    }
+    sessaoPreparar(&s, out, &mapa, m.ht, partida, 1);
+    if (!st->erro && st->var == 1) {
+        cat = catalogoMontar(&mapa, m.ht);
+        if (!cat || conjuntoIniciar(&c, cat) != 0) st->erro = 1;
+        else s.colecao = &c;
+    }
+    size_t prof = 0;
+    while (((size_t)2 << prof) - 1 <= m.n) ++prof;
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; roteiros && i < BENCH_PARTIDAS; ++i) {
+        char *r = roteiros + i * 64;
+        size_t k = 0, movs = 1 + bench_aleatorio(&x) % (prof + 1);
+        for (size_t j = 0; j < movs && k < 40; ++j) r[k++] = (x >> (8 + j)) & 1 ? 'd' : 'e';
+        snprintf(r + k, 64 - k, "s:Suspeito %u", (unsigned)(x >> 60));
+    }
+    st->itens = BENCH_PARTIDAS;
+    while (bench_continuar(st)) {
+        for (size_t i = 0; i < BENCH_PARTIDAS; ++i) {
+            arena_reiniciar(partida);
+            if (replayPartida(&s, roteiros + i * 64, &rst) != 0) st->erro = 1;
+        }
+    }
+    bench_sumidouro += rst.vereditos[VEREDITO_CULPADO];
+    sessaoLiberar(&s);
+    conjuntoLiberar(&c);
+    catalogoLiberar(cat);
+    free(roteiros);
+    arena_liberar(partida);
+    saidaLiberar(out);
+    bench_mansao_liberar(&m);
+}
+
+/* retrato e restauração na mesma sessão devolvem as mesmas pistas e o
+   mesmo líder? (0 = sim) */
+static int bench_retrato_ida_volta(Sessao *s) {
+    const ConjuntoPistas *c = s->colecao;
+    size_t len, n = c->n, lider = s->lider;
+    unsigned char *blob = sessaoRetratar(s, &len);
+    uint32_t *ids = malloc((n ? n : 1) * sizeof(uint32_t));
+    int ret = -1;
+    if (blob && ids) {
+        memcpy(ids, c->ids, n * sizeof(uint32_t));
+        ret = sessaoRestaurar(s, blob, len) == 0 && c->n == n && s->lider == lider ? 0 : -1;
+        for (size_t i = 0; ret == 0 && i < n; ++i)
+            if (!(c->bits[ids[i] / 64] >> (ids[i] % 64) & 1)) ret = -1;
+    }
+    free(blob);
+    free(ids);
+    return ret;
+}
+
+/* retrato/<op>/n: partida até o penúltimo nível (com coleção); var:
+   0 = sessaoRetratar, 1 = sessaoRestaurar, 2 = sessaoBifurcar + um
+   movimento no filho (a primeira escrita copia os buffers divididos),
+   3 = ida e volta conferida com o bitset cruzando 128 bytes (o tamanho
+   dele passa a ocupar dois bytes de varint) */
+static void bench_retrato(BenchEstado *st) {
+    BenchMansao m;
+    Catalogo *cat = NULL;
+    ConjuntoPistas c, cf;
+    Saida *out = saidaMemoria();
+    Arena *partida = arena_criar(0);
+    Mapa mapa;
+    Sessao s, f;
+    unsigned char *blob = NULL;
+    size_t len = 0;
+    memset(&c, 0, sizeof(c));
+    if (bench_mansao(&m, st->arg) != 0 || !out || !partida) {
+        st->erro = 1;
+        mapa = mapaDeSalas(NULL);
+    } else {
+        mapa = mapaDeSalas(m.raiz);
+    }
+    sessaoPreparar(&s, out, &mapa, m.ht, partida, 1);
+    if (!st->erro) {
+        cat = catalogoMontar(&mapa, m.ht);
+        if (!cat || conjuntoIniciar(&c, cat) != 0) st->erro = 1;
+        else s.colecao = &c;
+    }
+    if (!st->erro && sessaoReiniciar(&s, NULL) == 0) {
+        uint64_t x = 0x9e3779b97f4a7c15ull;
+        const MapaOps *op = mapa.ops;
+        NoMapa e;
+        /* para uma sala antes da folha: o filho ainda tem para onde ir */
+        while ((e = op->esq(mapa.dados, s.atual)) && (op->esq(mapa.dados, e) || op->dir(mapa.dados, e)))
+            sessaoComando(&s, bench_aleatorio(&x) & 1 ? 'd' : 'e');
+        /* ids 936..1031: a lista (2 bytes por id) fica maior que o bitset,
+           que vai de 118 a 129 bytes */
+        for (uint32_t id = 936; st->var == 3 && !st->erro && id < 1032 && id < cat->n; ++id) {
+            if (sessao_coletar_id(&s, id) != 0) st->erro = 1;
+            else if (id >= 992 && bench_retrato_ida_volta(&s) != 0) st->falha = "retrato diverge";
+            if (st->falha) st->erro = 1;
+        }
+        blob = sessaoRetratar(&s, &len);
+    }
+    if (!blob) st->erro = 1;
+    while (!st->erro && bench_continuar(st)) {
+        if (st->var == 0) {
+            unsigned char *b = sessaoRetratar(&s, &len);
+            st->erro = !b;
+            free(b);
+        } else if (st->var == 1) {
+            st->erro = sessaoRestaurar(&s, blob, len) != 0;
+        } else if (st->var == 3) {
+            if (bench_retrato_ida_volta(&s) != 0) {
+                st->falha = "retrato diverge";
+                st->erro = 1;
+            }
+        } else {
+            st->erro = sessaoBifurcar(&f, &s, &cf) != 0;
+            if (!st->erro) {
+                sessaoComando(&f, 'e');
+                sessaoLiberar(&f);
+                conjuntoLiberar(&cf);
+            }
+        }
+    }
+    bench_sumidouro += len;
+    free(blob);
+    sessaoLiberar(&s);
+    conjuntoLiberar(&c);
+    catalogoLiberar(cat);
+    arena_liberar(partida);
+    saidaLiberar(out);
+    bench_mansao_liberar(&m);
+}
+
+/* gerarMansao/<forma>/n: geração completa (threads = núcleos disponíveis) */
+static void bench_gerar(BenchEstado *st) {
+    GeradorConfig cfg = { st->arg, (FormaMansao)st->var, 0.5, 8, 1, 0 };
+    st->itens = st->arg;
+    while (bench_continuar(st)) {
+        MansaoGerada *g = gerarMansao(&cfg);
+        bench_pausar(st);
+        if (!g) st->erro = 1;
+        liberarMansaoGerada(g);
+        bench_retomar(st);
+    }
+}
+
+/* resolverCaminhos/<forma>/n: todos os caminhos de uma mansão gerada, 1 thread */
+static void bench_resolver(BenchEstado *st) {
+    GeradorConfig cfg = { st->arg, (FormaMansao)st->var, 0.5, 8, 1, 0 };
+    MansaoGerada *g = gerarMansao(&cfg);
+    Mapa mapa;
+    if (!g) st->erro = 1;
+    else mapa = mapaDePlano(&g->plano);
+    st->itens = st->arg;
+    while (bench_continuar(st)) {
+        ResolverStats rst;
+        if (resolverCaminhos(&mapa, g->ht, 1, NULL, &rst) != 0) st->erro = 1;
+        else bench_sumidouro += rst.caminhos;
+        resolverLiberarStats(&rst);
+    }
+    liberarMansaoGerada(g);
+}
+
+static const BenchCaso bench_casos[] = {
+    { "criarSala/heap/1024", bench_criar_salas, 1024, 0 },
+    { "criarSala/heap/65536", bench_criar_salas, 65536, 0 },
+    { "criarSala/heap/1048576", bench_criar_salas, 1048576, 0 },
+    { "criarSala/arena/65536", bench_criar_salas, 65536, 1 },
+    { "criarSala/arena/1048576", bench_criar_salas, 1048576, 1 },
+    { "liberarSalas/1024", bench_liberar_salas, 1024, 0 },
+    { "liberarSalas/65536", bench_liberar_salas, 65536, 0 },
+    { "liberarSalas/1048576", bench_liberar_salas, 1048576, 0 },
+    { "inserirPista/aleatoria/1024", bench_inserir_pistas, 1024, 0 },
+    { "inserirPista/aleatoria/65536", bench_inserir_pistas, 65536, 0 },
+    { "inserirPista/ordenada/1024", bench_inserir_pistas, 1024, 1 },
+    { "inserirPista/ordenada/65536", bench_inserir_pistas, 65536, 1 },
+    { "inserirPista/duplicadas/1024", bench_inserir_pistas, 1024, 2 },
+    { "inserirPista/duplicadas/65536", bench_inserir_pistas, 65536, 2 },
+    { "inserirNaHash/encadeada/carga:50", bench_hash_inserir, 50, 0 },
+    { "inserirNaHash/encadeada/carga:100", bench_hash_inserir, 100, 0 },
+    { "inserirNaHash/encadeada/carga:200", bench_hash_inserir, 200, 0 },
+    { "inserirNaHash/encadeada/carga:400", bench_hash_inserir, 400, 0 },
+    { "inserirNaHash/aberta/carga:25", bench_hash_inserir, 25, 1 },
+    { "inserirNaHash/aberta/carga:50", bench_hash_inserir, 50, 1 },
+    { "inserirNaHash/aberta/carga:75", bench_hash_inserir, 75, 1 },
+    { "inserirNaHash/aberta/carga:87", bench_hash_inserir, 87, 1 },
+    { "encontrarSuspeito/encadeada/acerto/carga:50", bench_hash_buscar, 50, 0 },
+    { "encontrarSuspeito/encadeada/acerto/carga:100", bench_hash_buscar, 100, 0 },
+    { "encontrarSuspeito/encadeada/acerto/carga:200", bench_hash_buscar, 200, 0 },
+    { "encontrarSuspeito/encadeada/acerto/carga:400", bench_hash_buscar, 400, 0 },
+    { "encontrarSuspeito/encadeada/falha/carga:50", bench_hash_buscar, 50, 1 },
+    { "encontrarSuspeito/encadeada/falha/carga:100", bench_hash_buscar, 100, 1 },
+    { "encontrarSuspeito/encadeada/falha/carga:200", bench_hash_buscar, 200, 1 },
+    { "encontrarSuspeito/encadeada/falha/carga:400", bench_hash_buscar, 400, 1 },
+    { "encontrarSuspeito/aberta/acerto/carga:25", bench_hash_buscar, 25, 2 },
+    { "encontrarSuspeito/aberta/acerto/carga:50", bench_hash_buscar, 50, 2 },
+    { "encontrarSuspeito/aberta/acerto/carga:75", bench_hash_buscar, 75, 2 },
+    { "encontrarSuspeito/aberta/acerto/carga:87", bench_hash_buscar, 87, 2 },
+    { "encontrarSuspeito/aberta/falha/carga:25", bench_hash_buscar, 25, 3 },
+    { "encontrarSuspeito/aberta/falha/carga:50", bench_hash_buscar, 50, 3 },
+    { "encontrarSuspeito/aberta/falha/carga:75", bench_hash_buscar, 75, 3 },
+    { "encontrarSuspeito/aberta/falha/carga:87", bench_hash_buscar, 87, 3 },
+    { "encontrarSuspeito/perfeita/acerto/carga:50", bench_hash_buscar, 50, 4 },
+    { "encontrarSuspeito/perfeita/acerto/carga:100", bench_hash_buscar, 100, 4 },
+    { "encontrarSuspeito/perfeita/acerto/carga:200", bench_hash_buscar, 200, 4 },
+    { "encontrarSuspeito/perfeita/falha/carga:100", bench_hash_buscar, 100, 5 },
+    { "contar_pistas_por_suspeito/1024", bench_contar, 1024, 0 },
+    { "contar_pistas_por_suspeito/65536", bench_contar, 65536, 0 },
+    { "conjuntoContarPorSuspeito/1024", bench_contar, 1024, 1 },
+    { "conjuntoContarPorSuspeito/65536", bench_contar, 65536, 1 },
+    { "partida/bst/127", bench_partidas, 127, 0 },
+    { "partida/bst/65535", bench_partidas, 65535, 0 },
+    { "partida/bitset/127", bench_partidas, 127, 1 },
+    { "partida/bitset/65535", bench_partidas, 65535, 1 },
+    { "retrato/retratar/65535", bench_retrato, 65535, 0 },
+    { "retrato/restaurar/65535", bench_retrato, 65535, 1 },
+    { "retrato/bifurcar/65535", bench_retrato, 65535, 2 },
+    { "retrato/fronteira/2047", bench_retrato, 2047, 3 },
+    { "gerarMansao/balanceada/1048576", bench_gerar, 1048576, FORMA_BALANCEADA },
+    { "gerarMansao/degenerada/1048576", bench_gerar, 1048576, FORMA_DEGENERADA },
+    { "gerarMansao/aleatoria/1048576", bench_gerar, 1048576, FORMA_ALEATORIA },
+    { "resolverCaminhos/balanceada/65536", bench_resolver, 65536, FORMA_BALANCEADA },
+    { "resolverCaminhos/aleatoria/65536", bench_resolver, 65536, FORMA_ALEATORIA },
+};
+#define N_BENCH_CASOS (sizeof(bench_casos) / sizeof(bench_casos[0]))
+
+/* roda um caso aumentando as voltas até o tempo medido passar de
+   'tempo_min' (como o Google Benchmark: até 10x por rodada) */
+static int bench_caso_rodar(const BenchCaso *c, double tempo_min, BenchResultado *r) {
+    size_t iter = 1;
+    for (;;) {
+        BenchEstado st;
+        memset(&st, 0, sizeof(st));
+        st.arg = c->arg;
+        st.var = c->var;
+        st.iteracoes = iter;
+        c->corpo(&st);
+        if (st.erro) {
+            r->falha = st.falha;
+            return -1;
+        }
+        if (st.real >= tempo_min || iter >= BENCH_MAX_ITER) {
+            r->nome = c->nome;
+            r->iteracoes = iter;
+            r->real_ns = st.real * 1e9 / (double)iter;
+            r->cpu_ns = st.cpu * 1e9 / (double)iter;
+            r->itens_s = st.itens && st.real > 0 ? (double)st.itens * (double)iter / st.real : 0;
+            return 0;
+        }
+        double mult = st.real > tempo_min / 10 ? tempo_min * 1.4 / st.real : 10;
+        size_t prox = (size_t)((double)iter * (mult < 10 ? mult : 10));
+        iter = prox > iter ? (prox < BENCH_MAX_ITER ? prox : BENCH_MAX_ITER) : iter + 1;
+    }
+}
+
+/* string JSON com as aspas e os escapes obrigatórios */
+static void bench_json_texto(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') fprintf(f, "\\%c", ch);
+        else if (ch < 0x20) fprintf(f, "\\u%04x", ch);
+        else fputc(ch, f);
+    }
+    fputc('"', f);
+}
+
+/* mesmo formato do --benchmark_out=json do Google Benchmark: as ferramentas
+   de comparação entre versões (compare.py) leem direto */
+static void bench_json(FILE *f, const char *executavel, const BenchResultado *r, size_t n) {
+    char data[64] = "", host[256] = "desconhecido";
+    time_t t = time(NULL);
+#ifdef DQ_POSIX
+    struct tm tm;
+    if (gethostname(host, sizeof(host)) != 0) strcpy(host, "desconhecido");
+    host[sizeof(host) - 1] = '\0';
+    if (localtime_r(&t, &tm)) strftime(data, sizeof(data), "%Y-%m-%dT%H:%M:%S%z", &tm);
+#else
+    struct tm *lt = localtime(&t);
+    if (lt) strftime(data, sizeof(data), "%Y-%m-%dT%H:%M:%S", lt);
+#endif
+    fprintf(f, "{\n  \"context\": {\n    \"date\": ");
+    bench_json_texto(f, data);
+    fprintf(f, ",\n    \"host_name\": ");
+    bench_json_texto(f, host);
+    fprintf(f, ",\n    \"executable\": ");
+    bench_json_texto(f, executavel);
+    fprintf(f, ",\n    \"num_cpus\": %d,\n", nucleos_disponiveis());
+#ifdef __OPTIMIZE__
+    fprintf(f, "    \"library_build_type\": \"release\",\n");
+#else
+    fprintf(f, "    \"library_build_type\": \"debug\",\n");
+#endif
+    fprintf(f, "    \"nucleos_texto\": \"%s\",\n    \"json_schema_version\": 1\n  },\n"
+               "  \"benchmarks\": [", nucleosTexto()->nome);
+    for (size_t i = 0; i < n; ++i) {
+        fprintf(f, "%s\n    {\n      \"name\": ", i ? "," : "");
+        bench_json_texto(f, r[i].nome);
+        fprintf(f, ",\n      \"family_index\": %zu,\n      \"per_family_instance_index\": 0,\n"
+                   "      \"run_name\": ", i);
+        bench_json_texto(f, r[i].nome);
+        fprintf(f, ",\n      \"run_type\": \"iteration\",\n      \"repetitions\": 1,\n"
+                   "      \"repetition_index\": 0,\n      \"threads\": 1,\n"
+                   "      \"iterations\": %zu,\n      \"real_time\": %.6e,\n"
+                   "      \"cpu_time\": %.6e,\n      \"time_unit\": \"ns\"",
+                r[i].iteracoes, r[i].real_ns, r[i].cpu_ns);
+        if (r[i].itens_s > 0) fprintf(f, ",\n      \"items_per_second\": %.6e", r[i].itens_s);
+        fprintf(f, "\n    }");
+    }
+    fprintf(f, "%s]\n}\n", n ? "\n  " : "");
+}
+
+/* itens/s com sufixo, como no console do Google Benchmark */
+static void bench_vazao_texto(char *buf, size_t cap, double v) {
+    static const char suf[] = " kMG";
+    int k = 0;
+    while (v >= 1000 && k < 3) {
+        v /= 1000;
+        ++k;
+    }
+    snprintf(buf, cap, "itens/s=%.4g%c", v, suf[k]);
+}
+
+/**
+ * benchSuite(filtro, arq_json, tempo_min, executavel)
+ * Roda os casos registrados em bench_casos cujo nome contém 'filtro' (NULL =
+ * todos), cada um por pelo menos 'tempo_min' segundos, e mostra a tabela no
+ * stdout. Com 'arq_json', grava também o JSON no formato do Google Benchmark
+ * ("-" = stdout; a tabela vai então para stderr). Retorna 0 em sucesso.
+ */
+int benchSuite(const char *filtro, const char *arq_json, double tempo_min, const char *executavel) {
+    int json_stdout = arq_json && strcmp(arq_json, "-") == 0;
+    FILE *con = json_stdout ? stderr : stdout;
+    BenchResultado *r = malloc(N_BENCH_CASOS * sizeof(BenchResultado));
+    size_t n = 0;
+    int ret = 0;
+    if (!r) return -1;
+    fprintf(con, "Rodando %s\n%d núcleo(s), núcleos de texto %s, tempo mínimo %.2f s por caso\n",
+            executavel, nucleos_disponiveis(), nucleosTexto()->nome, tempo_min);
+    fprintf(con, "%-48s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    fprintf(con, "----------------------------------------------------------------------"
+                 "----------------------\n");
+    for (size_t i = 0; i < N_BENCH_CASOS; ++i) {
+        if (filtro && !strstr(bench_casos[i].nome, filtro)) continue;
+        fflush(con);
+        r[n].falha = NULL;
+        if (bench_caso_rodar(&bench_casos[i], tempo_min, &r[n]) != 0) {
+            fprintf(con, "%-48s ERRO: %s\n", bench_casos[i].nome,
+                    r[n].falha ? r[n].falha : "memória insuficiente");
+            ret = -1;
+            continue;
+        }
+        char vazao[32] = "";
+        if (r[n].itens_s > 0) bench_vazao_texto(vazao, sizeof(vazao), r[n].itens_s);
+        fprintf(con, "%-48s %12.0f ns %12.0f ns %12zu %s\n", r[n].nome, r[n].real_ns,
+                r[n].cpu_ns, r[n].iteracoes, vazao);
+        ++n;
+    }
+    if (arq_json) {
+        FILE *f = json_stdout ? stdout : fopen(arq_json, "w");
+        if (!f) {
+            fprintf(stderr, "Erro: não foi possível criar '%s'.\n", arq_json);
+            ret = -1;
+        } else {
+            bench_json(f, executavel, r, n);
+            if (fflush(f) != 0) ret = -1;
+            if (f != stdout && fclose(f) != 0) ret = -1;
+        }
+    }
+    free(r);
+    return ret;
+}
+
+/* ===========================
+   Caso de demonstração e main
+   =========================== */
+
+/**
+ * montarCasoDemo(arena, raiz, ht)
+ * Monta o mapa fixo (árvore binária de salas) e a tabela pista -> suspeito.
+ * Com arena != NULL, salas, entradas e strings vêm da arena: a liberação é
+ * apenas arena_liberar + liberarHash (que então só libera os baldes).
+ * Retorna 0 em sucesso.
+ */
+int montarCasoDemo(Arena *arena, Sala **raiz, HashTable **ht) {
+    Sala *hall = criarSalaEm(arena, "Hall de Entrada", "Pegadas de lama");
+    Sala *salaEstar = criarSalaEm(arena, "Sala de Estar", "Livro com página faltando");
+    Sala *corredor = criarSalaEm(arena, "Corredor", NULL);
+    Sala *cozinha = criarSalaEm(arena, "Cozinha", "Chave perdida");
+    Sala *biblioteca = criarSalaEm(arena, "Biblioteca", NULL);
+    Sala *quarto = criarSalaEm(arena, "Quarto", "Lençol manchado");
+    Sala *jardim = criarSalaEm(arena, "Jardim", "Gaveta perdida");
+    if (!hall || !salaEstar || !corredor || !cozinha || !biblioteca || !quarto || !jardim)
+        return -1;
+
+    /* conectar nós (fixo) */
+    hall->esq = salaEstar;
+    hall->dir = corredor;
+    salaEstar->esq = cozinha;
+    salaEstar->dir = biblioteca;
+    corredor->esq = quarto;
+    corredor->dir = jardim;
+
+    /* criar tabela hash e inserir associações pista -> suspeito */
+    HashTable *h = criarHashEm(arena, 31); /* 31 buckets é suficiente para este exemplo */
+    if (!h) return -1;
+
+    /* Inserir associações (pré-definidas pela lógica do jogo) */
+    inserirNaHash(h, "Pegadas de lama", "Jardineiro");
+    inserirNaHash(h, "Gaveta perdida", "Jardineiro");
+    inserirNaHash(h, "Chave perdida", "Empregado");
+    inserirNaHash(h, "Lençol manchado", "Empregado");
+    inserirNaHash(h, "Livro com página faltando", "Bibliotecário");
+    /* você pode adicionar mais pistas↔suspeitos aqui */
+
+    *raiz = hall;
+    *ht = h;
+    return 0;
+}
+
+/* --mem: monta o caso no heap e na arena e compara os contadores */
+static void relatorio_memoria_demo(void) {
+    Sala *raiz = NULL;
+    HashTable *ht = NULL;
+    MemStats inicio = mem_heap;
+
+    arena_relatorio("antes (heap)", NULL);
+    if (montarCasoDemo(NULL, &raiz, &ht) == 0) {
+        arena_relatorio("montado (heap)", NULL);
+        liberarHash(ht);
+        liberarSalas(raiz);
+        arena_relatorio("liberado (heap)", NULL);
+    }
+
+    mem_heap = inicio;
+    Arena *a = arena_criar(0);
+    arena_relatorio("antes (arena)", a);
+    if (a && montarCasoDemo(a, &raiz, &ht) == 0) {
+        arena_relatorio("montado (arena)", a);
+        liberarHash(ht);
+        arena_relatorio("liberado (arena, antes de arena_liberar)", a);
+    }
+    arena_liberar(a);
+    interner_relatorio(interner_global);
+    interner_liberar(interner_global);
+    mem_heap = inicio;
+}
+
+/* --salvar-caso / --gerar-c: grava o caso montado; 0 em sucesso, 1 em erro */
+static int gravar_caso(const char *arq_salvar, const char *arq_c, const MapaPlano *plano,
+                       HashTable *ht) {
+    if (arq_salvar) {
+        if (casoSalvar(arq_salvar, plano, ht) != 0) return 1;
+        printf("Caso gravado em '%s'.\n", arq_salvar);
+    }
+    if (arq_c) {
+        if (casoGerarC(arq_c, plano, ht) != 0) return 1;
+        printf("Fonte do caso gravado em '%s'.\n", arq_c);
+    }
+    return 0;
+}
+
+/* --carga: roteiros de --replay / --replay-arquivo (ou aleatórios, sem
+   acusação) contra o servidor em 'endereco'; 0 em sucesso, 1 em erro */
+static int rodar_carga(const char *endereco, size_t conexoes, const char *movs,
+                       const char *arquivo, size_t por_conexao, int n_threads) {
+    enum { N_ALEATORIAS = 1024 };
+    Arena *a = arena_criar(0);
+    const char **partidas = NULL;
+    size_t n = 0;
+    int ret = 1;
+    if (!a) return 1;
+    if (arquivo) {
+        partidas = carregar_partidas(arquivo, a, &n);
+    } else if (movs) {
+        if ((partidas = malloc(sizeof(char *)))) partidas[n++] = movs;
+    } else if ((partidas = malloc(N_ALEATORIAS * sizeof(char *)))) {
+        /* até 12 movimentos, como em benchSessoes */
+        uint64_t x = 0x9e3779b97f4a7c15ull;
+        for (; n < N_ALEATORIAS; ++n) {
+            char buf[16];
+            size_t k = 0;
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            for (size_t movs_n = 1 + x % 12; k < movs_n; ++k)
+                buf[k] = (x >> (8 + 2 * k)) & 1 ? 'd' : 'e';
+            buf[k] = '\0';
+            if (!(partidas[n] = arena_strdup(a, buf))) break;
+        }
+    }
+    if (partidas && n)
+        ret = clienteCarga(endereco, conexoes, partidas, n, por_conexao, n_threads) == 0 ? 0 : 1;
+    free((void *)partidas);
+    arena_liberar(a);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    int usar_plano = 0, conferir = 0, quieto = 0;
+    const char *arq_caso = NULL, *arq_salvar = NULL, *arq_importar = NULL;
+    const char *replay_movs = NULL, *arq_replay = NULL, *arq_saida = NULL;
+    const char *arq_historico = NULL, *arq_c = NULL;
+    int contadores = 0, congelar = 0, compactar = 0;
+    size_t residentes = 0, pegada = 0;
+    size_t repeticoes = 1, bench_sessoes = 0, bench_lote = 0;
+    int n_threads = 0, resolver = 0, suite = 0, porta = 0;
+    const char *endereco_carga = NULL;
+    size_t conexoes = 100;
+    const char *bench_filtro = NULL, *bench_json_arq = NULL;
+    double bench_tempo = 0.2;
+    GeradorConfig gerar = { 0, FORMA_ALEATORIA, 0.5, 8, 1, 0 };
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--plano") == 0) {
+            usar_plano = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--caso") == 0 && i + 1 < argc) {
+            arq_caso = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--importar") == 0 && i + 1 < argc) {
+            arq_importar = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--salvar-caso") == 0 && i + 1 < argc) {
+            arq_salvar = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--gerar-c") == 0 && i + 1 < argc) {
+            /* fonte C do caso para compilar com -DDQ_CASO_EMBUTIDO */
+            arq_c = argv[++i];
+            congelar = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_movs = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--replay-arquivo") == 0 && i + 1 < argc) {
+            arq_replay = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--repetir") == 0 && i + 1 < argc) {
+            repeticoes = strtoul(argv[++i], NULL, 10);
+            continue;
+        }
+        if (strcmp(argv[i], "--saida") == 0 && i + 1 < argc) {
+            arq_saida = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--historico-arquivo") == 0 && i + 1 < argc) {
+            arq_historico = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--sob-demanda") == 0 && i + 1 < argc) {
+            /* --caso / --gerar com no máximo N salas na memória */
+            residentes = strtoul(argv[++i], NULL, 10);
+            if (residentes == 0) residentes = SOB_RESIDENTES_PADRAO;
+            continue;
+        }
+        if (strcmp(argv[i], "--contadores") == 0 && i + 1 < argc) {
+            /* relatório em stderr no fim (e em SIGUSR1): json ou prom */
+            const char *f = argv[++i];
+#ifndef DQ_INSTRUMENTAR
+            fprintf(stderr, "Erro: contadores desligados (compile com -DDQ_INSTRUMENTAR).\n");
+            return 1;
+#endif
+            if (strcmp(f, "json") == 0) contadores = 1;
+            else if (strcmp(f, "prom") == 0) contadores = 2;
+            else {
+                fprintf(stderr, "Erro: formato '%s' (json ou prom).\n", f);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--servidor") == 0 && i + 1 < argc) {
+            /* partidas pela rede (ver servidorJogo) até SIGINT/SIGTERM */
+            porta = atoi(argv[++i]);
+            if (porta <= 0 || porta > 65535) {
+                fprintf(stderr, "Erro: porta inválida '%s'.\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--carga") == 0 && i + 1 < argc) {
+            /* cliente de carga: HOST:PORTA de um --servidor */
+            endereco_carga = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--conexoes") == 0 && i + 1 < argc) {
+            conexoes = strtoul(argv[++i], NULL, 10);
+            continue;
+        }
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            n_threads = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--gerar") == 0 && i + 1 < argc) {
+            gerar.salas = strtoul(argv[++i], NULL, 10);
+            if (gerar.salas == 0) {
+                fprintf(stderr, "Erro: --gerar precisa de um número de salas.\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--forma") == 0 && i + 1 < argc) {
+            const char *f = argv[++i];
+            if (strcmp(f, "balanceada") == 0) gerar.forma = FORMA_BALANCEADA;
+            else if (strcmp(f, "degenerada") == 0) gerar.forma = FORMA_DEGENERADA;
+            else if (strcmp(f, "aleatoria") == 0) gerar.forma = FORMA_ALEATORIA;
+            else {
+                fprintf(stderr, "Erro: forma '%s' (balanceada, degenerada ou aleatoria).\n", f);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--densidade") == 0 && i + 1 < argc) {
+            gerar.densidade = strtod(argv[++i], NULL);
+            continue;
+        }
+        if (strcmp(argv[i], "--suspeitos") == 0 && i + 1 < argc) {
+            gerar.suspeitos = (uint32_t)strtoul(argv[++i], NULL, 10);
+            continue;
+        }
+        if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            gerar.semente = strtoull(argv[++i], NULL, 0);
+            continue;
+        }
+        if (strcmp(argv[i], "--bench-sessoes") == 0) {
+            size_t n = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 10) : 0;
+            if (n) ++i;
+            bench_sessoes = n ? n : 1000000;
+            continue;
+        }
+        if (strcmp(argv[i], "--bench-lote") == 0) {
+            size_t n = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 10) : 0;
+            if (n) ++i;
+            bench_lote = n ? n : 10000000;
+            continue;
+        }
+        if (strcmp(argv[i], "--resolver") == 0) {
+            resolver = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--resolver-caminhos") == 0) {
+            resolver = 2;
+            continue;
+        }
+        if (strcmp(argv[i], "--quiet") == 0) {
+            quieto = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--conferir") == 0) {
+            conferir = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--congelar") == 0) {
+            /* hash perfeita depois de montar o caso (também no --salvar-caso) */
+            congelar = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--compacto") == 0) {
+            /* salas de 16 bytes com ids de pista na hash perfeita (ver mapaCompactar) */
+            compactar = 1;
+            congelar = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--pegada") == 0) {
+            /* bytes por estrutura do caso e projeção para N salas */
+            size_t n = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 10) : 0;
+            if (n) ++i;
+            pegada = n ? n : 100000000;
+            continue;
+        }
+        if (strcmp(argv[i], "--mem") == 0) {
+            relatorio_memoria_demo();
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-hash-concorrente") == 0) {
+            size_t n = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 10) : 0;
+            bench_hash_concorrente(n ? n : 100000);
+            interner_liberar(interner_global);
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench") == 0) {
+            /* filtro opcional: só os casos cujo nome contém o texto */
+            suite = 1;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) bench_filtro = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--bench-json") == 0 && i + 1 < argc) {
+            suite = 1;
+            bench_json_arq = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--bench-tempo") == 0 && i + 1 < argc) {
+            bench_tempo = strtod(argv[++i], NULL);
+            continue;
+        }
+        if (strcmp(argv[i], "--bench-texto") == 0) {
+            size_t n = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 10) : 0;
+            bench_texto(n ? n : 10000);
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-hash-funcs") == 0) {
+            size_t n = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 10) : 0;
+            bench_funcoes_hash(n ? n : 100000);
+            interner_liberar(interner_global);
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-hash") == 0) {
+            size_t n = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 10) : 0;
+            bench_hash(n ? n : 50000);
+            interner_liberar(interner_global);
+            return 0;
+        }
+        fprintf(stderr, "Opção desconhecida: %s\n", argv[i]);
+        return 1;
+    }
+    if (contadores) instrSinal(contadores == 2);
+    if (suite) {
+        int r = benchSuite(bench_filtro, bench_json_arq, bench_tempo > 0 ? bench_tempo : 0.2,
+                           argv[0]) == 0 ? 0 : 1;
+        interner_liberar(interner_global);
+        if (contadores && instrRelatorio(stderr, contadores == 2) != 0) r = 1;
+        return r;
+    }
+    if (endereco_carga) {
+        /* --repetir: partidas por conexão; o mapa fica com o servidor */
+        int r = rodar_carga(endereco_carga, conexoes, replay_movs, arq_replay, repeticoes,
+                            n_threads > 0 ? n_threads : 1);
+        if (contadores && instrRelatorio(stderr, contadores == 2) != 0) r = 1;
+        return r;
+    }
+
+    /* todo o estado do jogo (salas, hash, pistas) fica na arena da partida */
+    Arena *jogo = arena_criar(0);
+    Sala *hall = NULL;
+    HashTable *ht = NULL;
+    MapaPlano *plano = NULL, *embutido = NULL;
+    CasoArquivo *caso = NULL;
+    MansaoGerada *gerada = NULL;
+    MapaSob *sob = NULL;
+    MapaCompacto *compacto = NULL;
+    ResumoMapa *resumo = NULL;
+    FILE *f_saida = NULL, *f_historico = NULL;
+    Saida *out = NULL;
+    Mapa mapa;
+    int ret = 1;
+    if (!jogo) goto fim;
+
+    /* texto do jogo: stdout ou o arquivo de --saida */
+    if (arq_saida) {
+        f_saida = fopen(arq_saida, "wb");
+        if (!f_saida) {
+            fprintf(stderr, "Erro: não foi possível criar '%s'.\n", arq_saida);
+            goto fim;
+        }
+        out = saidaArquivo(f_saida);
+    } else {
+        out = saidaPadrao();
+    }
+    if (!out) goto fim;
+    /* partidas longas: o caminho passa do buffer para este arquivo */
+    if (arq_historico) {
+        f_historico = fopen(arq_historico, "w+b");
+        if (!f_historico) {
+            fprintf(stderr, "Erro: não foi possível criar '%s'.\n", arq_historico);
+            goto fim;
+        }
+    }
+
+    if (residentes && (arq_caso || gerar.salas)) {
+        /* salas lidas (ou geradas) só quando a exploração chega nelas */
+        if (arq_salvar || arq_c || bench_sessoes || bench_lote || resolver || porta ||
+            compactar || pegada || n_threads > 0) {
+            fprintf(stderr, "Erro: --sob-demanda só vale para o jogo e o replay sequencial.\n");
+            goto fim;
+        }
+        if (congelar) {
+            fprintf(stderr, "Erro: --congelar não vale com --sob-demanda (a hash cresce no jogo).\n");
+            goto fim;
+        }
+        sob = arq_caso ? mapaSobDemandaArquivo(arq_caso, residentes)
+                       : mapaSobDemandaGerado(&gerar, residentes);
+        if (!sob) goto fim;
+        mapa = mapaDeSobDemanda(sob);
+        ht = mapaSobHash(sob);
+    } else if (arq_caso) {
+        /* caso gravado: mapa e hash leem direto do arquivo mapeado */
+        caso = casoAbrir(arq_caso);
+        if (!caso) goto fim;
+        if (conferir && casoConferir(caso) != 0) {
+            fprintf(stderr, "Erro: '%s' tem offsets ou salas inválidos.\n", arq_caso);
+            goto fim;
+        }
+        mapa = mapaDePlano(&caso->plano);
+        ht = caso->ht;
+        if (congelar && congelarHash(ht) != 0) goto fim;
+        if (arq_salvar || arq_c) {
+            ret = gravar_caso(arq_salvar, arq_c, &caso->plano, ht);
+            goto fim;
+        }
+    } else if (gerar.salas) {
+        /* mansão procedural: já no layout plano, com a hash pronta */
+        gerar.threads = n_threads;
+        gerada = gerarMansao(&gerar);
+        if (!gerada) goto fim;
+        gerarRelatorio(&gerar, gerada);
+        ht = gerada->ht;
+        if (congelar && congelarHash(ht) != 0) goto fim;
+        if (arq_salvar || arq_c) {
+            ret = gravar_caso(arq_salvar, arq_c, &gerada->plano, ht);
+            goto fim;
+        }
+        mansaoSoltar(gerada, 0);
+        mapa = mapaDePlano(&gerada->plano);
+    } else if (!arq_importar && casoEmbutido(&embutido, &ht) == 0) {
+        /* caso compilado no executável: nada a montar (a hash já é perfeita) */
+        if (arq_salvar || arq_c) {
+            ret = gravar_caso(arq_salvar, arq_c, embutido, ht);
+            goto fim;
+        }
+        mapa = mapaDePlano(embutido);
+    } else {
+        if (arq_importar) {
+            ImportStats st;
+            int r = importarCaso(arq_importar, jogo, &hall, &ht, &st);
+            importRelatorio(&st);
+            if (r != 0) goto fim;
+        } else if (montarCasoDemo(jogo, &hall, &ht) != 0) {
+            fprintf(stderr, "Erro: falha ao montar o caso.\n");
+            goto fim;
+        }
+        if (congelar && congelarHash(ht) != 0) goto fim;
+        if (usar_plano || arq_salvar || arq_c) {
+            /* mesma mansão no layout plano (vetor único + pool de strings) */
+            plano = mapaPlanoDeSalas(hall);
+            if (!plano) goto fim;
+        }
+        if (arq_salvar || arq_c) {
+            ret = gravar_caso(arq_salvar, arq_c, plano, ht);
+            goto fim;
+        }
+        mapa = plano ? mapaDePlano(plano) : mapaDeSalas(hall);
+    }
+
+    if (compactar) {
+        /* a cópia compacta substitui o mapa; o plano gerado não é mais lido */
+        compacto = mapaCompactar(&mapa, ht);
+        if (!compacto) goto fim;
+        mapa = mapaDeCompacto(compacto);
+        if (gerada) mansaoSoltar(gerada, 1);
+    }
+    if (pegada) {
+        ret = pegadaRelatorio(&mapa, ht, pegada) == 0 ? 0 : 1;
+        goto fim;
+    }
+    if (porta) {
+        ret = servidorJogo(&mapa, ht, porta, n_threads > 0 ? n_threads : 1) == 0 ? 0 : 1;
+        goto fim;
+    }
+    if (bench_sessoes) {
+        ret = benchSessoes(&mapa, ht, bench_sessoes, n_threads) == 0 ? 0 : 1;
+        goto fim;
+    }
+    if (bench_lote) {
+        ret = benchLote(&mapa, ht, bench_lote, n_threads) == 0 ? 0 : 1;
+        goto fim;
+    }
+    if (resolver) {
+        /* todos os caminhos; com --resolver-caminhos, um por linha na saída */
+        ResolverStats rst;
+        ret = resolverCaminhos(&mapa, ht, n_threads, resolver == 2 ? out : NULL, &rst) == 0 ? 0 : 1;
+        saidaDescarregar(out);
+        if (ret == 0) resolverRelatorio(&rst, ht);
+        resolverLiberarStats(&rst);
+        goto fim;
+    }
+    if ((replay_movs || arq_replay) && n_threads > 0) {
+        /* em paralelo as partidas são sempre silenciosas */
+        ret = executarReplayParalelo(&mapa, ht, replay_movs, arq_replay, repeticoes,
+                                     n_threads) == 0 ? 0 : 1;
+        goto fim;
+    }
+    if (replay_movs || arq_replay) {
+        ret = executarReplay(out, &mapa, ht, replay_movs, arq_replay, repeticoes, quieto,
+                             f_historico) == 0 ? 0 : 1;
+        goto fim;
+    }
+
+    /* dicas: o resumo só é montado no primeiro 'p' (mapas sob demanda não têm) */
+    DicasAdiadas dicas = { &mapa, ht, NULL, 0 };
+    saida_lit(out, "=== Detective Quest: Modo Mestre ===\n"
+                   "Explore a mansão e colete pistas. No final, acuse um suspeito.\n");
+    saida_texto(out, sob ? "Comandos: 'e' (esquerda), 'd' (direita), 's' (sair)\n"
+                         : "Comandos: 'e' (esquerda), 'd' (direita), 'p' (dica), 's' (sair)\n");
+
+    /* BST de pistas coletadas começa vazia; as pistas ficam na arena do jogo */
+    Sessao sessao;
+    sessaoPreparar(&sessao, out, &mapa, ht, jogo, 0);
+    sessaoDerramar(&sessao, f_historico);
+    if (!sob) sessao.dicas = &dicas;
+    INSTR_FASE(t_explorar);
+    if (sessaoReiniciar(&sessao, NULL) == 0) jogarSessao(&sessao);
+    INSTR_FASE_FIM(t_explorar, CONT_NS_EXPLORACAO);
+
+    INSTR_FASE(t_veredito);
+    verificarSuspeitoSessao(&sessao);
+    INSTR_FASE_FIM(t_veredito, CONT_NS_VEREDITO);
+    sessaoLiberar(&sessao);
+    resumo = dicas.resumo;
+
+    saida_lit(out, "\nFim do jogo. Obrigado por jogar (console version).\n");
+    ret = 0;
+
+fim:
+    /* liberar toda memória usada: a arena possui salas, entradas e pistas */
+    saidaDescarregar(out);
+    INSTR_FASE(t_liberar);
+    if (out && out->erro) ret = 1;
+    saidaLiberar(out);
+    if (f_saida && fclose(f_saida) != 0) ret = 1;
+    if (f_historico) fclose(f_historico);
+    resumoLiberar(resumo);
+    if (sob) mapaSobRelatorio(sob);
+    liberarMapaCompacto(compacto);
+    if (caso) casoFechar(caso);
+    else if (gerada) liberarMansaoGerada(gerada);
+    else if (sob) liberarMapaSob(sob);
+    else if (embutido) casoEmbutidoLiberar();
+    else liberarHash(ht);
+    liberarMapaPlano(plano);
+    arena_liberar(jogo);
+    interner_liberar(interner_global);
+    INSTR_FASE_FIM(t_liberar, CONT_NS_LIBERACAO);
+    if (contadores && instrRelatorio(stderr, contadores == 2) != 0) ret = 1;
+    return ret;
 }